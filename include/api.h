@@ -166,6 +166,8 @@ enum
     MSG_MAC_DOT11_ChanSwitchWaitForTX           = 397,
 	MSG_MAC_DOT11_ChanSwitchSinrProbe		    = 398,
 	MSG_MAC_DOT11_ChanSwitchTimerExpired	    = 399,
+    // Kernel timer of the per-interface DOT11 timer wheel
+    MSG_MAC_DOT11_TimerWheelExpired             = 348,
 //---------------------------Power-Save-Mode-Updates---------------------//
     MSG_BATTERY_TimerExpired                   = 334,
     MSG_MAC_DOT11_ATIMWindowTimerExpired       = 338,
@@ -220,6 +222,7 @@ enum
 #ifdef MILITARY_RADIOS_LIB
     MSG_EPLRS_DelayedSendToMac                 = 418,
 #endif
+    MSG_NETWORK_IpFragmentTimer                = 419,
 
     MSG_NETWORK_JoinGroup                      = 420,
     MSG_NETWORK_LeaveGroup                     = 421,
@@ -227,6 +230,7 @@ enum
     MSG_NETWORK_SendRequest                    = 423,
     MSG_NETWORK_SendReply                      = 424,
     MSG_NETWORK_CheckFg                        = 425,
+    MSG_NETWORK_ChanswitchQueueCheck           = 426,
 
     MSG_NETWORK_Retx                           = 430,
 
@@ -573,6 +577,7 @@ enum
     MSG_MAC_DOT11s_PannPropagationTimeout      = 1139,
     MSG_MAC_DOT11s_LinkStateFrameTimeout       = 1140,
     MSG_MAC_DOT11s_QueueAgingTimer             = 1141,
+    MSG_MAC_DOT11s_ChannelSwitchTimer          = 1142,
 
 /* Message Types Added Via Designer */
 
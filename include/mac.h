@@ -1908,8 +1908,10 @@ typedef struct struct_random_fault
 typedef struct dot11_visible_node_str{
     int channelId;
     Mac802Address bssAddr;
-    double signalStrength;
+    double signalStrength;      // RSS in dBm, smoothed over numSamples
     BOOL isAP;
+    int numSamples;
+    clocktype lastSeenTime;
     struct dot11_visible_node_str* next;
 
 }DOT11_VisibleNodeInfo;
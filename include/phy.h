@@ -638,6 +638,20 @@ int PHY_GetRxDataRateType(Node *node, int phyIndex);
 // **/
 void PHY_SetTxDataRateType(Node *node, int phyIndex, int dataRateType);
 
+// /**
+// API            :: PHY_SetTxAggregation
+// LAYER          :: Physical
+// PURPOSE        :: Mark the next transmitted frame as an A-MPDU, so that
+//                   the receiving PHY leaves the error draw of its
+//                   subframes to the MAC
+// PARAMETERS     ::
+// + node          : Node *      : node pointer to node
+// + phyIndex      : int         : interface index
+// + isAggregate   : BOOL        : whether the next frame is an A-MPDU
+// RETURN         :: void :
+// **/
+void PHY_SetTxAggregation(Node *node, int phyIndex, BOOL isAggregate);
+
 // /**
 // API            :: PHY_GetLowestTxDataRateType
 // LAYER          :: Physical
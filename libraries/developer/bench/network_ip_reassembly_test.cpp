@@ -0,0 +1,554 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Standalone check of the IP reassembly queues (network_ip-reassembly.h)
+ * for timeout, eviction, and fragments of different datagrams that
+ * share an IP ID.
+ *
+ * Fragments go through the steps IpFragmentInput takes with the
+ * queues: expire the queues whose hold time has passed, find the
+ * queue of the datagram, evict the oldest other queues until the
+ * fragment fits in the reassembly buffer (dropping the datagram if it
+ * still does not), create the queue if there is none, and charge the
+ * fragment to the buffer. A datagram is reassembled when its queue
+ * holds all its payload. A plain array of queues in creation order,
+ * searched linearly, takes the same steps as the reference.
+ *
+ * Three runs, all datagrams with IP ID 0x1234 to one destination:
+ *   interleave  64 sources send a TCP and a UDP datagram each, of a
+ *               size of their own, in 4 fragments; the 512 fragments
+ *               arrive shuffled. The TCP datagrams share one hash
+ *               bucket, and so do the UDP ones
+ *   timeout     a datagram every 500 ms from 100 sources, 3 of 4
+ *               fragments at once; even sources send the last 10 s
+ *               later, odd ones never do
+ *   eviction    a 16 KB buffer; 64 sources, 8 at a time, send 4 1 KB
+ *               fragments interleaved, then one source a datagram of
+ *               20 fragments, larger than the buffer
+ *
+ * The test exits with 1 if, after any fragment, the queues differ from
+ * the reference in order, key, bytes or hold time; a queue is not
+ * found under its own key; the buffer holds more than its size; a
+ * datagram is reassembled from another one's fragments; or the counts
+ * of a run differ from the reference's.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       network_ip_reassembly_test.cpp -o network_ip_reassembly_test
+ *
+ * Reference run:
+ *
+ *  run         datagrams  reassembled  timeouts  evictions  dropped  max buffered
+ *  interleave        128          128         0          0        0        143368
+ *  timeout           100           50        50          0        0         40432
+ *  eviction           65           16         1         97        1         15660
+ *
+ * Queues left at the end time out; evictions include the one drop.
+ * In the eviction run, only the last two datagrams of each group of 8
+ * complete; the others are evicted, some more than once, since their
+ * later fragments start new queues. The large datagram is dropped at
+ * its 16th fragment, and its last 4 start a queue that times out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api.h"
+#include "network_ip-reassembly.h"
+
+#define TEST_ID                 0x1234
+#define TEST_DESTINATION        0x0A0000FE
+#define TEST_MAX_DATAGRAMS      128
+#define TEST_MAX_FRAGMENTS      512
+#define TEST_BUFFER_SIZE        (1 << 30)
+#define TEST_EVICTION_BUFFER    (16 * 1024)
+
+typedef struct {
+    NodeAddress src;
+    unsigned char protocol;
+    int numFragments;
+    int fragmentPayload;        // bytes after the IP header
+} TestDatagram;
+
+typedef struct {
+    int datagram;
+    int fragment;
+    clocktype time;
+} TestFragment;
+
+typedef struct {
+    int numDatagrams;
+    int numReassembled;
+    int numTimeouts;
+    int numEvictions;
+    int numDropped;
+    unsigned int maxBufferedBytes;
+} TestCounts;
+
+// Queue of the reference: the datagram it is for, its bytes and
+// payload, and when it expires.
+typedef struct {
+    int datagram;
+    unsigned int bufferedBytes;
+    int payload;
+    clocktype fragHoldTime;
+} RefQueue;
+
+static TestDatagram TestDatagrams[TEST_MAX_DATAGRAMS];
+static int TestNumDatagrams;
+static TestFragment TestFragments[TEST_MAX_FRAGMENTS];
+static int TestNumFragments;
+
+static RefQueue RefQueues[TEST_MAX_DATAGRAMS];
+static int RefNumQueues;
+
+
+static unsigned int Random() {
+    static unsigned int x = 2463534242U;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+
+static int AddDatagram(
+    NodeAddress src,
+    unsigned char protocol,
+    int numFragments,
+    int fragmentPayload)
+{
+    TestDatagram* d = &TestDatagrams[TestNumDatagrams];
+
+    d->src = src;
+    d->protocol = protocol;
+    d->numFragments = numFragments;
+    d->fragmentPayload = fragmentPayload;
+    return TestNumDatagrams++;
+}
+
+
+static void AddFragment(int datagram, int fragment, clocktype time) {
+    TestFragments[TestNumFragments].datagram = datagram;
+    TestFragments[TestNumFragments].fragment = fragment;
+    TestFragments[TestNumFragments].time = time;
+    TestNumFragments++;
+}
+
+
+static void SortFragments() {
+    int i;
+
+    // Insertion sort, stable, so fragments of one time keep their order.
+    for (i = 1; i < TestNumFragments; i++) {
+        TestFragment f = TestFragments[i];
+        int j = i;
+
+        while (j > 0 && TestFragments[j - 1].time > f.time) {
+            TestFragments[j] = TestFragments[j - 1];
+            j--;
+        }
+        TestFragments[j] = f;
+    }
+}
+
+
+static void MakeHeader(IpHeaderType* ipHeader, int datagram) {
+    const TestDatagram* d = &TestDatagrams[datagram];
+
+    memset(ipHeader, 0, sizeof(IpHeaderType));
+    IpHeaderSetIpLength(&ipHeader->ip_v_hl_tos_len,
+                        sizeof(IpHeaderType) + d->fragmentPayload);
+    ipHeader->ip_id = TEST_ID;
+    ipHeader->ip_p = d->protocol;
+    ipHeader->ip_src = d->src;
+    ipHeader->ip_dst = TEST_DESTINATION;
+}
+
+
+static BOOL IsQueueOf(const IpFragQueue* fp, int datagram) {
+    const TestDatagram* d = &TestDatagrams[datagram];
+
+    return (BOOL) (fp->ipFrg_id == TEST_ID &&
+                   fp->ipFrg_src == d->src &&
+                   fp->ipFrg_dst == TEST_DESTINATION &&
+                   fp->ipFrg_p == d->protocol);
+}
+
+
+// IpDeleteFragmentedPacket without the fragments.
+static void DeleteQueue(NetworkDataIp* ip, IpFragQueue* fp) {
+    IpFragmentUnlinkQueue(ip, fp);
+    MEM_free(fp);
+}
+
+
+static void Expire(NetworkDataIp* ip, clocktype now, TestCounts* counts) {
+    IpFragQueue* fp;
+
+    while ((fp = IpFragmentExpiredQueue(ip, now)) != NULL) {
+        counts->numTimeouts++;
+        DeleteQueue(ip, fp);
+    }
+}
+
+
+// The queue handling of IpFragmentInput. Returns FALSE if the datagram
+// is reassembled from a queue that is not its own.
+static BOOL Receive(
+    NetworkDataIp* ip,
+    const TestFragment* f,
+    TestCounts* counts)
+{
+    const TestDatagram* d = &TestDatagrams[f->datagram];
+    unsigned int packetLen = sizeof(IpHeaderType) + d->fragmentPayload;
+    IpHeaderType ipHeader;
+    IpFragQueue* fp;
+    IpFragQueue* victim;
+
+    MakeHeader(&ipHeader, f->datagram);
+
+    Expire(ip, f->time, counts);
+
+    fp = IpFragmentFindQueue(ip, &ipHeader);
+
+    while ((victim = IpFragmentEvictionVictim(ip, fp, packetLen)) != NULL) {
+        counts->numEvictions++;
+        DeleteQueue(ip, victim);
+    }
+
+    if (ip->fragmentBufferedBytes + packetLen > ip->ipFragBufferSize) {
+        counts->numEvictions++;
+        counts->numDropped++;
+        if (fp) {
+            DeleteQueue(ip, fp);
+        }
+        return TRUE;
+    }
+
+    if (!fp) {
+        fp = IpFragmentNewQueue(ip, &ipHeader,
+                                f->time + IP_FRAGMENT_HOLD_TIME);
+    }
+
+    fp->totalFragmentSize += d->fragmentPayload;
+    IpFragmentChargeBuffer(ip, fp, packetLen);
+
+    if (ip->fragmentBufferedBytes > counts->maxBufferedBytes) {
+        counts->maxBufferedBytes = ip->fragmentBufferedBytes;
+    }
+
+    if (fp->totalFragmentSize ==
+        (unsigned) (d->numFragments * d->fragmentPayload))
+    {
+        if (!IsQueueOf(fp, f->datagram)) {
+            return FALSE;
+        }
+        counts->numReassembled++;
+        DeleteQueue(ip, fp);
+    }
+    return TRUE;
+}
+
+
+static void RefDelete(int i) {
+    memmove(&RefQueues[i], &RefQueues[i + 1],
+            (RefNumQueues - i - 1) * sizeof(RefQueue));
+    RefNumQueues--;
+}
+
+
+static unsigned int RefBufferedBytes() {
+    unsigned int bytes = 0;
+    int i;
+
+    for (i = 0; i < RefNumQueues; i++) {
+        bytes += RefQueues[i].bufferedBytes;
+    }
+    return bytes;
+}
+
+
+// The same steps on the array of queues.
+static void RefReceive(
+    const TestFragment* f,
+    unsigned int bufferSize,
+    TestCounts* counts)
+{
+    const TestDatagram* d = &TestDatagrams[f->datagram];
+    unsigned int packetLen = sizeof(IpHeaderType) + d->fragmentPayload;
+    int i;
+    int k;
+
+    while (RefNumQueues > 0 && f->time >= RefQueues[0].fragHoldTime) {
+        counts->numTimeouts++;
+        RefDelete(0);
+    }
+
+    for (i = 0; i < RefNumQueues && RefQueues[i].datagram != f->datagram;
+         i++)
+    {
+    }
+
+    k = 0;
+    while (k < RefNumQueues && RefBufferedBytes() + packetLen > bufferSize) {
+        if (k == i) {
+            k++;
+            continue;
+        }
+        counts->numEvictions++;
+        RefDelete(k);
+        if (k < i) {
+            i--;
+        }
+    }
+
+    if (RefBufferedBytes() + packetLen > bufferSize) {
+        counts->numEvictions++;
+        counts->numDropped++;
+        if (i < RefNumQueues) {
+            RefDelete(i);
+        }
+        return;
+    }
+
+    if (i == RefNumQueues) {
+        RefQueues[i].datagram = f->datagram;
+        RefQueues[i].bufferedBytes = 0;
+        RefQueues[i].payload = 0;
+        RefQueues[i].fragHoldTime = f->time + IP_FRAGMENT_HOLD_TIME;
+        RefNumQueues++;
+    }
+
+    RefQueues[i].bufferedBytes += packetLen;
+    RefQueues[i].payload += d->fragmentPayload;
+
+    if (RefBufferedBytes() > counts->maxBufferedBytes) {
+        counts->maxBufferedBytes = RefBufferedBytes();
+    }
+
+    if (RefQueues[i].payload == d->numFragments * d->fragmentPayload) {
+        counts->numReassembled++;
+        RefDelete(i);
+    }
+}
+
+
+// The queues must be those of the reference, in its order, and each
+// must be found under its own key.
+static BOOL SameQueues(const NetworkDataIp* ip) {
+    const IpFragQueue* fp = ip->fragmentListFirst;
+    const IpFragQueue* prev = NULL;
+    unsigned int bytes = 0;
+    int i;
+
+    for (i = 0; i < RefNumQueues; i++) {
+        IpHeaderType ipHeader;
+
+        if (fp == NULL || fp->prev != prev ||
+            !IsQueueOf(fp, RefQueues[i].datagram) ||
+            fp->bufferedBytes != RefQueues[i].bufferedBytes ||
+            fp->fragHoldTime != RefQueues[i].fragHoldTime)
+        {
+            return FALSE;
+        }
+
+        MakeHeader(&ipHeader, RefQueues[i].datagram);
+        if (IpFragmentFindQueue((NetworkDataIp*) ip, &ipHeader) != fp) {
+            return FALSE;
+        }
+
+        bytes += fp->bufferedBytes;
+        prev = fp;
+        fp = fp->next;
+    }
+
+    return (BOOL) (fp == NULL && ip->fragmentListLast == prev &&
+                   ip->fragmentBufferedBytes == bytes &&
+                   bytes <= ip->ipFragBufferSize);
+}
+
+
+static BOOL Run(
+    const char* name,
+    unsigned int bufferSize,
+    TestCounts* counts)
+{
+    NetworkDataIp* ip = (NetworkDataIp*) calloc(1, sizeof(NetworkDataIp));
+    TestCounts refCounts;
+    BOOL ok = TRUE;
+    int i;
+
+    ip->ipFragBufferSize = bufferSize;
+    memset(counts, 0, sizeof(TestCounts));
+    memset(&refCounts, 0, sizeof(TestCounts));
+    RefNumQueues = 0;
+
+    for (i = 0; i < TestNumFragments && ok; i++) {
+        if (!Receive(ip, &TestFragments[i], counts)) {
+            printf("%s: datagram %d reassembled from another queue\n",
+                   name, TestFragments[i].datagram);
+            ok = FALSE;
+        }
+        RefReceive(&TestFragments[i], bufferSize, &refCounts);
+
+        if (ok && !SameQueues(ip)) {
+            printf("%s: queues differ after fragment %d\n", name, i);
+            ok = FALSE;
+        }
+    }
+
+    // The reassembly timer, once every queue has expired.
+    Expire(ip, TestFragments[TestNumFragments - 1].time
+               + IP_FRAGMENT_HOLD_TIME, counts);
+    refCounts.numTimeouts += RefNumQueues;
+
+    counts->numDatagrams = TestNumDatagrams;
+    refCounts.numDatagrams = TestNumDatagrams;
+
+    if (ok && (ip->fragmentListFirst != NULL ||
+               memcmp(counts, &refCounts, sizeof(TestCounts)) != 0))
+    {
+        printf("%s: counts differ from the reference\n", name);
+        ok = FALSE;
+    }
+
+    while (ip->fragmentListFirst != NULL) {
+        DeleteQueue(ip, ip->fragmentListFirst);
+    }
+    free(ip);
+    return ok;
+}
+
+
+static void MakeInterleave() {
+    int s;
+    int i;
+
+    TestNumDatagrams = 0;
+    TestNumFragments = 0;
+
+    // The bytes of each source XOR to the same value, so IpFragmentHash
+    // puts the datagrams of one protocol in one bucket.
+    for (s = 0; s < 64; s++) {
+        NodeAddress src = 0x0A000000 | ((s + 1) << 8) | ((s + 1) ^ 0x5A);
+        int tcp = AddDatagram(src, 6, 4, 16 * (s + 1));
+        int udp = AddDatagram(src, 17, 4, 16 * (s + 1) + 8);
+
+        for (i = 0; i < 4; i++) {
+            AddFragment(tcp, i, 0);
+            AddFragment(udp, i, 0);
+        }
+    }
+
+    for (i = TestNumFragments - 1; i > 0; i--) {
+        int j = Random() % (i + 1);
+        TestFragment f = TestFragments[i];
+
+        TestFragments[i] = TestFragments[j];
+        TestFragments[j] = f;
+    }
+}
+
+
+static void MakeTimeout() {
+    int s;
+    int i;
+
+    TestNumDatagrams = 0;
+    TestNumFragments = 0;
+
+    for (s = 0; s < 100; s++) {
+        clocktype start = s * 500 * MILLI_SECOND;
+        int datagram = AddDatagram(0x0A000100 + s, 17, 4, 512);
+
+        for (i = 0; i < 3; i++) {
+            AddFragment(datagram, i, start);
+        }
+        if (s % 2 == 0) {
+            AddFragment(datagram, 3, start + 10 * SECOND);
+        }
+    }
+    SortFragments();
+}
+
+
+static void MakeEviction() {
+    int s;
+    int i;
+    int j;
+
+    TestNumDatagrams = 0;
+    TestNumFragments = 0;
+
+    for (s = 0; s < 64; s += 8) {
+        for (i = 0; i < 8; i++) {
+            AddDatagram(0x0A000100 + s + i, 17, 4, 1024);
+        }
+        for (j = 0; j < 4; j++) {
+            for (i = 0; i < 8; i++) {
+                AddFragment(s + i, j, s * MILLI_SECOND);
+            }
+        }
+    }
+
+    s = AddDatagram(0x0A000200, 17, 20, 1024);
+    for (j = 0; j < 20; j++) {
+        AddFragment(s, j, 64 * MILLI_SECOND);
+    }
+}
+
+
+int main() {
+    static const char* names[] = { "interleave", "timeout", "eviction" };
+    TestCounts counts[3];
+    BOOL ok = TRUE;
+    int run;
+
+    for (run = 0; run < 3; run++) {
+        unsigned int bufferSize = TEST_BUFFER_SIZE;
+
+        switch (run) {
+            case 0: MakeInterleave(); break;
+            case 1: MakeTimeout(); break;
+            default:
+                MakeEviction();
+                bufferSize = TEST_EVICTION_BUFFER;
+                break;
+        }
+
+        if (!Run(names[run], bufferSize, &counts[run])) {
+            ok = FALSE;
+        }
+    }
+
+    printf("run         datagrams  reassembled  timeouts  evictions  "
+           "dropped  max buffered\n");
+    for (run = 0; run < 3; run++) {
+        printf("%-10s  %9d  %11d  %8d  %9d  %7d  %12u\n",
+               names[run], counts[run].numDatagrams,
+               counts[run].numReassembled, counts[run].numTimeouts,
+               counts[run].numEvictions, counts[run].numDropped,
+               counts[run].maxBufferedBytes);
+    }
+
+    return ok ? 0 : 1;
+}
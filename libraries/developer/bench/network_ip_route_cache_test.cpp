@@ -0,0 +1,319 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Standalone check that the route cache in front of the IP forwarding
+ * table (network_ip-forwarding.h) is invalidated by every change of
+ * the table.
+ *
+ * The table starts with a default route, nested 10.x prefixes and 200
+ * 172.16.x.0/24 routes of four protocols. A working set of 48
+ * destinations is drawn from the table's prefixes, each in its own
+ * cache entry. Each change below is made 1000 times:
+ *
+ *   add     NetworkForwardingTableAddRow of a new prefix of length 16
+ *           to 32 over a destination of the working set, which moves
+ *           the rows after it;
+ *   delete  a route of protocol 7 over a destination of the working
+ *           set is added, and after the working set is looked up
+ *           again, NetworkForwardingTableRemoveRows of protocol 7;
+ *   metric  NetworkForwardingTableAddRow of an existing row with a new
+ *           cost, and one time in four a next hop of
+ *           NETWORK_UNREACHABLE or back to a reachable one, as
+ *           NetworkUpdateForwardingTable sets them.
+ *
+ * Before each change the working set is looked up twice through
+ * NetworkForwardingTableCachedRoute, so the cache holds it. After the
+ * change every destination is looked up once more. The test exits with
+ * 1 if that lookup is answered from the cache (a stale hit) or returns
+ * another row than NetworkForwardingTableFindRoute, or if a lookup of
+ * the second pass before a change misses.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       network_ip_route_cache_test.cpp -o network_ip_route_cache_test
+ *
+ * Reference run:
+ *
+ *  change  changes  warm hits  lookups after  stale hits  wrong rows
+ *  add        1000      48000          48000           0           0
+ *  delete     1000      48000          48000           0           0
+ *  metric     1000      48000          48000           0           0
+ *
+ * warm hits counts the hits of the second pass before each change.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api.h"
+#include "network_ip-forwarding.h"
+
+#define TEST_CHANGES            1000
+#define TEST_WORKING_SET        48
+#define TEST_STATIC_ROUTES      200
+#define TEST_DELETED_PROTOCOL   ((NetworkRoutingProtocolType) 7)
+
+enum {
+    TEST_ADD,
+    TEST_DELETE,
+    TEST_METRIC,
+    TEST_NUM_CHANGES
+};
+
+static const char* TestChangeName[TEST_NUM_CHANGES] =
+    { "add", "delete", "metric" };
+
+typedef struct {
+    int numWarmHits;
+    int numLookups;
+    int numStaleHits;
+    int numWrongRows;
+} TestCounts;
+
+static NodeAddress TestWorkingSet[TEST_WORKING_SET];
+
+
+// The cache entry NetworkForwardingTableCachedRoute uses.
+static int CacheEntry(NodeAddress destinationAddress) {
+    return (int) ((destinationAddress ^ (destinationAddress >> 8)
+                   ^ (destinationAddress >> 16) ^ (destinationAddress >> 24))
+                  & (NETWORK_ROUTE_CACHE_SIZE - 1));
+}
+
+
+static unsigned int Random() {
+    static unsigned int x = 2463534242U;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+
+static NodeAddress PrefixMask(int prefixLength) {
+    return ConvertNumHostBitsToSubnetMask(32 - prefixLength);
+}
+
+
+// As NetworkUpdateForwardingTable, with the admin distance of the
+// protocol and the interface of the next hop left out.
+static void Update(
+    NetworkForwardingTable* forwardTable,
+    NodeAddress destAddress,
+    int prefixLength,
+    NodeAddress nextHopAddress,
+    int cost,
+    NetworkRoutingProtocolType type)
+{
+    int i = NetworkForwardingTableAddRow(
+                forwardTable, destAddress, PrefixMask(prefixLength), type,
+                (NetworkRoutingAdminDistanceType) ((int) type + 1));
+
+    forwardTable->row[i].interfaceIndex = 0;
+    forwardTable->row[i].nextHopAddress = nextHopAddress;
+    forwardTable->row[i].cost = cost;
+    forwardTable->row[i].interfaceIsEnabled = TRUE;
+}
+
+
+static void InitTable(NetworkForwardingTable* forwardTable) {
+    BOOL entryIsUsed[NETWORK_ROUTE_CACHE_SIZE];
+    int i;
+
+    // As NetworkInitForwardingTable: no cache entry is valid.
+    memset(forwardTable, 0, sizeof(NetworkForwardingTable));
+    forwardTable->generation = 1;
+
+    Update(forwardTable, 0, 0, 1, 1, (NetworkRoutingProtocolType) 3);
+    Update(forwardTable, 0x0A000000, 8, 2, 1, (NetworkRoutingProtocolType) 0);
+    Update(forwardTable, 0x0A010000, 16, 3, 1, (NetworkRoutingProtocolType) 1);
+    Update(forwardTable, 0x0A010200, 24, 4, 1, (NetworkRoutingProtocolType) 2);
+
+    for (i = 0; i < TEST_STATIC_ROUTES; i++) {
+        Update(forwardTable, 0xAC100000 | ((NodeAddress) i << 8), 24,
+               5 + Random() % 20, 1 + Random() % 10,
+               (NetworkRoutingProtocolType) (Random() % 4));
+    }
+
+    memset(entryIsUsed, 0, sizeof(entryIsUsed));
+    i = 0;
+    while (i < TEST_WORKING_SET) {
+        const NetworkForwardingTableRow* row =
+            &forwardTable->row[Random() % forwardTable->size];
+        NodeAddress destination = row->destAddress |
+                                  (Random() & ~row->destAddressMask);
+
+        if (!entryIsUsed[CacheEntry(destination)]) {
+            entryIsUsed[CacheEntry(destination)] = TRUE;
+            TestWorkingSet[i++] = destination;
+        }
+    }
+}
+
+
+// Looks up the working set; returns the number of cache hits.
+static int LookUpWorkingSet(NetworkForwardingTable* forwardTable) {
+    int numHits = 0;
+    int i;
+
+    for (i = 0; i < TEST_WORKING_SET; i++) {
+        BOOL isCacheHit;
+
+        NetworkForwardingTableCachedRoute(
+            forwardTable, TestWorkingSet[i], &isCacheHit);
+        if (isCacheHit) {
+            numHits++;
+        }
+    }
+    return numHits;
+}
+
+
+static void Change(NetworkForwardingTable* forwardTable, int change) {
+    NodeAddress destination = TestWorkingSet[Random() % TEST_WORKING_SET];
+
+    switch (change) {
+        case TEST_ADD: {
+            int prefixLength = 16 + Random() % 17;
+
+            Update(forwardTable,
+                   destination & PrefixMask(prefixLength), prefixLength,
+                   1 + Random() % 50, 1 + Random() % 10,
+                   (NetworkRoutingProtocolType) (4 + Random() % 3));
+            break;
+        }
+        case TEST_DELETE: {
+            NetworkForwardingTableRemoveRows(forwardTable,
+                                             TEST_DELETED_PROTOCOL);
+            break;
+        }
+        case TEST_METRIC: {
+            const NetworkForwardingTableRow* row =
+                &forwardTable->row[Random() % forwardTable->size];
+            NodeAddress nextHopAddress = row->nextHopAddress;
+            int prefixLength = 0;
+
+            while (prefixLength < 32 &&
+                   (row->destAddressMask & (0x80000000 >> prefixLength)))
+            {
+                prefixLength++;
+            }
+
+            if (Random() % 4 == 0) {
+                nextHopAddress =
+                    (nextHopAddress == (unsigned) NETWORK_UNREACHABLE) ?
+                    1 + Random() % 50 : (unsigned) NETWORK_UNREACHABLE;
+            }
+
+            Update(forwardTable, row->destAddress, prefixLength,
+                   nextHopAddress, 1 + Random() % 10, row->protocolType);
+            break;
+        }
+    }
+}
+
+
+// The route of protocol 7 that the delete change removes.
+static void PrepareDelete(NetworkForwardingTable* forwardTable) {
+    NodeAddress destination = TestWorkingSet[Random() % TEST_WORKING_SET];
+    int prefixLength = 16 + Random() % 17;
+
+    Update(forwardTable,
+           destination & PrefixMask(prefixLength), prefixLength,
+           1 + Random() % 50, 1, TEST_DELETED_PROTOCOL);
+}
+
+
+static BOOL Check(int change, TestCounts* counts) {
+    NetworkForwardingTable forwardTable;
+    int n;
+
+    memset(counts, 0, sizeof(TestCounts));
+    InitTable(&forwardTable);
+
+    for (n = 0; n < TEST_CHANGES; n++) {
+        int i;
+
+        if (change == TEST_DELETE) {
+            PrepareDelete(&forwardTable);
+        }
+
+        LookUpWorkingSet(&forwardTable);
+        counts->numWarmHits += LookUpWorkingSet(&forwardTable);
+
+        Change(&forwardTable, change);
+
+        for (i = 0; i < TEST_WORKING_SET; i++) {
+            BOOL isCacheHit;
+            int rowIndex = NetworkForwardingTableCachedRoute(
+                               &forwardTable, TestWorkingSet[i],
+                               &isCacheHit);
+
+            counts->numLookups++;
+            if (isCacheHit) {
+                counts->numStaleHits++;
+            }
+            if (rowIndex != NetworkForwardingTableFindRoute(
+                                &forwardTable, TestWorkingSet[i],
+                                FALSE, FALSE,
+                                (NetworkRoutingProtocolType) 0))
+            {
+                counts->numWrongRows++;
+            }
+        }
+    }
+
+    NetworkForwardingTrieFree(forwardTable.trieRoot);
+    MEM_free(forwardTable.row);
+    MEM_free(forwardTable.rowNode);
+
+    return (BOOL) (counts->numWarmHits == TEST_CHANGES * TEST_WORKING_SET &&
+                   counts->numStaleHits == 0 &&
+                   counts->numWrongRows == 0);
+}
+
+
+int main() {
+    TestCounts counts[TEST_NUM_CHANGES];
+    BOOL ok = TRUE;
+    int change;
+
+    for (change = 0; change < TEST_NUM_CHANGES; change++) {
+        if (!Check(change, &counts[change])) {
+            ok = FALSE;
+        }
+    }
+
+    printf("change  changes  warm hits  lookups after  stale hits  "
+           "wrong rows\n");
+    for (change = 0; change < TEST_NUM_CHANGES; change++) {
+        printf("%-6s  %7d  %9d  %13d  %10d  %10d\n",
+               TestChangeName[change], TEST_CHANGES,
+               counts[change].numWarmHits, counts[change].numLookups,
+               counts[change].numStaleHits, counts[change].numWrongRows);
+    }
+
+    if (!ok) {
+        printf("the route cache is not invalidated\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,722 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file network_ip-forwarding.h
+ * \brief Longest prefix match index of the IP forwarding table.
+ *
+ * A path-compressed binary trie over the rows of NetworkForwardingTable,
+ * the row insertion and removal that keep it in step with the table,
+ * and the route cache in front of it. Nothing here touches a Node, so
+ * the bench can run it alone.
+ */
+
+#ifndef NETWORK_IP_FORWARDING_H
+#define NETWORK_IP_FORWARDING_H
+
+#include <string.h>
+
+#include "api.h"
+#include "network_ip.h"
+
+//
+// Initial allocated entries for routing table.
+//
+
+#define FORWARDING_TABLE_ROW_START_SIZE 8
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTriePrefixLength()
+// PURPOSE      Prefix length of a forwarding table row.
+// PARAMETERS   NodeAddress destAddress
+//                  Destination address of the row.
+//              NodeAddress destAddressMask
+//                  Netmask of the row.
+// RETURN       Prefix length, or -1 if the mask is not contiguous or
+//              destAddress has bits outside it. The trie cannot index
+//              such a row.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkForwardingTriePrefixLength(
+    NodeAddress destAddress,
+    NodeAddress destAddressMask)
+{
+    int prefixLength = 0;
+
+    while (prefixLength < 32
+           && (destAddressMask & (0x80000000 >> prefixLength)) != 0)
+    {
+        prefixLength++;
+    }
+
+    if (destAddressMask != ConvertNumHostBitsToSubnetMask(32 - prefixLength)
+        || (destAddress & ~destAddressMask) != 0)
+    {
+        return -1;
+    }
+
+    return prefixLength;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieBit()
+// PURPOSE      Bit of an address that selects the child of a trie node.
+// PARAMETERS   NodeAddress address
+//                  Address to branch on.
+//              int prefixLength
+//                  Prefix length of the node, below 32.
+// RETURN       0 or 1.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkForwardingTrieBit(NodeAddress address, int prefixLength)
+{
+    return (int) ((address >> (31 - prefixLength)) & 1);
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieFind()
+// PURPOSE      Find the trie node of a prefix.
+// PARAMETERS   NetworkForwardingTrieNode *trieNode
+//                  Root of the trie.
+//              NodeAddress prefix
+//                  Prefix, masked to prefixLength.
+//              int prefixLength
+//                  Prefix length.
+// RETURN       The node, NULL if the trie has none for this prefix.
+//-----------------------------------------------------------------------------
+
+static NetworkForwardingTrieNode *
+NetworkForwardingTrieFind(
+    NetworkForwardingTrieNode *trieNode,
+    NodeAddress prefix,
+    int prefixLength)
+{
+    while (trieNode != NULL
+           && trieNode->prefixLength <= prefixLength
+           && MaskIpAddress(
+                  prefix,
+                  ConvertNumHostBitsToSubnetMask(32 - trieNode->prefixLength))
+              == trieNode->prefix)
+    {
+        if (trieNode->prefixLength == prefixLength)
+        {
+            return trieNode;
+        }
+
+        trieNode = trieNode->child[
+            NetworkForwardingTrieBit(prefix, trieNode->prefixLength)];
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieNewNode()
+// PURPOSE      Allocate a trie node with no rows and no children.
+// PARAMETERS   NodeAddress prefix
+//                  Prefix, masked to prefixLength.
+//              int prefixLength
+//                  Prefix length.
+// RETURN       The new node.
+//-----------------------------------------------------------------------------
+
+static NetworkForwardingTrieNode *
+NetworkForwardingTrieNewNode(NodeAddress prefix, int prefixLength)
+{
+    NetworkForwardingTrieNode *trieNode = (NetworkForwardingTrieNode *)
+        MEM_malloc(sizeof(NetworkForwardingTrieNode));
+
+    memset(trieNode, 0, sizeof(NetworkForwardingTrieNode));
+    trieNode->prefix = prefix;
+    trieNode->prefixLength = prefixLength;
+    trieNode->firstRow = -1;
+
+    return trieNode;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieInsert()
+// PURPOSE      Find the trie node of a prefix, adding it if needed. A
+//              node is split where the new prefix leaves its path.
+// PARAMETERS   NetworkForwardingTrieNode **link
+//                  Root of the trie.
+//              NodeAddress prefix
+//                  Prefix, masked to prefixLength.
+//              int prefixLength
+//                  Prefix length.
+// RETURN       The node of the prefix.
+//-----------------------------------------------------------------------------
+
+static NetworkForwardingTrieNode *
+NetworkForwardingTrieInsert(
+    NetworkForwardingTrieNode **link,
+    NodeAddress prefix,
+    int prefixLength)
+{
+    while (TRUE)
+    {
+        NetworkForwardingTrieNode *trieNode = *link;
+        NetworkForwardingTrieNode *newNode;
+        NodeAddress difference;
+        int commonLength = 0;
+
+        if (trieNode == NULL)
+        {
+            *link = NetworkForwardingTrieNewNode(prefix, prefixLength);
+            return *link;
+        }
+
+        difference = trieNode->prefix ^ prefix;
+        while (commonLength < trieNode->prefixLength
+               && commonLength < prefixLength
+               && (difference & (0x80000000 >> commonLength)) == 0)
+        {
+            commonLength++;
+        }
+
+        if (commonLength == trieNode->prefixLength)
+        {
+            if (commonLength == prefixLength)
+            {
+                return trieNode;
+            }
+
+            link = &trieNode->child[
+                NetworkForwardingTrieBit(prefix, commonLength)];
+            continue;
+        }
+
+        newNode = NetworkForwardingTrieNewNode(prefix, prefixLength);
+
+        if (commonLength == prefixLength)
+        {
+            // The new prefix is above trieNode on its path.
+            newNode->child[
+                NetworkForwardingTrieBit(trieNode->prefix, commonLength)] =
+                trieNode;
+            *link = newNode;
+        }
+        else
+        {
+            NetworkForwardingTrieNode *branch =
+                NetworkForwardingTrieNewNode(
+                    MaskIpAddress(
+                        prefix,
+                        ConvertNumHostBitsToSubnetMask(32 - commonLength)),
+                    commonLength);
+
+            branch->child[NetworkForwardingTrieBit(prefix, commonLength)] =
+                newNode;
+            branch->child[
+                NetworkForwardingTrieBit(trieNode->prefix, commonLength)] =
+                trieNode;
+            *link = branch;
+        }
+
+        return newNode;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieRemove()
+// PURPOSE      Take a prefix whose last row is gone out of the trie, and
+//              splice out the nodes without rows left with fewer than
+//              two children on its path.
+// PARAMETERS   NetworkForwardingTrieNode **link
+//                  Root of the (sub)trie.
+//              NodeAddress prefix
+//                  Prefix, masked to prefixLength.
+//              int prefixLength
+//                  Prefix length.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkForwardingTrieRemove(
+    NetworkForwardingTrieNode **link,
+    NodeAddress prefix,
+    int prefixLength)
+{
+    NetworkForwardingTrieNode *trieNode = *link;
+
+    if (trieNode == NULL
+        || trieNode->prefixLength > prefixLength
+        || MaskIpAddress(
+               prefix,
+               ConvertNumHostBitsToSubnetMask(32 - trieNode->prefixLength))
+           != trieNode->prefix)
+    {
+        return;
+    }
+
+    if (trieNode->prefixLength < prefixLength)
+    {
+        NetworkForwardingTrieRemove(
+            &trieNode->child[
+                NetworkForwardingTrieBit(prefix, trieNode->prefixLength)],
+            prefix,
+            prefixLength);
+    }
+
+    if (trieNode->numRows == 0
+        && (trieNode->child[0] == NULL || trieNode->child[1] == NULL))
+    {
+        *link = (trieNode->child[0] != NULL) ?
+                trieNode->child[0] : trieNode->child[1];
+        MEM_free(trieNode);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTrieFree()
+// PURPOSE      Free a trie.
+// PARAMETERS   NetworkForwardingTrieNode *trieNode
+//                  Root of the trie, may be NULL.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkForwardingTrieFree(NetworkForwardingTrieNode *trieNode)
+{
+    if (trieNode != NULL)
+    {
+        NetworkForwardingTrieFree(trieNode->child[0]);
+        NetworkForwardingTrieFree(trieNode->child[1]);
+        MEM_free(trieNode);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableRenumberRows()
+// PURPOSE      Bring firstRow of the trie nodes up to date after rows
+//              from startRow on have moved.
+// PARAMETERS   NetworkForwardingTable *forwardTable
+//                  The forwarding table.
+//              int startRow
+//                  First row that may have moved.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkForwardingTableRenumberRows(
+    NetworkForwardingTable *forwardTable,
+    int startRow)
+{
+    int i;
+
+    for (i = startRow; i < forwardTable->size; i++)
+    {
+        NetworkForwardingTrieNode *trieNode = forwardTable->rowNode[i];
+
+        if (trieNode != NULL
+            && (i == 0 || forwardTable->rowNode[i - 1] != trieNode))
+        {
+            trieNode->firstRow = i;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableRouteIsUsable()
+// PURPOSE      Whether a lookup may return a row that matches its
+//              destination.
+// PARAMETERS   NetworkForwardingTableRow *row
+//                  The row.
+//              BOOL checkType
+//                  Whether to apply testType and type.
+//              BOOL testType
+//                  Only rows of protocol type if TRUE, only rows of
+//                  other protocols if FALSE.
+//              NetworkRoutingProtocolType type
+//                  Routing protocol type.
+// RETURN       TRUE if the row can be used.
+//-----------------------------------------------------------------------------
+
+static BOOL
+NetworkForwardingTableRouteIsUsable(
+    const NetworkForwardingTableRow *row,
+    BOOL checkType,
+    BOOL testType,
+    NetworkRoutingProtocolType type)
+{
+    if (row->nextHopAddress == (unsigned) NETWORK_UNREACHABLE
+        || row->interfaceIsEnabled == FALSE)
+    {
+        return FALSE;
+    }
+
+    if (checkType)
+    {
+        return (BOOL) ((row->protocolType == type) == (testType == TRUE));
+    }
+
+    return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableFindRoute()
+// PURPOSE      Find the row a lookup on destinationAddress returns: the
+//              first usable row, in table order, whose prefix matches.
+//              Rows are sorted by address, then mask, both descending,
+//              then administrative distance, so for nested prefixes this
+//              is the longest match and, among rows of that prefix, the
+//              preferred protocol. The trie visits the matching prefixes
+//              longest first and reads each one's rows in table order.
+// PARAMETERS   NetworkForwardingTable *forwardTable
+//                  The forwarding table.
+//              NodeAddress destinationAddress
+//                  Destination IP address.
+//              BOOL checkType, BOOL testType,
+//              NetworkRoutingProtocolType type
+//                  Protocol filter, see
+//                  NetworkForwardingTableRouteIsUsable().
+// RETURN       Row index, -1 if there is no route.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkForwardingTableFindRoute(
+    NetworkForwardingTable *forwardTable,
+    NodeAddress destinationAddress,
+    BOOL checkType,
+    BOOL testType,
+    NetworkRoutingProtocolType type)
+{
+    NetworkForwardingTrieNode *matches[33];
+    NetworkForwardingTrieNode *trieNode = forwardTable->trieRoot;
+    int numMatches = 0;
+    int i;
+
+    if (forwardTable->numUnindexedRows > 0)
+    {
+        for (i = 0; i < forwardTable->size; i++)
+        {
+            NodeAddress maskedDestinationAddress =
+                MaskIpAddress(
+                    destinationAddress,
+                    forwardTable->row[i].destAddressMask);
+
+            if (forwardTable->row[i].destAddress == maskedDestinationAddress
+                && NetworkForwardingTableRouteIsUsable(
+                       &forwardTable->row[i], checkType, testType, type))
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    while (trieNode != NULL
+           && MaskIpAddress(
+                  destinationAddress,
+                  ConvertNumHostBitsToSubnetMask(32 - trieNode->prefixLength))
+              == trieNode->prefix)
+    {
+        if (trieNode->numRows > 0)
+        {
+            matches[numMatches++] = trieNode;
+        }
+
+        if (trieNode->prefixLength == 32)
+        {
+            break;
+        }
+
+        trieNode = trieNode->child[
+            NetworkForwardingTrieBit(
+                destinationAddress, trieNode->prefixLength)];
+    }
+
+    while (numMatches > 0)
+    {
+        trieNode = matches[--numMatches];
+
+        for (i = trieNode->firstRow;
+             i < trieNode->firstRow + trieNode->numRows;
+             i++)
+        {
+            if (NetworkForwardingTableRouteIsUsable(
+                    &forwardTable->row[i], checkType, testType, type))
+            {
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableAddRow()
+// PURPOSE      Find the row of a destination, netmask and routing
+//              protocol, adding it if there is none. A new row goes in
+//              at its place in the table order (destination, then
+//              netmask, descending, then admin distance, ascending) and
+//              into the trie; the caller fills in its route. Either
+//              way the row changes, so the route cache is invalidated.
+// PARAMETERS   NetworkForwardingTable *forwardTable
+//                  The forwarding table.
+//              NodeAddress destAddress
+//                  IP address of destination network or host.
+//              NodeAddress destAddressMask
+//                  Netmask.
+//              NetworkRoutingProtocolType type
+//                  Type value of routing protocol.
+//              NetworkRoutingAdminDistanceType adminDistance
+//                  Admin distance of the routing protocol.
+// RETURN       Row index.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkForwardingTableAddRow(
+    NetworkForwardingTable *forwardTable,
+    NodeAddress destAddress,
+    NodeAddress destAddressMask,
+    NetworkRoutingProtocolType type,
+    NetworkRoutingAdminDistanceType adminDistance)
+{
+    int prefixLength =
+        NetworkForwardingTriePrefixLength(destAddress, destAddressMask);
+    NetworkForwardingTrieNode *trieNode = NULL;
+    int i;
+
+    if (prefixLength == -1)
+    {
+        for (i = 0; i < forwardTable->size
+                    && (forwardTable->row[i].destAddress != destAddress
+                        || forwardTable->row[i].destAddressMask != destAddressMask
+                        || forwardTable->row[i].protocolType != type); i++)
+        {
+            // Loop until match.
+        }
+    }
+    else
+    {
+        trieNode = NetworkForwardingTrieFind(
+                       forwardTable->trieRoot, destAddress, prefixLength);
+        i = forwardTable->size;
+
+        if (trieNode != NULL)
+        {
+            int j;
+
+            for (j = trieNode->firstRow;
+                 j < trieNode->firstRow + trieNode->numRows;
+                 j++)
+            {
+                if (forwardTable->row[j].protocolType == type)
+                {
+                    i = j;
+                    break;
+                }
+            }
+        }
+    }
+
+    forwardTable->generation++;
+
+    if (i < forwardTable->size)
+    {
+        return i;
+    }
+
+    forwardTable->size++;
+
+    if (forwardTable->size > forwardTable->allocatedSize)
+    {
+        if (forwardTable->allocatedSize == 0)
+        {
+            forwardTable->allocatedSize = FORWARDING_TABLE_ROW_START_SIZE;
+            forwardTable->row = (NetworkForwardingTableRow*)
+                MEM_malloc(
+                    forwardTable->allocatedSize *
+                    sizeof(NetworkForwardingTableRow));
+            forwardTable->rowNode = (NetworkForwardingTrieNode**)
+                MEM_malloc(
+                    forwardTable->allocatedSize *
+                    sizeof(NetworkForwardingTrieNode*));
+        }
+        else
+        {
+            int newSize = (forwardTable->allocatedSize * 2);
+
+            NetworkForwardingTableRow* newTableRow =
+                (NetworkForwardingTableRow*)MEM_malloc(
+                    newSize * sizeof(NetworkForwardingTableRow));
+            NetworkForwardingTrieNode** newRowNode =
+                (NetworkForwardingTrieNode**)MEM_malloc(
+                    newSize * sizeof(NetworkForwardingTrieNode*));
+
+            memcpy(newTableRow, forwardTable->row,
+                   (forwardTable->allocatedSize *
+                    sizeof(NetworkForwardingTableRow)));
+            memcpy(newRowNode, forwardTable->rowNode,
+                   (forwardTable->allocatedSize *
+                    sizeof(NetworkForwardingTrieNode*)));
+
+            MEM_free(forwardTable->row);
+            MEM_free(forwardTable->rowNode);
+            forwardTable->row = newTableRow;
+            forwardTable->rowNode = newRowNode;
+            forwardTable->allocatedSize = newSize;
+        }//if//
+    }//if//
+
+    while (i > 0 &&
+           (destAddress > forwardTable->row[i - 1].destAddress
+            || (destAddress == forwardTable->row[i - 1].destAddress
+                && destAddressMask > forwardTable->row[i - 1].destAddressMask)
+            || (destAddress == forwardTable->row[i - 1].destAddress
+                && destAddressMask == forwardTable->row[i - 1].destAddressMask
+                && adminDistance < forwardTable->row[i - 1].adminDistance)))
+    {
+        forwardTable->row[i] = forwardTable->row[i - 1];
+        forwardTable->rowNode[i] = forwardTable->rowNode[i - 1];
+        i--;
+    }//while//
+
+    if (prefixLength == -1)
+    {
+        forwardTable->numUnindexedRows++;
+    }
+    else
+    {
+        trieNode = NetworkForwardingTrieInsert(
+                       &forwardTable->trieRoot,
+                       destAddress,
+                       prefixLength);
+        trieNode->numRows++;
+    }
+
+    forwardTable->rowNode[i] = trieNode;
+    NetworkForwardingTableRenumberRows(forwardTable, i);
+
+    forwardTable->row[i].destAddress = destAddress;
+    forwardTable->row[i].destAddressMask = destAddressMask;
+    forwardTable->row[i].protocolType = type;
+    forwardTable->row[i].adminDistance = adminDistance;
+
+    return i;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableRemoveRows()
+// PURPOSE      Remove the rows of a routing protocol from the table and
+//              the trie, keeping the other rows in order, and
+//              invalidate the route cache.
+// PARAMETERS   NetworkForwardingTable *forwardTable
+//                  The forwarding table.
+//              NetworkRoutingProtocolType type
+//                  Type of routing protocol whose rows are removed.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkForwardingTableRemoveRows(
+    NetworkForwardingTable *forwardTable,
+    NetworkRoutingProtocolType type)
+{
+    int i;
+    int numKept = 0;
+
+    // Go through the routing table, moving the entries that are kept
+    // down over the deleted ones, in order.
+    for (i = 0; i < forwardTable->size; i++)
+    {
+        NetworkForwardingTrieNode *trieNode = forwardTable->rowNode[i];
+
+        // Delete entries that corresponds to the routing protocol used
+        if (forwardTable->row[i].protocolType == type)
+        {
+            if (trieNode == NULL)
+            {
+                forwardTable->numUnindexedRows--;
+            }
+            else
+            {
+                trieNode->numRows--;
+
+                if (trieNode->numRows == 0)
+                {
+                    NetworkForwardingTrieRemove(
+                        &forwardTable->trieRoot,
+                        trieNode->prefix,
+                        trieNode->prefixLength);
+                }
+            }
+        }
+        else
+        {
+            forwardTable->row[numKept] = forwardTable->row[i];
+            forwardTable->rowNode[numKept] = trieNode;
+            numKept++;
+        }
+    }
+
+    // Update forwarding table size.
+    forwardTable->size = numKept;
+    NetworkForwardingTableRenumberRows(forwardTable, 0);
+
+    forwardTable->generation++;
+}
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkForwardingTableCachedRoute()
+// PURPOSE      NetworkForwardingTableFindRoute() without a protocol
+//              filter, answered from the route cache when the cached
+//              entry for the destination is of the current generation.
+// PARAMETERS   NetworkForwardingTable *forwardTable
+//                  The forwarding table.
+//              NodeAddress destinationAddress
+//                  Destination IP address.
+//              BOOL *isCacheHit
+//                  Storage for whether the cache answered.
+// RETURN       Row index, -1 if there is no route.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkForwardingTableCachedRoute(
+    NetworkForwardingTable *forwardTable,
+    NodeAddress destinationAddress,
+    BOOL *isCacheHit)
+{
+    NetworkRouteCacheEntry *entry =
+        &forwardTable->routeCache[
+            (destinationAddress ^ (destinationAddress >> 8)
+             ^ (destinationAddress >> 16) ^ (destinationAddress >> 24))
+            & (NETWORK_ROUTE_CACHE_SIZE - 1)];
+
+    if (entry->generation == forwardTable->generation
+        && entry->destAddress == destinationAddress)
+    {
+        *isCacheHit = TRUE;
+        return entry->rowIndex;
+    }
+
+    entry->destAddress = destinationAddress;
+    entry->generation = forwardTable->generation;
+    entry->rowIndex = NetworkForwardingTableFindRoute(
+                          forwardTable, destinationAddress, FALSE, FALSE,
+                          (NetworkRoutingProtocolType) 0);
+
+    *isCacheHit = FALSE;
+    return entry->rowIndex;
+}
+
+#endif /* NETWORK_IP_FORWARDING_H */
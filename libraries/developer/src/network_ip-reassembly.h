@@ -0,0 +1,283 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file network_ip-reassembly.h
+ * \brief Reassembly queues of IP fragments.
+ *
+ * The hash table and oldest first list of the reassembly queues, their
+ * share of the reassembly buffer, and the choice of the queue to drop
+ * on timeout and when the buffer is full. The fragments themselves are
+ * handled by IpFragmentInput. Nothing here touches a Node, so the bench
+ * can run it alone.
+ */
+
+#ifndef NETWORK_IP_REASSEMBLY_H
+#define NETWORK_IP_REASSEMBLY_H
+
+#include "api.h"
+#include "network_ip.h"
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentHash
+// PURPOSE             :: Hash bucket of the reassembly queue of a datagram.
+// PARAMETERS          ::
+// +id                  : UInt32 id       : Identification of the datagram
+// +src                 : NodeAddress src : Source address
+// +dst                 : NodeAddress dst : Destination address
+// +protocol            : unsigned char protocol : Protocol of the datagram
+// RETURN               : int : Index into ip->fragmentHash
+//---------------------------------------------------------------------------
+
+static int
+IpFragmentHash(
+    UInt32 id,
+    NodeAddress src,
+    NodeAddress dst,
+    unsigned char protocol)
+{
+    UInt32 key = id ^ src ^ dst ^ ((UInt32) protocol << 16);
+
+    key ^= key >> 16;
+    key ^= key >> 8;
+
+    return (int) (key & (IP_FRAGMENT_HASH_SIZE - 1));
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentFindQueue
+// PURPOSE             :: Find the reassembly queue of the datagram of a
+//                        fragment.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +ipHeader            : const IpHeaderType* ipHeader: Header of the
+//                                      fragment.
+// RETURN               : IpFragQueue* : The queue, NULL if there is none.
+//---------------------------------------------------------------------------
+
+static IpFragQueue*
+IpFragmentFindQueue(NetworkDataIp* ip, const IpHeaderType* ipHeader)
+{
+    IpFragQueue* fp = ip->fragmentHash[
+                          IpFragmentHash(ipHeader->ip_id,
+                                         ipHeader->ip_src,
+                                         ipHeader->ip_dst,
+                                         ipHeader->ip_p)];
+
+    while (fp != NULL)
+    {
+        if (ipHeader->ip_id == fp->ipFrg_id &&
+            (ipHeader->ip_src == fp->ipFrg_src) &&
+            (ipHeader->ip_dst == fp->ipFrg_dst) &&
+            (ipHeader->ip_p == fp->ipFrg_p))
+        {
+            break;
+        }
+        fp = fp->hashNext;
+    }
+
+    return fp;
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentNewQueue
+// PURPOSE             :: Create the reassembly queue of the datagram of a
+//                        fragment, at the end of the list and in the hash
+//                        table.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +ipHeader            : const IpHeaderType* ipHeader: Header of the
+//                                      fragment.
+// +fragHoldTime        : clocktype fragHoldTime: Time the queue expires.
+// RETURN               : IpFragQueue* : The new, empty queue.
+//---------------------------------------------------------------------------
+
+static IpFragQueue*
+IpFragmentNewQueue(
+    NetworkDataIp* ip,
+    const IpHeaderType* ipHeader,
+    clocktype fragHoldTime)
+{
+    IpFragQueue* fp = (IpFragQueue*) MEM_malloc(sizeof(IpFragQueue));
+    int hashIndex = IpFragmentHash(ipHeader->ip_id,
+                                   ipHeader->ip_src,
+                                   ipHeader->ip_dst,
+                                   ipHeader->ip_p);
+
+    fp->firstMsg = NULL;
+    fp->lastMsg = NULL;
+    fp->ipFrg_id = ipHeader->ip_id;
+    fp->ipFrg_src = ipHeader->ip_src;
+    fp->ipFrg_dst = ipHeader->ip_dst;
+    fp->ipFrg_p = ipHeader->ip_p;
+
+    fp->actualacketSize = IpHeaderGetIpLength(ipHeader->ip_v_hl_tos_len);
+    fp->totalFragmentSize = 0;
+    fp->bufferedBytes = 0;
+
+    fp->fragHoldTime = fragHoldTime;
+
+    // The newest queue goes at the end of the list.
+    fp->prev = ip->fragmentListLast;
+    fp->next = NULL;
+    if (ip->fragmentListLast)
+    {
+        ip->fragmentListLast->next = fp;
+    }
+    else
+    {
+        ip->fragmentListFirst = fp;
+    }
+    ip->fragmentListLast = fp;
+
+    fp->hashNext = ip->fragmentHash[hashIndex];
+    ip->fragmentHash[hashIndex] = fp;
+
+    return fp;
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentChargeBuffer
+// PURPOSE             :: Count the bytes of a queued fragment against the
+//                        reassembly buffer.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +fp                  : IpFragQueue* fp: Queue of the fragment.
+// +size                : unsigned int size: Bytes of the fragment.
+// RETURN               : None
+//---------------------------------------------------------------------------
+
+static void
+IpFragmentChargeBuffer(NetworkDataIp* ip, IpFragQueue* fp, unsigned int size)
+{
+    fp->bufferedBytes += size;
+    ip->fragmentBufferedBytes += size;
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentUnlinkQueue
+// PURPOSE             :: Take a reassembly queue off the list and the hash
+//                        table, and give its bytes back to the buffer.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +fp                  : IpFragQueue* fp: Queue to unlink.
+// RETURN               : None
+//---------------------------------------------------------------------------
+
+static void
+IpFragmentUnlinkQueue(NetworkDataIp* ip, IpFragQueue* fp)
+{
+    IpFragQueue** link = &ip->fragmentHash[
+                             IpFragmentHash(fp->ipFrg_id,
+                                            fp->ipFrg_src,
+                                            fp->ipFrg_dst,
+                                            fp->ipFrg_p)];
+
+    while (*link != fp)
+    {
+        link = &(*link)->hashNext;
+    }
+    *link = fp->hashNext;
+
+    if (fp->prev)
+    {
+        fp->prev->next = fp->next;
+    }
+    else
+    {
+        ip->fragmentListFirst = fp->next;
+    }
+
+    if (fp->next)
+    {
+        fp->next->prev = fp->prev;
+    }
+    else
+    {
+        ip->fragmentListLast = fp->prev;
+    }
+
+    ip->fragmentBufferedBytes -= fp->bufferedBytes;
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentExpiredQueue
+// PURPOSE             :: The oldest reassembly queue if its hold time has
+//                        passed. Every queue has the same hold time, so
+//                        the queues expire in the order they were
+//                        created.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +now                 : clocktype now : Current time.
+// RETURN               : IpFragQueue* : The queue to delete, NULL if none
+//                                      has expired.
+//---------------------------------------------------------------------------
+
+static IpFragQueue*
+IpFragmentExpiredQueue(NetworkDataIp* ip, clocktype now)
+{
+    if (ip->fragmentListFirst != NULL
+        && now >= ip->fragmentListFirst->fragHoldTime)
+    {
+        return ip->fragmentListFirst;
+    }
+
+    return NULL;
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentEvictionVictim
+// PURPOSE             :: The oldest reassembly queue other than keep, if
+//                        size more bytes do not fit in the reassembly
+//                        buffer.
+// PARAMETERS          ::
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +keep                : IpFragQueue* keep: Queue the bytes are for,
+//                                      NULL if it is a new one.
+// +size                : unsigned int size: Bytes to make room for.
+// RETURN               : IpFragQueue* : The queue to delete, NULL if the
+//                                      bytes fit or only keep is left.
+//---------------------------------------------------------------------------
+
+static IpFragQueue*
+IpFragmentEvictionVictim(
+    NetworkDataIp* ip,
+    IpFragQueue* keep,
+    unsigned int size)
+{
+    IpFragQueue* fp = ip->fragmentListFirst;
+
+    if (ip->fragmentBufferedBytes + size <= ip->ipFragBufferSize)
+    {
+        return NULL;
+    }
+
+    if (fp == keep)
+    {
+        fp = fp->next;
+    }
+
+    return fp;
+}
+
+#endif /* NETWORK_IP_REASSEMBLY_H */
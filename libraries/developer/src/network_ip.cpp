@@ -36,6 +36,8 @@
 #include "ip6_icmp.h"
 #include "ip6_output.h"
 #include "network_ip.h"
+#include "network_ip-forwarding.h"
+#include "network_ip-reassembly.h"
 #include "network_dualip.h"
 #include "network_icmp.h"
 #include "multicast_static.h"
@@ -241,16 +243,6 @@
 
 #define NUM_INITIAL_PHB_INFO_ENTRIES 4
 
-//-----------------------------------------------------------------------------
-// Routing table (forwarding table)
-//-----------------------------------------------------------------------------
-
-//
-// Initial allocated entries for routing table.
-//
-
-#define FORWARDING_TABLE_ROW_START_SIZE 8
-
 //-----------------------------------------------------------------------------
 // Router info
 //-----------------------------------------------------------------------------
@@ -269,9 +261,6 @@
 
 #define NoECN_DEBUG_TEST
 
-//percentage of queue-fill at which to switch channels
-#define CHANSWITCH_THRESHOLD 75.0
-
 /*
  * Change this value to the number of drops required
  * e.g. #define ECN_TEST_PKT_MARK 3 for 3 drops
@@ -505,6 +494,18 @@ QueueUpIpFragmentForMacLayer(
 static void //inline//
 ProcessDelayedSendToMac(Node *node, Message *msg);
 
+//-----------------------------------------------------------------------------
+// Output queue triggers
+//-----------------------------------------------------------------------------
+
+static void
+NetworkIpQueueCheckChanswitch(
+    Node *node,
+    Scheduler *scheduler,
+    int interfaceIndex,
+    BOOL queueBusy,
+    BOOL inMacCall);
+
 //-----------------------------------------------------------------------------
 // Source route
 //-----------------------------------------------------------------------------
@@ -755,6 +756,7 @@ NetworkIpPreInit(Node *node)
 #endif
 
     ip->ipFragHoldTime = IP_FRAGMENT_HOLD_TIME;
+    ip->ipFragBufferSize = IP_FRAGMENT_BUFFER_SIZE;
     ip->maxPacketLength = MAX_NW_PKT_SIZE;
 
     NetworkIpInitStats(node, &(ip->stats));
@@ -1161,6 +1163,7 @@ NetworkIpInit(Node *node, const NodeInput *nodeInput)
     char forwardingEnabledString[MAX_STRING_LENGTH];
     char buf[MAX_STRING_LENGTH];
     clocktype ipFragHoldTime = 0;
+    int ipFragBufferSize = 0;
     int i;
 
     int ipFragUnit = 0;
@@ -1467,6 +1470,21 @@ NetworkIpInit(Node *node, const NodeInput *nodeInput)
          ip->ipFragHoldTime = ipFragHoldTime;
      }
 
+    IO_ReadInt(node->nodeId,
+           ANY_ADDRESS,
+           nodeInput,
+           "IP-FRAGMENT-BUFFER-SIZE",
+           &retVal,
+           &ipFragBufferSize);
+
+    if (retVal)
+    {
+        ERROR_Assert(ipFragBufferSize > 0,
+            "IP-FRAGMENT-BUFFER-SIZE should be greater than 0");
+
+        ip->ipFragBufferSize = (unsigned int) ipFragBufferSize;
+    }
+
 #ifdef ADDON_BOEINGFCS
     {
         BOOL useSubnet = FALSE;
@@ -1846,6 +1864,10 @@ NetworkIpInit(Node *node, const NodeInput *nodeInput)
     // Fragmentation id set to 0
     ip->ipFragmentId = 0;
     ip->fragmentListFirst = NULL;
+    ip->fragmentListLast = NULL;
+    memset(ip->fragmentHash, 0, sizeof(ip->fragmentHash));
+    ip->fragmentBufferedBytes = 0;
+    ip->fragmentTimer = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -2401,6 +2423,16 @@ NetworkIpLayer(Node *node, Message *msg)
                     IPsecHandleEvent(node, msg);
                     break;
                 }
+                case MSG_NETWORK_IpFragmentTimer:
+                {
+                    IpFragmentHandleTimer(node, msg);
+                    break;
+                }
+                case MSG_NETWORK_ChanswitchQueueCheck:
+                {
+                    NetworkIpQueueHandleChanswitchCheck(node, msg);
+                    break;
+                }
                 default:
                     ERROR_ReportError("Invalid switch value");
             }//switch//
@@ -7151,6 +7183,13 @@ BOOL NetworkIpOutputQueueDequeuePacket(
             }
         }
         //GuiEnd
+
+        NetworkIpQueueCheckChanswitch(
+            node,
+            scheduler,
+            interfaceIndex,
+            !(*scheduler).isEmpty(ALL_PRIORITIES),
+            TRUE);
     }
 
     return dequeued;
@@ -7276,6 +7315,13 @@ BOOL NetworkIpOutputQueueDequeuePacketForAPriority(
                                    getSimTime(node) + getSimStartTime(node));
         }
         //GuiEnd
+
+        NetworkIpQueueCheckChanswitch(
+            node,
+            scheduler,
+            interfaceIndex,
+            !(*scheduler).isEmpty(ALL_PRIORITIES),
+            TRUE);
         return TRUE;
     }
     return FALSE;
@@ -8207,6 +8253,36 @@ ReturnPriorityForPHB(
 // Routing table (forwarding table)
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpCachedRoute()
+// PURPOSE      Route lookup through the route cache, counted in the IP
+//              statistics.
+// PARAMETERS   NetworkDataIp *ip
+//                  IP data of the node.
+//              NodeAddress destinationAddress
+//                  Destination IP address.
+// RETURN       Row index, -1 if there is no route.
+//-----------------------------------------------------------------------------
+
+static int
+NetworkIpCachedRoute(
+    NetworkDataIp *ip,
+    NodeAddress destinationAddress)
+{
+    BOOL isCacheHit;
+    int i = NetworkForwardingTableCachedRoute(
+                &(ip->forwardTable), destinationAddress, &isCacheHit);
+
+    ip->stats.ipRouteCacheLookups++;
+
+    if (isCacheHit)
+    {
+        ip->stats.ipRouteCacheHits++;
+    }
+
+    return i;
+}
+
 //-----------------------------------------------------------------------------
 // FUNCTION     NetworkGetInterfaceAndNextHopFromForwardingTable()
 // PURPOSE      Do a lookup on the routing table with a destination IP
@@ -8240,19 +8316,12 @@ void NetworkGetInterfaceAndNextHopFromForwardingTable(
 
     //NetworkPrintForwardingTable(node);
 
-    for (i=0; i < forwardTable->size; i++) {
-        NodeAddress maskedDestinationAddress =
-            MaskIpAddress(
-                destinationAddress, forwardTable->row[i].destAddressMask);
+    i = NetworkIpCachedRoute(ip, destinationAddress);
 
-        if (forwardTable->row[i].destAddress == maskedDestinationAddress
-            && forwardTable->row[i].nextHopAddress != (unsigned) NETWORK_UNREACHABLE
-            && forwardTable->row[i].interfaceIsEnabled != FALSE)
-        {
-            *interfaceIndex = forwardTable->row[i].interfaceIndex;
-            *nextHopAddress = forwardTable->row[i].nextHopAddress;
-            break;
-        }
+    if (i != -1)
+    {
+        *interfaceIndex = forwardTable->row[i].interfaceIndex;
+        *nextHopAddress = forwardTable->row[i].nextHopAddress;
     }
 }
 
@@ -8296,30 +8365,13 @@ void NetworkGetInterfaceAndNextHopFromForwardingTable
 
     // NetworkPrintForwardingTable(node);
 
-    for (i=0; i < forwardTable->size; i++) {
-        NodeAddress maskedDestinationAddress =
-            MaskIpAddress(
-                destinationAddress,
-                forwardTable->row[i].destAddressMask);
+    i = NetworkForwardingTableFindRoute(
+            forwardTable, destinationAddress, TRUE, testType, type);
 
-        if (forwardTable->row[i].destAddress == maskedDestinationAddress
-            && forwardTable->row[i].nextHopAddress != (unsigned) NETWORK_UNREACHABLE
-            && forwardTable->row[i].interfaceIsEnabled != FALSE)
-        {
-            if (testType == TRUE &&
-                forwardTable->row[i].protocolType == type)
-            {
-                *interfaceIndex = forwardTable->row[i].interfaceIndex;
-                *nextHopAddress = forwardTable->row[i].nextHopAddress;
-                break;
-            }
-            else if (testType == FALSE && forwardTable->row[i].protocolType != type)
-            {
-                *interfaceIndex = forwardTable->row[i].interfaceIndex;
-                *nextHopAddress = forwardTable->row[i].nextHopAddress;
-                break;
-            }
-        }
+    if (i != -1)
+    {
+        *interfaceIndex = forwardTable->row[i].interfaceIndex;
+        *nextHopAddress = forwardTable->row[i].nextHopAddress;
     }
 }
 //-----------------------------------------------------------------------------
@@ -8487,18 +8539,11 @@ NetworkGetMetricForDestAddress(
     int i;
     int metric = 0xFFFFFFFF;
 
-    for (i = 0; i < forwardTable->size; i++) {
-        NodeAddress maskedDestinationAddress =
-            MaskIpAddress(
-                destAddress, forwardTable->row[i].destAddressMask);
+    i = NetworkIpCachedRoute(ip, destAddress);
 
-        if (forwardTable->row[i].destAddress == maskedDestinationAddress
-            && forwardTable->row[i].nextHopAddress != (unsigned) NETWORK_UNREACHABLE
-            && forwardTable->row[i].interfaceIsEnabled != FALSE)
-        {
-            metric = forwardTable->row[i].cost;
-            break;
-        }
+    if (i != -1)
+    {
+        metric = forwardTable->row[i].cost;
     }
     return metric;
 }
@@ -8726,6 +8771,14 @@ NetworkInitForwardingTable(Node *node)
     ip->forwardTable.size = 0;
     ip->forwardTable.allocatedSize = 0;
     ip->forwardTable.row = NULL;
+    ip->forwardTable.trieRoot = NULL;
+    ip->forwardTable.rowNode = NULL;
+    ip->forwardTable.numUnindexedRows = 0;
+
+    // Cache entries start at generation 0, so none of them is valid.
+    ip->forwardTable.generation = 1;
+    memset(ip->forwardTable.routeCache, 0,
+           sizeof(ip->forwardTable.routeCache));
 }
 
 //-----------------------------------------------------------------------------
@@ -8756,6 +8809,9 @@ NetworkInitForwardingTable(Node *node)
 //              addresses and netmasks, these entries added by different
 //              routing protocols.
 //
+//              The existing entry is found through the trie, which
+//              holds the entries of each prefix next to each other.
+//
 //              This function should have an interfaceIndex field, if
 //              the protocol wishes to specify the outgoing interface
 //              directly.
@@ -8820,65 +8876,11 @@ NetworkUpdateForwardingTable(
     }
 #endif // ENTERPRISE_LIB
 
-    for (i = 0; i < forwardTable->size
-                && (forwardTable->row[i].destAddress != destAddress
-                    || forwardTable->row[i].destAddressMask != destAddressMask
-                    || forwardTable->row[i].protocolType != type); i++)
-    {
-        // Loop until match.
-    }
-
-    if (i == forwardTable->size)
-    {
-        forwardTable->size++;
-
-        if (forwardTable->size > forwardTable->allocatedSize)
-        {
-            if (forwardTable->allocatedSize == 0)
-            {
-                forwardTable->allocatedSize = FORWARDING_TABLE_ROW_START_SIZE;
-                forwardTable->row = (NetworkForwardingTableRow*)
-                    MEM_malloc(
-                        forwardTable->allocatedSize *
-                        sizeof(NetworkForwardingTableRow));
-            }
-            else
-            {
-                int newSize = (forwardTable->allocatedSize * 2);
-
-                NetworkForwardingTableRow* newTableRow =
-                    (NetworkForwardingTableRow*)MEM_malloc(
-                        newSize * sizeof(NetworkForwardingTableRow));
-
-                memcpy(newTableRow, forwardTable->row,
-                       (forwardTable->allocatedSize *
-                        sizeof(NetworkForwardingTableRow)));
-
-                MEM_free(forwardTable->row);
-                forwardTable->row = newTableRow;
-                forwardTable->allocatedSize = newSize;
-            }//if//
-        }//if//
-
-        while (i > 0 &&
-               (destAddress > forwardTable->row[i - 1].destAddress
-                || (destAddress == forwardTable->row[i - 1].destAddress
-                    && destAddressMask > forwardTable->row[i - 1].destAddressMask)
-                || (destAddress == forwardTable->row[i - 1].destAddress
-                    && destAddressMask == forwardTable->row[i - 1].destAddressMask
-                    && adminDistance < forwardTable->row[i - 1].adminDistance)))
-        {
-            forwardTable->row[i] = forwardTable->row[i - 1];
-            i--;
-        }//while//
-    }//if//
+    i = NetworkForwardingTableAddRow(
+            forwardTable, destAddress, destAddressMask, type, adminDistance);
 
-    forwardTable->row[i].destAddress = destAddress;
-    forwardTable->row[i].destAddressMask = destAddressMask;
     forwardTable->row[i].interfaceIndex = interfaceIndex;
     forwardTable->row[i].nextHopAddress = nextHopAddress;
-    forwardTable->row[i].protocolType = type;
-    forwardTable->row[i].adminDistance = adminDistance;
 
     forwardTable->row[i].cost = cost;
 
@@ -8920,31 +8922,7 @@ NetworkEmptyForwardingTable(
     NetworkDataIp *ip = (NetworkDataIp *) node->networkData.networkVar;
     NetworkForwardingTable *rt = &ip->forwardTable;
 
-    int i = 0;
-
-    // Go through the routing table...
-    while (i < rt->size)
-    {
-        // Delete entries that corresponds to the routing protocol used
-        if (rt->row[i].protocolType == type)
-        {
-            int j = i + 1;
-
-            // Move all other entries down
-            while (j < rt->size)
-            {
-                rt->row[j - 1] = rt->row[j];
-                j++;
-            }
-
-            // Update forwarding table size.
-            rt->size--;
-        }
-        else
-        {
-            i++;
-        }
-    }
+    NetworkForwardingTableRemoveRows(rt, type);
 }
 
 //-----------------------------------------------------------------------------
@@ -13798,6 +13776,363 @@ NetworkIpRemoveOutputQueue(
 // Network-layer enqueueing
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueHeadSojournTime()
+// PURPOSE      Return how long the oldest head-of-line packet over all
+//              priority queues of the scheduler has been waiting.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              Scheduler *scheduler
+//                  Output queue of the interface.
+// RETURN       Sojourn time, 0 if the scheduler is empty.
+//-----------------------------------------------------------------------------
+
+static clocktype
+NetworkIpQueueHeadSojournTime(
+    Node *node,
+    Scheduler *scheduler)
+{
+    clocktype now = getSimTime(node);
+    clocktype oldestInsertTime = now;
+    int i;
+
+    for (i = 0; i < (*scheduler).numQueue(); i++)
+    {
+        Message *headMsg = NULL;
+        QueuePriorityType queuePriority = ALL_PRIORITIES;
+
+        if ((*scheduler).retrieve((*scheduler).GetQueuePriority(i),
+                                  0,
+                                  &headMsg,
+                                  &queuePriority,
+                                  PEEK_AT_NEXT_PACKET,
+                                  now))
+        {
+            clocktype insertTime =
+                ((QueuedPacketInfo *) MESSAGE_ReturnInfo(headMsg))->insertTime;
+
+            if (insertTime < oldestInsertTime)
+            {
+                oldestInsertTime = insertTime;
+            }
+        }
+    }
+
+    return now - oldestInsertTime;
+}
+
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueChanswitchTriggerEnabled()
+// PURPOSE      Tell whether the output queue of an interface drives the
+//              dot11 channel switch.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              int interfaceIndex
+//                  Interface of the output queue.
+// RETURN       The dot11 data of the interface if the queue trigger is
+//              in use, NULL otherwise.
+//-----------------------------------------------------------------------------
+
+static MacDataDot11 *
+NetworkIpQueueChanswitchTriggerEnabled(
+    Node *node,
+    int interfaceIndex)
+{
+    MacDataDot11 *dot11;
+
+    if (interfaceIndex == CPU_INTERFACE
+        || node->macData[interfaceIndex]->macProtocol != MAC_PROTOCOL_DOT11)
+    {
+        return NULL;
+    }
+
+    dot11 = (MacDataDot11 *) node->macData[interfaceIndex]->macVar;
+
+    if (dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SIMPLE
+        || ((dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_AP_PROBE
+                || dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SINR)
+            && dot11->chanswitchTrigger == DOT11_CHANSWITCH_TRIGGER_QUEUE))
+    {
+        return dot11;
+    }
+
+    return NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueStartChanswitchCheck()
+// PURPOSE      (Re)start the queue trigger check timer of an interface.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              MacDataDot11 *dot11
+//                  dot11 data of the interface.
+//              int interfaceIndex
+//                  Interface of the output queue.
+//              clocktype delay
+//                  Time to the check.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkIpQueueStartChanswitchCheck(
+    Node *node,
+    MacDataDot11 *dot11,
+    int interfaceIndex,
+    clocktype delay)
+{
+    if (dot11->chanswitchQueueTimer != NULL)
+    {
+        MESSAGE_CancelSelfMsg(node, dot11->chanswitchQueueTimer);
+    }
+
+    dot11->chanswitchQueueTimer = MESSAGE_Alloc(node,
+                                                NETWORK_LAYER,
+                                                NETWORK_PROTOCOL_IP,
+                                                MSG_NETWORK_ChanswitchQueueCheck);
+    MESSAGE_SetInstanceId(dot11->chanswitchQueueTimer, (short) interfaceIndex);
+    MESSAGE_Send(node, dot11->chanswitchQueueTimer, delay);
+}
+
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueCheckChanswitchTrigger()
+// PURPOSE      Ask for a channel switch when the output queue of a dot11
+//              interface congests. With the FILL metric the queue congests
+//              when priority 0 is filled above MAC-DOT11-CHANSWITCH-THRESHOLD
+//              and drains below MAC-DOT11-CHANSWITCH-LOW-THRESHOLD. With the
+//              SOJOURN metric it congests when the head-of-line sojourn time
+//              over all priorities stays above MAC-DOT11-CHANSWITCH-SOJOURN-
+//              TARGET for MAC-DOT11-CHANSWITCH-SOJOURN-INTERVAL (the CoDel
+//              rule) and drains when it falls below the target.
+//              The trigger is edge-triggered: it fires once on congestion
+//              and re-arms only when the queue drains or when
+//              MAC-DOT11-CHANSWITCH-TRIGGER-INTERVAL has passed, so at most
+//              one request is outstanding per interface.
+//              The caller checks NetworkIpQueueChanswitchTriggerEnabled().
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              Scheduler *scheduler
+//                  Output queue of the interface.
+//              int outgoingInterface
+//                  dot11 interface the packet is queued for.
+//              BOOL inMacCall
+//                  TRUE when called from a MAC dequeue. The simple switch
+//                  retunes the MAC directly, so it is then deferred to the
+//                  check timer instead of running under the dequeue.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkIpQueueCheckChanswitchTrigger(
+    Node *node,
+    Scheduler *scheduler,
+    int outgoingInterface,
+    BOOL inMacCall)
+{
+    MacDataDot11 *dot11 =
+        (MacDataDot11 *) node->macData[outgoingInterface]->macVar;
+    clocktype now = getSimTime(node);
+    BOOL congested;
+    BOOL drained;
+
+    if (dot11->chanswitchQueueMetric == DOT11_CHANSWITCH_QUEUE_METRIC_SOJOURN)
+    {
+        clocktype sojourn = NetworkIpQueueHeadSojournTime(node, scheduler);
+
+        congested = FALSE;
+        drained = sojourn < dot11->chanswitchSojournTarget;
+        if (drained)
+        {
+            dot11->chanswitchSojournAboveTime = 0;
+        }
+        else if (dot11->chanswitchSojournAboveTime == 0)
+        {
+            dot11->chanswitchSojournAboveTime =
+                now + dot11->chanswitchSojournInterval;
+        }
+        else if (now >= dot11->chanswitchSojournAboveTime)
+        {
+            congested = TRUE;
+        }
+    }
+    else
+    {
+        int bytes = (*scheduler).bytesInQueue(0);
+        int maxBytes = (*scheduler).sizeOfQueue(0);
+        double filled = 100 * ((double)bytes / (double)maxBytes);
+
+        // printf("NetworkIpQueueInsert: node %d, there are %d / %d bytes in queue (%4.2f%%) \n", node->nodeId, bytes, maxBytes, filled);
+        congested = filled > dot11->chanswitchThreshold;
+        drained = filled < dot11->chanswitchLowThreshold;
+    }
+
+    if (dot11->chanswitchTriggerPending
+        && (drained
+            || now - dot11->chanswitchLastTriggerTime >=
+                   dot11->chanswitchTriggerInterval))
+    {
+        dot11->chanswitchTriggerPending = FALSE;
+    }
+
+    if (!congested)
+    {
+        return;
+    }
+
+    if (dot11->chanswitchTriggerPending)
+    {
+        dot11->chanswitchTriggersSuppressed++;
+        return;
+    }
+
+    dot11->chanswitchTriggerPending = TRUE;
+    dot11->chanswitchLastTriggerTime = now;
+    dot11->chanswitchTriggersSent++;
+
+    if (dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SIMPLE)
+    {
+        if (inMacCall)
+        {
+            dot11->chanswitchQueueRequestDeferred = TRUE;
+            NetworkIpQueueStartChanswitchCheck(
+                node, dot11, outgoingInterface, 0);
+            return;
+        }
+        MAC_NetworkLayerChanswitch(node, outgoingInterface); //used by simple channel switch
+        return;
+    }
+
+    Message *appMsg;
+    int appType;
+    if (dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_AP_PROBE)
+    {
+        appType = APP_CHANSWITCH_CLIENT;
+    }
+    else
+    {
+        appType = APP_CHANSWITCH_SINR_CLIENT;
+    }
+    appMsg = MESSAGE_Alloc(node,
+        APP_LAYER,
+        appType,
+        MSG_APP_InitiateChannelScanRequest);
+    AppInitScanRequest* info = (AppInitScanRequest *)
+    MESSAGE_InfoAlloc(
+        node,
+        appMsg,
+        sizeof(AppInitScanRequest));
+    ERROR_Assert(info, "cannot allocate enough space for needed info");
+    info->connectionId = dot11->connectionId;
+    MESSAGE_Send(node, appMsg, 0);
+}
+
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueCheckChanswitch()
+// PURPOSE      Evaluate the channel switch queue trigger of an interface,
+//              on insert, on dequeue and from the periodic check, and keep
+//              the periodic check running while the queue holds packets.
+//              Without it a queue that stops moving would never be looked
+//              at again: the sojourn time grows with no insert or dequeue
+//              to notice, and a pending trigger never re-arms.
+//              The check runs every MAC-DOT11-CHANSWITCH-SOJOURN-INTERVAL
+//              with the SOJOURN metric and every MAC-DOT11-CHANSWITCH-
+//              TRIGGER-INTERVAL with the FILL metric.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              Scheduler *scheduler
+//                  Output queue of the interface.
+//              int interfaceIndex
+//                  Interface of the output queue.
+//              BOOL queueBusy
+//                  TRUE if the queue holds, or is about to hold, packets.
+//              BOOL inMacCall
+//                  TRUE when called from a MAC dequeue.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+static void
+NetworkIpQueueCheckChanswitch(
+    Node *node,
+    Scheduler *scheduler,
+    int interfaceIndex,
+    BOOL queueBusy,
+    BOOL inMacCall)
+{
+    MacDataDot11 *dot11 =
+        NetworkIpQueueChanswitchTriggerEnabled(node, interfaceIndex);
+    clocktype checkInterval;
+
+    if (dot11 == NULL)
+    {
+        return;
+    }
+
+    NetworkIpQueueCheckChanswitchTrigger(
+        node, scheduler, interfaceIndex, inMacCall);
+
+    if (!queueBusy || dot11->chanswitchQueueTimer != NULL)
+    {
+        return;
+    }
+
+    if (dot11->chanswitchQueueMetric == DOT11_CHANSWITCH_QUEUE_METRIC_SOJOURN)
+    {
+        checkInterval = dot11->chanswitchSojournInterval;
+    }
+    else
+    {
+        checkInterval = dot11->chanswitchTriggerInterval;
+    }
+
+    if (checkInterval > 0)
+    {
+        NetworkIpQueueStartChanswitchCheck(
+            node, dot11, interfaceIndex, checkInterval);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueHandleChanswitchCheck()
+// PURPOSE      Periodic check of the channel switch queue trigger.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              Message *msg
+//                  The check timer, freed here.
+// RETURN       None.
+//-----------------------------------------------------------------------------
+
+void
+NetworkIpQueueHandleChanswitchCheck(
+    Node *node,
+    Message *msg)
+{
+    NetworkDataIp *ip = (NetworkDataIp *) node->networkData.networkVar;
+    int interfaceIndex = MESSAGE_GetInstanceId(msg);
+    MacDataDot11 *dot11 =
+        (MacDataDot11 *) node->macData[interfaceIndex]->macVar;
+    Scheduler *scheduler = ip->interfaceInfo[interfaceIndex]->scheduler;
+
+    dot11->chanswitchQueueTimer = NULL;
+    MESSAGE_Free(node, msg);
+
+    if (dot11->chanswitchQueueRequestDeferred)
+    {
+        dot11->chanswitchQueueRequestDeferred = FALSE;
+        MAC_NetworkLayerChanswitch(node, interfaceIndex);
+    }
+
+    if (!(*scheduler).isEmpty(ALL_PRIORITIES))
+    {
+        NetworkIpQueueCheckChanswitch(
+            node, scheduler, interfaceIndex, TRUE, FALSE);
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 // FUNCTION     NetworkIpQueueInsert()
 // PURPOSE      Calls the packet scheduler for an interface to retrieve
@@ -13848,44 +14183,9 @@ NetworkIpQueueInsert(
     QueuedPacketInfo *infoPtr;
     BOOL isResolved = FALSE;
 
-    int bytes = (*scheduler).bytesInQueue(0);
-    int maxBytes = (*scheduler).sizeOfQueue(0);
-    double filled = 100 * ((double)bytes / (double)maxBytes);
-    if(node->macData[outgoingInterface]->macProtocol == MAC_PROTOCOL_DOT11){
-        MacDataDot11 *dot11 = (MacDataDot11 *) node->macData[outgoingInterface]->macVar;
-        if(filled > dot11->chanswitchThreshold){
-            // printf("NetworkIpQueueInsert: node %d, there are %d / %d bytes in queue (%4.2f%%) \n", node->nodeId, bytes, maxBytes, filled);
-            if(dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SIMPLE){
-                MAC_NetworkLayerChanswitch(node, outgoingInterface); //used by simple channel switch
-            }
-            else if((dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_AP_PROBE 
-                        || dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SINR)
-                        && dot11->chanswitchTrigger == DOT11_CHANSWITCH_TRIGGER_QUEUE){
-                // printf("telling app layer to initiate a chanswitch \n");
-                Message *appMsg;
-                int appType;
-                if(dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_AP_PROBE){
-                    appType = APP_CHANSWITCH_CLIENT;
-                }
-                else if (dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_SINR){
-                    appType = APP_CHANSWITCH_SINR_CLIENT;
-                }
-                appMsg = MESSAGE_Alloc(node,
-                    APP_LAYER,
-                    appType,
-                    MSG_APP_InitiateChannelScanRequest);
-                AppInitScanRequest* info = (AppInitScanRequest *)
-                MESSAGE_InfoAlloc(
-                    node,
-                    appMsg,
-                    sizeof(AppInitScanRequest));
-                ERROR_Assert(info, "cannot allocate enough space for needed info");
-                info->connectionId = dot11->connectionId;
-                MESSAGE_Send(node, appMsg, 0);
-            }
+    NetworkIpQueueCheckChanswitch(
+        node, scheduler, outgoingInterface, TRUE, FALSE);
 
-        }
-    }
     ipHeader = (IpHeaderType*) MESSAGE_ReturnPacket(msg);
 
     // Tack on the nextHopAddress to the message using the insidious "info"
@@ -13937,6 +14237,7 @@ NetworkIpQueueInsert(
 
     infoPtr->nextHopAddress = nextHopAddress;
     infoPtr->destinationAddress.ipv4DestAddr = destinationAddress;
+    infoPtr->insertTime = getSimTime(node);
 
 
     memcpy(infoPtr->macAddress,hwAddr.byte,hwAddr.hwLength);
@@ -14553,6 +14854,11 @@ NetworkIpInitStats(Node* node, NetworkIpStatsType *stats)
     stats->ipFragsCreated = 0;
     stats->ipPacketsAfterFragsReasm = 0;
     stats->ipFragsInBuff = 0;
+    stats->ipReasmTimeouts = 0;
+    stats->ipReasmEvictions = 0;
+
+    stats->ipRouteCacheLookups = 0;
+    stats->ipRouteCacheHits = 0;
 
     //ATM : statistics added for gateway
     stats->ipRoutePktThruGt = 0;
@@ -15239,9 +15545,23 @@ NetworkIpPrintStats(Node *node)
     IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
     sprintf(buf, "Packets created after reassembling = %u", stats->ipPacketsAfterFragsReasm);
     IO_PrintStat(node, "Network", "IP", ANY_DEST, -1, buf);
+    sprintf(buf, "Reassemblies timed out = %u", stats->ipReasmTimeouts);
+    IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
+    sprintf(buf, "Reassemblies dropped for buffer space = %u",
+            stats->ipReasmEvictions);
+    IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
     sprintf(buf, "ipInDelivers TTL sum = %u", stats->deliveredPacketTtlTotal);
     IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
 
+    sprintf(buf, "Route cache lookups = %u", stats->ipRouteCacheLookups);
+    IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
+    sprintf(buf, "Route cache hits = %u", stats->ipRouteCacheHits);
+    IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
+    sprintf(buf, "Route cache hit rate (%%) = %.2f",
+            stats->ipRouteCacheLookups == 0 ? 0.0 :
+            100.0 * stats->ipRouteCacheHits / stats->ipRouteCacheLookups);
+    IO_PrintStat(node, "Network", "IP", ANY_DEST, -1 /* instance Id */, buf);
+
     // ATM : statistics added for gateway
     if (ip->gatewayConfigured)
     {
@@ -15738,7 +16058,14 @@ RouteThePacketUsingMulticastForwardingTable(
 //                                  list header.
 //                      : BOOL fragmentForMpls:Fragment an IP packet for MPLS
 // RETURN               : int : status of fragmentation.
-// NOTES                : IP fragmented packet processing function
+// NOTES                : IP fragmented packet processing function.
+//                        Every fragment is a new message; msg is left
+//                        to the caller to free. Fragments do not share
+//                        one payload buffer: the channel duplicates a
+//                        fragment for every receiver and parallel runs
+//                        serialize it, both copying the info fields
+//                        byte for byte, so a reference count kept there
+//                        would not follow the copies.
 //---------------------------------------------------------------------------
 int
 IpFragmentPacket(
@@ -15752,7 +16079,7 @@ IpFragmentPacket(
     int hlen;
     int fragmentedLen;
 
-    IpHeaderType* originalIpHdr = NULL;
+    IpHeaderType originalIpHdr;
     IpHeaderType *ipHeader = NULL;
 
     Message* tmpMsg = NULL;
@@ -15808,9 +16135,7 @@ IpFragmentPacket(
     }
 
     // Get the copy of the ip header.
-    originalIpHdr = (IpHeaderType*) MEM_malloc(sizeof(IpHeaderType));
-
-    memcpy(originalIpHdr, payload, sizeof(IpHeaderType));
+    memcpy(&originalIpHdr, payload, sizeof(IpHeaderType));
 
     packetLen = IpHeaderGetIpLength(ipHeader->ip_v_hl_tos_len);
     // Remove the Ip header from the original packet.
@@ -15911,8 +16236,8 @@ IpFragmentPacket(
 #ifdef ADDON_BOEINGFCS
     // needed for distinguishing SDR control packets from others
     // in SINCGARS
-    IpHeaderSetIpReserved(&ipHeader->ipFragment, IpHeaderGetIpReserved(originalIpHdr->ipFragment));
-    ipHeader->ip_sum = originalIpHdr->ip_sum;
+    IpHeaderSetIpReserved(&ipHeader->ipFragment, IpHeaderGetIpReserved(originalIpHdr.ipFragment));
+    ipHeader->ip_sum = originalIpHdr.ip_sum;
 #endif
     ip->stats.ipFragsCreated++;
 
@@ -15953,12 +16278,22 @@ IpFragmentPacket(
         // virtual packet is added.
         if (msg->packetSize > off)
         {
+            // The real bytes may end inside this fragment, the rest of
+            // it is then virtual.
+            int realLen = MIN((int) curPayloadLen, msg->packetSize - off);
+
             MESSAGE_PacketAlloc(node, tmpMsg,
-                curPayloadLen,
+                realLen,
                 TRACE_IP);
             // Now Make the fragmented Packet. with out virtual packet
             tempPayload = MESSAGE_ReturnPacket(tmpMsg);
-            memcpy(tempPayload, payload + off, curPayloadLen);
+            memcpy(tempPayload, payload + off, realLen);
+
+            if ((int) curPayloadLen > realLen)
+            {
+                MESSAGE_AddVirtualPayload(
+                    node, tmpMsg, curPayloadLen - realLen);
+            }
         }
         else
         {
@@ -15997,8 +16332,8 @@ IpFragmentPacket(
         // needed for distinguishing SDR control packets from others
         // in SINCGARS
         IpHeaderSetIpReserved(&(ipHeader->ipFragment),
-            IpHeaderGetIpReserved(originalIpHdr->ipFragment));
-        ipHeader->ip_sum = originalIpHdr->ip_sum;
+            IpHeaderGetIpReserved(originalIpHdr.ipFragment));
+        ipHeader->ip_sum = originalIpHdr.ip_sum;
 #endif
 #ifdef ADDON_DB
         // Adding the info fields for the Fragmented message
@@ -16017,23 +16352,51 @@ IpFragmentPacket(
 
     } // end of creating all fragments
 
-    MEM_free(originalIpHdr);
     ip->ipFragmentId++;
     ip->stats.ipFragOKs++;
     return TRUE;
 } // end of fragmentation.
 
 
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentScheduleTimer
+// PURPOSE             :: Make sure the reassembly timer is pending for the
+//                        deadline of the oldest queue, if there is one.
+// PARAMETERS          ::
+// +node                : Node* node    : Pointer to node
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// RETURN               : None
+//---------------------------------------------------------------------------
+
+static void
+IpFragmentScheduleTimer(Node* node, NetworkDataIp* ip)
+{
+    if (ip->fragmentListFirst == NULL || ip->fragmentTimer != NULL)
+    {
+        return;
+    }
+
+    ip->fragmentTimer = MESSAGE_Alloc(node,
+                                      NETWORK_LAYER,
+                                      NETWORK_PROTOCOL_IP,
+                                      MSG_NETWORK_IpFragmentTimer);
+
+    MESSAGE_Send(node,
+                 ip->fragmentTimer,
+                 ip->fragmentListFirst->fragHoldTime - getSimTime(node));
+}
+
+
 //---------------------------------------------------------------------------
 // FUNCTION             : IpDeleteFragmentedPacket
-// PURPOSE             :: This function deletes all the fragmented packet.
+// PURPOSE             :: This function deletes all the fragments of a
+//                        datagram and its reassembly queue.
 // PARAMETERS          ::
 // +node                : Node* node    : Pointer to node
-// +ipv6                : NetworkDataIp* ip: Ip data pointer of node.
-// +prevFp              : IpFragQueue** prevFp: Pointer to the pointer of
-//                                      previous fragment queue.
-// +fp                  : IpFragQueue** fp: Pointer to the pointer of
-//                                      fragment queue.
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +fp                  : IpFragQueue* fp: Fragment queue to delete.
+// +comment             : PacketActionCommentType comment: Reason of the
+//                                      drop, for the trace.
 // RETURN               : None
 // NOTES                : fragmented header processing function
 //---------------------------------------------------------------------------
@@ -16042,33 +16405,119 @@ static void
 IpDeleteFragmentedPacket(
     Node* node,
     NetworkDataIp* ip,
-    IpFragQueue** prevFp,
-    IpFragQueue** fp)
+    IpFragQueue* fp,
+    PacketActionCommentType comment)
 {
-    IpFragQueue* tempFp = NULL;
-    IpFragData* tempFrg = (*fp)->firstMsg;
+    IpFragData* tempFrg = fp->firstMsg;
     IpFragData* grbFrg = NULL;
 
+    ActionData acnData;
+    NetworkType netType = NETWORK_IPV4;
+
     while (tempFrg)
     {
         grbFrg = tempFrg;
         tempFrg = tempFrg->nextMsg;
+
+        //Trace drop
+        acnData.actionType = DROP;
+        acnData.actionComment = comment;
+        TRACE_PrintTrace(node,
+                         grbFrg->msg,
+                         TRACE_NETWORK_LAYER,
+                         PACKET_IN,
+                         &acnData,
+                         netType);
+
         MESSAGE_Free(node, grbFrg->msg);
         MEM_free(grbFrg);
         ip->stats.ipReasmFails++;
         ip->stats.ipFragsInBuff--;
     }
-    if ((*prevFp))
+
+    IpFragmentUnlinkQueue(ip, fp);
+    MEM_free(fp);
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentExpire
+// PURPOSE             :: Delete the reassembly queues whose hold time has
+//                        passed and rearm the reassembly timer. Every
+//                        queue has the same hold time, so the queues
+//                        expire in the order they were created.
+// PARAMETERS          ::
+// +node                : Node* node    : Pointer to node
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// RETURN               : None
+//---------------------------------------------------------------------------
+
+static void
+IpFragmentExpire(Node* node, NetworkDataIp* ip)
+{
+    IpFragQueue* fp;
+
+    while ((fp = IpFragmentExpiredQueue(ip, getSimTime(node))) != NULL)
     {
-        (*prevFp)->next = (*fp)->next;
+        ip->stats.ipReasmTimeouts++;
+        IpDeleteFragmentedPacket(node, ip, fp, DROP_LIFETIME_EXPIRY);
     }
-    else
+
+    IpFragmentScheduleTimer(node, ip);
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentHandleTimer
+// PURPOSE             :: Handle the reassembly timer.
+// PARAMETERS          ::
+// +node                : Node* node    : Pointer to node
+// +msg                 : Message* msg  : The timer message
+// RETURN               : None
+//---------------------------------------------------------------------------
+
+void
+IpFragmentHandleTimer(Node* node, Message* msg)
+{
+    NetworkDataIp* ip = (NetworkDataIp *) node->networkData.networkVar;
+
+    ip->fragmentTimer = NULL;
+    MESSAGE_Free(node, msg);
+
+    IpFragmentExpire(node, ip);
+}
+
+
+//---------------------------------------------------------------------------
+// FUNCTION             : IpFragmentMakeRoom
+// PURPOSE             :: Delete reassembly queues, oldest first, until
+//                        size more bytes fit in the reassembly buffer.
+//                        The queue keep is never deleted.
+// PARAMETERS          ::
+// +node                : Node* node    : Pointer to node
+// +ip                  : NetworkDataIp* ip: Ip data pointer of node.
+// +keep                : IpFragQueue* keep: Queue the bytes are for,
+//                                      NULL if it is a new one.
+// +size                : unsigned int size: Bytes to make room for.
+// RETURN               : BOOL : TRUE if the bytes fit.
+//---------------------------------------------------------------------------
+
+static BOOL
+IpFragmentMakeRoom(
+    Node* node,
+    NetworkDataIp* ip,
+    IpFragQueue* keep,
+    unsigned int size)
+{
+    IpFragQueue* fp;
+
+    while ((fp = IpFragmentEvictionVictim(ip, keep, size)) != NULL)
     {
-        ip->fragmentListFirst = (*fp)->next;
+        ip->stats.ipReasmEvictions++;
+        IpDeleteFragmentedPacket(node, ip, fp, DROP_BUFFER_SIZE_EXCEED);
     }
-    tempFp = (*fp);
-    (*fp) = (*fp)->next;
-    MEM_free(tempFp);
+
+    return (BOOL) (ip->fragmentBufferedBytes + size <= ip->ipFragBufferSize);
 }
 
 
@@ -16094,8 +16543,8 @@ IpFragmentInput(Node* node, Message* msg, int interfaceId, BOOL* isReassembled)
 
     IpHeaderType* ipHeader = (IpHeaderType *) payload;
 
-    IpFragQueue* prevFp = NULL;
-    IpFragQueue* fp = ip->fragmentListFirst;
+    IpFragQueue* fp = NULL;
+    IpFragData* prevFragMsg = NULL;
 
     ActionData acnData;
     NetworkType netType = NETWORK_IPV4;
@@ -16179,110 +16628,94 @@ IpFragmentInput(Node* node, Message* msg, int interfaceId, BOOL* isReassembled)
          return NULL;
     }
 
-    while (fp)
-    {
-        // Look for queue of fragments of this datagram.
-        if (ipHeader->ip_id == fp->ipFrg_id &&
-            (ipHeader->ip_src == fp->ipFrg_src) &&
-            (ipHeader->ip_dst == fp->ipFrg_dst))
-        {
-            break;
-        }
-        // Delete all the fragmented packets whose time has expired.
-        if (getSimTime(node) >= fp->fragHoldTime)
-        {
-            IpDeleteFragmentedPacket(node, ip, &prevFp, &fp);
-        }// end of deleting.
-        else
-        {
-            prevFp = fp;
-            fp = fp->next;
-        }
-    }
+    // Delete all the fragmented packets whose time has expired.
+    IpFragmentExpire(node, ip);
 
-    // Now add the fragment in the buffer.
-    IpFragData* newFragMsg = NULL;
+    // Look for queue of fragments of this datagram.
+    fp = IpFragmentFindQueue(ip, ipHeader);
+
+    // Find the place of the fragment in the queue, which is sorted by
+    // fragment offset. prevFragMsg stays NULL if it goes in the front.
     if (fp)
     {
-        IpFragData* temp = fp->firstMsg;
-        char* tempPayload = MESSAGE_ReturnPacket(temp->msg);
-        IpHeaderType* tempIpHeader = (IpHeaderType *)tempPayload;
+        IpFragData* temp = NULL;
         int msgFragOff = IpHeaderGetIpFragOffset(ipHeader->ipFragment) << 3;
-        int currentFragOff =
-            IpHeaderGetIpFragOffset(tempIpHeader->ipFragment)<< 3;
 
-        // if this fragment offset is less than the starting fragment
-        // offset so put it in the front
-        if (currentFragOff > msgFragOff)
-        {
-            newFragMsg = (IpFragData*) MEM_malloc(sizeof(IpFragData));
-            newFragMsg->nextMsg = fp->firstMsg;
-            fp->firstMsg = newFragMsg;
-        }
-        else
+        for (temp = fp->firstMsg; temp != NULL; temp = temp->nextMsg)
         {
-            IpFragData* prevTemp = temp;
-            for (;
-                temp != NULL; temp = temp->nextMsg)
-               {
-                   tempPayload = MESSAGE_ReturnPacket(temp->msg);
-                   tempIpHeader = (IpHeaderType *)tempPayload;
-                   msgFragOff = IpHeaderGetIpFragOffset(
-                       ipHeader->ipFragment) << 3;
-                   currentFragOff = IpHeaderGetIpFragOffset(
-                       tempIpHeader->ipFragment) << 3;
-
-                   if (currentFragOff == msgFragOff)
-                   {
-                       MESSAGE_Free(node, msg);
-                       return NULL;
-                   }
-
-                   if (currentFragOff > msgFragOff)
-                   {
-                       break;
-                   }
-                   prevTemp = temp;
-               }
-               newFragMsg = (IpFragData*) MEM_malloc(sizeof(IpFragData));
-               newFragMsg->nextMsg = prevTemp->nextMsg;
-               prevTemp->nextMsg = newFragMsg;
-         }
+            IpHeaderType* tempIpHeader =
+                (IpHeaderType *) MESSAGE_ReturnPacket(temp->msg);
+            int currentFragOff =
+                IpHeaderGetIpFragOffset(tempIpHeader->ipFragment) << 3;
 
+            if (currentFragOff == msgFragOff)
+            {
+                MESSAGE_Free(node, msg);
+                return NULL;
+            }
+
+            if (currentFragOff > msgFragOff)
+            {
+                break;
+            }
+            prevFragMsg = temp;
+        }
     }
-    else
+
+    // Keep the reassembly buffer within its size.
+    if (!IpFragmentMakeRoom(node, ip, fp, (unsigned) packetLen))
     {
-        if (!prevFp)
-        {
-            ip->fragmentListFirst =
-                (IpFragQueue*) MEM_malloc(sizeof(IpFragQueue));
-            fp = ip->fragmentListFirst;
-        }
-        else
+        // Only this datagram is left and it does not fit, so it can
+        // never be reassembled.
+        ip->stats.ipReasmEvictions++;
+
+        if (fp)
         {
-            prevFp->next =
-                (IpFragQueue*) MEM_malloc(sizeof(IpFragQueue));
-            fp = prevFp->next;
+            IpDeleteFragmentedPacket(node, ip, fp, DROP_BUFFER_SIZE_EXCEED);
         }
 
-        fp->firstMsg = (IpFragData*) MEM_malloc(sizeof(IpFragData));
-        fp->firstMsg->nextMsg = NULL;
-        newFragMsg = fp->firstMsg;
-        fp->ipFrg_id = ipHeader->ip_id;
-        fp->ipFrg_src = ipHeader->ip_src;
-        fp->ipFrg_dst = ipHeader->ip_dst;
+        ip->stats.ipReasmFails++;
+        *isReassembled = FALSE;
+        //Trace drop
+        acnData.actionType = DROP;
+        acnData.actionComment = DROP_BUFFER_SIZE_EXCEED;
+        TRACE_PrintTrace(node,
+                         msg,
+                         TRACE_NETWORK_LAYER,
+                         PACKET_IN,
+                         &acnData,
+                         netType);
+
+        MESSAGE_Free(node, msg);
+        return NULL;
+    }
 
-        fp->actualacketSize = IpHeaderGetIpLength(ipHeader->ip_v_hl_tos_len);
-        fp->totalFragmentSize = 0;
+    // Now add the fragment in the buffer.
+    if (!fp)
+    {
+        fp = IpFragmentNewQueue(
+                 ip, ipHeader, getSimTime(node) + ip->ipFragHoldTime);
+        IpFragmentScheduleTimer(node, ip);
+    }
+
+    IpFragData* newFragMsg = (IpFragData*) MEM_malloc(sizeof(IpFragData));
 
-        fp->fragHoldTime = getSimTime(node) + ip->ipFragHoldTime;
-        fp->next = NULL;
+    if (prevFragMsg)
+    {
+        newFragMsg->nextMsg = prevFragMsg->nextMsg;
+        prevFragMsg->nextMsg = newFragMsg;
+    }
+    else
+    {
+        newFragMsg->nextMsg = fp->firstMsg;
+        fp->firstMsg = newFragMsg;
     }
 
     ip->stats.ipFragsInBuff++;
     newFragMsg->msg = msg;
     fp->totalFragmentSize += MESSAGE_ReturnPacketSize(msg) -
             sizeof(IpHeaderType);
+    IpFragmentChargeBuffer(ip, fp, (unsigned) packetLen);
 
     // Not all the fragment packet received yet so wait for all to
     // come till atleast hold time
@@ -16294,29 +16727,18 @@ IpFragmentInput(Node* node, Message* msg, int interfaceId, BOOL* isReassembled)
     }
     else // This is the last fragment packet so try to ressemble it.
     {
-        if (fp)
-        {
-            // Join all the  fragmented packets then return.
-            joinedMsg = IpFragementReassamble(node, msg, fp, interfaceId);
+        // Join all the  fragmented packets then return.
+        joinedMsg = IpFragementReassamble(node, msg, fp, interfaceId);
 
-            // Delete the fragment queue head
-            if (ip->fragmentListFirst == fp)
-            {
-                ip->fragmentListFirst = fp->next;
-            }
-            else
-            {
-                prevFp->next = fp->next;
-            }
-            MEM_free(fp);
+        // Delete the fragment queue head
+        IpFragmentUnlinkQueue(ip, fp);
+        MEM_free(fp);
 
-            if (!joinedMsg)
-            {
-                *isReassembled = FALSE;
-                return NULL;
-            }
+        if (!joinedMsg)
+        {
+            *isReassembled = FALSE;
+            return NULL;
         }
-
     }
     ip->stats.ipPacketsAfterFragsReasm++;
     *isReassembled = TRUE;
@@ -16501,6 +16923,56 @@ IpFragementReassamble(Node* node, Message* msg, IpFragQueue* fp, int interfaceId
         return NULL;
     }
 
+    // If only the first fragment has real bytes, as whenever the real
+    // part of the datagram fit in one fragment, the first fragment
+    // becomes the datagram and nothing is copied.
+    if (totalLength == fp->firstMsg->msg->packetSize - hLen)
+    {
+        tempFragData = fp->firstMsg;
+        joinedMsg = tempFragData->msg;
+
+        // Remove the Ip header from the original packet.
+        NetworkIpRemoveIpHeader(
+            node,
+            joinedMsg,
+            &sourceAddress,
+            &destinationAddress,
+            &priority,
+            &protocol,
+            &hLim);
+
+        MESSAGE_AddVirtualPayload(
+            node,
+            joinedMsg,
+            totalVirtualPackeLength - joinedMsg->virtualPayLoadSize);
+        MESSAGE_SetEvent(joinedMsg, MSG_NETWORK_Ip_Fragment);
+
+        while (tempFragData != NULL)
+        {
+            ip->stats.ipReasmOKs++;
+            ip->stats.ipFragsInBuff--;
+            prevFragData = tempFragData;
+            tempFragData = tempFragData->nextMsg;
+
+            if (prevFragData->msg != joinedMsg)
+            {
+                MESSAGE_Free(node, prevFragData->msg);
+            }
+            MEM_free(prevFragData);
+        }
+
+        NetworkIpAddHeader(
+            node,
+            joinedMsg,
+            sourceAddress,
+            destinationAddress,
+            priority,
+            protocol,
+            hLim);
+
+        return joinedMsg;
+    }
+
     //Now allocate joined Message data;
     joinedMsg = MESSAGE_Alloc(node,
                            NETWORK_LAYER,
@@ -16897,6 +17369,13 @@ BOOL NetworkIpOutputQueueDequeuePacketWithIndex(
         }
         //GuiEnd
 #endif
+
+        NetworkIpQueueCheckChanswitch(
+            node,
+            scheduler,
+            interfaceIndex,
+            !(*scheduler).isEmpty(ALL_PRIORITIES),
+            TRUE);
         return TRUE;
     }
     return FALSE;
@@ -17027,6 +17506,13 @@ BOOL NetworkIpOutputQueueDequeuePacket(
                                    getSimTime(node));
         }
         //GuiEnd
+
+        NetworkIpQueueCheckChanswitch(
+            node,
+            scheduler,
+            interfaceIndex,
+            !(*scheduler).isEmpty(ALL_PRIORITIES),
+            TRUE);
     }
 
     return dequeued;
@@ -17070,9 +17556,13 @@ NetworkIpPreInitDestructor(Node *node)
         if (ip->forwardTable.allocatedSize > 0)
         {
             MEM_free(ip->forwardTable.row);
+            MEM_free(ip->forwardTable.rowNode);
             ip->forwardTable.allocatedSize = 0;
         }
 
+        NetworkForwardingTrieFree(ip->forwardTable.trieRoot);
+        ip->forwardTable.trieRoot = NULL;
+
         if (ip->multicastForwardingTable.allocatedSize > 0)
         {
             MEM_free(ip->multicastForwardingTable.row);
@@ -1441,6 +1441,21 @@ static unsigned char Ip_timestampGetOvflw (unsigned char flgOflw)
 // **/
 #define IP_FRAGMENT_HOLD_TIME  15 * SECOND
 
+// /**
+// CONSTANT    :: IP_FRAGMENT_BUFFER_SIZE : 4 * 1024 * 1024
+// DESCRIPTION :: Default number of bytes of fragments a node holds for
+//                reassembly. When the buffer is full the oldest
+//                partial datagrams are dropped first.
+// **/
+#define IP_FRAGMENT_BUFFER_SIZE  (4 * 1024 * 1024)
+
+// /**
+// CONSTANT    :: IP_FRAGMENT_HASH_SIZE : 256
+// DESCRIPTION :: Number of hash buckets of the reassembly queues.
+//                Must be a power of two.
+// **/
+#define IP_FRAGMENT_HASH_SIZE  256
+
 // /**
 // MACRO       :: IpHeaderSize(ipHeader)
 // DESCRIPTION :: Returns IP header ip_hl field * 4, which is the size of
@@ -1602,6 +1617,10 @@ struct
     // are store into CPU queue instead of internal scheduler
     // to handles all INPUT and CPU queues.
     int incomingInterface;
+
+    // Time the packet entered the queue, used to measure the
+    // head-of-line sojourn time.
+    clocktype insertTime;
 } QueuedPacketInfo;
 
 
@@ -1882,6 +1901,15 @@ struct
     D_UInt32 ipFragsCreated;
     // Number of IP datagrams after joining fragments.
     UInt32 ipPacketsAfterFragsReasm;
+    // Number of partial datagrams dropped because their hold time
+    // passed, and because the reassembly buffer was full.
+    UInt32 ipReasmTimeouts;
+    UInt32 ipReasmEvictions;
+
+    // Number of unicast route lookups that went through the route
+    // cache, and how many of them were answered from it.
+    UInt32 ipRouteCacheLookups;
+    UInt32 ipRouteCacheHits;
 
     // ATM : Number of Ip datagrams routed thru gateway
     UInt32 ipRoutePktThruGt;
@@ -1954,6 +1982,46 @@ struct
 }
 NetworkForwardingTableRow;
 
+// /**
+// STRUCT      :: NetworkForwardingTrieNode
+// DESCRIPTION :: Node of the path-compressed binary trie that indexes
+//                the forwarding table rows by prefix. A node with rows
+//                owns the rows [firstRow, firstRow + numRows) of the
+//                table, which all have its prefix; a node without rows
+//                only joins two subtrees.
+// **/
+typedef
+struct network_forwarding_trie_node_str
+{
+    NodeAddress prefix;              // masked to prefixLength bits
+    int prefixLength;
+    int firstRow;
+    int numRows;
+    struct network_forwarding_trie_node_str *child[2];
+}
+NetworkForwardingTrieNode;
+
+// /**
+// CONSTANT    :: NETWORK_ROUTE_CACHE_SIZE : 64
+// DESCRIPTION :: Number of entries of the per-node route cache in front
+//                of the forwarding table. Must be a power of two.
+// **/
+#define NETWORK_ROUTE_CACHE_SIZE 64
+
+// /**
+// STRUCT      :: NetworkRouteCacheEntry
+// DESCRIPTION :: Result of an earlier forwarding table lookup. The entry
+//                is valid only while its generation equals the table's.
+// **/
+typedef
+struct
+{
+    NodeAddress destAddress;
+    unsigned int generation;         // 0 if the entry was never filled
+    int rowIndex;                    // -1 if there was no route
+}
+NetworkRouteCacheEntry;
+
 // /**
 // STRUCT      :: NetworkForwardingTable
 // DESCRIPTION :: Structure of forwarding table.
@@ -1964,6 +2032,20 @@ struct
     int size;                        // number of entries
     int allocatedSize;
     NetworkForwardingTableRow *row;  // allocation in Init function in Ip
+
+    // Longest prefix match index over row. rowNode[i] is the trie
+    // node of row[i], NULL for a row whose mask is not contiguous or
+    // whose address has bits outside its mask. While there is such a
+    // row, lookups fall back to scanning row.
+    NetworkForwardingTrieNode *trieRoot;
+    NetworkForwardingTrieNode **rowNode;
+    int numUnindexedRows;
+
+    // Direct mapped cache of lookups by destination address. Anything
+    // that changes row, or the interfaceIsEnabled flag of a row, must
+    // increment generation, which invalidates every cached entry.
+    unsigned int generation;
+    NetworkRouteCacheEntry routeCache[NETWORK_ROUTE_CACHE_SIZE];
 }
 NetworkForwardingTable;
 
@@ -2176,14 +2258,16 @@ typedef struct ip_frag_data
 
 
 // /**
-// STRUCT      :: Ipv6FragQueue
-// DESCRIPTION :: Ipv6 fragment queue structure.
+// STRUCT      :: IpFragQueue
+// DESCRIPTION :: Reassembly queue of one datagram, keyed by
+//                (id, source, destination, protocol).
 // **/
 typedef struct ip_frag_q_struct
 {
     UInt32 ipFrg_id;
     NodeAddress ipFrg_src;
     NodeAddress ipFrg_dst;
+    unsigned char ipFrg_p;
     clocktype fragHoldTime;
     IpFragData* firstMsg;
     IpFragData* lastMsg;
@@ -2191,7 +2275,16 @@ typedef struct ip_frag_q_struct
     unsigned int actualacketSize;
     unsigned int totalFragmentSize;
 
+    // Bytes of the fragments held, counted against the node's
+    // reassembly buffer.
+    unsigned int bufferedBytes;
+
+    // Neighbours in the node's list of queues, oldest first.
+    struct ip_frag_q_struct* prev;
     struct ip_frag_q_struct* next;
+
+    // Next queue in the same hash bucket.
+    struct ip_frag_q_struct* hashNext;
 }IpFragQueue;
 
 
@@ -2362,7 +2455,16 @@ struct struct_network_ip_str
 
     // Fragment Id counter.
     UInt32 ipFragmentId;
+
+    // Reassembly queues, oldest first. Every queue gets the same hold
+    // time, so this is also the order they expire in. fragmentTimer is
+    // the pending reassembly timer, NULL if there is none.
     IpFragQueue* fragmentListFirst;
+    IpFragQueue* fragmentListLast;
+    IpFragQueue* fragmentHash[IP_FRAGMENT_HASH_SIZE];
+    unsigned int fragmentBufferedBytes;
+    unsigned int ipFragBufferSize;
+    Message* fragmentTimer;
     clocktype ipFragHoldTime;
 
 #ifndef ADDON_BOEINGFCS
@@ -5397,6 +5499,11 @@ IpFragmentInput(
     int interfaceId,
     BOOL* isReassembled);
 
+void
+IpFragmentHandleTimer(
+    Node* node,
+    Message* msg);
+
 Message*
 IpFragementReassamble(
     Node* node,
@@ -5607,6 +5714,21 @@ NetworkIpQueueInsert(
     int incomingInterface = ANY_INTERFACE,
     BOOL isOutputQueue = FALSE);
 
+//--------------------------------------------------------------------------
+// FUNCTION     NetworkIpQueueHandleChanswitchCheck()
+// PURPOSE      Periodic check of the dot11 channel switch queue trigger
+//              of an output queue, MSG_NETWORK_ChanswitchQueueCheck.
+// PARAMETERS   Node *node
+//                  Pointer to node.
+//              Message *msg
+//                  The check timer, freed here.
+// RETURN       None.
+//--------------------------------------------------------------------------
+void
+NetworkIpQueueHandleChanswitchCheck(
+    Node *node,
+    Message *msg);
+
 #ifdef ADDON_BOEINGFCS
 int NetworkIpGetOutgoingInterfaceFromAddr(Node* node,
         int interfaceIndex,
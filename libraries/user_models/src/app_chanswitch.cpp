@@ -30,6 +30,7 @@
 #include "tcpapps.h"
 #include "app_util.h"
 #include "app_chanswitch.h"
+#include "util_dbconv.h"
 
  #define DEBUG_CHANSWITCH 1
 
@@ -727,9 +728,25 @@ AppChanswitchClientEvaluateChannels(Node *node,AppDataChanswitchClient *clientPt
     int csNodeCount[NUM_CHANNELS] = { 0 }; //CS count per channel
     BOOL isHN;
     double sinr = 0.0;
+    double txPowerAtRx_mW = DBCONV_NonDb(clientPtr->signalStrengthAtRx);
+    double rxNodePower_mW[RSS_BATCH_SIZE];
+    int batchCount = 0;
+    int batchIndex = 0;
 
     //look for HN
     while(rxNode != NULL){
+        //convert the next run of neighbour signal strengths in one batch
+        if(batchIndex == batchCount){
+            DOT11_VisibleNodeInfo* batchNode = rxNode;
+            batchCount = 0;
+            while(batchNode != NULL && batchCount < RSS_BATCH_SIZE){
+                rxNodePower_mW[batchCount++] = batchNode->signalStrength;
+                batchNode = batchNode->next;
+            }
+            DBCONV_NonDbBatch(rxNodePower_mW, rxNodePower_mW, batchCount);
+            batchIndex = 0;
+        }
+
         isHN = TRUE;
         //hidden if RX sees it and TX doesn't, and the signal strength isn't strong enough for TX to negotiate
         while(txNode != NULL){
@@ -741,7 +758,7 @@ AppChanswitchClientEvaluateChannels(Node *node,AppDataChanswitchClient *clientPt
         }
 
         //verify signal strength
-        sinr = NON_DB(clientPtr->signalStrengthAtRx) / (NON_DB(rxNode->signalStrength) + clientPtr->noise_mW) ; 
+        sinr = txPowerAtRx_mW / (rxNodePower_mW[batchIndex++] + clientPtr->noise_mW) ; 
 
         if(isHN && (sinr > clientPtr->hnThreshold)){ //20 dB default
             #ifdef DEBUG_CHANSWITCH
@@ -44,6 +44,7 @@
 #define CS_MIN_DBM                 -69.0            //energy threshold for carrier sense node in dBm (default)
 #define CHANGE_BACKOFF             (1 * SECOND)
 #define NUM_CHANNELS               14               //hardcode because C++ is gross. should not be using more than this in our simulations  
+#define RSS_BATCH_SIZE             64               //neighbour signal strengths converted to mW per DBCONV batch
 
 //tx (client) states
  enum {
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include "api.h"
 #include "partition.h"
 #include "antenna.h"
@@ -9,27 +10,64 @@
 #include "antenna_steerable.h"
 #include "antenna_patterned.h"
 #include "phy_chanswitch.h"
+#include "phy_802_11_receive.h"
+#include "util_dbconv.h"
 
 #include "mac_csma.h"
 #include "mac_dot11.h"
 #include "mac_dot11-sta.h"
 
+static
+void PhyChanSwitchUpdateRateSinr(
+    PhyDataChanSwitch* phychanswitch,
+    double sinr_dB);
+
+//
+// Receive path hooks for Phy802_11Receiver. Unlike 802.11a/b, a signal
+// arriving during a transmission ends it, no signal is locked on while
+// the radio is retuning, and every frame passed up feeds the SINR rate
+// controller.
+//
+struct PhyChanSwitchModel {
+    typedef PhyDataChanSwitch PhyType;
+    typedef PhyChanSwitchPlcpHeader PlcpHeader;
+
+    enum {
+        ABORT_TX_ON_ARRIVAL = 1
+    };
+
+    static TraceProtocolType TraceProtocol() {
+        return TRACE_PHY_CHANSWITCH;
+    }
+
+    static BOOL IsRetuning(Node* node, int phyIndex) {
+        return PhyChanSwitchIsRetuning(node, phyIndex);
+    }
+
+    static void SignalLostToRetune(PhyDataChanSwitch* phychanswitch) {
+        phychanswitch->stats.totalSignalsLostToRetune++;
+    }
+
+    static void FrameReceived(PhyDataChanSwitch* phychanswitch) {
+        // The rate controller wants the plain channel SINR.
+        if (phychanswitch->rateAdaptation) {
+            PhyChanSwitchUpdateRateSinr(
+                phychanswitch,
+                DBCONV_InDb(phychanswitch->rxMsgPower_mW /
+                            (phychanswitch->interferencePower_mW +
+                             phychanswitch->noisePower_mW)));
+        }
+    }
+};
+
+typedef Phy802_11Receiver<PhyChanSwitchModel> PhyChanSwitchRx;
+
 void PhyChanSwitchChangeState(
     Node* node,
     int phyIndex,
     PhyStatusType newStatus)
 {
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyDataChanSwitch *phychanswitch = (PhyDataChanSwitch *)thisPhy->phyVar;
-    phychanswitch->previousMode = phychanswitch->mode;
-    phychanswitch->mode = newStatus;
-
-
-    Phy_ReportStatusToEnergyModel(
-        node,
-        phyIndex,
-        phychanswitch->previousMode,
-        newStatus);
+    PhyChanSwitchRx::ChangeState(node, phyIndex, newStatus);
 }
 
 double
@@ -39,256 +77,191 @@ PhyChanSwitchGetSignalStrength(Node *node,PhyDataChanSwitch* phychanswitch)
     int dataRateToUse;
     PhyChanSwitchGetLowestTxDataRateType(phychanswitch->thisPhy, &dataRateToUse);
     rxThreshold_mW = phychanswitch->rxSensitivity_mW[dataRateToUse];
-    return IN_DB(rxThreshold_mW);
+    return DBCONV_InDb(rxThreshold_mW);
 }
 
+//
+// SINR/ACK rate controller for the unicast link. The SINR of every frame
+// the PHY locks on to is averaged into rateSinr_dB, and the highest rate
+// whose minimum SINR plus margin fits under the average is the base rate.
+// ACK outcomes move rateOffset around that base: a run of failures steps
+// down, a run of successes probes one rate up, and a failed probe falls
+// straight back. Until a SINR sample exists the offset alone drives the
+// rate, which is plain ARF.
+//
+// A channel change invalidates both the SINR and the ACK history, so the
+// controller starts over; the first frame heard on the new channel sets
+// the base rate directly.
+//
 static
-void PhyChanSwitchReportExtendedStatusToMac(
-    Node *node,
-    int phyNum,
-    PhyStatusType status,
-    clocktype receiveDuration,
-    Message* potentialIncomingPacket)
-{
-    PhyData* thisPhy = node->phyData[phyNum];
-    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch *)thisPhy->phyVar;
-
-    assert(status == phychanswitch->mode);
-
-    if (potentialIncomingPacket != NULL) {
-        MESSAGE_RemoveHeader(
-            node,
-            potentialIncomingPacket,
-            sizeof(PhyChanSwitchPlcpHeader),
-            TRACE_PHY_CHANSWITCH);
-    }
-
-    MAC_ReceivePhyStatusChangeNotification(
-        node, thisPhy->macInterfaceIndex,
-        phychanswitch->previousMode, status,
-        receiveDuration, potentialIncomingPacket);
-
-    if (potentialIncomingPacket != NULL) {
-        MESSAGE_AddHeader(
-            node,
-            potentialIncomingPacket,
-            sizeof(PhyChanSwitchPlcpHeader),
-            TRACE_PHY_CHANSWITCH);
-    }
+void PhyChanSwitchResetRateControl(PhyDataChanSwitch* phychanswitch) {
+    phychanswitch->rateSinrValid = FALSE;
+    phychanswitch->rateSinr_dB = 0.0;
+    phychanswitch->rateOffset = 0;
+    phychanswitch->rateProbing = FALSE;
+    phychanswitch->rateSuccesses = 0;
+    phychanswitch->rateFailures = 0;
 }
 
-static /*inline*/
-void PhyChanSwitchReportStatusToMac(
-    Node *node, int phyNum, PhyStatusType status)
-{
-    PhyChanSwitchReportExtendedStatusToMac(
-        node, phyNum, status, 0, NULL);
-}
 
-static //inline//
-void PhyChanSwitchLockSignal(
+//
+// Start a retune to channelIndex. The radio is dead until retuneEndTime;
+// a retune that starts while another one is in progress only extends the
+// dead period, so the dead time counter never counts an interval twice.
+//
+static
+void PhyChanSwitchStartRetune(
     Node* node,
     PhyDataChanSwitch* phychanswitch,
-    Message *msg,
-    double rxPower_mW,
-    clocktype rxEndTime,
-    Orientation rxDOA)
+    int channelIndex)
 {
+    clocktype now = getSimTime(node);
+    clocktype delay =
+        phychanswitch->retuneDelay + phychanswitch->pllSettlingTime;
 
-    char *plcp = MESSAGE_ReturnPacket(msg);
-    memcpy(&phychanswitch->rxDataRateType,plcp,sizeof(int));
-
-    if (DEBUG)
+    if (phychanswitch->fastChannelSwitch &&
+        abs(channelIndex - phychanswitch->tunedChannel) == 1)
     {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: LockSignal from %d at %d\n",
-               currTime,
-               msg->originatingNodeId,
-               node->nodeId);
+        delay = phychanswitch->retuneDelay;
+        phychanswitch->stats.totalFastRetunes++;
     }
 
-    phychanswitch->rxMsg = msg;
-    phychanswitch->rxMsgError = FALSE;
-    phychanswitch->rxMsgPower_mW = rxPower_mW;
-    phychanswitch->rxTimeEvaluated = getSimTime(node);
-    phychanswitch->rxEndTime = rxEndTime;
-    phychanswitch->rxDOA = rxDOA;
-    phychanswitch->stats.totalSignalsLocked++;
-}
-
-static //inline//
-void PhyChanSwitchUnlockSignal(PhyDataChanSwitch* phychanswitch) {
-    phychanswitch->rxMsg = NULL;
-    phychanswitch->rxMsgError = FALSE;
-    phychanswitch->rxMsgPower_mW = 0.0;
-    phychanswitch->rxTimeEvaluated = 0;
-    phychanswitch->rxEndTime = 0;
-    phychanswitch->rxDOA.azimuth = 0;
-    phychanswitch->rxDOA.elevation = 0;
-}
-
-static /*inline*/
-BOOL PhyChanSwitchCarrierSensing(Node* node, PhyDataChanSwitch* phychanswitch) {
+    phychanswitch->tunedChannel = channelIndex;
+    phychanswitch->stats.totalRetunes++;
 
-    double rxSensitivity_mW = phychanswitch->rxSensitivity_mW[0];
+    if (phychanswitch->rateAdaptation) {
+        PhyChanSwitchResetRateControl(phychanswitch);
+        phychanswitch->stats.totalRateResets++;
+    }
 
-    if (!ANTENNA_IsInOmnidirectionalMode(node, phychanswitch->
-        thisPhy->phyIndex)) {
-        rxSensitivity_mW =
-            NON_DB(IN_DB(rxSensitivity_mW) +
-                   phychanswitch->directionalAntennaGain_dB);
-    }//if//
+    if (now + delay > phychanswitch->retuneEndTime) {
+        phychanswitch->stats.retuneDeadTime +=
+            now + delay - MAX(now, phychanswitch->retuneEndTime);
+        phychanswitch->retuneEndTime = now + delay;
+    }
 
-    if ((phychanswitch->interferencePower_mW + phychanswitch->noisePower_mW) >
-        rxSensitivity_mW)
+    if (DEBUG)
     {
-        return TRUE;
+        char clockStr[MAX_STRING_LENGTH];
+        TIME_PrintClockInSecond(delay, clockStr);
+        printf("PHY_ChanSwitch: node %d retuning to channel %d for %s s\n",
+               node->nodeId, channelIndex, clockStr);
     }
-
-    return FALSE;
 }
 
 
+BOOL PhyChanSwitchIsRetuning(Node* node, int phyIndex) {
+    PhyDataChanSwitch* phychanswitch =
+        (PhyDataChanSwitch*)node->phyData[phyIndex]->phyVar;
 
-static //inline//
-BOOL PhyChanSwitchCheckRxPacketError(
-    Node* node,
+    return (getSimTime(node) < phychanswitch->retuneEndTime);
+}
+
+
+static
+void PhyChanSwitchUpdateRateSinr(
     PhyDataChanSwitch* phychanswitch,
-    double *sinrPtr)
+    double sinr_dB)
 {
-    double sinr;
-    double BER;
-    double noise =
-        phychanswitch->thisPhy->noise_mW_hz * phychanswitch->channelBandwidth;
+    if (!phychanswitch->rateSinrValid) {
+        phychanswitch->rateSinr_dB = sinr_dB;
+        phychanswitch->rateSinrValid = TRUE;
+        return;
+    }
 
-    assert(phychanswitch->rxMsgError == FALSE);
+    phychanswitch->rateSinr_dB +=
+        PHY_CHANSWITCH_RATE_SINR_EWMA_WEIGHT *
+        (sinr_dB - phychanswitch->rateSinr_dB);
+}
 
 
-    sinr = (phychanswitch->rxMsgPower_mW /
-            (phychanswitch->interferencePower_mW + noise));
-    
-    // if(node->nodeId < 3) {
-    //     printf("PhyChanSwitchCheckRxPacketError sinr = %f, rx msg power = %f, int+noise = %f at node %d \n", 
-    //     IN_DB(sinr),IN_DB(phychanswitch->rxMsgPower_mW),IN_DB(phychanswitch->interferencePower_mW + noise),node->nodeId);
+static
+int PhyChanSwitchGetBaseRateType(PhyDataChanSwitch* phychanswitch) {
+    int rateType = phychanswitch->lowestDataRateType;
 
-    // }
+    if (!phychanswitch->rateSinrValid) {
+        return rateType;
+    }
 
-    if (sinrPtr != NULL)
+    while (rateType < phychanswitch->highestDataRateType &&
+           PhyChanSwitchTraits::MinSinr_dB(rateType + 1) +
+           phychanswitch->rateSinrMargin_dB <= phychanswitch->rateSinr_dB)
     {
-        *sinrPtr = sinr;
+        rateType++;
     }
 
-    assert(phychanswitch->rxDataRateType >= 0 &&
-           phychanswitch->rxDataRateType < phychanswitch->numDataRates);
+    return rateType;
+}
 
-    BER = PHY_BER(phychanswitch->thisPhy,
-                  phychanswitch->rxDataRateType,
-                  sinr);
 
-    if (BER != 0.0) {
-        double numBits =
-            ((double)(getSimTime(node) - phychanswitch->rxTimeEvaluated) *
-             (double)phychanswitch->dataRate[phychanswitch->rxDataRateType] /
-             (double)SECOND);
+BOOL PhyChanSwitchRateAdaptationEnabled(Node* node, int phyIndex) {
+    PhyDataChanSwitch* phychanswitch =
+        (PhyDataChanSwitch*)node->phyData[phyIndex]->phyVar;
 
-        double errorProbability = 1.0 - pow((1.0 - BER), numBits);
-        double rand = RANDOM_erand(phychanswitch->thisPhy->seed);
+    return phychanswitch->rateAdaptation;
+}
 
-        assert((errorProbability >= 0.0) && (errorProbability <= 1.0));
 
-        if (errorProbability > rand) {
-            return TRUE;
-        }
-    }
+int PhyChanSwitchSelectTxDataRateType(Node* node, int phyIndex) {
+    PhyDataChanSwitch* phychanswitch =
+        (PhyDataChanSwitch*)node->phyData[phyIndex]->phyVar;
+    int baseRateType = PhyChanSwitchGetBaseRateType(phychanswitch);
 
-    return FALSE;
+    return MIN(phychanswitch->highestDataRateType,
+               MAX(phychanswitch->lowestDataRateType,
+                   baseRateType + phychanswitch->rateOffset));
 }
 
-static
-void PhyChanSwitchaInitializeDefaultParameters(Node* node, int phyIndex) {
+
+void PhyChanSwitchReportTxOutcome(Node* node, int phyIndex, BOOL success) {
     PhyDataChanSwitch* phychanswitch =
-        (PhyDataChanSwitch*)(node->phyData[phyIndex]->phyVar);
+        (PhyDataChanSwitch*)node->phyData[phyIndex]->phyVar;
+    int baseRateType;
 
+    if (!phychanswitch->rateAdaptation) {
+        return;
+    }
 
-    phychanswitch->numDataRates = PHY_CHANSWITCH_NUM_DATA_RATES;
-
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH__6M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER__6M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH__9M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER__9M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_12M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_12M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_18M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_18M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_24M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_24M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_36M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_36M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_48M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_48M_dBm;
-    phychanswitch->txDefaultPower_dBm[PHY_CHANSWITCH_54M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_54M_dBm;
-
-
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH__6M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__6M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH__9M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__9M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_12M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_12M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_18M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_18M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_24M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_24M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_36M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_36M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_48M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_48M_dBm);
-    phychanswitch->rxSensitivity_mW[PHY_CHANSWITCH_54M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_54M_dBm);
-
-
-    phychanswitch->dataRate[PHY_CHANSWITCH__6M] = PHY_CHANSWITCH_DATA_RATE__6M;
-    phychanswitch->dataRate[PHY_CHANSWITCH__9M] = PHY_CHANSWITCH_DATA_RATE__9M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_12M] = PHY_CHANSWITCH_DATA_RATE_12M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_18M] = PHY_CHANSWITCH_DATA_RATE_18M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_24M] = PHY_CHANSWITCH_DATA_RATE_24M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_36M] = PHY_CHANSWITCH_DATA_RATE_36M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_48M] = PHY_CHANSWITCH_DATA_RATE_48M;
-    phychanswitch->dataRate[PHY_CHANSWITCH_54M] = PHY_CHANSWITCH_DATA_RATE_54M;
-
-
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH__6M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__6M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH__9M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__9M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_12M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_12M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_18M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_18M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_24M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_24M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_36M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_36M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_48M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_48M;
-    phychanswitch->numDataBitsPerSymbol[PHY_CHANSWITCH_54M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_54M;
-
-
-    phychanswitch->lowestDataRateType = PHY_CHANSWITCH_LOWEST_DATA_RATE_TYPE;
-    phychanswitch->highestDataRateType = PHY_CHANSWITCH_HIGHEST_DATA_RATE_TYPE;
-    phychanswitch->txDataRateTypeForBC = PHY_CHANSWITCH_DATA_RATE_TYPE_FOR_BC;
-
-    phychanswitch->channelBandwidth = PHY_CHANSWITCH_CHANNEL_BANDWIDTH;
-    phychanswitch->rxTxTurnaroundTime = PHY_CHANSWITCH_RX_TX_TURNAROUND_TIME;
+    baseRateType = PhyChanSwitchGetBaseRateType(phychanswitch);
 
+    if (success) {
+        phychanswitch->rateFailures = 0;
+        phychanswitch->rateProbing = FALSE;
+        phychanswitch->rateSuccesses++;
 
+        // With a SINR estimate, probe at most one rate above it.
+        int maxOffset = phychanswitch->rateSinrValid ?
+            1 : phychanswitch->highestDataRateType - baseRateType;
 
-    return;
+        if (phychanswitch->rateSuccesses >=
+                PHY_CHANSWITCH_RATE_SUCCESSES_FOR_PROBE &&
+            phychanswitch->rateOffset < maxOffset &&
+            baseRateType + phychanswitch->rateOffset <
+                phychanswitch->highestDataRateType)
+        {
+            phychanswitch->rateOffset++;
+            phychanswitch->rateProbing = TRUE;
+            phychanswitch->rateSuccesses = 0;
+        }
+    }
+    else {
+        phychanswitch->rateSuccesses = 0;
+        phychanswitch->rateFailures++;
+
+        if ((phychanswitch->rateProbing ||
+             phychanswitch->rateFailures >=
+                PHY_CHANSWITCH_RATE_FAILURES_FOR_DROP) &&
+            baseRateType + phychanswitch->rateOffset >
+                phychanswitch->lowestDataRateType)
+        {
+            phychanswitch->rateOffset--;
+            phychanswitch->rateFailures = 0;
+        }
+        phychanswitch->rateProbing = FALSE;
+    }
 }
 
+
 static
 void PhyChanSwitchaSetUserConfigurableParameters(
     Node* node,
@@ -516,191 +489,6 @@ void PhyChanSwitchaSetUserConfigurableParameters(
 
 
 
-static
-void PhyChanSwitchbInitializeDefaultParameters(Node* node, int phyIndex) {
-    PhyDataChanSwitch* phychanswitchb =
-        (PhyDataChanSwitch*)(node->phyData[phyIndex]->phyVar);
-
-
-    phychanswitchb->numDataRates = PHY_CHANSWITCH_NUM_DATA_RATES;
-
-    phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH__1M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER__1M_dBm;
-    phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH__2M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER__2M_dBm;
-    phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCHb__6M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER__6M_dBm;
-    phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH_11M] =
-        PHY_CHANSWITCH_DEFAULT_TX_POWER_11M_dBm;
-
-
-    phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__1M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__1M_dBm);
-    phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__2M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__2M_dBm);
-    phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__6M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__6M_dBm);
-    phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH_11M] =
-        NON_DB(PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_11M_dBm);
-
-
-    phychanswitchb->dataRate[PHY_CHANSWITCH__1M] = PHY_CHANSWITCH_DATA_RATE__1M;
-    phychanswitchb->dataRate[PHY_CHANSWITCH__2M] = PHY_CHANSWITCH_DATA_RATE__2M;
-    phychanswitchb->dataRate[PHY_CHANSWITCH__6M] = PHY_CHANSWITCH_DATA_RATE__6M;
-    phychanswitchb->dataRate[PHY_CHANSWITCH_11M] = PHY_CHANSWITCH_DATA_RATE_11M;
-
-
-    phychanswitchb->numDataBitsPerSymbol[PHY_CHANSWITCH__1M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__1M;
-    phychanswitchb->numDataBitsPerSymbol[PHY_CHANSWITCH__2M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__2M;
-    phychanswitchb->numDataBitsPerSymbol[PHY_CHANSWITCH__6M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__6M;
-    phychanswitchb->numDataBitsPerSymbol[PHY_CHANSWITCH_11M] =
-        PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_11M;
-
-
-    phychanswitchb->lowestDataRateType = PHY_CHANSWITCH_LOWEST_DATA_RATE_TYPE;
-    phychanswitchb->highestDataRateType = PHY_CHANSWITCH_HIGHEST_DATA_RATE_TYPE;
-    phychanswitchb->txDataRateTypeForBC = PHY_CHANSWITCH_DATA_RATE_TYPE_FOR_BC;
-
-    phychanswitchb->rxDataRateType = PHY_CHANSWITCH_LOWEST_DATA_RATE_TYPE;
-
-    phychanswitchb->channelBandwidth = PHY_CHANSWITCH_CHANNEL_BANDWIDTH;
-    phychanswitchb->rxTxTurnaroundTime = PHY_CHANSWITCH_RX_TX_TURNAROUND_TIME;
-
-    return;
-}
-
-
-
-static
-void PhyChanSwitchbSetUserConfigurableParameters(
-    Node* node,
-    int phyIndex,
-    const NodeInput *nodeInput)
-{
-    double rxSensitivity_dBm;
-    double txPower_dBm;
-    BOOL   wasFound;
-
-    PhyDataChanSwitch* phychanswitchb =
-        (PhyDataChanSwitch*)(node->phyData[phyIndex]->phyVar);
-
-
-    //
-    // Set PHY_CHANSWITCH-TX-POWER's
-    //
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-TX-POWER--1MBPS",
-        &wasFound,
-        &txPower_dBm);
-
-    if (wasFound) {
-        phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH__1M] = (float)txPower_dBm;
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-TX-POWER--2MBPS",
-        &wasFound,
-        &txPower_dBm);
-
-    if (wasFound) {
-        phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH__2M] = (float)txPower_dBm;
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-TX-POWER--6MBPS",
-        &wasFound,
-        &txPower_dBm);
-
-    if (wasFound) {
-        phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH__6M] = (float)txPower_dBm;
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-TX-POWER-11MBPS",
-        &wasFound,
-        &txPower_dBm);
-
-    if (wasFound) {
-        phychanswitchb->txDefaultPower_dBm[PHY_CHANSWITCH_11M] = (float)txPower_dBm;
-    }
-
-
-    //
-    // Set PHY_CHANSWITCH-RX-SENSITIVITY's
-    //
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-RX-SENSITIVITY--1MBPS",
-        &wasFound,
-        &rxSensitivity_dBm);
-
-    if (wasFound) {
-        phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__1M] =
-            NON_DB(rxSensitivity_dBm);
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-RX-SENSITIVITY--2MBPS",
-        &wasFound,
-        &rxSensitivity_dBm);
-
-    if (wasFound) {
-        phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__2M] =
-            NON_DB(rxSensitivity_dBm);
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-RX-SENSITIVITY--6MBPS",
-        &wasFound,
-        &rxSensitivity_dBm);
-
-    if (wasFound) {
-        phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH__6M] =
-            NON_DB(rxSensitivity_dBm);
-    }
-
-    IO_ReadDouble(
-        node->nodeId,
-        node->phyData[phyIndex]->networkAddress,
-        nodeInput,
-        "PHY_CHANSWITCH-RX-SENSITIVITY-11MBPS",
-        &wasFound,
-        &rxSensitivity_dBm);
-
-    if (wasFound) {
-        phychanswitchb->rxSensitivity_mW[PHY_CHANSWITCH_11M] =
-            NON_DB(rxSensitivity_dBm);
-    }
-
-
-    return;
-}
-
-
-
 void PhyChanSwitchInit(
     Node *node,
     const int phyIndex,
@@ -797,6 +585,30 @@ void PhyChanSwitchInit(
             new D_ClocktypeObj(&phychanswitch->stats.turnOnTime));
     }
 
+    if (h->CreatePhyPath(
+            node,
+            phyIndex,
+            "ChanSwitch",
+            "totalRetunes",
+            path))
+    {
+        h->AddObject(
+            path,
+            new D_Int32Obj(&phychanswitch->stats.totalRetunes));
+    }
+
+    if (h->CreatePhyPath(
+            node,
+            phyIndex,
+            "ChanSwitch",
+            "retuneDeadTime",
+            path))
+    {
+        h->AddObject(
+            path,
+            new D_ClocktypeObj(&phychanswitch->stats.retuneDeadTime));
+    }
+
     if (h->CreatePhyPath(
             node,
             phyIndex,
@@ -838,7 +650,10 @@ void PhyChanSwitchInit(
 
 
     if (node->phyData[phyIndex]->phyModel == PHY_CHANSWITCH){
-        PhyChanSwitchaInitializeDefaultParameters(node, phyIndex);
+        PhyChanSwitchCore::InitializeDefaultRates(phychanswitch);
+        phychanswitch->channelBandwidth = PHY_CHANSWITCH_CHANNEL_BANDWIDTH;
+        phychanswitch->rxTxTurnaroundTime =
+            PHY_CHANSWITCH_RX_TX_TURNAROUND_TIME;
         PhyChanSwitchaSetUserConfigurableParameters(node, phyIndex, nodeInput);
     }
     else {
@@ -875,7 +690,7 @@ void PhyChanSwitchInit(
 
         if (wasFound1) {
             for (i = 0; i < phychanswitch->numDataRates; i++) {
-                if (dataRate == phychanswitch->dataRate[i]) {
+                if (dataRate == PhyChanSwitchCore::DataRate(i)) {
                     break;
                 }
             }
@@ -897,6 +712,41 @@ void PhyChanSwitchInit(
 
     PhyChanSwitchSetLowestTxDataRateType(phychanswitch->thisPhy);
 
+    //
+    // Set PHY_CHANSWITCH-RATE-ADAPTATION and PHY_CHANSWITCH-RATE-SINR-MARGIN
+    //
+    IO_ReadBool(
+        node->nodeId,
+        node->phyData[phyIndex]->networkAddress,
+        nodeInput,
+        "PHY_CHANSWITCH-RATE-ADAPTATION",
+        &wasFound,
+        &yes);
+
+    phychanswitch->rateAdaptation = (wasFound && yes == TRUE);
+
+    if (phychanswitch->rateAdaptation &&
+        phychanswitch->lowestDataRateType ==
+            phychanswitch->highestDataRateType)
+    {
+        ERROR_ReportError(
+            "PHY_CHANSWITCH-RATE-ADAPTATION needs "
+            "PHY_CHANSWITCH-AUTO-RATE-FALLBACK turned on");
+    }
+
+    phychanswitch->rateSinrMargin_dB =
+        PHY_CHANSWITCH_DEFAULT_RATE_SINR_MARGIN_dB;
+
+    IO_ReadDouble(
+        node->nodeId,
+        node->phyData[phyIndex]->networkAddress,
+        nodeInput,
+        "PHY_CHANSWITCH-RATE-SINR-MARGIN",
+        &wasFound,
+        &(phychanswitch->rateSinrMargin_dB));
+
+    PhyChanSwitchResetRateControl(phychanswitch);
+
     //
     // Set PHYCHANSWITCH-DATA-RATE-FOR-BROADCAST
     //
@@ -910,7 +760,7 @@ void PhyChanSwitchInit(
 
     if (wasFound) {
         for (i = 0; i < phychanswitch->numDataRates; i++) {
-            if (dataRateForBroadcast == phychanswitch->dataRate[i]) {
+            if (dataRateForBroadcast == PhyChanSwitchCore::DataRate(i)) {
                 break;
             }
         }
@@ -954,6 +804,51 @@ void PhyChanSwitchInit(
             "PHY_CHANSWITCH-ESTIMATED-DIRECTIONAL-ANTENNA-GAIN is missing\n");
     }
 
+    PhyChanSwitchRx::SetDirectionalSensitivity(phychanswitch);
+
+
+    //
+    // Set PHY_CHANSWITCH-RETUNE-DELAY and PHY_CHANSWITCH-PLL-SETTLING-TIME
+    //
+    phychanswitch->retuneDelay = PHY_CHANSWITCH_DEFAULT_RETUNE_DELAY;
+    phychanswitch->pllSettlingTime = PHY_CHANSWITCH_DEFAULT_PLL_SETTLING_TIME;
+
+    IO_ReadTime(
+        node->nodeId,
+        node->phyData[phyIndex]->networkAddress,
+        nodeInput,
+        "PHY_CHANSWITCH-RETUNE-DELAY",
+        &wasFound,
+        &(phychanswitch->retuneDelay));
+
+    if (wasFound && phychanswitch->retuneDelay < 0) {
+        ERROR_ReportError(
+            "PHY_CHANSWITCH-RETUNE-DELAY should not be negative\n");
+    }
+
+    IO_ReadTime(
+        node->nodeId,
+        node->phyData[phyIndex]->networkAddress,
+        nodeInput,
+        "PHY_CHANSWITCH-PLL-SETTLING-TIME",
+        &wasFound,
+        &(phychanswitch->pllSettlingTime));
+
+    if (wasFound && phychanswitch->pllSettlingTime < 0) {
+        ERROR_ReportError(
+            "PHY_CHANSWITCH-PLL-SETTLING-TIME should not be negative\n");
+    }
+
+    IO_ReadBool(
+        node->nodeId,
+        node->phyData[phyIndex]->networkAddress,
+        nodeInput,
+        "PHY_CHANSWITCH-FAST-CHANNEL-SWITCH",
+        &wasFound,
+        &yes);
+
+    phychanswitch->fastChannelSwitch = (wasFound && yes == TRUE);
+
 
     //
     // Initialize phy statistics variables
@@ -964,6 +859,16 @@ void PhyChanSwitchInit(
     phychanswitch->stats.totalTxSignals = 0;
     phychanswitch->stats.energyConsumed = 0.0;
     phychanswitch->stats.turnOnTime = getSimTime(node);
+    phychanswitch->stats.totalRetunes = 0;
+    phychanswitch->stats.totalFastRetunes = 0;
+    phychanswitch->stats.totalSignalsLostToRetune = 0;
+    phychanswitch->stats.totalTxDeferredByRetune = 0;
+    phychanswitch->stats.retuneDeadTime = 0;
+    phychanswitch->stats.totalRateResets = 0;
+    for (i = 0; i < PHY_CHANSWITCH_NUM_DATA_RATES; i++) {
+        phychanswitch->stats.txSignalsAtRate[i] = 0;
+        phychanswitch->stats.txAirtimeAtRate[i] = 0;
+    }
 
     // //add the channel checked array
     // phychanswitch->channelChecked =  new D_BOOL[numChannels];
@@ -981,6 +886,9 @@ void PhyChanSwitchInit(
     //
     phychanswitch->rxMsg = NULL;
     phychanswitch->rxMsgError = FALSE;
+    phychanswitch->rxMsgIsAggregate = FALSE;
+    phychanswitch->rxMinSinr = 0.0;
+    phychanswitch->txIsAggregate = FALSE;
     phychanswitch->rxMsgPower_mW = 0.0;
     phychanswitch->interferencePower_mW = 0.0;
     phychanswitch->noisePower_mW =
@@ -1004,6 +912,10 @@ void PhyChanSwitchInit(
     assert(i != numChannels);
     PHY_SetTransmissionChannel(node, phyIndex, i);
 
+    // The radio powers up already tuned, so no retune here.
+    phychanswitch->tunedChannel = i;
+    phychanswitch->retuneEndTime = 0;
+
     return;
 }
 
@@ -1029,6 +941,13 @@ void PhyChanSwitchChannelListeningSwitchNotification(
         {
             PhyChanSwitchTerminateCurrentTransmission(node,phyIndex);
         }
+
+        // Every channel switch path ends up here, so this is where the
+        // retune delay is charged. Re-listening to the current channel
+        // (e.g. after a transmission) is not a retune.
+        if (channelIndex != phychanswitch->tunedChannel) {
+            PhyChanSwitchStartRetune(node, phychanswitch, channelIndex);
+        }
         PHY_SignalInterference(
             node,
             phyIndex,
@@ -1037,7 +956,7 @@ void PhyChanSwitchChannelListeningSwitchNotification(
             NULL,
             &(phychanswitch->interferencePower_mW));
 
-        if (PhyChanSwitchCarrierSensing(node, phychanswitch) == TRUE) {
+        if (PhyChanSwitchRx::CarrierSensing(node, phychanswitch) == TRUE) {
             PhyChanSwitchChangeState(node,phyIndex, PHY_SENSING);
         }
         else {
@@ -1045,7 +964,7 @@ void PhyChanSwitchChannelListeningSwitchNotification(
         }
 
         if(phychanswitch->previousMode != phychanswitch->mode)
-            PhyChanSwitchReportStatusToMac(node, phyIndex, phychanswitch->mode);
+            PhyChanSwitchRx::ReportStatusToMac(node, phyIndex, phychanswitch->mode);
     }
     else if(phychanswitch->mode != PHY_TRANSMITTING)
     {
@@ -1118,7 +1037,7 @@ BOOL PhyChanSwitchMediumIsIdle(Node* node, int phyIndex) {
         NULL,
         &(phychanswitch->interferencePower_mW));
 
-    IsIdle = (!PhyChanSwitchCarrierSensing(node, phychanswitch));
+    IsIdle = (!PhyChanSwitchRx::CarrierSensing(node, phychanswitch));
     phychanswitch->interferencePower_mW = oldInterferencePower;
 
     return IsIdle;
@@ -1156,7 +1075,7 @@ BOOL PhyChanSwitchMediumIsIdleInDirection(Node* node, int phyIndex,
         NULL,
         &(phychanswitch->interferencePower_mW));
 
-    IsIdle = (!PhyChanSwitchCarrierSensing(node, phychanswitch));
+    IsIdle = (!PhyChanSwitchRx::CarrierSensing(node, phychanswitch));
     phychanswitch->interferencePower_mW = oldInterferencePower;
     ANTENNA_SetToDefaultMode(node, phyIndex);
 
@@ -1191,6 +1110,7 @@ void PhyChanSwitchFinalize(Node *node, const int phyIndex) {
     PhyData* thisPhy = node->phyData[phyIndex];
     PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
     char buf[MAX_STRING_LENGTH];
+    int i;
 	
     if (thisPhy->phyStats == FALSE) {
         return;
@@ -1214,155 +1134,65 @@ void PhyChanSwitchFinalize(Node *node, const int phyIndex) {
             (int) phychanswitch->stats.totalSignalsWithErrors);
     IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-    PhyChanSwitchChangeState(node,phyIndex, PHY_IDLE);
-
-}
-
-
-
-void PhyChanSwitchSignalArrivalFromChannel(
-    Node* node,
-    int phyIndex,
-    int channelIndex,
-    PropRxInfo *propRxInfo)
-{
-    PhyData *thisPhy = node->phyData[phyIndex];
-    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
-    char clockStr[20];
-    TIME_PrintClockInSecond(getSimTime(node), clockStr);
-    Int8 buf[MAX_STRING_LENGTH];
-
-    if(phychanswitch->mode == PHY_TRANSMITTING){
-        printf("PhyChanSwitchSignalArrivalFromChannel: terminating transmission at node %d, time %s \n",
-            node->nodeId,clockStr);
-        PhyChanSwitchTerminateCurrentTransmission(node,phyIndex);
-        PhyChanSwitchChangeState(node,phyIndex, PHY_IDLE);
+    sprintf(buf, "Channel retunes = %d",
+            (int) phychanswitch->stats.totalRetunes);
+    IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-        if(phychanswitch->previousMode != phychanswitch->mode)
-            PhyChanSwitchReportStatusToMac(node, phyIndex, phychanswitch->mode);
-    }
+    sprintf(buf, "Fast channel retunes = %d",
+            (int) phychanswitch->stats.totalFastRetunes);
+    IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-    sprintf(buf, "PhyChanSwitchSignalArrivalFromChannel: failed on node %d, time %s, mode %d \n",
-            node->nodeId, clockStr, phychanswitch->mode);
-    ERROR_Assert(phychanswitch->mode != PHY_TRANSMITTING, buf);
+    char deadTimeStr[MAX_STRING_LENGTH];
+    TIME_PrintClockInSecond(phychanswitch->stats.retuneDeadTime, deadTimeStr);
+    sprintf(buf, "Retune dead time (seconds) = %s", deadTimeStr);
+    IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-    // assert(phychanswitch->mode != PHY_TRANSMITTING);
+    sprintf(buf, "Signals lost while retuning = %d",
+            (int) phychanswitch->stats.totalSignalsLostToRetune);
+    IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
+    sprintf(buf, "Transmissions deferred by retuning = %d",
+            (int) phychanswitch->stats.totalTxDeferredByRetune);
+    IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-    if (DEBUG)
+    for (i = phychanswitch->lowestDataRateType;
+         i <= phychanswitch->highestDataRateType;
+         i++)
     {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: SignalArrival from %d at %d\n",
-               currTime,
-               propRxInfo->txMsg->originatingNodeId,
-               node->nodeId);
-    }
-    switch (phychanswitch->mode) {
-        case PHY_RECEIVING: {
-            double rxPower_mW =
-                NON_DB(ANTENNA_GainForThisSignal(node, phyIndex,
-                        propRxInfo) + propRxInfo->rxPower_dBm);
-
-
-            if (!phychanswitch->rxMsgError) {
-               phychanswitch->rxMsgError = PhyChanSwitchCheckRxPacketError(
-                   node,
-                   phychanswitch,
-                   NULL);
-            }//if//
-
-            phychanswitch->rxTimeEvaluated = getSimTime(node);
-            phychanswitch->interferencePower_mW += rxPower_mW;
-
-            break;
-        }
+        char airtimeStr[MAX_STRING_LENGTH];
 
-        //
-        // If the phy is idle or sensing,
-        // check if it can receive this signal.
-        //
-        case PHY_IDLE:
-        case PHY_SENSING:
-        {
-            double rxInterferencePower_mW = NON_DB(
-                ANTENNA_GainForThisSignal(node, phyIndex, propRxInfo) +
-                propRxInfo->rxPower_dBm);
-
-            double rxPowerInOmni_mW = NON_DB(
-                ANTENNA_DefaultGainForThisSignal(node, phyIndex, propRxInfo)
-                + propRxInfo->rxPower_dBm);
-
-            if (rxPowerInOmni_mW >= phychanswitch->rxSensitivity_mW[0]) {
-                PropTxInfo *propTxInfo
-                    = (PropTxInfo *)MESSAGE_ReturnInfo(propRxInfo->txMsg);
-                clocktype txDuration = propTxInfo->duration;
-                double rxPower_mW;
-
-                if (!ANTENNA_IsLocked(node, phyIndex)) {
-                   ANTENNA_SetToBestGainConfigurationForThisSignal(
-                       node, phyIndex, propRxInfo);
-
-                   PHY_SignalInterference(
-                       node,
-                       phyIndex,
-                       channelIndex,
-                       propRxInfo->txMsg,
-                       &rxPower_mW,
-                       &(phychanswitch->interferencePower_mW));
-                }
-                else {
-                    // ChanSwitch will listen to this signal, taken care of in SignalEnd
-                    rxPower_mW = rxInterferencePower_mW;
-                }
-
-                PhyChanSwitchLockSignal(
-                    node,
-                    phychanswitch,
-                    propRxInfo->txMsg,
-                    rxPower_mW,
-                    (propRxInfo->rxStartTime + propRxInfo->duration),
-                    propRxInfo->rxDOA);
-                PhyChanSwitchChangeState(node,phyIndex, PHY_RECEIVING);
-                PhyChanSwitchReportExtendedStatusToMac(
-                    node,
-                    phyIndex,
-                    PHY_RECEIVING,
-                    txDuration,
-                    propRxInfo->txMsg);
-            }
-            else {
-                //
-                // Otherwise, check if the signal changes the phy status
-                //
-
-                PhyStatusType newMode;
+        sprintf(buf, "Signals transmitted at %d Mbps = %d",
+                PhyChanSwitchCore::DataRate(i) / 1000000,
+                phychanswitch->stats.txSignalsAtRate[i]);
+        IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
 
-                phychanswitch->interferencePower_mW += rxInterferencePower_mW;
+        TIME_PrintClockInSecond(
+            phychanswitch->stats.txAirtimeAtRate[i], airtimeStr);
+        sprintf(buf, "Airtime at %d Mbps (seconds) = %s",
+                PhyChanSwitchCore::DataRate(i) / 1000000, airtimeStr);
+        IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
+    }
 
-                if (PhyChanSwitchCarrierSensing(node, phychanswitch)) {
-                   newMode = PHY_SENSING;
-                } else {
-                   newMode = PHY_IDLE;
-                }//if//
+    if (phychanswitch->rateAdaptation) {
+        sprintf(buf, "Rate controller resets = %d",
+                phychanswitch->stats.totalRateResets);
+        IO_PrintStat(node, "Physical", "ChanSwitch", ANY_DEST, phyIndex, buf);
+    }
 
-                if (newMode != phychanswitch->mode) {
-                    PhyChanSwitchChangeState(node,phyIndex, newMode);
-                    PhyChanSwitchReportStatusToMac(
-                        node,
-                        phyIndex,
-                        newMode);
+    PhyChanSwitchChangeState(node,phyIndex, PHY_IDLE);
 
-                }//if//
-            }//if//
+}
 
-            break;
-        }
 
-        default:
-            abort();
 
-    }//switch (phychanswitch->mode)//
+void PhyChanSwitchSignalArrivalFromChannel(
+    Node* node,
+    int phyIndex,
+    int channelIndex,
+    PropRxInfo *propRxInfo)
+{
+    PhyChanSwitchRx::SignalArrivalFromChannel<PhyChanSwitchTraits>(
+        node, phyIndex, channelIndex, propRxInfo);
 }
 
 
@@ -1372,89 +1202,14 @@ void PhyChanSwitchTerminateCurrentReceive(
     BOOL* frameError,
     clocktype* endSignalTime)
 {
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*)thisPhy->phyVar;
-
-
-    *endSignalTime = phychanswitch->rxEndTime;
-
-    if (!phychanswitch->rxMsgError) {
-       phychanswitch->rxMsgError = PhyChanSwitchCheckRxPacketError(
-           node,
-           phychanswitch,
-           NULL);
-    }//if//
-
-    *frameError = phychanswitch->rxMsgError;
-
-    if ((terminateOnlyOnReceiveError) && (!phychanswitch->rxMsgError)) {
-        return;
-    }//if//
-
-    if (thisPhy->antennaData->antennaModelType == ANTENNA_OMNIDIRECTIONAL) {
-
-        phychanswitch->interferencePower_mW += phychanswitch->rxMsgPower_mW;
-    }
-    else {
-        int channelIndex;
-        PHY_GetTransmissionChannel(node, phyIndex, &channelIndex);
-
-        ERROR_Assert(((thisPhy->antennaData->antennaModelType
-                    == ANTENNA_SWITCHED_BEAM) ||
-               (thisPhy->antennaData->antennaModelType
-                    == ANTENNA_STEERABLE) ||
-               (thisPhy->antennaData->antennaModelType
-                    == ANTENNA_PATTERNED)) ,
-                "Illegal antennaModelType");
-
-        if (!ANTENNA_IsLocked(node, phyIndex)) {
-            ANTENNA_SetToDefaultMode(node, phyIndex);
-        }//if//
-
-        PHY_SignalInterference(
-            node,
-            phyIndex,
-            channelIndex,
-            NULL,
-            NULL,
-            &(phychanswitch->interferencePower_mW));
-    }//if//
-
-
-    PhyChanSwitchUnlockSignal(phychanswitch);
-    if (PhyChanSwitchCarrierSensing(node, phychanswitch)) {
-        PhyChanSwitchChangeState(node,phyIndex, PHY_SENSING);
-    } else {
-            PhyChanSwitchChangeState(node,phyIndex, PHY_IDLE);
-
-    }//if//
+    PhyChanSwitchRx::TerminateCurrentReceive<PhyChanSwitchTraits>(
+        node, phyIndex, terminateOnlyOnReceiveError,
+        frameError, endSignalTime);
 }
 
 void PhyChanSwitchTerminateCurrentTransmission(Node* node, int phyIndex)
 {
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*)thisPhy->phyVar;
-     int channelIndex;
-    PHY_GetTransmissionChannel(node, phyIndex, &channelIndex);
-
-    //GuiStart
-    if (node->guiOption == TRUE) {
-        GUI_EndBroadcast(node->nodeId,
-                         GUI_PHY_LAYER,
-                         GUI_DEFAULT_DATA_TYPE,
-                         thisPhy->macInterfaceIndex,
-                         getSimTime(node));
-    }
-    //GuiEnd
-    assert(phychanswitch->mode == PHY_TRANSMITTING);
-
-    //Cancel the timer end message so that 'PhyChanSwitchTransmissionEnd' is
-    // not called.
-    if( phychanswitch->txEndTimer)
-    {
-        MESSAGE_CancelSelfMsg(node, phychanswitch->txEndTimer);
-        phychanswitch->txEndTimer = NULL;
-    }
+    PhyChanSwitchRx::TerminateCurrentTransmission(node, phyIndex);
 }
 
 
@@ -1466,161 +1221,11 @@ void PhyChanSwitchSignalEndFromChannel(
     int channelIndex,
     PropRxInfo *propRxInfo)
 {
-    PhyData *thisPhy = node->phyData[phyIndex];
-    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
-    double sinr = -1.0;
-
-    BOOL receiveErrorOccurred = FALSE;
-
-    if (DEBUG)
-    {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: SignalEnd from %d at %d\n",
-               currTime,
-               propRxInfo->txMsg->originatingNodeId,
-               node->nodeId);
-    }
-    assert(phychanswitch->mode != PHY_TRANSMITTING);
-
-    if (phychanswitch->mode == PHY_RECEIVING) {
-        if (phychanswitch->rxMsgError == FALSE) {
-            phychanswitch->rxMsgError = PhyChanSwitchCheckRxPacketError(
-                node,
-                phychanswitch,
-                &sinr);
-            phychanswitch->rxTimeEvaluated = getSimTime(node);
-        }//if
-    }//if//
-
-    receiveErrorOccurred = phychanswitch->rxMsgError;
-
-    //
-    // If the phy is still receiving this signal, forward the frame
-    // to the MAC layer.
-    //
-
-    if ((phychanswitch->mode == PHY_RECEIVING) &&
-        (phychanswitch->rxMsg == propRxInfo->txMsg))
-    {
-        Message *newMsg;
-
-        if (!ANTENNA_IsLocked(node, phyIndex)) {
-            ANTENNA_SetToDefaultMode(node, phyIndex);
-            //GuiStart
-            if (node->guiOption) {
-                GUI_SetPatternIndex(node,
-                                    thisPhy->macInterfaceIndex,
-                                    ANTENNA_OMNIDIRECTIONAL_PATTERN,
-                                    getSimTime(node));
-            }
-            //GuiEnd
-            PHY_SignalInterference(
-                node,
-                phyIndex,
-                channelIndex,
-                NULL,
-                NULL,
-                &(phychanswitch->interferencePower_mW));
-        }//if//
-
-        //Perform Signal measurement
-        PhySignalMeasurement sigMeasure;
-        sigMeasure.rxBeginTime = propRxInfo->rxStartTime;
-
-        double noise = phychanswitch->thisPhy->noise_mW_hz *
-                           phychanswitch->channelBandwidth;
-        if (phychanswitch->thisPhy->phyModel == PHY_CHANSWITCH &&
-            (phychanswitch->rxDataRateType == PHY_CHANSWITCH__6M ||
-             phychanswitch->rxDataRateType == PHY_CHANSWITCH_11M))
-        {
-            noise = noise * 11.0;
-        }
-
-        sigMeasure.rss = IN_DB(phychanswitch->rxMsgPower_mW);
-        sigMeasure.snr = IN_DB(phychanswitch->rxMsgPower_mW /noise);
-        sigMeasure.cinr = IN_DB(phychanswitch->rxMsgPower_mW /
-                             (phychanswitch->interferencePower_mW + noise));
-
-		// printf("PhyChanSwitchSignalEndFromChannel: rss %f, snr = %f, cinr = %f \n", sigMeasure.rss, sigMeasure.snr, sigMeasure.cinr);
-
-        PhyChanSwitchUnlockSignal(phychanswitch);
-
-        if (PhyChanSwitchCarrierSensing(node, phychanswitch) == TRUE) {
-
-            PhyChanSwitchChangeState(node,phyIndex, PHY_SENSING);
-        }
-        else {
-            PhyChanSwitchChangeState(node,phyIndex, PHY_IDLE);
-        }
-
-        if (!receiveErrorOccurred) {
-            newMsg = MESSAGE_Duplicate(node, propRxInfo->txMsg);
-
-            MESSAGE_RemoveHeader(
-                node, newMsg, sizeof(PhyChanSwitchPlcpHeader), TRACE_PHY_CHANSWITCH);
-
-            PhySignalMeasurement* signalMeaInfo;		
-            MESSAGE_InfoAlloc(node,
-                              newMsg,
-                              sizeof(PhySignalMeasurement));
-            signalMeaInfo = (PhySignalMeasurement*)
-                            MESSAGE_ReturnInfo(newMsg);
-            memcpy(signalMeaInfo,&sigMeasure,sizeof(PhySignalMeasurement));
-
-
-            MESSAGE_SetInstanceId(newMsg, (short) phyIndex);
-            MAC_ReceivePacketFromPhy(
-                node,
-                node->phyData[phyIndex]->macInterfaceIndex,
-                newMsg);
-
-            phychanswitch->stats.totalRxSignalsToMac++;
-        }
-        else {
-            // printf("receive error occurred node %d \n", node->nodeId);
-            PhyChanSwitchReportStatusToMac(
-                node,
-                phyIndex,
-                phychanswitch->mode);
-
-            phychanswitch->stats.totalSignalsWithErrors++;
-        }//if//
-    }
-    else {
-        PhyStatusType newMode;
-
-        double rxPower_mW =
-            NON_DB(ANTENNA_GainForThisSignal(node, phyIndex, propRxInfo) +
-                   propRxInfo->rxPower_dBm);
-
-        phychanswitch->interferencePower_mW -= rxPower_mW;
-
-        if (phychanswitch->interferencePower_mW < 0.0) {
-            phychanswitch->interferencePower_mW = 0.0;
-        }
-
-
-        if (phychanswitch->mode != PHY_RECEIVING) {
-           if (PhyChanSwitchCarrierSensing(node, phychanswitch) == TRUE) {
-               newMode = PHY_SENSING;
-           } else {
-               newMode = PHY_IDLE;
-           }//if//
-
-           if (newMode != phychanswitch->mode) {
-                PhyChanSwitchChangeState(node,phyIndex, newMode);
-               PhyChanSwitchReportStatusToMac(
-                   node,
-                   phyIndex,
-                   newMode);
-           }//if//
-        }//if//
-    }//if//
+    PhyChanSwitchRx::SignalEndFromChannel<PhyChanSwitchTraits>(
+        node, phyIndex, channelIndex, propRxInfo);
 }
 
 
-
 void PhyChanSwitchSetTransmitPower(PhyData *thisPhy, double newTxPower_mW) {
     PhyDataChanSwitch *phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
 
@@ -1639,14 +1244,14 @@ void PhyChanSwitchGetTransmitPower(PhyData *thisPhy, double *txPower_mW) {
 int PhyChanSwitchGetTxDataRate(PhyData *thisPhy) {
     PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
 
-    return phychanswitch->dataRate[phychanswitch->txDataRateType];
+    return PhyChanSwitchCore::DataRate(phychanswitch->txDataRateType);
 }
 
 
 int PhyChanSwitchGetRxDataRate(PhyData *thisPhy) {
     PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
 
-    return phychanswitch->dataRate[phychanswitch->rxDataRateType];
+    return PhyChanSwitchCore::DataRate(phychanswitch->rxDataRateType);
 }
 
 
@@ -1676,6 +1281,15 @@ void PhyChanSwitchSetTxDataRateType(PhyData* thisPhy, int dataRateType) {
 }
 
 
+// Marks the next frame handed to the PHY as an A-MPDU. Cleared again
+// once that frame is on the air.
+void PhyChanSwitchSetTxAggregation(PhyData* thisPhy, BOOL isAggregate) {
+    PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
+
+    phychanswitch->txIsAggregate = isAggregate;
+}
+
+
 void PhyChanSwitchGetLowestTxDataRateType(PhyData* thisPhy, int* dataRateType) {
     PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*) thisPhy->phyVar;
 
@@ -1748,17 +1362,7 @@ clocktype PhyChanSwitchGetFrameDuration(
 {
     switch (thisPhy->phyModel) {
         case PHY_CHANSWITCH: {
-            const PhyDataChanSwitch* phychanswitch = (PhyDataChanSwitch*)
-                                                thisPhy->phyVar;
-            const int numOfdmSymbols =
-                (int)ceil((size * 8 +
-                           PHY_CHANSWITCH_SERVICE_BITS_SIZE +
-                           PHY_CHANSWITCH_TAIL_BITS_SIZE) /
-                          phychanswitch->numDataBitsPerSymbol[dataRateType]);
-            return
-                PHY_CHANSWITCH_SYNCHRONIZATION_TIME +
-                (numOfdmSymbols * PHY_CHANSWITCH_OFDM_SYMBOL_DURATION) *
-                MICRO_SECOND;
+            return PhyChanSwitchCore::FrameDuration(dataRateType, size);
         }
 
         default:
@@ -1852,6 +1456,13 @@ void StartTransmittingSignal(
 #endif // NETSEC_LIB
     }//if//
 
+    // A radio that is still retuning cannot go on the air until it is done.
+    if (phychanswitch->retuneEndTime > getSimTime(node) + delayUntilAirborne)
+    {
+        delayUntilAirborne = phychanswitch->retuneEndTime - getSimTime(node);
+        phychanswitch->stats.totalTxDeferredByRetune++;
+    }
+
     assert(phychanswitch->mode != PHY_TRANSMITTING);
 
     if (sendDirectionally) {
@@ -1886,7 +1497,7 @@ void StartTransmittingSignal(
                 NULL,
                 &(phychanswitch->interferencePower_mW));
         }
-        PhyChanSwitchUnlockSignal(phychanswitch);
+        PhyChanSwitchRx::UnlockSignal(phychanswitch);
     }
     PhyChanSwitchChangeState(node,phyIndex, PHY_TRANSMITTING);
 
@@ -1897,8 +1508,11 @@ void StartTransmittingSignal(
     MESSAGE_AddHeader(node, packet, sizeof(PhyChanSwitchPlcpHeader),
                       TRACE_PHY_CHANSWITCH);
 
-    char *plcp1 = MESSAGE_ReturnPacket(packet);
-    memcpy(plcp1,&phychanswitch->txDataRateType,sizeof(int));
+    PhyChanSwitchPlcpHeader plcp;
+    plcp.rate = phychanswitch->txDataRateType;
+    plcp.isAggregate = phychanswitch->txIsAggregate;
+    memcpy(MESSAGE_ReturnPacket(packet), &plcp, sizeof(PhyChanSwitchPlcpHeader));
+    phychanswitch->txIsAggregate = FALSE;
 
     if (PHY_IsListeningToChannel(node, phyIndex, channelIndex))
     {
@@ -1976,9 +1590,12 @@ void StartTransmittingSignal(
     phychanswitch->txEndTimer = endMsg;
     /* Keep track of phy statistics and battery computations */
     phychanswitch->stats.totalTxSignals++;
+    phychanswitch->stats.txSignalsAtRate[phychanswitch->txDataRateType]++;
+    phychanswitch->stats.txAirtimeAtRate[phychanswitch->txDataRateType] +=
+        duration;
     phychanswitch->stats.energyConsumed
         += duration * (BATTERY_TX_POWER_COEFFICIENT
-                       * NON_DB(phychanswitch->txPower_dBm)
+                       * DBCONV_NonDb(phychanswitch->txPower_dBm)
                        + BATTERY_TX_POWER_OFFSET
                        - BATTERY_RX_POWER);
 }
@@ -24,6 +24,7 @@
 #define PHY_CHANSWITCH_H
 
 #include "dynamic.h"
+#include "phy_802_11_core.h"
 
 /*
  * 802.11a parameters OFDM PHY
@@ -52,6 +53,16 @@
 #define PHY_CHANSWITCH_RX_TX_TURNAROUND_TIME  (2 * MICRO_SECOND)
 #define PHY_CHANSWITCH_PHY_DELAY PHY_CHANSWITCH_RX_TX_TURNAROUND_TIME
 
+//
+// Radio retune model. Moving to a different channel leaves the radio
+// unable to transmit or receive for RETUNE-DELAY plus PLL-SETTLING-TIME.
+// With FAST-CHANNEL-SWITCH enabled the PLL settling is skipped when the
+// new channel is adjacent to the old one. Both default to zero, i.e. an
+// instantaneous switch.
+//
+#define PHY_CHANSWITCH_DEFAULT_RETUNE_DELAY       0
+#define PHY_CHANSWITCH_DEFAULT_PLL_SETTLING_TIME  0
+
 #define PHY_CHANSWITCH_NUM_DATA_RATES 8
 
 /*
@@ -118,6 +129,30 @@
 #define PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_48M_dBm  -69.0
 #define PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_54M_dBm  -69.0
 
+//
+// Minimum SINR for roughly 10% PER on a 1000 byte frame, used by the
+// rate controller to pick the starting rate for a measured SINR.
+//
+#define PHY_CHANSWITCH_MIN_SINR__6M_dB   6.0
+#define PHY_CHANSWITCH_MIN_SINR__9M_dB   7.8
+#define PHY_CHANSWITCH_MIN_SINR_12M_dB   9.0
+#define PHY_CHANSWITCH_MIN_SINR_18M_dB  10.8
+#define PHY_CHANSWITCH_MIN_SINR_24M_dB  17.0
+#define PHY_CHANSWITCH_MIN_SINR_36M_dB  18.8
+#define PHY_CHANSWITCH_MIN_SINR_48M_dB  24.0
+#define PHY_CHANSWITCH_MIN_SINR_54M_dB  24.6
+
+//
+// Rate controller tuning. The SINR average weights each new frame by
+// RATE_SINR_EWMA_WEIGHT; RATE_FAILURES_FOR_DROP consecutive ACK failures
+// step one rate down and RATE_SUCCESSES_FOR_PROBE consecutive successes
+// probe one rate up.
+//
+#define PHY_CHANSWITCH_DEFAULT_RATE_SINR_MARGIN_dB  2.0
+#define PHY_CHANSWITCH_RATE_SINR_EWMA_WEIGHT        0.25
+#define PHY_CHANSWITCH_RATE_FAILURES_FOR_DROP       2
+#define PHY_CHANSWITCH_RATE_SUCCESSES_FOR_PROBE     10
+
 
 #define PHY_CHANSWITCH__1M  0
 #define PHY_CHANSWITCH__2M  1
@@ -151,8 +186,101 @@
 //#define PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__6M_dBm  -87.0
 #define PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_11M_dBm  -83.0
 
+//
+// Compile-time parameters of the PHY_CHANSWITCH OFDM rate set, see
+// phy_802_11_core.h.
+//
+struct PhyChanSwitchTraits {
+    enum {
+        NUM_DATA_RATES = PHY_CHANSWITCH_NUM_DATA_RATES,
+        LOWEST_DATA_RATE_TYPE = PHY_CHANSWITCH_LOWEST_DATA_RATE_TYPE,
+        HIGHEST_DATA_RATE_TYPE = PHY_CHANSWITCH_HIGHEST_DATA_RATE_TYPE,
+        DATA_RATE_TYPE_FOR_BC = PHY_CHANSWITCH_DATA_RATE_TYPE_FOR_BC,
+        SERVICE_AND_TAIL_BITS =
+            PHY_CHANSWITCH_SERVICE_BITS_SIZE + PHY_CHANSWITCH_TAIL_BITS_SIZE,
+        BITS_PER_SYMBOL_SCALE = 1
+    };
+
+    static clocktype SynchronizationTime() {
+        return PHY_CHANSWITCH_SYNCHRONIZATION_TIME;
+    }
+
+    static clocktype SymbolDuration() {
+        return PHY_CHANSWITCH_OFDM_SYMBOL_DURATION * MICRO_SECOND;
+    }
+
+    static int DataRate(int dataRateType) {
+        static const int dataRate[NUM_DATA_RATES] = {
+            PHY_CHANSWITCH_DATA_RATE__6M, PHY_CHANSWITCH_DATA_RATE__9M,
+            PHY_CHANSWITCH_DATA_RATE_12M, PHY_CHANSWITCH_DATA_RATE_18M,
+            PHY_CHANSWITCH_DATA_RATE_24M, PHY_CHANSWITCH_DATA_RATE_36M,
+            PHY_CHANSWITCH_DATA_RATE_48M, PHY_CHANSWITCH_DATA_RATE_54M };
+        return dataRate[dataRateType];
+    }
+
+    static int ScaledDataBitsPerSymbol(int dataRateType) {
+        static const int numDataBitsPerSymbol[NUM_DATA_RATES] = {
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__6M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL__9M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_12M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_18M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_24M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_36M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_48M,
+            PHY_CHANSWITCH_NUM_DATA_BITS_PER_SYMBOL_54M };
+        return numDataBitsPerSymbol[dataRateType];
+    }
+
+    static double NoiseFactor(int dataRateType) {
+        return 1.0;
+    }
+
+    static double DefaultTxPower_dBm(int dataRateType) {
+        static const double txPower_dBm[NUM_DATA_RATES] = {
+            PHY_CHANSWITCH_DEFAULT_TX_POWER__6M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER__9M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_12M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_18M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_24M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_36M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_48M_dBm,
+            PHY_CHANSWITCH_DEFAULT_TX_POWER_54M_dBm };
+        return txPower_dBm[dataRateType];
+    }
+
+    static double DefaultRxSensitivity_dBm(int dataRateType) {
+        static const double rxSensitivity_dBm[NUM_DATA_RATES] = {
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__6M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY__9M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_12M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_18M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_24M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_36M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_48M_dBm,
+            PHY_CHANSWITCH_DEFAULT_RX_SENSITIVITY_54M_dBm };
+        return rxSensitivity_dBm[dataRateType];
+    }
+
+    static double MinSinr_dB(int dataRateType) {
+        static const double minSinr_dB[NUM_DATA_RATES] = {
+            PHY_CHANSWITCH_MIN_SINR__6M_dB, PHY_CHANSWITCH_MIN_SINR__9M_dB,
+            PHY_CHANSWITCH_MIN_SINR_12M_dB, PHY_CHANSWITCH_MIN_SINR_18M_dB,
+            PHY_CHANSWITCH_MIN_SINR_24M_dB, PHY_CHANSWITCH_MIN_SINR_36M_dB,
+            PHY_CHANSWITCH_MIN_SINR_48M_dB, PHY_CHANSWITCH_MIN_SINR_54M_dB };
+        return minSinr_dB[dataRateType];
+    }
+};
+
+typedef Phy802_11Core<PhyChanSwitchTraits> PhyChanSwitchCore;
+
+//
+// isAggregate stands in for the aggregation bit of the HT-SIG field.
+// The receiver then leaves the error decision to the MAC, which draws
+// it per subframe.
+//
 typedef struct phy_chanswitch_plcp_header {
-    int rate;
+    int  rate;
+    BOOL isAggregate;
 } PhyChanSwitchPlcpHeader;
 
 //
@@ -187,6 +315,14 @@ typedef struct phy_chanswitch_stats_str {
     D_Int32 totalSignalsWithErrors;
     D_Float64 energyConsumed;
     D_Clocktype turnOnTime;
+    D_Int32 totalRetunes;
+    D_Int32 totalFastRetunes;
+    D_Int32 totalSignalsLostToRetune;
+    D_Int32 totalTxDeferredByRetune;
+    D_Clocktype retuneDeadTime;
+    int       txSignalsAtRate[PHY_CHANSWITCH_NUM_DATA_RATES];
+    clocktype txAirtimeAtRate[PHY_CHANSWITCH_NUM_DATA_RATES];
+    int       totalRateResets;
 } PhyChanSwitchStats;
 
 /*
@@ -204,12 +340,12 @@ typedef struct struct_phy_chanswitch_str {
     double    rxSensitivity_mW[PHY_CHANSWITCH_NUM_DATA_RATES];
 
     int       numDataRates;
-    int       dataRate[PHY_CHANSWITCH_NUM_DATA_RATES];
-    double    numDataBitsPerSymbol[PHY_CHANSWITCH_NUM_DATA_RATES];
     int       lowestDataRateType;
     int       highestDataRateType;
 
     double    directionalAntennaGain_dB;
+    // carrier sense threshold while the antenna is not omnidirectional
+    double    directionalRxSensitivity_mW;
 
     Message*  rxMsg;
     double    rxMsgPower_mW;
@@ -218,6 +354,12 @@ typedef struct struct_phy_chanswitch_str {
     clocktype rxEndTime;
     Orientation rxDOA;
 
+    // A-MPDU reception: lowest SINR seen over the frame, reported to
+    // the MAC in place of the whole-frame error draw.
+    BOOL      txIsAggregate;
+    BOOL      rxMsgIsAggregate;
+    double    rxMinSinr;
+
     Message *txEndTimer;
     D_Int32   channelBandwidth;
     clocktype rxTxTurnaroundTime;
@@ -227,6 +369,21 @@ typedef struct struct_phy_chanswitch_str {
     PhyStatusType mode;
     PhyStatusType previousMode;
 
+    int       tunedChannel;
+    clocktype retuneDelay;
+    clocktype pllSettlingTime;
+    BOOL      fastChannelSwitch;
+    clocktype retuneEndTime;
+
+    BOOL      rateAdaptation;
+    double    rateSinrMargin_dB;
+    double    rateSinr_dB;
+    BOOL      rateSinrValid;
+    int       rateOffset;
+    BOOL      rateProbing;
+    int       rateSuccesses;
+    int       rateFailures;
+
     PhyChanSwitchStats  stats;
 
 } PhyDataChanSwitch;
@@ -308,6 +465,7 @@ int PhyChanSwitchGetTxDataRateType(PhyData *thisPhy);
 int PhyChanSwitchGetRxDataRateType(PhyData *thisPhy);
 
 void PhyChanSwitchSetTxDataRateType(PhyData* thisPhy, int dataRateType);
+void PhyChanSwitchSetTxAggregation(PhyData* thisPhy, BOOL isAggregate);
 void PhyChanSwitchGetLowestTxDataRateType(PhyData* thisPhy, int* dataRateType);
 void PhyChanSwitchSetLowestTxDataRateType(PhyData* thisPhy);
 void PhyChanSwitchGetHighestTxDataRateType(PhyData* thisPhy, int* dataRateType);
@@ -358,4 +516,10 @@ void PhyChanSwitchChangeState(Node* node, int phyIndex, PhyStatusType newStatus)
 
 double PhyChanSwitchComputeSINR (PhyDataChanSwitch* phychanswitch);
 
+BOOL PhyChanSwitchIsRetuning(Node* node, int phyIndex);
+
+BOOL PhyChanSwitchRateAdaptationEnabled(Node* node, int phyIndex);
+int PhyChanSwitchSelectTxDataRateType(Node* node, int phyIndex);
+void PhyChanSwitchReportTxOutcome(Node* node, int phyIndex, BOOL success);
+
 #endif /* PHY_CHANSWITCH_H */
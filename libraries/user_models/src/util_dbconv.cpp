@@ -0,0 +1,299 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * dB <-> linear conversion kernels.
+ *
+ * NON_DB: 10^(x/10) = 2^y with y = x * log2(10) / 10. y is split into
+ * n / 64 + r with integer n and r in [0, 1/64); 2^(n/64) comes from the
+ * exponent bits plus a 64-entry table and 2^r from a degree 5 polynomial
+ * (truncation error < 3e-15).
+ *
+ * IN_DB: linear = m * 2^e with m in [1, 2). The top 6 mantissa bits pick
+ * a table midpoint c, u = m / c - 1 is within +/-1/129 and ln(1 + u) is
+ * a degree 6 polynomial (truncation error < 3e-16).
+ */
+
+#include <math.h>
+#include <string.h>
+#include <float.h>
+
+#include "types.h"
+#include "util_dbconv.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DBCONV_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define DBCONV_TABLE_BITS   6
+#define DBCONV_TABLE_SIZE   (1 << DBCONV_TABLE_BITS)
+#define DBCONV_TABLE_MASK   (DBCONV_TABLE_SIZE - 1)
+
+#define DBCONV_LN2          0.69314718055994530942
+#define DBCONV_LOG2_10      3.32192809488736234787
+#define DBCONV_10_LOG10_2   3.01029995663981195214
+#define DBCONV_10_LOG10_E   4.34294481903251827651
+
+// 2^(n/64) per dB, and the step of r after scaling back to natural log.
+#define DBCONV_EXP_SCALE    (DBCONV_LOG2_10 / 10.0 * DBCONV_TABLE_SIZE)
+#define DBCONV_EXP_STEP     (DBCONV_LN2 / DBCONV_TABLE_SIZE)
+#define DBCONV_EXP_LIMIT    (DBCONV_NON_DB_FAST_RANGE_DB * DBCONV_EXP_SCALE)
+
+#define DBCONV_EXP_BIAS     1023
+#define DBCONV_MANT_BITS    52
+#define DBCONV_MANT_MASK    0x000FFFFFFFFFFFFFULL
+#define DBCONV_ONE_BITS     0x3FF0000000000000ULL
+
+// 2^(j/64)
+static double DbconvExp2Table[DBCONV_TABLE_SIZE];
+// Midpoint c_j = 1 + (j + 0.5) / 64, its reciprocal and 10 * log10(c_j)
+static double DbconvMidTable[DBCONV_TABLE_SIZE];
+static double DbconvInvMidTable[DBCONV_TABLE_SIZE];
+static double DbconvLogMidTable[DBCONV_TABLE_SIZE];
+
+//
+// The tables are filled once before main() runs, so every partition
+// thread sees them initialized without a check on the hot path.
+//
+static struct DbconvTableInit {
+    DbconvTableInit() {
+        int j;
+        for (j = 0; j < DBCONV_TABLE_SIZE; j++) {
+            double mid = 1.0 + (j + 0.5) / DBCONV_TABLE_SIZE;
+
+            DbconvExp2Table[j] = pow(2.0, (double) j / DBCONV_TABLE_SIZE);
+            DbconvMidTable[j] = mid;
+            DbconvInvMidTable[j] = 1.0 / mid;
+            DbconvLogMidTable[j] = 10.0 * log10(mid);
+        }
+    }
+} DbconvTableInitializer;
+
+
+static inline
+double DbconvExpPoly(double r) {
+    return 1.0 + r * (1.0 + r * (1.0 / 2.0 + r * (1.0 / 6.0 +
+           r * (1.0 / 24.0 + r * (1.0 / 120.0)))));
+}
+
+
+static inline
+double DbconvLogPoly(double u) {
+    return u * (1.0 + u * (-1.0 / 2.0 + u * (1.0 / 3.0 + u * (-1.0 / 4.0 +
+           u * (1.0 / 5.0 + u * (-1.0 / 6.0))))));
+}
+
+
+static inline
+double DbconvPow2(int k) {
+    UInt64 bits = (UInt64)(k + DBCONV_EXP_BIAS) << DBCONV_MANT_BITS;
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+double DBCONV_NonDb(double dB) {
+    double y = dB * DBCONV_EXP_SCALE;
+
+    // Also catches NaN.
+    if (!(y > -DBCONV_EXP_LIMIT && y < DBCONV_EXP_LIMIT)) {
+        return pow(10.0, dB / 10.0);
+    }
+
+    double n = floor(y);
+    int ni = (int) n;
+    int j = ni & DBCONV_TABLE_MASK;
+    int k = (ni - j) / DBCONV_TABLE_SIZE;
+
+    return DbconvExp2Table[j] * DbconvPow2(k) *
+           DbconvExpPoly((y - n) * DBCONV_EXP_STEP);
+}
+
+
+double DBCONV_InDb(double linear) {
+    // Zero, negative, subnormal, infinite and NaN keep libm semantics.
+    if (!(linear >= DBL_MIN && linear <= DBL_MAX)) {
+        return 10.0 * log10(linear);
+    }
+
+    UInt64 bits;
+    double m;
+
+    memcpy(&bits, &linear, sizeof(bits));
+
+    int e = (int)(bits >> DBCONV_MANT_BITS) - DBCONV_EXP_BIAS;
+    int j = (int)(bits >> (DBCONV_MANT_BITS - DBCONV_TABLE_BITS)) &
+            DBCONV_TABLE_MASK;
+
+    bits = (bits & DBCONV_MANT_MASK) | DBCONV_ONE_BITS;
+    memcpy(&m, &bits, sizeof(m));
+
+    // m - c_j is exact since both share the binade and c_j has 7 bits.
+    double u = (m - DbconvMidTable[j]) * DbconvInvMidTable[j];
+
+    return DBCONV_10_LOG10_2 * e + DbconvLogMidTable[j] +
+           DBCONV_10_LOG10_E * DbconvLogPoly(u);
+}
+
+
+#ifdef DBCONV_USE_SSE2
+
+void DBCONV_NonDbBatch(const double* dB, double* linear, int count) {
+    const __m128d scale = _mm_set1_pd(DBCONV_EXP_SCALE);
+    const __m128d lowLimit = _mm_set1_pd(-DBCONV_EXP_LIMIT);
+    const __m128d highLimit = _mm_set1_pd(DBCONV_EXP_LIMIT);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d step = _mm_set1_pd(DBCONV_EXP_STEP);
+    int i;
+
+    for (i = 0; i + 1 < count; i += 2) {
+        __m128d y = _mm_mul_pd(_mm_loadu_pd(dB + i), scale);
+        __m128d inRange = _mm_and_pd(_mm_cmpgt_pd(y, lowLimit),
+                                     _mm_cmplt_pd(y, highLimit));
+
+        if (_mm_movemask_pd(inRange) != 3) {
+            double x0 = dB[i];
+            double x1 = dB[i + 1];
+            linear[i] = DBCONV_NonDb(x0);
+            linear[i + 1] = DBCONV_NonDb(x1);
+            continue;
+        }
+
+        // floor(y): truncate, then step down where truncation rounded up.
+        __m128d n = _mm_cvtepi32_pd(_mm_cvttpd_epi32(y));
+        n = _mm_sub_pd(n, _mm_and_pd(_mm_cmpgt_pd(n, y), one));
+        __m128i ni = _mm_cvttpd_epi32(n);
+
+        int n0 = _mm_cvtsi128_si32(ni);
+        int n1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(ni, 1));
+        int j0 = n0 & DBCONV_TABLE_MASK;
+        int j1 = n1 & DBCONV_TABLE_MASK;
+        int k0 = (n0 - j0) / DBCONV_TABLE_SIZE + DBCONV_EXP_BIAS;
+        int k1 = (n1 - j1) / DBCONV_TABLE_SIZE + DBCONV_EXP_BIAS;
+
+        __m128d pow2 = _mm_castsi128_pd(
+            _mm_slli_epi64(_mm_set_epi32(0, k1, 0, k0), DBCONV_MANT_BITS));
+        __m128d table =
+            _mm_set_pd(DbconvExp2Table[j1], DbconvExp2Table[j0]);
+
+        __m128d r = _mm_mul_pd(_mm_sub_pd(y, n), step);
+        __m128d p = _mm_set1_pd(1.0 / 120.0);
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 24.0));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 6.0));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0 / 2.0));
+        p = _mm_add_pd(_mm_mul_pd(p, r), one);
+        p = _mm_add_pd(_mm_mul_pd(p, r), one);
+
+        _mm_storeu_pd(linear + i,
+                      _mm_mul_pd(_mm_mul_pd(table, pow2), p));
+    }
+
+    for (; i < count; i++) {
+        linear[i] = DBCONV_NonDb(dB[i]);
+    }
+}
+
+
+void DBCONV_InDbBatch(const double* linear, double* dB, int count) {
+    const __m128d minNormal = _mm_set1_pd(DBL_MIN);
+    const __m128d maxNormal = _mm_set1_pd(DBL_MAX);
+    const __m128i mantMask = _mm_set_epi32(0x000FFFFF, (int) 0xFFFFFFFF,
+                                           0x000FFFFF, (int) 0xFFFFFFFF);
+    const __m128i oneBits = _mm_set_epi32(0x3FF00000, 0,
+                                          0x3FF00000, 0);
+    int i;
+
+    for (i = 0; i + 1 < count; i += 2) {
+        __m128d x = _mm_loadu_pd(linear + i);
+        __m128d inRange = _mm_and_pd(_mm_cmpge_pd(x, minNormal),
+                                     _mm_cmple_pd(x, maxNormal));
+
+        if (_mm_movemask_pd(inRange) != 3) {
+            double x0 = linear[i];
+            double x1 = linear[i + 1];
+            dB[i] = DBCONV_InDb(x0);
+            dB[i + 1] = DBCONV_InDb(x1);
+            continue;
+        }
+
+        __m128i bits = _mm_castpd_si128(x);
+
+        // Biased exponents sit in the low dword of each qword.
+        __m128i exps = _mm_shuffle_epi32(
+            _mm_srli_epi64(bits, DBCONV_MANT_BITS), _MM_SHUFFLE(3, 3, 2, 0));
+        __m128d e = _mm_sub_pd(_mm_cvtepi32_pd(exps),
+                               _mm_set1_pd((double) DBCONV_EXP_BIAS));
+
+        __m128i idx = _mm_srli_epi64(
+            bits, DBCONV_MANT_BITS - DBCONV_TABLE_BITS);
+        int j0 = _mm_cvtsi128_si32(idx) & DBCONV_TABLE_MASK;
+        int j1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(idx, 2)) &
+                 DBCONV_TABLE_MASK;
+
+        __m128d m = _mm_castsi128_pd(
+            _mm_or_si128(_mm_and_si128(bits, mantMask), oneBits));
+        __m128d u = _mm_mul_pd(
+            _mm_sub_pd(m, _mm_set_pd(DbconvMidTable[j1],
+                                     DbconvMidTable[j0])),
+            _mm_set_pd(DbconvInvMidTable[j1], DbconvInvMidTable[j0]));
+
+        __m128d p = _mm_set1_pd(-1.0 / 6.0);
+        p = _mm_add_pd(_mm_mul_pd(p, u), _mm_set1_pd(1.0 / 5.0));
+        p = _mm_add_pd(_mm_mul_pd(p, u), _mm_set1_pd(-1.0 / 4.0));
+        p = _mm_add_pd(_mm_mul_pd(p, u), _mm_set1_pd(1.0 / 3.0));
+        p = _mm_add_pd(_mm_mul_pd(p, u), _mm_set1_pd(-1.0 / 2.0));
+        p = _mm_add_pd(_mm_mul_pd(p, u), _mm_set1_pd(1.0));
+        p = _mm_mul_pd(p, u);
+
+        __m128d result = _mm_add_pd(
+            _mm_add_pd(_mm_mul_pd(e, _mm_set1_pd(DBCONV_10_LOG10_2)),
+                       _mm_set_pd(DbconvLogMidTable[j1],
+                                  DbconvLogMidTable[j0])),
+            _mm_mul_pd(p, _mm_set1_pd(DBCONV_10_LOG10_E)));
+
+        _mm_storeu_pd(dB + i, result);
+    }
+
+    for (; i < count; i++) {
+        dB[i] = DBCONV_InDb(linear[i]);
+    }
+}
+
+#else // DBCONV_USE_SSE2
+
+void DBCONV_NonDbBatch(const double* dB, double* linear, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        linear[i] = DBCONV_NonDb(dB[i]);
+    }
+}
+
+
+void DBCONV_InDbBatch(const double* linear, double* dB, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        dB[i] = DBCONV_InDb(linear[i]);
+    }
+}
+
+#endif // DBCONV_USE_SSE2
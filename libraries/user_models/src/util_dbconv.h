@@ -0,0 +1,103 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+// /**
+// PACKAGE     :: DBCONV
+// DESCRIPTION :: Fast replacements for NON_DB and IN_DB on the radio hot
+//                paths. Both directions use a 64-entry table followed by a
+//                short polynomial, so no call goes through pow or log10
+//                unless the argument is outside the fast range.
+// **/
+
+#ifndef UTIL_DBCONV_H
+#define UTIL_DBCONV_H
+
+#include "types.h"
+
+// /**
+// CONSTANT    :: DBCONV_NON_DB_MAX_REL_ERROR : 2.0e-13
+// DESCRIPTION :: Bound on |DBCONV_NonDb(x) / NON_DB(x) - 1| for
+//                |x| < DBCONV_NON_DB_FAST_RANGE_DB. Most of it is the
+//                rounding of x * log2(10) / 10 at large |x|; for the
+//                -200..200 dB range of signal powers it is below 2e-14.
+// **/
+#define DBCONV_NON_DB_MAX_REL_ERROR     2.0e-13
+
+// /**
+// CONSTANT    :: DBCONV_IN_DB_MAX_ABS_ERROR : 1.0e-12
+// DESCRIPTION :: Bound on |DBCONV_InDb(x) - IN_DB(x)| in dB for every
+//                positive normal double x.
+// **/
+#define DBCONV_IN_DB_MAX_ABS_ERROR      1.0e-12
+
+// /**
+// CONSTANT    :: DBCONV_NON_DB_FAST_RANGE_DB : 3000.0
+// DESCRIPTION :: Magnitude in dB above which DBCONV_NonDb falls back to
+//                pow. Covers every power level a radio model produces.
+// **/
+#define DBCONV_NON_DB_FAST_RANGE_DB     3000.0
+
+// /**
+// FUNCTION   :: DBCONV_NonDb
+// LAYER      :: Physical
+// PURPOSE    :: Convert a value in dB to linear scale, like NON_DB.
+// PARAMETERS ::
+// + dB       : double : value in dB
+// RETURN     :: double : 10^(dB/10)
+// **/
+double DBCONV_NonDb(double dB);
+
+// /**
+// FUNCTION   :: DBCONV_InDb
+// LAYER      :: Physical
+// PURPOSE    :: Convert a linear value to dB, like IN_DB. Zero, negative
+//               and non-finite arguments give the same result as IN_DB.
+// PARAMETERS ::
+// + linear   : double : value in linear scale
+// RETURN     :: double : 10 * log10(linear)
+// **/
+double DBCONV_InDb(double linear);
+
+// /**
+// FUNCTION   :: DBCONV_NonDbBatch
+// LAYER      :: Physical
+// PURPOSE    :: DBCONV_NonDb over an array, two values per SSE2 step.
+//               Same error bound as the scalar version. in and out may
+//               be the same array.
+// PARAMETERS ::
+// + dB       : const double* : values in dB
+// + linear   : double*       : results in linear scale
+// + count    : int           : number of values
+// RETURN     :: void :
+// **/
+void DBCONV_NonDbBatch(const double* dB, double* linear, int count);
+
+// /**
+// FUNCTION   :: DBCONV_InDbBatch
+// LAYER      :: Physical
+// PURPOSE    :: DBCONV_InDb over an array, two values per SSE2 step.
+//               Same error bound as the scalar version. in and out may
+//               be the same array.
+// PARAMETERS ::
+// + linear   : const double* : values in linear scale
+// + dB       : double*       : results in dB
+// + count    : int           : number of values
+// RETURN     :: void :
+// **/
+void DBCONV_InDbBatch(const double* linear, double* dB, int count);
+
+#endif /* UTIL_DBCONV_H */
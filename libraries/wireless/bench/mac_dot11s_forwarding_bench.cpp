@@ -0,0 +1,684 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Standalone benchmark of the 802.11s per frame forwarding path at one
+ * MP, in nanoseconds per frame, for meshes of 10 to 500 MPs.
+ *
+ * The MPs sit on a square grid and each is an MAP with
+ * BENCH_STATIONS_PER_MAP stations. The measured MP is in the middle of
+ * the grid. Its tables hold what it learns in a run: its grid neighbors
+ * (up to 8), a forwarding item per other MP, a proxy item per station
+ * in the mesh, its own stations, and an end to end item per
+ * destination MP it has sent to. Items are allocated one at a time in
+ * the order they are learnt, interleaved across the tables.
+ *
+ * Every frame goes from a random station to a random station behind
+ * another MAP, and makes the table lookups mac_dot11s.cpp makes:
+ *
+ *   relay  mesh data frame from a neighbor (Dot11s_ReceiveDataUnicast):
+ *          neighbor TA (Dot11s_IsAssociatedNeighbor), station DA
+ *          (Dot11s_IsSelfOrBssStationAddr), proxy DA and forwarding
+ *          MAP (routing function), neighbor next hop
+ *          (Dot11s_ComputeLinkMetric), neighbor RA
+ *          (Dot11s_PacketAckEvent).
+ *   bss    data frame from an own station: station TA, station DA,
+ *          end to end DA/SA (Dot11sE2eList_NextSeqNo), then proxy,
+ *          forwarding and the two neighbor lookups as above.
+ *
+ * The old path is the list walk the lookup functions did before the
+ * address index; the new path is Dot11sAddrIndex_Lookup. Every frame is
+ * first run through both paths and must reach the same items.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       mac_dot11s_forwarding_bench.cpp -o mac_dot11s_forwarding_bench
+ *
+ * Reference run (g++ 12 -O2, x86-64), ns per frame:
+ *
+ *   MPs   fwd  proxy    relay old  relay new     bss old    bss new
+ *    10     9     36        290.3      241.2       238.4      290.4
+ *    25    24     96        627.4      257.0       475.5      310.3
+ *    50    49    196       1103.8      268.5       949.2      312.7
+ *   100    99    396       1950.6      270.4      1975.8      320.6
+ *   200   199    796       4144.5      306.0      4570.5      359.4
+ *   500   499   1996       9955.9      295.0     11196.6      309.3
+ *
+ * fwd and proxy are the table sizes. With the index the cost of a frame
+ * stays flat; the list walk grows with the proxy and forwarding tables
+ * and is 3 to 4 times slower from 25 MPs on. At 10 MPs the walk over a
+ * few entries still beats hashing for frames from the BSS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "api.h"
+#include "mac_dot11s-index.h"
+
+#define BENCH_FRAMES            (1 << 20)
+#define BENCH_STATIONS_PER_MAP  4
+
+#define BENCH_MP                1
+#define BENCH_STATION           2
+
+// Key fields first, sized as the mac_dot11s.h items
+struct BenchNeighborItem {
+    Mac802Address neighborAddr;
+    Mac802Address primaryAddr;
+    char rest[136];
+};
+
+struct BenchProxyItem {
+    Mac802Address staAddr;
+    BOOL inMesh;
+    BOOL isProxied;
+    Mac802Address proxyAddr;
+};
+
+struct BenchFwdItem {
+    Mac802Address mpAddr;
+    Mac802Address nextHopAddr;
+    int itemType;
+};
+
+struct BenchStationItem {
+    Mac802Address staAddr;
+    Mac802Address prevApAddr;
+    int status;
+};
+
+struct BenchE2eItem {
+    Mac802Address DA;
+    Mac802Address SA;
+    int seqNo;
+};
+
+struct BenchTable {
+    ListItem* first;
+    ListItem* last;
+    DOT11s_AddrIndex* index;
+    int size;
+};
+
+struct BenchFrame {
+    Mac802Address TA;
+    Mac802Address DA;
+};
+
+// Results of one frame, to compare the two paths
+struct BenchTrace {
+    void* item[7];
+};
+
+static Mac802Address BenchAddress(int type, int id) {
+    Mac802Address addr;
+    int i;
+
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++) {
+        addr.byte[i] = 0;
+    }
+    addr.byte[0] = (unsigned char) type;
+    addr.byte[MAC_ADDRESS_LENGTH_IN_BYTE - 2] = (unsigned char)(id >> 8);
+    addr.byte[MAC_ADDRESS_LENGTH_IN_BYTE - 1] = (unsigned char) id;
+    return addr;
+}
+
+
+static void TableInit(BenchTable* table) {
+    table->first = NULL;
+    table->last = NULL;
+    table->size = 0;
+    Dot11sAddrIndex_Init(&table->index);
+}
+
+
+static void TableAppend(
+    BenchTable* table, const DOT11s_AddrKey& key, void* data)
+{
+    ListItem* listItem = (ListItem*) malloc(sizeof(ListItem));
+
+    memset(listItem, 0, sizeof(ListItem));
+    listItem->data = data;
+    listItem->prev = table->last;
+    if (table->last != NULL) {
+        table->last->next = listItem;
+    }
+    else {
+        table->first = listItem;
+    }
+    table->last = listItem;
+    table->size++;
+    Dot11sAddrIndex_Insert(table->index, key, listItem);
+}
+
+
+static void TableFree(BenchTable* table) {
+    ListItem* listItem = table->first;
+
+    while (listItem != NULL) {
+        ListItem* next = listItem->next;
+
+        free(listItem->data);
+        free(listItem);
+        listItem = next;
+    }
+    Dot11sAddrIndex_Free(table->index);
+}
+
+
+// The tables of one MP
+struct BenchMp {
+    Mac802Address selfAddr;
+    BenchTable neighborList;
+    BenchTable proxyList;
+    BenchTable fwdList;
+    BenchTable stationList;
+    BenchTable e2eList;
+};
+
+
+// ------------------------------------------------------------------
+// Old path: walk the list comparing the key of every item.
+
+static BenchNeighborItem* OldNeighborLookup(
+    BenchMp* mp, const Mac802Address& addr)
+{
+    ListItem* listItem = mp->neighborList.first;
+
+    while (listItem != NULL) {
+        BenchNeighborItem* item = (BenchNeighborItem*) listItem->data;
+
+        if (item->neighborAddr == addr) {
+            return item;
+        }
+        listItem = listItem->next;
+    }
+    return NULL;
+}
+
+
+static BenchProxyItem* OldProxyLookup(
+    BenchMp* mp, const Mac802Address& addr)
+{
+    ListItem* listItem = mp->proxyList.first;
+
+    while (listItem != NULL) {
+        BenchProxyItem* item = (BenchProxyItem*) listItem->data;
+
+        if (item->staAddr == addr) {
+            return item;
+        }
+        listItem = listItem->next;
+    }
+    return NULL;
+}
+
+
+static BenchFwdItem* OldFwdLookup(
+    BenchMp* mp, const Mac802Address& addr)
+{
+    ListItem* listItem = mp->fwdList.first;
+
+    while (listItem != NULL) {
+        BenchFwdItem* item = (BenchFwdItem*) listItem->data;
+
+        if (item->mpAddr == addr) {
+            return item;
+        }
+        listItem = listItem->next;
+    }
+    return NULL;
+}
+
+
+static BenchStationItem* OldStationLookup(
+    BenchMp* mp, const Mac802Address& addr)
+{
+    ListItem* listItem = mp->stationList.first;
+
+    while (listItem != NULL) {
+        BenchStationItem* item = (BenchStationItem*) listItem->data;
+
+        if (item->staAddr == addr) {
+            return item;
+        }
+        listItem = listItem->next;
+    }
+    return NULL;
+}
+
+
+static BenchE2eItem* OldE2eLookup(
+    BenchMp* mp, const Mac802Address& DA, const Mac802Address& SA)
+{
+    ListItem* listItem = mp->e2eList.first;
+
+    while (listItem != NULL) {
+        BenchE2eItem* item = (BenchE2eItem*) listItem->data;
+
+        if (item->DA == DA && item->SA == SA) {
+            return item;
+        }
+        listItem = listItem->next;
+    }
+    return NULL;
+}
+
+
+// ------------------------------------------------------------------
+// New path: look the key up in the table's address index.
+
+static void* NewLookup(
+    BenchTable* table,
+    const Mac802Address& addr1,
+    const Mac802Address& addr2 = Mac802Address())
+{
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        table->index, Dot11sAddrIndex_Key(addr1, addr2));
+
+    return (listItem != NULL ? listItem->data : NULL);
+}
+
+
+// ------------------------------------------------------------------
+// The two frame paths. Each lookup uses the result of the one before,
+// as the forwarding code does, so the work cannot be hoisted.
+
+static BOOL OldRelayFrame(
+    BenchMp* mp, const BenchFrame& frame, BenchTrace* trace)
+{
+    BenchNeighborItem* fromItem = OldNeighborLookup(mp, frame.TA);
+    BenchStationItem* stationItem = OldStationLookup(mp, frame.DA);
+    BenchProxyItem* proxyItem;
+    BenchFwdItem* fwdItem;
+    BenchNeighborItem* nextHopItem;
+    BenchNeighborItem* ackItem;
+
+    if (fromItem == NULL || stationItem != NULL) {
+        return FALSE;
+    }
+    proxyItem = OldProxyLookup(mp, frame.DA);
+    fwdItem = OldFwdLookup(mp, proxyItem->proxyAddr);
+    nextHopItem = OldNeighborLookup(mp, fwdItem->nextHopAddr);
+    ackItem = OldNeighborLookup(mp, nextHopItem->neighborAddr);
+
+    trace->item[0] = fromItem;
+    trace->item[1] = stationItem;
+    trace->item[2] = proxyItem;
+    trace->item[3] = fwdItem;
+    trace->item[4] = nextHopItem;
+    trace->item[5] = ackItem;
+    return TRUE;
+}
+
+
+static BOOL NewRelayFrame(
+    BenchMp* mp, const BenchFrame& frame, BenchTrace* trace)
+{
+    BenchNeighborItem* fromItem = (BenchNeighborItem*)
+        NewLookup(&mp->neighborList, frame.TA);
+    BenchStationItem* stationItem = (BenchStationItem*)
+        NewLookup(&mp->stationList, frame.DA);
+    BenchProxyItem* proxyItem;
+    BenchFwdItem* fwdItem;
+    BenchNeighborItem* nextHopItem;
+    BenchNeighborItem* ackItem;
+
+    if (fromItem == NULL || stationItem != NULL) {
+        return FALSE;
+    }
+    proxyItem = (BenchProxyItem*) NewLookup(&mp->proxyList, frame.DA);
+    fwdItem = (BenchFwdItem*) NewLookup(&mp->fwdList, proxyItem->proxyAddr);
+    nextHopItem = (BenchNeighborItem*)
+        NewLookup(&mp->neighborList, fwdItem->nextHopAddr);
+    ackItem = (BenchNeighborItem*)
+        NewLookup(&mp->neighborList, nextHopItem->neighborAddr);
+
+    trace->item[0] = fromItem;
+    trace->item[1] = stationItem;
+    trace->item[2] = proxyItem;
+    trace->item[3] = fwdItem;
+    trace->item[4] = nextHopItem;
+    trace->item[5] = ackItem;
+    return TRUE;
+}
+
+
+static BOOL OldBssFrame(
+    BenchMp* mp, const BenchFrame& frame, BenchTrace* trace)
+{
+    BenchStationItem* fromItem = OldStationLookup(mp, frame.TA);
+    BenchStationItem* stationItem = OldStationLookup(mp, frame.DA);
+    BenchProxyItem* proxyItem;
+    BenchE2eItem* e2eItem;
+    BenchFwdItem* fwdItem;
+    BenchNeighborItem* nextHopItem;
+    BenchNeighborItem* ackItem;
+
+    if (fromItem == NULL || stationItem != NULL) {
+        return FALSE;
+    }
+    proxyItem = OldProxyLookup(mp, frame.DA);
+    e2eItem = OldE2eLookup(mp, proxyItem->proxyAddr, mp->selfAddr);
+    e2eItem->seqNo++;
+    fwdItem = OldFwdLookup(mp, proxyItem->proxyAddr);
+    nextHopItem = OldNeighborLookup(mp, fwdItem->nextHopAddr);
+    ackItem = OldNeighborLookup(mp, nextHopItem->neighborAddr);
+
+    trace->item[0] = fromItem;
+    trace->item[1] = stationItem;
+    trace->item[2] = proxyItem;
+    trace->item[3] = fwdItem;
+    trace->item[4] = nextHopItem;
+    trace->item[5] = ackItem;
+    trace->item[6] = e2eItem;
+    return TRUE;
+}
+
+
+static BOOL NewBssFrame(
+    BenchMp* mp, const BenchFrame& frame, BenchTrace* trace)
+{
+    BenchStationItem* fromItem = (BenchStationItem*)
+        NewLookup(&mp->stationList, frame.TA);
+    BenchStationItem* stationItem = (BenchStationItem*)
+        NewLookup(&mp->stationList, frame.DA);
+    BenchProxyItem* proxyItem;
+    BenchE2eItem* e2eItem;
+    BenchFwdItem* fwdItem;
+    BenchNeighborItem* nextHopItem;
+    BenchNeighborItem* ackItem;
+
+    if (fromItem == NULL || stationItem != NULL) {
+        return FALSE;
+    }
+    proxyItem = (BenchProxyItem*) NewLookup(&mp->proxyList, frame.DA);
+    e2eItem = (BenchE2eItem*) NewLookup(
+        &mp->e2eList, proxyItem->proxyAddr, mp->selfAddr);
+    e2eItem->seqNo++;
+    fwdItem = (BenchFwdItem*) NewLookup(&mp->fwdList, proxyItem->proxyAddr);
+    nextHopItem = (BenchNeighborItem*)
+        NewLookup(&mp->neighborList, fwdItem->nextHopAddr);
+    ackItem = (BenchNeighborItem*)
+        NewLookup(&mp->neighborList, nextHopItem->neighborAddr);
+
+    trace->item[0] = fromItem;
+    trace->item[1] = stationItem;
+    trace->item[2] = proxyItem;
+    trace->item[3] = fwdItem;
+    trace->item[4] = nextHopItem;
+    trace->item[5] = ackItem;
+    trace->item[6] = e2eItem;
+    return TRUE;
+}
+
+
+// ------------------------------------------------------------------
+// Mesh set up
+
+// Grid hops between two cells
+static int GridDistance(int side, int a, int b) {
+    int dRow = abs(a / side - b / side);
+    int dCol = abs(a % side - b % side);
+
+    return (dRow > dCol ? dRow : dCol);
+}
+
+
+// Learn the tables of the MP at grid cell self, in the order a run
+// would: neighbors as their beacons arrive, own stations as they
+// associate, then forwarding, proxy and end to end items as traffic
+// to each MP starts.
+static void BuildMp(BenchMp* mp, int numMps, int side, int self) {
+    int neighbors[8];
+    int numNeighbors = 0;
+    int i;
+    int j;
+
+    mp->selfAddr = BenchAddress(BENCH_MP, self);
+    TableInit(&mp->neighborList);
+    TableInit(&mp->proxyList);
+    TableInit(&mp->fwdList);
+    TableInit(&mp->stationList);
+    TableInit(&mp->e2eList);
+
+    for (i = 0; i < numMps; i++) {
+        BenchNeighborItem* item;
+
+        if (i == self || GridDistance(side, i, self) > 1) {
+            continue;
+        }
+        neighbors[numNeighbors++] = i;
+        item = (BenchNeighborItem*) malloc(sizeof(BenchNeighborItem));
+        memset(item, 0, sizeof(BenchNeighborItem));
+        item->neighborAddr = BenchAddress(BENCH_MP, i);
+        TableAppend(&mp->neighborList,
+            Dot11sAddrIndex_Key(item->neighborAddr), item);
+    }
+
+    for (j = 0; j < BENCH_STATIONS_PER_MAP; j++) {
+        BenchStationItem* item =
+            (BenchStationItem*) malloc(sizeof(BenchStationItem));
+
+        memset(item, 0, sizeof(BenchStationItem));
+        item->staAddr =
+            BenchAddress(BENCH_STATION, self * BENCH_STATIONS_PER_MAP + j);
+        TableAppend(&mp->stationList,
+            Dot11sAddrIndex_Key(item->staAddr), item);
+    }
+
+    for (i = 0; i < numMps; i++) {
+        // Next hop is the neighbor closest to the destination
+        int nextHop = neighbors[0];
+        BenchFwdItem* fwdItem;
+        BenchE2eItem* e2eItem;
+
+        if (i == self) {
+            continue;
+        }
+        for (j = 1; j < numNeighbors; j++) {
+            if (GridDistance(side, neighbors[j], i)
+                < GridDistance(side, nextHop, i))
+            {
+                nextHop = neighbors[j];
+            }
+        }
+
+        fwdItem = (BenchFwdItem*) malloc(sizeof(BenchFwdItem));
+        memset(fwdItem, 0, sizeof(BenchFwdItem));
+        fwdItem->mpAddr = BenchAddress(BENCH_MP, i);
+        fwdItem->nextHopAddr = BenchAddress(BENCH_MP, nextHop);
+        TableAppend(&mp->fwdList,
+            Dot11sAddrIndex_Key(fwdItem->mpAddr), fwdItem);
+
+        for (j = 0; j < BENCH_STATIONS_PER_MAP; j++) {
+            BenchProxyItem* proxyItem =
+                (BenchProxyItem*) malloc(sizeof(BenchProxyItem));
+
+            memset(proxyItem, 0, sizeof(BenchProxyItem));
+            proxyItem->staAddr =
+                BenchAddress(BENCH_STATION, i * BENCH_STATIONS_PER_MAP + j);
+            proxyItem->isProxied = TRUE;
+            proxyItem->proxyAddr = fwdItem->mpAddr;
+            TableAppend(&mp->proxyList,
+                Dot11sAddrIndex_Key(proxyItem->staAddr), proxyItem);
+        }
+
+        e2eItem = (BenchE2eItem*) malloc(sizeof(BenchE2eItem));
+        memset(e2eItem, 0, sizeof(BenchE2eItem));
+        e2eItem->DA = fwdItem->mpAddr;
+        e2eItem->SA = mp->selfAddr;
+        TableAppend(&mp->e2eList,
+            Dot11sAddrIndex_Key(e2eItem->DA, e2eItem->SA), e2eItem);
+    }
+}
+
+
+// Frames relayed by the MP: from a neighbor, to a station behind
+// any other MAP. Frames from the BSS: from an own station.
+static void BuildFrames(
+    BenchMp* mp,
+    int numMps,
+    int self,
+    BenchFrame* relayFrames,
+    BenchFrame* bssFrames)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        ListItem* listItem = mp->neighborList.first;
+        int hop = rand() % mp->neighborList.size;
+        int dest = rand() % (numMps - 1);
+
+        if (dest >= self) {
+            dest++;
+        }
+        while (hop-- > 0) {
+            listItem = listItem->next;
+        }
+
+        relayFrames[i].TA =
+            ((BenchNeighborItem*) listItem->data)->neighborAddr;
+        relayFrames[i].DA = BenchAddress(BENCH_STATION,
+            dest * BENCH_STATIONS_PER_MAP
+            + rand() % BENCH_STATIONS_PER_MAP);
+
+        bssFrames[i].TA = BenchAddress(BENCH_STATION,
+            self * BENCH_STATIONS_PER_MAP
+            + rand() % BENCH_STATIONS_PER_MAP);
+        bssFrames[i].DA = relayFrames[i].DA;
+    }
+}
+
+
+static double NsPerFrame(clock_t start) {
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return seconds * 1e9 / BENCH_FRAMES;
+}
+
+
+static void Run(int numMps) {
+    int side = 1;
+    int self;
+    BenchMp mp;
+    BenchFrame* relayFrames =
+        (BenchFrame*) malloc(BENCH_FRAMES * sizeof(BenchFrame));
+    BenchFrame* bssFrames =
+        (BenchFrame*) malloc(BENCH_FRAMES * sizeof(BenchFrame));
+    volatile long sink = 0;
+    double relayOld;
+    double relayNew;
+    double bssOld;
+    double bssNew;
+    clock_t start;
+    int i;
+
+    while (side * side < numMps) {
+        side++;
+    }
+    self = (numMps / side / 2) * side + side / 2;
+
+    BuildMp(&mp, numMps, side, self);
+    BuildFrames(&mp, numMps, self, relayFrames, bssFrames);
+
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        BenchTrace oldTrace;
+        BenchTrace newTrace;
+
+        memset(&oldTrace, 0, sizeof(BenchTrace));
+        memset(&newTrace, 0, sizeof(BenchTrace));
+        if (!OldRelayFrame(&mp, relayFrames[i], &oldTrace)
+            || !NewRelayFrame(&mp, relayFrames[i], &newTrace)
+            || memcmp(&oldTrace, &newTrace, sizeof(BenchTrace)) != 0)
+        {
+            printf("relay mismatch at %d MPs, frame %d\n", numMps, i);
+            exit(1);
+        }
+
+        memset(&oldTrace, 0, sizeof(BenchTrace));
+        memset(&newTrace, 0, sizeof(BenchTrace));
+        if (!OldBssFrame(&mp, bssFrames[i], &oldTrace)
+            || !NewBssFrame(&mp, bssFrames[i], &newTrace)
+            || memcmp(&oldTrace, &newTrace, sizeof(BenchTrace)) != 0)
+        {
+            printf("bss mismatch at %d MPs, frame %d\n", numMps, i);
+            exit(1);
+        }
+    }
+
+    start = clock();
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        BenchTrace trace;
+
+        sink += OldRelayFrame(&mp, relayFrames[i], &trace);
+    }
+    relayOld = NsPerFrame(start);
+
+    start = clock();
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        BenchTrace trace;
+
+        sink += NewRelayFrame(&mp, relayFrames[i], &trace);
+    }
+    relayNew = NsPerFrame(start);
+
+    start = clock();
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        BenchTrace trace;
+
+        sink += OldBssFrame(&mp, bssFrames[i], &trace);
+    }
+    bssOld = NsPerFrame(start);
+
+    start = clock();
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        BenchTrace trace;
+
+        sink += NewBssFrame(&mp, bssFrames[i], &trace);
+    }
+    bssNew = NsPerFrame(start);
+
+    printf("%5d  %4d  %5d   %10.1f %10.1f  %10.1f %10.1f\n",
+           numMps, mp.fwdList.size, mp.proxyList.size,
+           relayOld, relayNew, bssOld, bssNew);
+
+    TableFree(&mp.neighborList);
+    TableFree(&mp.proxyList);
+    TableFree(&mp.fwdList);
+    TableFree(&mp.stationList);
+    TableFree(&mp.e2eList);
+    free(relayFrames);
+    free(bssFrames);
+}
+
+
+int main() {
+    static const int sizes[] = { 10, 25, 50, 100, 200, 500 };
+    unsigned int i;
+
+    srand(1);
+    printf("  MPs   fwd  proxy    relay old  relay new     bss old    bss new\n");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Run(sizes[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,372 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Slot level replay of scenarios/TDMA/multichannel, for the three
+ * schedule files of the scenario.
+ *
+ * Each node's frame is built from the schedule file the way MacTdmaInit
+ * builds it, and its slot timer is driven by the transition table
+ * (mac_tdma-transition.h) the way MacTdmaLayer drives it: at each
+ * expiry a non-idle slot on another channel retunes the radio, costing
+ * PHY_CHANSWITCH-RETUNE-DELAY before the slot's transmission goes out.
+ * Senders are saturated from the CBR start. A frame is delivered if its
+ * receiver is in a receive slot tuned to the sender's channel and no
+ * other node transmits on that channel in the slot; all nodes are in
+ * range of each other. The frame duration is the 802.11a one at 6 Mbps
+ * (phy_802_11_core.h) for the CBR payload with its UDP, IP and TDMA
+ * headers.
+ *
+ * Propagation, noise and the queues are not modelled, so the numbers
+ * are the throughput the schedules allow; the UDP server statistics of
+ * nodes 2, 4, 6 and 8 should come out at them when no frame is lost.
+ *
+ * The test exits with 1 if two nodes transmit on one channel in a
+ * slot, a receiver is on the wrong channel, a transmission does not fit
+ * its slot after the retune, or the 2 and 4 channel schedules do not
+ * carry 2 and 4 times the packets of the single channel one.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       mac_tdma_multichannel_test.cpp -o mac_tdma_multichannel_test
+ *   ./mac_tdma_multichannel_test ../../../scenarios/TDMA/multichannel
+ *
+ * Reference run:
+ *
+ *  schedule           packets/pair  aggregate kbps  switches/node  slack us
+ *  tdma_mc_1ch.sched          2265          2559.9              0      1456
+ *  tdma_mc_2ch.sched          4531          5119.7           4687      1456
+ *  tdma_mc_4ch.sched          9062         10239.4           9374      1456
+ *
+ * A pair gets 1, 2 or 4 slots per 12.801 ms frame, one 1024 byte
+ * packet each, and aggregate throughput scales with it. Senders retune
+ * twice a frame on 2 channels and at every slot on 4. slack is what is
+ * left of the 3 ms slot after the 100 us retune and the 1444 us frame.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "api.h"
+#include "mac_tdma-transition.h"
+#include "phy_802_11_core.h"
+
+#define TEST_NUM_NODES      8
+#define TEST_NUM_SLOTS      4
+#define TEST_NUM_CHANNELS   4
+
+// As in tdma_mc.config and tdma_mc.app
+static const clocktype TestSlotDuration = 3 * MILLI_SECOND;
+static const clocktype TestGuardTime = 200 * MICRO_SECOND;
+static const clocktype TestInterFrameTime = 1 * MICRO_SECOND;
+static const clocktype TestRetuneDelay = 100 * MICRO_SECOND;
+static const clocktype TestSimulationTime = 30 * SECOND;
+static const clocktype TestCbrStart = 1 * SECOND;
+static const int TestCbrItemSize = 1024;
+
+// UDP and IP headers under TdmaHeader
+static const int TestUdpIpHeaderSize = 8 + 20;
+
+static const char* TestScheduleFiles[] = {
+    "tdma_mc_1ch.sched",
+    "tdma_mc_2ch.sched",
+    "tdma_mc_4ch.sched"
+};
+
+typedef struct {
+    char frameDescriptor[TEST_NUM_SLOTS];
+    int slotChannel[TEST_NUM_SLOTS];
+    int nextTransitionSlot[TEST_NUM_SLOTS];
+    clocktype nextTransitionDelay[TEST_NUM_SLOTS];
+
+    int currentStatus;
+    int channelIndex;
+    Int64 nextExpiry;           // slot count at which the timer fires
+    clocktype txStart;          // retune end, in the current slot
+
+    int numChannelSwitches;
+    int numDelivered;
+} TestNode;
+
+typedef struct {
+    int packetsPerPair;
+    double aggregateKbps;
+    int switchesPerNode;
+    clocktype slack;
+} TestResult;
+
+
+// The slot entries of MacTdmaInit: <node>-<Rx|Tx>[-<channel>]
+static BOOL ReadSchedule(const char* path, TestNode* nodes) {
+    char line[MAX_STRING_LENGTH];
+    FILE* fp = fopen(path, "r");
+    int i;
+    int s;
+
+    if (fp == NULL) {
+        printf("cannot open %s\n", path);
+        return FALSE;
+    }
+
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        for (s = 0; s < TEST_NUM_SLOTS; s++) {
+            nodes[i].frameDescriptor[s] = TDMA_STATUS_IDLE;
+            nodes[i].slotChannel[s] = -1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char* token = strtok(line, " \t\r\n");
+        int slotId;
+
+        if (token == NULL) {
+            continue;
+        }
+        slotId = atoi(token);
+
+        while ((token = strtok(NULL, " \t\r\n")) != NULL) {
+            char* typeStr = strchr(token, '-');
+            char* channelStr;
+            int channel = -1;
+            char* c;
+
+            for (c = token; *c != 0; c++) {
+                *c = (char)tolower(*c);
+            }
+
+            *typeStr = 0;
+            typeStr++;
+            channelStr = strchr(typeStr, '-');
+            if (channelStr != NULL) {
+                *channelStr = 0;
+                channel = atoi(channelStr + 1);
+            }
+
+            i = atoi(token) - 1;
+            if (strcmp(typeStr, "tx") == 0) {
+                nodes[i].frameDescriptor[slotId] = TDMA_STATUS_TX;
+                nodes[i].slotChannel[slotId] = channel;
+            }
+            else if (nodes[i].frameDescriptor[slotId] != TDMA_STATUS_TX) {
+                nodes[i].frameDescriptor[slotId] = TDMA_STATUS_RX;
+                nodes[i].slotChannel[slotId] = channel;
+            }
+        }
+    }
+    fclose(fp);
+
+    // PHY-LISTENING-CHANNEL-MASK 1000: the first listening channel is 0
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        for (s = 0; s < TEST_NUM_SLOTS; s++) {
+            if (nodes[i].slotChannel[s] == -1) {
+                nodes[i].slotChannel[s] = 0;
+            }
+        }
+    }
+    return TRUE;
+}
+
+
+static clocktype SlotStart(Int64 slotCount) {
+    return TestInterFrameTime * (slotCount / TEST_NUM_SLOTS + 1) +
+           (TestSlotDuration + TestGuardTime) * slotCount;
+}
+
+
+static BOOL Replay(const char* path, TestResult* result) {
+    const int frameSize =
+        TestCbrItemSize + TestUdpIpHeaderSize + (int)sizeof(TdmaHeader);
+    const clocktype frameDuration =
+        Phy802_11aCore::FrameDuration(PHY802_11a_LOWEST_DATA_RATE_TYPE,
+                                      frameSize);
+    TestNode nodes[TEST_NUM_NODES];
+    Int64 slotCount;
+    int i;
+
+    memset(nodes, 0, sizeof(nodes));
+    if (!ReadSchedule(path, nodes)) {
+        return FALSE;
+    }
+
+    // MacTdmaBuildTransitionTable and MacTdmaInitializeTimer
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        TestNode* n = &nodes[i];
+
+        MacTdmaComputeTransitions(n->frameDescriptor, n->slotChannel,
+                                  TEST_NUM_SLOTS,
+                                  TestSlotDuration + TestGuardTime,
+                                  TestInterFrameTime, FALSE,
+                                  n->nextTransitionSlot,
+                                  n->nextTransitionDelay);
+        n->currentStatus = n->frameDescriptor[0];
+        n->channelIndex = 0;
+
+        if (n->frameDescriptor[0] == TDMA_STATUS_TX ||
+            n->slotChannel[0] != n->channelIndex)
+        {
+            n->nextExpiry = 0;
+        }
+        else if (n->nextTransitionSlot[0] == -1) {
+            n->nextExpiry = -1;
+        }
+        else {
+            n->nextExpiry = n->nextTransitionSlot[0];
+        }
+    }
+
+    result->slack = TestSlotDuration - TestRetuneDelay - frameDuration;
+
+    for (slotCount = 0; SlotStart(slotCount) < TestSimulationTime;
+         slotCount++)
+    {
+        const int slotId = (int)(slotCount % TEST_NUM_SLOTS);
+        const clocktype slotStart = SlotStart(slotCount);
+        int transmitter[TEST_NUM_CHANNELS];
+        int c;
+
+        // MacTdmaLayer at the expiry of each node's timer
+        for (i = 0; i < TEST_NUM_NODES; i++) {
+            TestNode* n = &nodes[i];
+            int nextSlotId;
+
+            n->txStart = slotStart;
+
+            if (n->nextExpiry != slotCount) {
+                continue;
+            }
+
+            n->currentStatus = n->frameDescriptor[slotId];
+            if (n->currentStatus != TDMA_STATUS_IDLE &&
+                n->slotChannel[slotId] != n->channelIndex)
+            {
+                n->channelIndex = n->slotChannel[slotId];
+                n->numChannelSwitches++;
+                n->txStart = slotStart + TestRetuneDelay;
+            }
+
+            nextSlotId = n->nextTransitionSlot[slotId];
+            n->nextExpiry = slotCount + (nextSlotId - slotId);
+            if (nextSlotId <= slotId) {
+                n->nextExpiry += TEST_NUM_SLOTS;
+            }
+        }
+
+        for (c = 0; c < TEST_NUM_CHANNELS; c++) {
+            transmitter[c] = -1;
+        }
+
+        for (i = 0; i < TEST_NUM_NODES; i++) {
+            TestNode* n = &nodes[i];
+
+            if (n->currentStatus != TDMA_STATUS_TX ||
+                slotStart < TestCbrStart)
+            {
+                continue;
+            }
+
+            if (transmitter[n->channelIndex] != -1) {
+                printf("%s: nodes %d and %d on channel %d in slot %d\n",
+                       path, transmitter[n->channelIndex] + 1, i + 1,
+                       n->channelIndex, slotId);
+                return FALSE;
+            }
+            if (n->txStart + frameDuration > slotStart + TestSlotDuration) {
+                printf("%s: node %d overruns slot %d\n", path, i + 1, slotId);
+                return FALSE;
+            }
+            transmitter[n->channelIndex] = i;
+        }
+
+        for (c = 0; c < TEST_NUM_CHANNELS; c++) {
+            // Pairs are 1->2, 3->4, 5->6 and 7->8
+            int sender = transmitter[c];
+            TestNode* receiver;
+
+            if (sender == -1) {
+                continue;
+            }
+
+            receiver = &nodes[sender + 1];
+            if (receiver->currentStatus != TDMA_STATUS_RX ||
+                receiver->channelIndex != c)
+            {
+                printf("%s: node %d not on channel %d in slot %d\n",
+                       path, sender + 2, c, slotId);
+                return FALSE;
+            }
+            receiver->numDelivered++;
+        }
+    }
+
+    result->packetsPerPair = nodes[1].numDelivered;
+    result->aggregateKbps = 0.0;
+    for (i = 1; i < TEST_NUM_NODES; i += 2) {
+        // The simulation may end between the slots of two pairs
+        if (abs(nodes[i].numDelivered - result->packetsPerPair) > 1) {
+            printf("%s: pairs get different slot counts\n", path);
+            return FALSE;
+        }
+        result->aggregateKbps +=
+            (double)nodes[i].numDelivered * TestCbrItemSize * 8 /
+            ((double)(TestSimulationTime - TestCbrStart) / SECOND) / 1000.0;
+    }
+    result->switchesPerNode = nodes[0].numChannelSwitches;
+    return TRUE;
+}
+
+
+int main(int argc, char** argv) {
+    const char* dir = "../../../scenarios/TDMA/multichannel";
+    TestResult results[3];
+    int k;
+
+    if (argc > 1) {
+        dir = argv[1];
+    }
+
+    for (k = 0; k < 3; k++) {
+        char path[MAX_STRING_LENGTH];
+
+        sprintf(path, "%s/%s", dir, TestScheduleFiles[k]);
+        if (!Replay(path, &results[k])) {
+            return 1;
+        }
+    }
+
+    // Each pair has 1, 2 and 4 slots per frame
+    if (results[1].packetsPerPair < 2 * results[0].packetsPerPair - 1 ||
+        results[2].packetsPerPair < 4 * results[0].packetsPerPair - 3)
+    {
+        printf("throughput does not scale with the channels\n");
+        return 1;
+    }
+
+    printf("schedule           packets/pair  aggregate kbps  "
+           "switches/node  slack us\n");
+    for (k = 0; k < 3; k++) {
+        printf("%-17s  %12d  %14.1f  %13d  %8d\n",
+               TestScheduleFiles[k],
+               results[k].packetsPerPair,
+               results[k].aggregateKbps,
+               results[k].switchesPerNode,
+               (int)(results[k].slack / MICRO_SECOND));
+    }
+    return 0;
+}
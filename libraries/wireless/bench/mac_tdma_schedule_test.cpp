@@ -0,0 +1,424 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Standalone check of TDMA-DYNAMIC-SLOT-ALLOCATION
+ * (mac_tdma-schedule.h), run frame by frame on a subnet of 8 nodes
+ * sharing a frame of 32 slots under skewed load.
+ *
+ * Every node runs its own copy of the allocation, as in the simulator,
+ * and hears the schedule header of every frame the others send. A slot
+ * with one transmitter delivers its frame; a slot with several is a
+ * collision and delivers nothing. A node whose queue is empty in its
+ * slot sends nothing.
+ *
+ * Three runs:
+ *   static   slot i belongs to node i mod 8, no schedule header
+ *   dynamic  no frame is lost
+ *   loss     as dynamic, but node 3 hears nothing during frame 10
+ *
+ * The test exits with 1 if:
+ *   - the nodes of the dynamic run ever disagree on the schedule, or a
+ *     slot has several transmitters, or none while no node is on its
+ *     static slot;
+ *   - a node's slot count is off its backlog share of the spare slots
+ *     by one or more, or a node has no slot;
+ *   - in the loss run, the nodes disagree or a slot has several
+ *     transmitters outside frame 12 (the frame whose reallocation uses
+ *     the reports of frame 10), or a node is still on its static slot
+ *     from frame 14 on;
+ *   - from frame 20 on, the queues of either dynamic run hold more
+ *     than two frames of slots.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       mac_tdma_schedule_test.cpp -o mac_tdma_schedule_test
+ *
+ * Reference run (g++ 12 -O2, x86-64), 2000 frames, offered load of 24
+ * packets per frame, 12 of them at node 0; max backlog is over all
+ * queues from frame 20 on:
+ *
+ *  run      delivered/frame  empty slots  double booked  collisions  max backlog
+ *  static             14.00        0.562              0           0        20000
+ *  dynamic            24.00        0.250              0           0           22
+ *  loss               23.99        0.250              3           0           22
+ *
+ * With the static schedule node 0 gets 4 of the 32 slots for 12
+ * packets a frame and its queue grows without bound, while the slots of
+ * the lightly loaded nodes go empty. The dynamic schedule carries the
+ * whole offered load. Since it follows reports two frames old, node
+ * 0's share swings between 1 and 25 slots over a few frames rather than
+ * settling, but the queues stay under one frame of slots. In the loss
+ * run node 3 claims three slots of node 0 in frame 12; its queue is
+ * empty by then, so nothing collides. All nodes then keep to their
+ * static slots for frame 13 and agree again from frame 14.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api.h"
+#include "mac_tdma-schedule.h"
+
+#define TEST_NUM_NODES      8
+#define TEST_NUM_SLOTS      32
+#define TEST_NUM_FRAMES     2000
+#define TEST_LOSS_NODE      3
+#define TEST_LOSS_FRAME     10
+
+enum {
+    TEST_RUN_STATIC,
+    TEST_RUN_DYNAMIC,
+    TEST_RUN_LOSS
+};
+
+// Packets arriving at each node per frame.
+static const int TestArrivals[TEST_NUM_NODES] = { 12, 6, 2, 1, 1, 1, 1, 0 };
+
+typedef struct {
+    MacDataTdma tdma;
+    int queueLength;
+} TestNode;
+
+typedef struct {
+    int numDelivered;
+    int numTxSlots;
+    int numTxSlotsMissed;
+    int numDoubleBooked;        // slots with several transmitters
+    int numCollisions;          // of them, slots with several frames
+    int maxBacklog;             // all queues, from frame 20 on
+} TestResult;
+
+
+static void InitNode(TestNode* testNode, int nodeIndex, BOOL dynamicMode) {
+    MacDataTdma* tdma = &testNode->tdma;
+    int i;
+
+    memset(testNode, 0, sizeof(TestNode));
+    tdma->numSlotsPerFrame = TEST_NUM_SLOTS;
+    tdma->frameDescriptor = (char*)malloc(TEST_NUM_SLOTS);
+
+    for (i = 0; i < TEST_NUM_SLOTS; i++) {
+        tdma->frameDescriptor[i] = (i % TEST_NUM_NODES == nodeIndex) ?
+                                   TDMA_STATUS_TX : TDMA_STATUS_RX;
+    }
+
+    if (dynamicMode) {
+        // As MacTdmaInit does for TDMA-DYNAMIC-SLOT-ALLOCATION YES
+        MacTdmaDynamicAllocation* dynamic = (MacTdmaDynamicAllocation*)
+            calloc(1, sizeof(MacTdmaDynamicAllocation));
+
+        dynamic->subnetListIndex = nodeIndex;
+        dynamic->numNodesInSubnet = TEST_NUM_NODES;
+        dynamic->reallocationInterval = 1;
+        dynamic->frameNumber = -1;
+        dynamic->reports = (MacTdmaBacklogReport*)
+            malloc(2 * TEST_NUM_NODES * sizeof(MacTdmaBacklogReport));
+        for (i = 0; i < 2 * TEST_NUM_NODES; i++) {
+            dynamic->reports[i].frameNumber = -1;
+            dynamic->reports[i].backlog = 0;
+        }
+        dynamic->slotCount = (int*)malloc(TEST_NUM_NODES * sizeof(int));
+        dynamic->remainder = (int*)malloc(TEST_NUM_NODES * sizeof(int));
+        dynamic->scheduleEpoch = -1;
+
+        tdma->dynamicAllocation = dynamic;
+    }
+}
+
+
+static void FreeNode(TestNode* testNode) {
+    MacTdmaDynamicAllocation* dynamic = testNode->tdma.dynamicAllocation;
+
+    if (dynamic != NULL) {
+        free(dynamic->reports);
+        free(dynamic->slotCount);
+        free(dynamic->remainder);
+        free(dynamic);
+    }
+    free(testNode->tdma.frameDescriptor);
+}
+
+
+// What MacTdmaStartFrame does at slot 0, less the transition table.
+static void StartFrame(MacDataTdma* tdma) {
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    BOOL usedStaticSlot = dynamic->useStaticSlot;
+
+    dynamic->frameNumber++;
+
+    if (dynamic->scheduleMismatch) {
+        dynamic->useStaticSlot = TRUE;
+    }
+    else if (dynamic->scheduleConfirmed) {
+        dynamic->useStaticSlot = FALSE;
+    }
+    dynamic->scheduleMismatch = FALSE;
+    dynamic->scheduleConfirmed = FALSE;
+
+    if (dynamic->frameNumber % dynamic->reallocationInterval == 0) {
+        MacTdmaReallocateSlots(tdma);
+        MacTdmaLayOutSchedule(tdma);
+    }
+    else if (dynamic->useStaticSlot != usedStaticSlot) {
+        MacTdmaLayOutSchedule(tdma);
+    }
+}
+
+
+// Each node's slot count is its backlog share of the spare slots,
+// rounded up or down, plus its own slot.
+static BOOL CheckShares(const MacTdmaDynamicAllocation* dynamic) {
+    const int numSpare = TEST_NUM_SLOTS - TEST_NUM_NODES;
+    const int reportFrame = dynamic->frameNumber - 2;
+    int backlog[TEST_NUM_NODES];
+    int totalBacklog = 0;
+    int i;
+
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        const MacTdmaBacklogReport* report =
+            &dynamic->reports[2 * i + reportFrame % 2];
+
+        backlog[i] = (report->frameNumber == reportFrame) ?
+                     report->backlog : 0;
+        totalBacklog += backlog[i];
+    }
+
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        double share = (totalBacklog == 0) ?
+                       (double)numSpare / TEST_NUM_NODES :
+                       (double)numSpare * backlog[i] / totalBacklog;
+        double extra = dynamic->slotCount[i] - 1 - share;
+
+        if (dynamic->slotCount[i] < 1 || extra <= -1.0 || extra >= 1.0) {
+            printf("frame %d: node %d has %d slots for a share of %.2f\n",
+                   dynamic->frameNumber, i, dynamic->slotCount[i], share);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+static BOOL Run(int run, TestResult* result) {
+    TestNode nodes[TEST_NUM_NODES];
+    BOOL dynamicMode = (run != TEST_RUN_STATIC);
+    int frame;
+    int slotId;
+    int i;
+
+    memset(result, 0, sizeof(TestResult));
+
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        InitNode(&nodes[i], i, dynamicMode);
+    }
+
+    for (frame = 0; frame < TEST_NUM_FRAMES; frame++) {
+        BOOL agree = TRUE;
+        BOOL anyStaticSlot = FALSE;
+
+        for (i = 0; i < TEST_NUM_NODES; i++) {
+            nodes[i].queueLength += TestArrivals[i];
+
+            if (dynamicMode) {
+                StartFrame(&nodes[i].tdma);
+            }
+        }
+
+        if (dynamicMode) {
+            const MacTdmaDynamicAllocation* first =
+                nodes[0].tdma.dynamicAllocation;
+
+            for (i = 0; i < TEST_NUM_NODES; i++) {
+                const MacTdmaDynamicAllocation* dynamic =
+                    nodes[i].tdma.dynamicAllocation;
+
+                if (dynamic->scheduleHash != first->scheduleHash) {
+                    agree = FALSE;
+                }
+                if (dynamic->useStaticSlot) {
+                    anyStaticSlot = TRUE;
+                }
+                if (run == TEST_RUN_LOSS &&
+                    frame >= TEST_LOSS_FRAME + 4 &&
+                    dynamic->useStaticSlot)
+                {
+                    printf("loss: node %d on its static slot in frame %d\n",
+                           i, frame);
+                    return FALSE;
+                }
+            }
+
+            if (!agree &&
+                (run == TEST_RUN_DYNAMIC || frame != TEST_LOSS_FRAME + 2))
+            {
+                printf("run %d: schedules differ in frame %d\n", run, frame);
+                return FALSE;
+            }
+            if (agree && frame >= 2 && !CheckShares(first)) {
+                return FALSE;
+            }
+        }
+
+        for (slotId = 0; slotId < TEST_NUM_SLOTS; slotId++) {
+            int numTransmitters = 0;
+            int numSent = 0;
+            int sender = -1;
+            TdmaScheduleHeader scheduleHdr;
+
+            memset(&scheduleHdr, 0, sizeof(TdmaScheduleHeader));
+
+            for (i = 0; i < TEST_NUM_NODES; i++) {
+                MacDataTdma* tdma = &nodes[i].tdma;
+                MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+
+                if (tdma->frameDescriptor[slotId] != TDMA_STATUS_TX) {
+                    continue;
+                }
+
+                numTransmitters++;
+                result->numTxSlots++;
+
+                if (nodes[i].queueLength == 0) {
+                    result->numTxSlotsMissed++;
+                    continue;
+                }
+
+                nodes[i].queueLength--;
+                numSent++;
+                sender = i;
+
+                if (dynamic != NULL) {
+                    // As MacTdmaAddScheduleHeader
+                    scheduleHdr.senderIndex = dynamic->subnetListIndex;
+                    scheduleHdr.frameNumber = dynamic->frameNumber;
+                    scheduleHdr.scheduleEpoch = dynamic->scheduleEpoch;
+                    scheduleHdr.scheduleHash = dynamic->scheduleHash;
+                    scheduleHdr.backlog = nodes[i].queueLength;
+
+                    MacTdmaRecordBacklog(tdma,
+                                         scheduleHdr.senderIndex,
+                                         scheduleHdr.frameNumber,
+                                         scheduleHdr.backlog);
+                }
+            }
+
+            // Only frame 12 of the loss run may have two transmitters.
+            // On static slots, the spare slots have none.
+            if ((numTransmitters > 1 &&
+                 (run != TEST_RUN_LOSS || frame != TEST_LOSS_FRAME + 2)) ||
+                (numTransmitters == 0 && !anyStaticSlot))
+            {
+                printf("run %d: %d transmitters in slot %d of frame %d\n",
+                       run, numTransmitters, slotId, frame);
+                return FALSE;
+            }
+
+            if (numTransmitters > 1) {
+                result->numDoubleBooked++;
+            }
+
+            if (numSent > 1) {
+                result->numCollisions++;
+                continue;
+            }
+
+            if (numSent == 0) {
+                continue;
+            }
+
+            result->numDelivered++;
+
+            if (!dynamicMode) {
+                continue;
+            }
+
+            // As MacTdmaRemoveScheduleHeader at every other node
+            for (i = 0; i < TEST_NUM_NODES; i++) {
+                if (i == sender ||
+                    (run == TEST_RUN_LOSS && i == TEST_LOSS_NODE &&
+                     frame == TEST_LOSS_FRAME))
+                {
+                    continue;
+                }
+
+                MacTdmaRecordBacklog(&nodes[i].tdma,
+                                     scheduleHdr.senderIndex,
+                                     scheduleHdr.frameNumber,
+                                     scheduleHdr.backlog);
+                MacTdmaCheckSchedule(&nodes[i].tdma,
+                                     scheduleHdr.scheduleEpoch,
+                                     scheduleHdr.scheduleHash);
+            }
+        }
+
+        if (frame >= 2 * TEST_LOSS_FRAME) {
+            int backlog = 0;
+
+            for (i = 0; i < TEST_NUM_NODES; i++) {
+                backlog += nodes[i].queueLength;
+            }
+            if (backlog > result->maxBacklog) {
+                result->maxBacklog = backlog;
+            }
+        }
+    }
+
+    for (i = 0; i < TEST_NUM_NODES; i++) {
+        FreeNode(&nodes[i]);
+    }
+    return TRUE;
+}
+
+
+int main() {
+    static const char* runNames[] = { "static", "dynamic", "loss" };
+    TestResult results[3];
+    int run;
+
+    for (run = TEST_RUN_STATIC; run <= TEST_RUN_LOSS; run++) {
+        if (!Run(run, &results[run])) {
+            return 1;
+        }
+    }
+
+    if (results[TEST_RUN_DYNAMIC].maxBacklog > 2 * TEST_NUM_SLOTS ||
+        results[TEST_RUN_LOSS].maxBacklog > 2 * TEST_NUM_SLOTS)
+    {
+        printf("backlog over two frames: %d and %d\n",
+               results[TEST_RUN_DYNAMIC].maxBacklog,
+               results[TEST_RUN_LOSS].maxBacklog);
+        return 1;
+    }
+
+    printf("run      delivered/frame  empty slots  double booked  "
+           "collisions  max backlog\n");
+    for (run = TEST_RUN_STATIC; run <= TEST_RUN_LOSS; run++) {
+        const TestResult* result = &results[run];
+
+        printf("%-7s  %15.2f  %11.3f  %13d  %10d  %11d\n",
+               runNames[run],
+               (double)result->numDelivered / TEST_NUM_FRAMES,
+               (double)result->numTxSlotsMissed / result->numTxSlots,
+               result->numDoubleBooked,
+               result->numCollisions,
+               result->maxBacklog);
+    }
+    return 0;
+}
@@ -0,0 +1,301 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Standalone timing and equivalence test for the TDMA slot transition
+ * table (mac_tdma-transition.h), at 8 to 4096 slots per frame.
+ *
+ * Equivalence: for random frames of TX, RX and idle slots on random
+ * channels, with and without the stop at frame start of dynamic slot
+ * allocation, MacTdmaComputeTransitions must give the same next slot
+ * and delay for every slot as a slot by slot walk. The walk is what
+ * MacTdmaUpdateTimer did before the table: step one slot at a time,
+ * adding the inter-frame time at the wrap, until the status or channel
+ * changes or the current slot is a transmit slot. A frame with no
+ * change gives no transition. The test exits with 1 on a mismatch.
+ *
+ * Timing, on the frame TDMA-SCHEDULING AUTOMATIC builds for node 0 of
+ * a subnet of 8 and of a subnet with one slot per node: the walk and
+ * the table lookup per transition, and the one time cost of building
+ * the table for the second frame.
+ *
+ * Build from this directory:
+ *
+ *   g++ -O2 -I../src -I$QUALNET_HOME/include \
+ *       mac_tdma_transition_test.cpp -o mac_tdma_transition_test
+ *
+ * Reference run (g++ 12 -O2, x86-64), ns per transition and us per
+ * table build:
+ *
+ *           subnet of 8        one slot per node
+ *  slots   walk ns  table ns   walk ns  table ns  build us
+ *      8      14.9       2.6      15.3       2.6      0.09
+ *     16      15.6       2.6      28.0       2.6      0.19
+ *     32      15.9       2.6      52.1       2.5      0.40
+ *     64      16.0       2.5     103.5       2.5      0.77
+ *    128      15.9       2.6     195.6       2.5      1.72
+ *    256      15.6       2.5     393.0       2.5      3.16
+ *    512      15.0       2.4     777.4       2.6      6.29
+ *   1024      15.9       2.6    1337.9       2.6     12.77
+ *   2048      13.5       2.5    2663.2       2.5     28.22
+ *   4096      13.4       2.6    5268.8       2.6     55.47
+ *
+ * The walk costs the length of the run it crosses; the lookup does not
+ * depend on the frame. The build is paid at init and, with dynamic
+ * slot allocation, at every reallocation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "api.h"
+#include "mac_tdma-transition.h"
+
+#define TEST_MIN_SLOTS          8
+#define TEST_MAX_SLOTS          4096
+#define TEST_FRAMES_PER_SIZE    64
+#define TEST_SUBNET_SIZE        8
+#define TEST_TRANSITIONS        (1 << 20)
+
+static const clocktype TestSlotTime = 10 * MILLI_SECOND;
+static const clocktype TestInterFrameTime = 1 * MICRO_SECOND;
+
+
+// The walk MacTdmaUpdateTimer did before the transition table.
+static int WalkNextTransition(
+    const char* frameDescriptor,
+    const int* slotChannel,
+    int numSlots,
+    BOOL stopAtFrameStart,
+    int slotId,
+    clocktype* delay)
+{
+    int currentSlotId = slotId;
+    int nextSlotId;
+    int i;
+
+    *delay = 0;
+
+    for (i = 0; i < numSlots; i++) {
+        nextSlotId = (slotId == numSlots - 1) ? 0 : slotId + 1;
+
+        *delay += TestSlotTime;
+        if (nextSlotId == 0) {
+            *delay += TestInterFrameTime;
+        }
+
+        if (frameDescriptor[nextSlotId] != frameDescriptor[currentSlotId] ||
+            slotChannel[nextSlotId] != slotChannel[currentSlotId] ||
+            frameDescriptor[currentSlotId] == TDMA_STATUS_TX ||
+            (stopAtFrameStart && nextSlotId == 0))
+        {
+            return nextSlotId;
+        }
+
+        slotId = nextSlotId;
+    }
+
+    *delay = 0;
+    return -1;
+}
+
+
+static void RandomFrame(
+    char* frameDescriptor,
+    int* slotChannel,
+    int numSlots,
+    int numStatuses,
+    int numChannels)
+{
+    static const char statuses[] =
+        { TDMA_STATUS_RX, TDMA_STATUS_IDLE, TDMA_STATUS_TX };
+    int runLength = 1 + rand() % 16;
+    int i;
+
+    for (i = 0; i < numSlots; i++) {
+        if (i % runLength == 0) {
+            runLength = 1 + rand() % 16;
+            frameDescriptor[i] = statuses[rand() % numStatuses];
+            slotChannel[i] = rand() % numChannels;
+        }
+        else {
+            frameDescriptor[i] = frameDescriptor[i - 1];
+            slotChannel[i] = slotChannel[i - 1];
+        }
+    }
+}
+
+
+static BOOL CheckFrame(
+    const char* frameDescriptor,
+    const int* slotChannel,
+    int numSlots,
+    BOOL stopAtFrameStart,
+    int* nextTransitionSlot,
+    clocktype* nextTransitionDelay)
+{
+    int i;
+
+    MacTdmaComputeTransitions(frameDescriptor, slotChannel, numSlots,
+                              TestSlotTime, TestInterFrameTime,
+                              stopAtFrameStart,
+                              nextTransitionSlot, nextTransitionDelay);
+
+    for (i = 0; i < numSlots; i++) {
+        clocktype delay;
+        int nextSlotId = WalkNextTransition(frameDescriptor, slotChannel,
+                                            numSlots, stopAtFrameStart,
+                                            i, &delay);
+
+        if (nextSlotId != nextTransitionSlot[i] ||
+            delay != nextTransitionDelay[i])
+        {
+            printf("mismatch: %d slots, slot %d, walk %d, table %d\n",
+                   numSlots, i, nextSlotId, nextTransitionSlot[i]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+
+static double Elapsed(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+static void Time(
+    int numSlots,
+    int subnetSize,
+    char* frameDescriptor,
+    int* slotChannel,
+    int* nextTransitionSlot,
+    clocktype* nextTransitionDelay,
+    double* walkNs,
+    double* tableNs,
+    double* buildUs)
+{
+    volatile clocktype sink = 0;
+    int numBuilds = TEST_TRANSITIONS / numSlots + 1;
+    int slotId;
+    clock_t start;
+    int i;
+
+    // The frame of node 0 under automatic scheduling: slot i belongs
+    // to node i % subnet size, the other slots are receive slots.
+    for (i = 0; i < numSlots; i++) {
+        frameDescriptor[i] = (i % subnetSize == 0) ?
+                             TDMA_STATUS_TX : TDMA_STATUS_RX;
+        slotChannel[i] = 0;
+    }
+
+    start = clock();
+    for (i = 0; i < numBuilds; i++) {
+        MacTdmaComputeTransitions(frameDescriptor, slotChannel, numSlots,
+                                  TestSlotTime, TestInterFrameTime, FALSE,
+                                  nextTransitionSlot, nextTransitionDelay);
+    }
+    *buildUs = Elapsed(start) * 1e6 / numBuilds;
+
+    slotId = 0;
+    start = clock();
+    for (i = 0; i < TEST_TRANSITIONS; i++) {
+        clocktype delay;
+
+        slotId = WalkNextTransition(frameDescriptor, slotChannel, numSlots,
+                                    FALSE, slotId, &delay);
+        sink += delay;
+    }
+    *walkNs = Elapsed(start) * 1e9 / TEST_TRANSITIONS;
+
+    slotId = 0;
+    start = clock();
+    for (i = 0; i < TEST_TRANSITIONS; i++) {
+        sink += nextTransitionDelay[slotId];
+        slotId = nextTransitionSlot[slotId];
+    }
+    *tableNs = Elapsed(start) * 1e9 / TEST_TRANSITIONS;
+}
+
+
+int main() {
+    char* frameDescriptor = (char*)malloc(TEST_MAX_SLOTS);
+    int* slotChannel = (int*)malloc(TEST_MAX_SLOTS * sizeof(int));
+    int* nextTransitionSlot = (int*)malloc(TEST_MAX_SLOTS * sizeof(int));
+    clocktype* nextTransitionDelay =
+        (clocktype*)malloc(TEST_MAX_SLOTS * sizeof(clocktype));
+    int numSlots;
+    int frame;
+
+    srand(1);
+
+    for (numSlots = TEST_MIN_SLOTS;
+         numSlots <= TEST_MAX_SLOTS;
+         numSlots *= 2)
+    {
+        for (frame = 0; frame < TEST_FRAMES_PER_SIZE; frame++) {
+            // Vary the number of statuses and channels so that single
+            // status and single channel frames are covered too.
+            int numStatuses = 1 + frame % 3;
+            int numChannels = 1 + (frame / 3) % 3;
+            int size = numSlots - (frame % 2) * (rand() % (numSlots / 2));
+
+            RandomFrame(frameDescriptor, slotChannel, size,
+                        numStatuses, numChannels);
+
+            if (!CheckFrame(frameDescriptor, slotChannel, size, FALSE,
+                            nextTransitionSlot, nextTransitionDelay) ||
+                !CheckFrame(frameDescriptor, slotChannel, size, TRUE,
+                            nextTransitionSlot, nextTransitionDelay))
+            {
+                return 1;
+            }
+        }
+    }
+    printf("equivalence: %d to %d slots OK\n\n",
+           TEST_MIN_SLOTS, TEST_MAX_SLOTS);
+
+    printf("         subnet of %d        one slot per node\n",
+           TEST_SUBNET_SIZE);
+    printf("slots   walk ns  table ns   walk ns  table ns  build us\n");
+    for (numSlots = TEST_MIN_SLOTS;
+         numSlots <= TEST_MAX_SLOTS;
+         numSlots *= 2)
+    {
+        double walkNs[2];
+        double tableNs[2];
+        double buildUs;
+
+        Time(numSlots, TEST_SUBNET_SIZE, frameDescriptor, slotChannel,
+             nextTransitionSlot, nextTransitionDelay,
+             &walkNs[0], &tableNs[0], &buildUs);
+        Time(numSlots, numSlots, frameDescriptor, slotChannel,
+             nextTransitionSlot, nextTransitionDelay,
+             &walkNs[1], &tableNs[1], &buildUs);
+
+        printf("%5d  %8.1f  %8.1f  %8.1f  %8.1f  %8.2f\n",
+               numSlots, walkNs[0], tableNs[0],
+               walkNs[1], tableNs[1], buildUs);
+    }
+
+    free(frameDescriptor);
+    free(slotChannel);
+    free(nextTransitionSlot);
+    free(nextTransitionDelay);
+    return 0;
+}
@@ -0,0 +1,1093 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file mac_dot11-ampdu.cpp
+ * \brief A-MPDU aggregation with Block ACK for the DCF data path.
+ *
+ * The aggregate is a single packet: a DOT11_AMPDU header, then per
+ * subframe a delimiter and the real bytes of the data frame; the virtual
+ * payloads of the subframes add up to the virtual payload of the
+ * aggregate. The PHY is told the frame is an aggregate, so it skips its
+ * whole-frame error draw and reports the worst SINR of the reception;
+ * each subframe is then drawn here against its own length.
+ *
+ * Subframe i of a first attempt carries sequence number toSeqNo + i, and
+ * toSeqNo moves past the whole aggregate once it completes or is
+ * dropped. Retries leave gaps and send older numbers after newer ones,
+ * so the receiver keeps a 64 entry scoreboard per sender instead of the
+ * next-expected check used for single frames.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "api.h"
+#include "partition.h"
+#include "mac_dot11.h"
+#include "mac_dot11-sta.h"
+#include "util_dbconv.h"
+
+#define DOT11_SEQNO_MASK    (DOT11_SEQNO_MODULO - 1)
+
+
+//-------------------------------------------------------------------------
+// Static Functions
+//-------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduSizeBucket
+//  PURPOSE:     Histogram bucket of an aggregate size: 1, 2, 3-4, 5-8,
+//               9-16, 17-32 and 33-64 subframes.
+//  PARAMETERS:  int numSubframes
+//                  Number of subframes, 1 to DOT11_AMPDU_MAX_SUBFRAMES
+//  RETURN:      Bucket index
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+int MacDot11AmpduSizeBucket(int numSubframes)
+{
+    int bucket = 0;
+    int size = numSubframes - 1;
+
+    while (size > 0) {
+        bucket++;
+        size >>= 1;
+    }
+
+    return bucket;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduGetLinkStats
+//  PURPOSE:     Find or create the statistics of a receiver.
+//  PARAMETERS:  DOT11_Ampdu* ampdu
+//                  Aggregation state
+//               Mac802Address address
+//                  Receiver address
+//  RETURN:      Statistics of the link
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+DOT11_AmpduLinkStats* MacDot11AmpduGetLinkStats(
+    DOT11_Ampdu* ampdu,
+    Mac802Address address)
+{
+    DOT11_AmpduLinkStats* link = ampdu->linkStatsHead;
+
+    while (link != NULL) {
+        if (link->address == address) {
+            return link;
+        }
+        link = link->next;
+    }
+
+    link = (DOT11_AmpduLinkStats*) MEM_malloc(sizeof(DOT11_AmpduLinkStats));
+    memset(link, 0, sizeof(DOT11_AmpduLinkStats));
+    link->address = address;
+    link->next = ampdu->linkStatsHead;
+    ampdu->linkStatsHead = link;
+
+    return link;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduFrameQualifies
+//  PURPOSE:     Whether the local buffer frame may be aggregated. Only
+//               plain DCF unicast data is: QoS, mesh, power save,
+//               directional antennas and MAC security each change the
+//               frame exchange in ways the aggregate does not model.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      TRUE if the frame may go out in an aggregate
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+BOOL MacDot11AmpduFrameQualifies(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    return dot11->ampduEnabled
+           && dot11->dot11TxFrameInfo != NULL
+           && dot11->dot11TxFrameInfo->frameType == DOT11_DATA
+           && dot11->currentNextHopAddress != ANY_MAC802
+           && !MacDot11IsQoSEnabled(node, dot11)
+           && !dot11->isMP
+           && !dot11->useDvcs
+           && !MacDot11IsAPSupportPSMode(dot11)
+           && !MacDot11IsIBSSStationSupportPSMode(dot11)
+           && !MacDot11IsStationSupportPSMode(dot11)
+           && node->macData[dot11->myMacData->interfaceIndex]->encryptionVar
+              == NULL;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduReleaseSubframes
+//  PURPOSE:     End the outstanding aggregate. Unacknowledged subframes
+//               taken from the output queue are reported to the network
+//               layer as dropped.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11AmpduReleaseSubframes(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    int i;
+
+    for (i = 1; i < ampdu->numSubframes; i++) {
+        DOT11_AmpduSubframe* subframe = &ampdu->subframe[i];
+
+        if (subframe->acked) {
+            continue;
+        }
+
+        MESSAGE_RemoveHeader(node,
+                             subframe->msg,
+                             sizeof(DOT11_FrameHdr),
+                             TRACE_DOT11);
+        MAC_NotificationOfPacketDrop(node,
+                                     subframe->ipNextHopAddr,
+                                     dot11->myMacData->interfaceIndex,
+                                     subframe->msg);
+        subframe->msg = NULL;
+
+        dot11->pktsDroppedDcf++;
+        ampdu->link->subframesDropped++;
+    }
+
+    if (!ampdu->subframe[0].acked) {
+        ampdu->link->subframesDropped++;
+    }
+
+    ampdu->numSubframes = 0;
+    ampdu->numAcked = 0;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduCollect
+//  PURPOSE:     Start a new aggregate with the local buffer frame and add
+//               the frames queued behind it for the same receiver, while
+//               the length, duration and subframe limits allow.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               Message* frame
+//                  Copy of the local buffer frame
+//               int dataRateType
+//                  Transmit data rate type
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11AmpduCollect(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* frame,
+    int dataRateType)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    int interfaceIndex = dot11->myMacData->interfaceIndex;
+    DOT11_FrameHdr* hdr = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(frame);
+    Mac802Address ipDestAddr = dot11->ipDestAddr;
+    int length =
+        sizeof(DOT11_FrameHdr) + sizeof(DOT11_AmpduDelimiter) +
+        MESSAGE_ReturnPacketSize(frame);
+
+    ampdu->numSubframes = 1;
+    ampdu->numAcked = 0;
+    ampdu->receiverAddr = dot11->currentNextHopAddress;
+    ampdu->link = MacDot11AmpduGetLinkStats(ampdu, ampdu->receiverAddr);
+    ampdu->subframe[0].msg = dot11->currentMessage;
+    ampdu->subframe[0].seqNo = hdr->seqNo;
+    ampdu->subframe[0].ipNextHopAddr = dot11->ipNextHopAddr;
+    ampdu->subframe[0].acked = FALSE;
+
+    while (ampdu->numSubframes < dot11->ampduMaxSubframes) {
+        DOT11_AmpduSubframe* subframe =
+            &ampdu->subframe[ampdu->numSubframes];
+        DOT11_FrameHdr* subframeHdr;
+        Message* msg = NULL;
+        Mac802Address nextHopAddr;
+        Mac802Address receiverAddr;
+        int networkType;
+        TosType priority;
+        int size;
+
+        if (!MAC_OutputQueueTopPacket(node,
+                                      interfaceIndex,
+                                      &msg,
+                                      &nextHopAddr,
+                                      &networkType,
+                                      &priority))
+        {
+            break;
+        }
+
+        // Same mapping as MacDot11ClassifyPacket: a BSS station sends
+        // every unicast to its AP.
+        receiverAddr = nextHopAddr;
+        if (MacDot11IsBssStation(dot11) &&
+            !MAC_IsBroadcastMac802Address(&nextHopAddr))
+        {
+            receiverAddr = dot11->bssAddr;
+        }
+
+        if (receiverAddr != ampdu->receiverAddr) {
+            break;
+        }
+
+        size = sizeof(DOT11_AmpduDelimiter) + sizeof(DOT11_FrameHdr) +
+               MESSAGE_ReturnPacketSize(msg);
+
+        if (length + size > dot11->ampduMaxLength ||
+            PHY_GetTransmissionDuration(
+                node, dot11->myMacData->phyNumber,
+                dataRateType, length + size) > dot11->ampduMaxDuration)
+        {
+            break;
+        }
+
+        MAC_OutputQueueDequeuePacket(node,
+                                     interfaceIndex,
+                                     &msg,
+                                     &nextHopAddr,
+                                     &networkType,
+                                     &priority);
+
+        MESSAGE_AddHeader(node, msg, sizeof(DOT11_FrameHdr), TRACE_DOT11);
+
+        // Address3 of a BSS station comes from the IP next hop.
+        dot11->ipDestAddr = nextHopAddr;
+        subframeHdr = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(msg);
+        MacDot11StationSetFieldsInDataFrameHdr(dot11,
+                                               subframeHdr,
+                                               ampdu->receiverAddr,
+                                               DOT11_DATA);
+        subframeHdr->seqNo =
+            (hdr->seqNo + ampdu->numSubframes) & DOT11_SEQNO_MASK;
+        subframeHdr->duration = hdr->duration;
+
+        subframe->msg = msg;
+        subframe->seqNo = subframeHdr->seqNo;
+        subframe->ipNextHopAddr = nextHopAddr;
+        subframe->acked = FALSE;
+
+        ampdu->numSubframes++;
+        dot11->pktsToSend++;
+        length += size;
+    }
+
+    dot11->ipDestAddr = ipDestAddr;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduCopyMessageFields
+//  PURPOSE:     Copy the simulation bookkeeping of a message, as IP does
+//               for fragments.
+//  PARAMETERS:  Message* to
+//                  Message to fill in
+//               const Message* from
+//                  Message to copy from
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11AmpduCopyMessageFields(
+    Message* to,
+    const Message* from)
+{
+    int i;
+
+    to->sequenceNumber = from->sequenceNumber;
+    to->originatingProtocol = from->originatingProtocol;
+    to->protocolType = from->protocolType;
+    to->layerType = from->layerType;
+    to->numberOfHeaders = from->numberOfHeaders;
+    to->packetCreationTime = from->packetCreationTime;
+    to->originatingNodeId = from->originatingNodeId;
+    to->instanceId = from->instanceId;
+    to->naturalOrder = from->naturalOrder;
+
+    for (i = 0; i < from->numberOfHeaders; i++) {
+        to->headerProtocols[i] = from->headerProtocols[i];
+        to->headerSizes[i] = from->headerSizes[i];
+    }
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduAssemble
+//  PURPOSE:     Build the aggregate of the subframes not acknowledged
+//               yet. Frees the local buffer copy.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               Message* frame
+//                  Copy of the local buffer frame
+//               int dataRateType
+//                  Transmit data rate type
+//  RETURN:      The aggregate
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+Message* MacDot11AmpduAssemble(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* frame,
+    int dataRateType)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    DOT11_FrameHdr* frameHdr = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(frame);
+    Message* aggregate;
+    DOT11_FrameHdr* hdr;
+    char* payload;
+    int realSize = sizeof(DOT11_FrameHdr);
+    int virtualSize = 0;
+    int firstSeqNo = -1;
+    int numSent = 0;
+    int i;
+
+    for (i = 0; i < ampdu->numSubframes; i++) {
+        Message* msg = (i == 0) ? frame : ampdu->subframe[i].msg;
+
+        if (ampdu->subframe[i].acked) {
+            continue;
+        }
+        if (firstSeqNo < 0) {
+            firstSeqNo = ampdu->subframe[i].seqNo;
+        }
+
+        realSize += sizeof(DOT11_AmpduDelimiter) + msg->packetSize;
+        virtualSize += MESSAGE_ReturnPacketSize(msg) - msg->packetSize;
+        numSent++;
+    }
+
+    aggregate = MESSAGE_Alloc(node, 0, 0, 0);
+    MESSAGE_PacketAlloc(node, aggregate, realSize, TRACE_DOT11);
+    payload = MESSAGE_ReturnPacket(aggregate);
+
+    hdr = (DOT11_FrameHdr*) payload;
+    memset(hdr, 0, sizeof(DOT11_FrameHdr));
+    hdr->frameType = DOT11_AMPDU;
+    hdr->frameFlags = frameHdr->frameFlags;
+    hdr->destAddr = ampdu->receiverAddr;
+    hdr->sourceAddr = dot11->selfAddr;
+    hdr->address3 = frameHdr->address3;
+    hdr->seqNo = firstSeqNo;
+    hdr->duration = (UInt16)
+        MacDot11NanoToMicrosecond(
+            dot11->extraPropDelay + dot11->sifs +
+            PHY_GetTransmissionDuration(
+                node, dot11->myMacData->phyNumber,
+                dataRateType,
+                DOT11_BLOCK_ACK_FRAME_SIZE) +
+            dot11->extraPropDelay);
+    payload += sizeof(DOT11_FrameHdr);
+
+    for (i = 0; i < ampdu->numSubframes; i++) {
+        Message* msg = (i == 0) ? frame : ampdu->subframe[i].msg;
+        DOT11_AmpduDelimiter delimiter;
+
+        if (ampdu->subframe[i].acked) {
+            continue;
+        }
+
+        delimiter.mpduLength = (UInt16) msg->packetSize;
+        delimiter.virtualLength =
+            (UInt16) (MESSAGE_ReturnPacketSize(msg) - msg->packetSize);
+
+        memcpy(payload, &delimiter, sizeof(DOT11_AmpduDelimiter));
+        payload += sizeof(DOT11_AmpduDelimiter);
+        memcpy(payload, MESSAGE_ReturnPacket(msg), msg->packetSize);
+        payload += msg->packetSize;
+    }
+
+    if (virtualSize > 0) {
+        MESSAGE_AddVirtualPayload(node, aggregate, virtualSize);
+    }
+
+    MacDot11AmpduCopyMessageFields(aggregate, frame);
+    MESSAGE_Free(node, frame);
+
+    ampdu->link->subframesSent += numSent;
+
+    PHY_SetTxAggregation(node, dot11->myMacData->phyNumber, TRUE);
+
+    return aggregate;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduSubframeInError
+//  PURPOSE:     Error draw for one part of a received aggregate.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               double ber
+//                  Bit error rate at the worst SINR of the reception
+//               int size
+//                  Size of the part in bytes
+//  RETURN:      TRUE if the part is corrupted
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+BOOL MacDot11AmpduSubframeInError(
+    MacDataDot11* dot11,
+    double ber,
+    int size)
+{
+    double errorProbability;
+
+    if (ber == 0.0) {
+        return FALSE;
+    }
+
+    errorProbability = 1.0 - pow(1.0 - ber, (double) size * 8.0);
+
+    return errorProbability > RANDOM_erand(dot11->seed);
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduRebuildSubframe
+//  PURPOSE:     Make a data frame message out of a received subframe.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               const Message* aggregate
+//                  The received aggregate
+//               const char* mpdu
+//                  First byte of the subframe
+//               const DOT11_AmpduDelimiter* delimiter
+//                  Delimiter of the subframe
+//  RETURN:      The data frame
+//  ASSUMPTION:  The bookkeeping of the aggregate, which is that of its
+//               first subframe, stands for that of every subframe.
+//--------------------------------------------------------------------------
+static
+Message* MacDot11AmpduRebuildSubframe(
+    Node* node,
+    Message* aggregate,
+    const char* mpdu,
+    const DOT11_AmpduDelimiter* delimiter)
+{
+    Message* msg = MESSAGE_Alloc(node, 0, 0, 0);
+
+    MESSAGE_PacketAlloc(node, msg, delimiter->mpduLength, TRACE_DOT11);
+    memcpy(MESSAGE_ReturnPacket(msg), mpdu, delimiter->mpduLength);
+
+    if (delimiter->virtualLength > 0) {
+        MESSAGE_AddVirtualPayload(node, msg, delimiter->virtualLength);
+    }
+
+    MacDot11AmpduCopyMessageFields(msg, aggregate);
+    MESSAGE_CopyInfo(node, msg, aggregate);
+
+    return msg;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11AmpduTransmitBlockAck
+//  PURPOSE:     Answer an aggregate after SIFS.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               Mac802Address destAddr
+//                  Transmitter of the aggregate
+//               int startSeqNo
+//                  Sequence number of bit 0 of the bitmap
+//               UInt64 bitmap
+//                  Subframes received
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11AmpduTransmitBlockAck(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address destAddr,
+    int startSeqNo,
+    UInt64 bitmap)
+{
+    Message* pktToPhy;
+    DOT11_BlockAckFrame* newHdr;
+    int dataRateType =
+        PHY_GetRxDataRateType(node, dot11->myMacData->phyNumber);
+    int i;
+
+    pktToPhy = MESSAGE_Alloc(node, 0, 0, 0);
+
+    MESSAGE_PacketAlloc(node,
+                        pktToPhy,
+                        DOT11_BLOCK_ACK_FRAME_SIZE,
+                        TRACE_DOT11);
+
+    newHdr = (DOT11_BlockAckFrame*) MESSAGE_ReturnPacket(pktToPhy);
+    memset(newHdr, 0, sizeof(DOT11_BlockAckFrame));
+
+    newHdr->frameType = DOT11_BLOCK_ACK;
+    newHdr->destAddr = destAddr;
+    newHdr->sourceAddr = dot11->selfAddr;
+    newHdr->startSeqNo = (UInt16) startSeqNo;
+    for (i = 0; i < 8; i++) {
+        newHdr->bitmap[i] = (UInt8) (bitmap >> (8 * i));
+    }
+
+    newHdr->duration = 0;
+
+    MacDot11StationSetState(node, dot11, DOT11_X_ACK);
+
+    dot11->ampdu->blockAcksSent++;
+
+    PHY_SetTxDataRateType(node, dot11->myMacData->phyNumber, dataRateType);
+
+    MacDot11StationStartTransmittingPacket(
+        node,
+        dot11,
+        pktToPhy,
+        dot11->sifs);
+}
+
+
+//-------------------------------------------------------------------------
+// Interface Functions
+//-------------------------------------------------------------------------
+
+void MacDot11AmpduInit(
+    Node* node,
+    MacDataDot11* dot11,
+    const NodeInput* nodeInput,
+    Address* address)
+{
+    BOOL wasFound;
+    char retString[MAX_STRING_LENGTH];
+    int anIntInput;
+
+    // Read A-MPDU aggregation.
+    // Format is :
+    // MAC-DOT11-AMPDU YES | NO
+    // Default is NO
+
+    IO_ReadString(
+        node->nodeId,
+        address,
+        nodeInput,
+        "MAC-DOT11-AMPDU",
+        &wasFound,
+        retString);
+
+    if ((!wasFound) || (strcmp(retString, "NO") == 0))
+    {
+        dot11->ampduEnabled = FALSE;
+    }
+    else if (strcmp(retString, "YES") == 0)
+    {
+        dot11->ampduEnabled = TRUE;
+    }
+    else
+    {
+        ERROR_ReportError("MacDot11Init: "
+            "Invalid value for MAC-DOT11-AMPDU "
+            "in configuration file.\n"
+            "Expecting YES or NO.\n");
+    }
+
+    // MAC-DOT11-AMPDU-MAX-LENGTH <bytes>
+    // Default is DOT11_AMPDU_DEFAULT_MAX_LENGTH (value 65535)
+
+    IO_ReadInt(
+        node->nodeId,
+        address,
+        nodeInput,
+        "MAC-DOT11-AMPDU-MAX-LENGTH",
+        &wasFound,
+        &anIntInput);
+
+    if (wasFound)
+    {
+        dot11->ampduMaxLength = anIntInput;
+        ERROR_Assert(dot11->ampduMaxLength > 0 &&
+                     dot11->ampduMaxLength <= DOT11_AMPDU_DEFAULT_MAX_LENGTH,
+            "MacDot11Init: "
+            "Value of MAC-DOT11-AMPDU-MAX-LENGTH "
+            "should be between 1 and 65535.\n");
+    }
+    else
+    {
+        dot11->ampduMaxLength = DOT11_AMPDU_DEFAULT_MAX_LENGTH;
+    }
+
+    // MAC-DOT11-AMPDU-MAX-DURATION <time>
+    // Default is DOT11_AMPDU_DEFAULT_MAX_DURATION (value 4MS)
+
+    IO_ReadTime(
+        node->nodeId,
+        address,
+        nodeInput,
+        "MAC-DOT11-AMPDU-MAX-DURATION",
+        &wasFound,
+        &dot11->ampduMaxDuration);
+
+    if (!wasFound)
+    {
+        dot11->ampduMaxDuration = DOT11_AMPDU_DEFAULT_MAX_DURATION;
+    }
+    else if (dot11->ampduMaxDuration <= 0)
+    {
+        ERROR_ReportError(
+            "MAC-DOT11-AMPDU-MAX-DURATION should be positive\n");
+    }
+
+    // MAC-DOT11-AMPDU-MAX-SUBFRAMES <value>
+    // Default is DOT11_AMPDU_MAX_SUBFRAMES (value 64)
+
+    IO_ReadInt(
+        node->nodeId,
+        address,
+        nodeInput,
+        "MAC-DOT11-AMPDU-MAX-SUBFRAMES",
+        &wasFound,
+        &anIntInput);
+
+    if (wasFound)
+    {
+        dot11->ampduMaxSubframes = anIntInput;
+        ERROR_Assert(dot11->ampduMaxSubframes > 0 &&
+                     dot11->ampduMaxSubframes <= DOT11_AMPDU_MAX_SUBFRAMES,
+            "MacDot11Init: "
+            "Value of MAC-DOT11-AMPDU-MAX-SUBFRAMES "
+            "should be between 1 and 64.\n");
+    }
+    else
+    {
+        dot11->ampduMaxSubframes = DOT11_AMPDU_MAX_SUBFRAMES;
+    }
+
+    // Every station answers aggregates, whether or not it sends any.
+    dot11->ampdu = (DOT11_Ampdu*) MEM_malloc(sizeof(DOT11_Ampdu));
+    memset(dot11->ampdu, 0, sizeof(DOT11_Ampdu));
+}
+
+
+BOOL MacDot11AmpduExchangeActive(
+    MacDataDot11* dot11)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+
+    return ampdu != NULL
+           && ampdu->numSubframes > 0
+           && dot11->currentMessage != NULL
+           && ampdu->subframe[0].msg == dot11->currentMessage;
+}
+
+
+Message* MacDot11AmpduBuildFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* frame,
+    int dataRateType)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+
+    // The local buffer frame left without the aggregate completing,
+    // e.g. flushed by a management action; what was taken with it from
+    // the output queue cannot be sent any more.
+    if (ampdu->numSubframes > 0 && !MacDot11AmpduExchangeActive(dot11)) {
+        MacDot11AmpduReleaseSubframes(node, dot11);
+    }
+
+    if (MacDot11AmpduExchangeActive(dot11)) {
+        return MacDot11AmpduAssemble(node, dot11, frame, dataRateType);
+    }
+
+    if (!MacDot11AmpduFrameQualifies(node, dot11)) {
+        return frame;
+    }
+
+    MacDot11AmpduCollect(node, dot11, frame, dataRateType);
+
+    if (ampdu->numSubframes == 1) {
+        // Nothing queued for this receiver; a single frame is cheaper
+        // than an aggregate of one.
+        ampdu->numSubframes = 0;
+        return frame;
+    }
+
+    ampdu->link->aggregatesSent++;
+    ampdu->link->sizeCount[
+        MacDot11AmpduSizeBucket(ampdu->numSubframes)]++;
+
+    return MacDot11AmpduAssemble(node, dot11, frame, dataRateType);
+}
+
+
+void MacDot11AmpduReceiveFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    DOT11_FrameHdr* hdr = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(msg);
+    Mac802Address sourceAddr = hdr->sourceAddr;
+    int startSeqNo = hdr->seqNo;
+    PhySignalMeasurement* signalMeaInfo =
+        (PhySignalMeasurement*) MESSAGE_ReturnInfo(msg);
+    int phyIndex = dot11->myMacData->phyNumber;
+    double ber =
+        PHY_BER(node->phyData[phyIndex],
+                PHY_GetRxDataRateType(node, phyIndex),
+                DBCONV_NonDb(signalMeaInfo->cinr));
+    Message* received[DOT11_AMPDU_MAX_SUBFRAMES];
+    int numReceived = 0;
+    UInt64 bitmap = 0;
+    char* payload;
+    char* end;
+    DOT11_SeqNoEntry* entry;
+    int i;
+
+    if ((dot11->state != DOT11_S_WFDATA) &&
+        (MacDot11IsWaitingForResponseState(dot11->state)))
+    {
+        MacDot11Trace(node, dot11, NULL,
+            "Drop, waiting for non-data response");
+        MESSAGE_Free(node, msg);
+        return;
+    }
+
+    ampdu->aggregatesReceived++;
+
+    // The aggregate header goes with the PHY header; without it none of
+    // the subframes can be found.
+    if (MacDot11AmpduSubframeInError(dot11, ber, sizeof(DOT11_FrameHdr))) {
+        MacDot11Trace(node, dot11, NULL, "Drop, A-MPDU header in error");
+        MESSAGE_Free(node, msg);
+        return;
+    }
+
+    MacDot11Trace(node, dot11, msg, "Receive");
+
+    payload = MESSAGE_ReturnPacket(msg) + sizeof(DOT11_FrameHdr);
+    end = MESSAGE_ReturnPacket(msg) + msg->packetSize;
+
+    while (payload + sizeof(DOT11_AmpduDelimiter) <= end) {
+        DOT11_AmpduDelimiter delimiter;
+        DOT11_FrameHdr subframeHdr;
+        int offset;
+
+        memcpy(&delimiter, payload, sizeof(DOT11_AmpduDelimiter));
+        payload += sizeof(DOT11_AmpduDelimiter);
+
+        if (MacDot11AmpduSubframeInError(
+                dot11, ber,
+                sizeof(DOT11_AmpduDelimiter) + delimiter.mpduLength +
+                delimiter.virtualLength))
+        {
+            ampdu->subframesWithErrors++;
+            payload += delimiter.mpduLength;
+            continue;
+        }
+
+        memcpy(&subframeHdr, payload, sizeof(DOT11_FrameHdr));
+        offset = (subframeHdr.seqNo - startSeqNo) & DOT11_SEQNO_MASK;
+
+        ERROR_Assert(offset < DOT11_AMPDU_MAX_SUBFRAMES,
+            "MacDot11AmpduReceiveFrame: "
+            "Subframe outside the Block ACK window.\n");
+
+        // Retries are acknowledged again, the first ACK may be lost.
+        bitmap |= ((UInt64) 1) << offset;
+
+        if (MacDot11AmpduCheckSeqNo(
+                node, dot11, sourceAddr, subframeHdr.seqNo))
+        {
+            received[numReceived++] =
+                MacDot11AmpduRebuildSubframe(
+                    node, msg, payload, &delimiter);
+        }
+        else {
+            ampdu->duplicateSubframes++;
+        }
+
+        payload += delimiter.mpduLength;
+    }
+
+    if (bitmap != 0) {
+        MacDot11StationCancelTimer(node, dot11);
+        MacDot11AmpduTransmitBlockAck(
+            node, dot11, sourceAddr, startSeqNo, bitmap);
+    }
+
+    MESSAGE_Free(node, msg);
+
+    // Handed off after the Block ACK is under way, as for single frames,
+    // so that packets the upper layer sends back wait for it.
+    for (i = 0; i < numReceived; i++) {
+        MacDot11CfPollListUpdateForUnicastReceived(
+            node, dot11, sourceAddr);
+        MacDot11StationHandOffSuccessfullyReceivedUnicast(
+            node, dot11, received[i]);
+
+        ampdu->subframesReceived++;
+        dot11->unicastPacketsGotDcf++;
+    }
+
+    // Keep the next-expected number in step for single frames.
+    entry = MacDot11StationGetSeqNo(node, dot11, sourceAddr);
+    entry->fromSeqNo = entry->ampduWinEnd;
+}
+
+
+void MacDot11AmpduProcessBlockAck(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    DOT11_BlockAckFrame* hdr =
+        (DOT11_BlockAckFrame*) MESSAGE_ReturnPacket(msg);
+    DOT11_SeqNoEntry* entry;
+    int i;
+
+    ampdu->blockAcksReceived++;
+
+    for (i = 0; i < ampdu->numSubframes; i++) {
+        DOT11_AmpduSubframe* subframe = &ampdu->subframe[i];
+        int offset = (subframe->seqNo - hdr->startSeqNo) & DOT11_SEQNO_MASK;
+
+        if (subframe->acked ||
+            offset >= DOT11_AMPDU_MAX_SUBFRAMES ||
+            !(hdr->bitmap[offset / 8] & (1 << (offset % 8))))
+        {
+            continue;
+        }
+
+        subframe->acked = TRUE;
+        ampdu->numAcked++;
+        ampdu->link->subframesAcked++;
+
+        // The local buffer frame is acknowledged with the exchange.
+        if (i > 0) {
+            MAC_MacLayerAcknowledgement(node,
+                                        dot11->myMacData->interfaceIndex,
+                                        subframe->msg,
+                                        ampdu->receiverAddr);
+            MESSAGE_Free(node, subframe->msg);
+            subframe->msg = NULL;
+            dot11->unicastPacketsSentDcf++;
+        }
+    }
+
+    // A Block ACK shows the link works even if some subframes were lost.
+    dot11->dataRateInfo->numAcksInSuccess++;
+
+    if (MacDot11StationUsesChanSwitchRateControl(node, dot11)) {
+        PhyChanSwitchReportTxOutcome(
+            node, dot11->myMacData->phyNumber, TRUE);
+    }
+
+    if (ampdu->numAcked < ampdu->numSubframes) {
+        MacDot11Trace(node, dot11, NULL,
+            "Retransmit unacknowledged subframes");
+        MacDot11StationRetransmit(node, dot11);
+        return;
+    }
+
+    // MacDot11StationProcessAck steps past the local buffer frame.
+    entry = MacDot11StationGetSeqNo(node, dot11, ampdu->receiverAddr);
+    entry->toSeqNo += ampdu->numSubframes - 1;
+    ampdu->numSubframes = 0;
+    ampdu->numAcked = 0;
+
+    MacDot11StationProcessAck(node, dot11, msg);
+}
+
+
+BOOL MacDot11AmpduCheckSeqNo(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address sourceAddr,
+    int seqNo)
+{
+    DOT11_SeqNoEntry* entry =
+        MacDot11StationGetSeqNo(node, dot11, sourceAddr);
+    int behind;
+    int ahead;
+
+    ERROR_Assert(entry,
+        "MacDot11AmpduCheckSeqNo: "
+        "Sequence number entry not found.\n");
+
+    behind = (entry->ampduWinEnd - 1 - seqNo) & DOT11_SEQNO_MASK;
+
+    if (behind < DOT11_AMPDU_MAX_SUBFRAMES) {
+        UInt64 bit = ((UInt64) 1) << behind;
+
+        if (entry->ampduRxBitmap & bit) {
+            return FALSE;
+        }
+        entry->ampduRxBitmap |= bit;
+        return TRUE;
+    }
+
+    // Anything outside the window is new: the sender never retries a
+    // frame more than one aggregate behind the newest it has sent.
+    ahead = (seqNo - entry->ampduWinEnd) & DOT11_SEQNO_MASK;
+
+    if (ahead + 1 < DOT11_AMPDU_MAX_SUBFRAMES) {
+        entry->ampduRxBitmap = (entry->ampduRxBitmap << (ahead + 1)) | 1;
+    }
+    else {
+        entry->ampduRxBitmap = 1;
+    }
+    entry->ampduWinEnd = (unsigned short) ((seqNo + 1) & DOT11_SEQNO_MASK);
+
+    return TRUE;
+}
+
+
+BOOL MacDot11AmpduDropExchange(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    DOT11_SeqNoEntry* entry;
+    int numSubframes;
+    BOOL leadAcked;
+
+    if (!MacDot11AmpduExchangeActive(dot11)) {
+        return FALSE;
+    }
+
+    numSubframes = ampdu->numSubframes;
+    leadAcked = ampdu->subframe[0].acked;
+    MacDot11AmpduReleaseSubframes(node, dot11);
+
+    // None of the numbers of the aggregate is used again, the receiver
+    // may hold some of them. The caller steps past an acknowledged local
+    // buffer frame.
+    entry = MacDot11StationGetSeqNo(node, dot11, ampdu->receiverAddr);
+    entry->toSeqNo += leadAcked ? numSubframes - 1 : numSubframes;
+
+    return leadAcked;
+}
+
+
+void MacDot11AmpduPrintStats(
+    Node* node,
+    MacDataDot11* dot11,
+    int interfaceIndex)
+{
+    static const char* bucketName[DOT11_AMPDU_SIZE_BUCKETS] = {
+        "1", "2", "3-4", "5-8", "9-16", "17-32", "33-64" };
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    DOT11_AmpduLinkStats* link;
+    char buf[MAX_STRING_LENGTH];
+    char addrStr[MAX_STRING_LENGTH];
+    int i;
+
+    if (ampdu == NULL ||
+        (ampdu->linkStatsHead == NULL && ampdu->aggregatesReceived == 0))
+    {
+        return;
+    }
+
+    sprintf(buf, "A-MPDUs received = %d", ampdu->aggregatesReceived);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "A-MPDU subframes received = %d",
+            ampdu->subframesReceived);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "A-MPDU subframes received with errors = %d",
+            ampdu->subframesWithErrors);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "A-MPDU duplicate subframes received = %d",
+            ampdu->duplicateSubframes);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Block ACKs sent = %d", ampdu->blockAcksSent);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Block ACKs received = %d", ampdu->blockAcksReceived);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    for (link = ampdu->linkStatsHead; link != NULL; link = link->next) {
+        MacDot11MacAddressToStr(addrStr, &link->address);
+
+        sprintf(buf, "A-MPDUs sent to %s = %d",
+                addrStr, link->aggregatesSent);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+        for (i = 0; i < DOT11_AMPDU_SIZE_BUCKETS; i++) {
+            sprintf(buf, "A-MPDUs sent to %s with %s subframes = %d",
+                    addrStr, bucketName[i], link->sizeCount[i]);
+            IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+        }
+
+        sprintf(buf, "A-MPDU subframes sent to %s = %d",
+                addrStr, link->subframesSent);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+        sprintf(buf, "A-MPDU subframes acknowledged by %s = %d",
+                addrStr, link->subframesAcked);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+        sprintf(buf, "A-MPDU subframes dropped for %s = %d",
+                addrStr, link->subframesDropped);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+    }
+}
+
+
+void MacDot11AmpduFinalize(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_Ampdu* ampdu = dot11->ampdu;
+    int i;
+
+    if (ampdu == NULL) {
+        return;
+    }
+
+    for (i = 1; i < ampdu->numSubframes; i++) {
+        if (ampdu->subframe[i].msg != NULL) {
+            MESSAGE_Free(node, ampdu->subframe[i].msg);
+        }
+    }
+
+    while (ampdu->linkStatsHead != NULL) {
+        DOT11_AmpduLinkStats* link = ampdu->linkStatsHead;
+
+        ampdu->linkStatsHead = link->next;
+        MEM_free(link);
+    }
+
+    MEM_free(ampdu);
+    dot11->ampdu = NULL;
+}
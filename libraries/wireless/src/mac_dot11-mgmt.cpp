@@ -465,7 +465,140 @@ DOT11_ApInfo* MacDot11ManagementGetAPInfo(
     return apInfo;
 }
 
-//Add a new node to the visible node list.
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ManagementVisibleNodeHash
+//  PURPOSE:     Home slot of a MAC address in the visible node index.
+//  PARAMETERS:  Mac802Address addr
+//                  MAC address
+//  RETURN:      Index slot
+//--------------------------------------------------------------------------
+static
+unsigned int MacDot11ManagementVisibleNodeHash(Mac802Address addr)
+{
+    // FNV-1a; the byte sum of Mac802Address::hash() clusters badly for
+    // the sequential addresses QualNet hands out.
+    unsigned int hash = 2166136261U;
+    int i;
+
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++) {
+        hash = (hash ^ addr.byte[i]) * 16777619U;
+    }
+
+    return hash & (DOT11_VISIBLE_NODE_HASH_SIZE - 1);
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ManagementVisibleNodeLookup
+//  PURPOSE:     Find the index slot holding addr, or the empty slot
+//               where it would be inserted.
+//  PARAMETERS:  DOT11_VisibleNodeTable* table
+//                  Visible node table
+//               Mac802Address addr
+//                  MAC address
+//  RETURN:      Index slot
+//--------------------------------------------------------------------------
+static
+unsigned int MacDot11ManagementVisibleNodeLookup(
+    DOT11_VisibleNodeTable* table,
+    Mac802Address addr)
+{
+    unsigned int slot = MacDot11ManagementVisibleNodeHash(addr);
+
+    // The index is never more than half full, so this terminates.
+    while (table->index[slot] != -1 &&
+           !(table->nodes[table->index[slot]].bssAddr == addr))
+    {
+        slot = (slot + 1) & (DOT11_VISIBLE_NODE_HASH_SIZE - 1);
+    }
+
+    return slot;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ManagementVisibleNodeUnindex
+//  PURPOSE:     Remove an occupied index slot. Later entries of the probe
+//               run are shifted back so lookups need no tombstones.
+//  PARAMETERS:  DOT11_VisibleNodeTable* table
+//                  Visible node table
+//               unsigned int slot
+//                  Index slot to clear
+//  RETURN:      None
+//--------------------------------------------------------------------------
+static
+void MacDot11ManagementVisibleNodeUnindex(
+    DOT11_VisibleNodeTable* table,
+    unsigned int slot)
+{
+    const unsigned int mask = DOT11_VISIBLE_NODE_HASH_SIZE - 1;
+    unsigned int next = slot;
+
+    while (TRUE) {
+        unsigned int home;
+
+        next = (next + 1) & mask;
+        if (table->index[next] == -1) {
+            break;
+        }
+
+        // Move the entry back unless its home lies cyclically in
+        // (slot, next], where it is still reachable without this move.
+        home = MacDot11ManagementVisibleNodeHash(
+                   table->nodes[table->index[next]].bssAddr);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            table->index[slot] = table->index[next];
+            slot = next;
+        }
+    }
+
+    table->index[slot] = -1;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ManagementVisibleNodeAlloc
+//  PURPOSE:     Get a pool entry for a new visible node. Takes a free
+//               entry and links it on visibleNodeList, or, when the pool
+//               is full, reuses the least recently seen entry in place.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      Pool slot of the entry
+//--------------------------------------------------------------------------
+static
+int MacDot11ManagementVisibleNodeAlloc(MacDataDot11* dot11)
+{
+    DOT11_VisibleNodeTable* table = dot11->visibleNodeTable;
+    DOT11_VisibleNodeInfo* nodeInfo;
+    int victim;
+    int i;
+
+    if (table->numNodes < DOT11_VISIBLE_NODE_MAX) {
+        victim = table->numNodes++;
+        nodeInfo = &table->nodes[victim];
+
+        nodeInfo->next = dot11->visibleNodeList;
+        dot11->visibleNodeList = nodeInfo;
+        return victim;
+    }
+
+    victim = 0;
+    for (i = 1; i < DOT11_VISIBLE_NODE_MAX; i++) {
+        if (table->nodes[i].lastSeenTime <
+            table->nodes[victim].lastSeenTime)
+        {
+            victim = i;
+        }
+    }
+
+    MacDot11ManagementVisibleNodeUnindex(
+        table,
+        MacDot11ManagementVisibleNodeLookup(
+            table, table->nodes[victim].bssAddr));
+    table->numEvictions++;
+
+    return victim;
+}
+
+//Add a new node to the visible node list, or fold a new RSS sample into
+//the entry that is already there.
 DOT11_VisibleNodeInfo* MacDot11ManagementAddVisibleNode(
     Node* node,
     MacDataDot11* dot11,
@@ -473,62 +606,69 @@ DOT11_VisibleNodeInfo* MacDot11ManagementAddVisibleNode(
     Mac802Address bssAddr,
     double signalStrength,
     BOOL isAP){
-    
+
+    DOT11_VisibleNodeTable* table = dot11->visibleNodeTable;
     DOT11_VisibleNodeInfo* nodeInfo;
+    unsigned int slot;
+    int i;
 
     // don't add myself to the list
     if(bssAddr == dot11->bssAddr){
-        return nodeInfo;
+        return NULL;
     }
 
-    // check if the neighbor already in the list
-    nodeInfo = dot11->visibleNodeList;
-    while (nodeInfo != NULL)
-    {
-        if (nodeInfo->bssAddr == bssAddr)
-        {
-            break;
+    if (table == NULL) {
+        table = (DOT11_VisibleNodeTable*)
+                MEM_malloc(sizeof(DOT11_VisibleNodeTable));
+        ERROR_Assert(table != NULL, "MAC 802.11: Out of memory!");
+        memset((char*) table, 0, sizeof(DOT11_VisibleNodeTable));
+        for (i = 0; i < DOT11_VISIBLE_NODE_HASH_SIZE; i++) {
+            table->index[i] = -1;
         }
-
-        nodeInfo = nodeInfo->next;
+        dot11->visibleNodeTable = table;
     }
 
-    //Update info if AP was added from ProcessAnyFrame
-    if(nodeInfo != NULL && !(nodeInfo->isAP) && isAP){
-        nodeInfo->channelId = channelId;
-        nodeInfo->bssAddr = bssAddr;
-        nodeInfo->signalStrength = signalStrength;
-        nodeInfo->isAP = isAP; //always true
-
-        // printf("MacDot11ManagementAddVisibleNode at node %d (node update): channel %d, signal strength %f dBm, isAP %d, bss %d \n",
-        //     node->nodeId,nodeInfo->channelId, nodeInfo->signalStrength, nodeInfo->isAP, nodeInfo->bssAddr);
+    slot = MacDot11ManagementVisibleNodeLookup(table, bssAddr);
 
-    }
-
-    else if (nodeInfo == NULL)
+    if (table->index[slot] == -1)
     {
         // not in neighbor list, create it
-        nodeInfo = (DOT11_VisibleNodeInfo*) MEM_malloc(sizeof(DOT11_VisibleNodeInfo));
-        ERROR_Assert(nodeInfo != NULL, "MAC 802.11: Out of memory!");
-        memset((char*) nodeInfo, 0, sizeof(DOT11_VisibleNodeInfo)); 
-        nodeInfo->channelId = channelId;
+        int entry = MacDot11ManagementVisibleNodeAlloc(dot11);
+
+        // eviction may have shifted the index, look the slot up again
+        slot = MacDot11ManagementVisibleNodeLookup(table, bssAddr);
+        table->index[slot] = (short) entry;
+
+        nodeInfo = &table->nodes[entry];
         nodeInfo->bssAddr = bssAddr;
-        nodeInfo->signalStrength = signalStrength;
-        nodeInfo->isAP = isAP;
+        nodeInfo->isAP = FALSE;
+        nodeInfo->numSamples = 0;
 
         // printf("MacDot11ManagementAddVisibleNode at node %d: channel %d, signal strength %f dBm, isAP %d, bss %d \n",
         //     node->nodeId,nodeInfo->channelId, nodeInfo->signalStrength, nodeInfo->isAP, nodeInfo->bssAddr);
-
-        // add visible node in the list
-        nodeInfo->next = dot11->visibleNodeList;
-        dot11->visibleNodeList = nodeInfo;
-
-
+    }
+    else {
+        nodeInfo = &table->nodes[table->index[slot]];
     }
 
-    return nodeInfo;
+    // RSS on another channel is a different measurement, start over
+    if (nodeInfo->numSamples == 0 || nodeInfo->channelId != channelId) {
+        nodeInfo->channelId = channelId;
+        nodeInfo->signalStrength = signalStrength;
+        nodeInfo->numSamples = 1;
+    }
+    else {
+        nodeInfo->signalStrength +=
+            DOT11_VISIBLE_NODE_RSS_EWMA_WEIGHT *
+            (signalStrength - nodeInfo->signalStrength);
+        nodeInfo->numSamples++;
+    }
 
+    // once seen as an AP, always an AP
+    nodeInfo->isAP = nodeInfo->isAP || isAP;
+    nodeInfo->lastSeenTime = getSimTime(node);
 
+    return nodeInfo;
 }
 //--------------------------------------------------------------------------
 // Build Management Frame Functions
@@ -1031,6 +1171,7 @@ int MacDot11ManagementBuildAssociateResponseFrame(
                 {
                     return DOT11_R_FAILED;
                 }
+                MacDot11ApPsAddStation(node, dot11, reqFrame->hdr.sourceAddr);
             }
 //---------------------------Power-Save-Mode-End-Updates-----------------//
 
@@ -1228,6 +1369,7 @@ int MacDot11eManagementBuildAssociateResponseFrame(
             {
                 return DOT11_R_FAILED;
             }
+            MacDot11ApPsAddStation(node, dot11, reqFrame->hdr.sourceAddr);
             assocFrame->assocId =(unsigned short) assocID;
             assocFrame->statusCode = DOT11_SC_SUCCESSFUL;
 
@@ -1374,6 +1516,7 @@ int MacDot11eManagementBuildReassociateResponseFrame(
                             dot11,
                             reqFrame->hdr.sourceAddr,
                             qoSEnabled);
+            MacDot11ApPsAddStation(node, dot11, reqFrame->hdr.sourceAddr);
 
             reassocFrame->assocId = (unsigned short)assocID;
             reassocFrame->statusCode = DOT11_SC_SUCCESSFUL;
@@ -1930,6 +2073,7 @@ int MacDot11ManagementBuildReassociateResponseFrame(
                             reqFrame->listenInterval,
                             MacDot11IsPSModeEnabledAtSTA(
                                 reqFrame->hdr.frameFlags));
+            MacDot11ApPsAddStation(node, dot11, reqFrame->hdr.sourceAddr);
 //---------------------------Power-Save-Mode-End-Updates-----------------//
 
             reassocFrame->assocId = (unsigned short)assocID;
@@ -2139,7 +2283,6 @@ int MacDot11ManagementProcessBeacon(
     dot11->pcfEnable = FALSE;
     int result = DOT11_R_FAILED;
     clocktype newNAV = 0;
-    int offset;
     DOT11_BeaconFrame* beacon =
             (DOT11_BeaconFrame*) MESSAGE_ReturnPacket(rxFrame);
 
@@ -2148,12 +2291,8 @@ int MacDot11ManagementProcessBeacon(
       if(Dot11_GetCfsetFromBeacon(node, dot11, rxFrame, &cfSet))
             {
           dot11->pcfEnable = TRUE;
-           // If Cf set is present then set Offset to Point Tim frame
 
-         offset = ( sizeof(DOT11_BeaconFrame)+ sizeof(DOT11_CFParameterSet)+
-                    DOT11_IE_HDR_LENGTH);
-
-        Dot11_GetTimFromBeacon(node, dot11, rxFrame, offset, &timFrame);
+        Dot11_GetTimFromBeacon(node, dot11, rxFrame, &timFrame);
         dot11->DTIMCount =  timFrame.dTIMCount;
 
         int dataRateType = PHY_GetRxDataRateType(node,
@@ -2783,32 +2922,13 @@ BOOL Dot11_GetCfsetFromProbeResponse(
     ERROR_Assert(frameHdr->frameType == DOT11_PROBE_RESP,
         "Dot11_GetCfsetFromBeacon: Wrong frame type.\n");
 
-    int offset = sizeof(DOT11_ProbeRespFrame);
+    int offset;
     int rxFrameSize = MESSAGE_ReturnPacketSize(msg);
-
-    if (offset >= rxFrameSize)
-    {
-        return isFound;
-    }
-
     DOT11_Ie element;
-    DOT11_IeHdr ieHdr;
     unsigned char* rxFrame = (unsigned char *) frameHdr;
 
-    ieHdr = rxFrame + offset;
-
-    // The first expected IE is cfSet
-    while (ieHdr.id != DOT11_CF_PARAMETER_SET_ID)
-    {
-        offset += ieHdr.length + 2;
-        if (offset >= rxFrameSize)
-        {
-            return isFound;
-        }
-        ieHdr = rxFrame + offset;
-    }
-
-    if (ieHdr.id == DOT11_CF_PARAMETER_SET_ID)
+    if (MacDot11IeIndexFind(dot11, msg, sizeof(DOT11_ProbeRespFrame),
+            DOT11_CF_PARAMETER_SET_ID, &offset) != NULL)
     {
         Dot11s_AssignToElement(&element, rxFrame, &offset, rxFrameSize);
         Dot11_ParseCfsetIdElement(node, &element, cfSet);
@@ -3192,37 +3312,17 @@ BOOL Dot11_GetTspecFromFrame(
     //ERROR_Assert(frameHdr->frameType == DOT11_PROBE_REQ,
       //  "Dot11_GetTspecFromFrame: Wrong frame type.\n");
 
-    int offset = sizeof(DOT11e_ADDTS_Request_frame);
+    int offset;
     int rxFrameSize = MESSAGE_ReturnPacketSize(msg);
-
-    if (offset >= rxFrameSize)
-    {
-        return isFound;
-    }
-
     DOT11_Ie element;
-    DOT11_IeHdr ieHdr;
     unsigned char* rxFrame = (unsigned char *) frameHdr;
 
-    ieHdr = rxFrame + offset;
-
-    // The first expected IE is cfSet
-    while (ieHdr.id != DOT11_TSPEC_ID)
-    {
-        offset += ieHdr.length + 2;
-        ieHdr = rxFrame + offset;
-        if (offset >= rxFrameSize)
-        {
-            return isFound;
-        }
-    }
-
-    if (ieHdr.id == DOT11_TSPEC_ID)
+    if (MacDot11IeIndexFind(dot11, msg, sizeof(DOT11e_ADDTS_Request_frame),
+            DOT11_TSPEC_ID, &offset) != NULL)
     {
         Dot11s_AssignToElement(&element, rxFrame, &offset, rxFrameSize);
         Dot11_ParseTSPECIdElement(node, &element, TSPEC);
 
-        ieHdr = rxFrame + offset;
         isFound = TRUE;
 }
        return isFound;
@@ -4056,6 +4156,16 @@ void MacDot11ManagementScanCompleted(
     DOT11_ManagementVars * mgmtVars =
         (DOT11_ManagementVars*) dot11->mngmtVars;
 
+    if (mgmtVars->scanType == DOT11_SCAN_ACTIVE) {
+        DOT11_ScanStats* stats = &dot11->scanStats;
+
+        stats->numScans++;
+        stats->totalScanTime +=
+            getSimTime(node) - mgmtVars->channelInfo->scanStartTime;
+        stats->totalTimeSaved += stats->currentScanTimeSaved;
+        stats->currentScanTimeSaved = 0;
+    }
+
     //added: 
     if(dot11->chanswitchType == DOT11_CHANSWITCH_TYPE_AP_PROBE){
         printf("MacDot11ManagementScanCompleted: node %d, channel %d: Ad-hoc AP probe chanswitch mode (do not associate) \n", 
@@ -4385,6 +4495,7 @@ int MacDot11ManagementScanStart(
                             dot11,
                             DOT11_S_M_WFSCAN);
             mngmtVars->channelInfo->scanStartTime = getSimTime(node);
+            dot11->scanStats.currentScanTimeSaved = 0;
 
             MacDot11TransmitProbeRequestFrame(node,dot11);
 
@@ -4727,7 +4838,7 @@ int MacDot11ManagementAutoJoin(
 
 //--------------------------------------------------------------------------
 /*!
- * \brief  Process states after receiving a timeout and pass to handler.
+ * \brief  Leave the channel being scanned actively and scan the next one.
  *
  * \param node      Node*           : Pointer to node
  * \param dot11     MacDataDot11*   : Pointer to Dot11 structure
@@ -4735,47 +4846,117 @@ int MacDot11ManagementAutoJoin(
  * \return          NONE.
  */
 //--------------------------------------------------------------------------
-void MacDot11ManagementHandleTimeout(
+static
+void MacDot11ManagementLeaveScanChannel(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_ManagementVars* mngmtVars =
+        (DOT11_ManagementVars *) dot11->mngmtVars;
+    DOT11_ScanStats* stats = &dot11->scanStats;
+    clocktype dwell = getSimTime(node) - dot11->scanChannelStartTime;
+
+    stats->channelsScanned++;
+    if (dwell < mngmtVars->longScanTimer) {
+        stats->currentScanTimeSaved += mngmtVars->longScanTimer - dwell;
+    }
+
+    if(MacDot11ManagementScanNextChannel(node, dot11) !=
+        DOT11_R_OK)
+    {
+        ERROR_ReportError("MacDot11ManagementAttemptingToJoin:"
+                " Scan next channel failed.\n");
+    }
+}// MacDot11ManagementLeaveScanChannel
+
+
+//--------------------------------------------------------------------------
+/*!
+ * \brief  Stay on the channel being scanned actively for another
+ *         MinChannelTime, or what is left of MaxChannelTime if less.
+ *
+ * \param node      Node*           : Pointer to node
+ * \param dot11     MacDataDot11*   : Pointer to Dot11 structure
+
+ * \return          BOOL            : FALSE if MaxChannelTime is reached
+ */
+//--------------------------------------------------------------------------
+static
+BOOL MacDot11ManagementExtendScanChannel(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_ManagementVars* mngmtVars =
+        (DOT11_ManagementVars *) dot11->mngmtVars;
+    clocktype remaining =
+        dot11->scanChannelStartTime + mngmtVars->longScanTimer -
+        getSimTime(node);
+
+    if (remaining <= 0) {
+        dot11->scanStats.channelsAtMaxTime++;
+        return FALSE;
+    }
+
+    // Responses are counted afresh for each extension.
+    mngmtVars->probeResponseRecieved = FALSE;
+    mngmtVars->channelInfo->dwellTime =
+        MIN(dot11->scanMinChannelTime, remaining);
+
+    MacDot11ManagementStartTimerOfGivenType(
+        node,
+        dot11,
+        mngmtVars->channelInfo->dwellTime,
+        MSG_MAC_DOT11_Active_Scan_Long_Timer);
+
+    return TRUE;
+}// MacDot11ManagementExtendScanChannel
+
+
+//--------------------------------------------------------------------------
+/*!
+ * \brief  Process states after a management timer fires and pass to
+ *         handler.
+ *
+ * \param node      Node*           : Pointer to node
+ * \param dot11     MacDataDot11*   : Pointer to Dot11 structure
+ * \param timerType int             : Event type of the timer
+ * \param timerSequenceNumber unsigned int : Sequence number of the timer
+
+ * \return          NONE.
+ */
+//--------------------------------------------------------------------------
+void MacDot11ManagementHandleTimer(
     Node* node,
     MacDataDot11* dot11,
-    Message* msg)
+    int timerType,
+    unsigned int timerSequenceNumber)
 {
 
     DOT11_ManagementVars * mngmtVars =
         (DOT11_ManagementVars*) dot11->mngmtVars;
 
     ERROR_Assert( (!MacDot11IsAp(dot11) ||
-        msg->eventType == MSG_MAC_DOT11_Enable_Management_Timer),
+        timerType == MSG_MAC_DOT11_Enable_Management_Timer),
         "MacDot11HandleTimeout: "
         "Wait For Join state for a non station.\n");
-    switch(msg->eventType)
+    switch(timerType)
     {
         case MSG_MAC_DOT11_Active_Scan_Short_Timer:
         {
-            unsigned timerSequenceNumber = (unsigned)*(int*)(MESSAGE_ReturnInfo(msg));
             if (timerSequenceNumber == dot11->managementSequenceNumber)
             {
-                if(dot11->MayReceiveProbeResponce == TRUE)
+                // MinChannelTime: stay only if the medium was busy or a
+                // probe response came in.
+                if((dot11->MayReceiveProbeResponce == TRUE ||
+                    mngmtVars->probeResponseRecieved) &&
+                    MacDot11ManagementExtendScanChannel(node, dot11))
                 {
-                    DOT11_ManagementVars* mngmtVars =
-                        (DOT11_ManagementVars *) dot11->mngmtVars;
-                    mngmtVars->channelInfo->dwellTime =
-                                         mngmtVars->longScanTimer;
-                    MacDot11ManagementStartTimerOfGivenType(
-                        node,
-                        dot11,
-                        mngmtVars->channelInfo->dwellTime,
-                        MSG_MAC_DOT11_Active_Scan_Long_Timer);
-
+                    dot11->scanStats.channelsExtended++;
                 }
                 else
                 {
-                    if(MacDot11ManagementScanNextChannel(node, dot11) !=
-                        DOT11_R_OK)
-                    {
-                        ERROR_ReportError("MacDot11ManagementAttemptingToJoin:"
-                                " Scan next channel failed.\n");
-                    }
+                    dot11->scanStats.channelsLeftAtMinTime++;
+                    MacDot11ManagementLeaveScanChannel(node, dot11);
                 }
             }
 
@@ -4783,9 +4964,22 @@ void MacDot11ManagementHandleTimeout(
         }
 
         case MSG_MAC_DOT11_Active_Scan_Long_Timer:
+        {
+            if (timerSequenceNumber == dot11->managementSequenceNumber)
+            {
+                // Keep extending while responses keep arriving, up to
+                // MaxChannelTime.
+                if(!mngmtVars->probeResponseRecieved ||
+                   !MacDot11ManagementExtendScanChannel(node, dot11))
+                {
+                    MacDot11ManagementLeaveScanChannel(node, dot11);
+                }
+            }
+            break;
+        }
+
         case MSG_MAC_DOT11_Beacon_Wait_Timer:
         {
-            unsigned timerSequenceNumber = (unsigned)*(int*)(MESSAGE_ReturnInfo(msg));
             if (timerSequenceNumber == dot11->managementSequenceNumber)
             {
                 if(MacDot11ManagementScanNextChannel(node, dot11) !=
@@ -4930,16 +5124,14 @@ void MacDot11ManagementHandleTimeout(
         }
         default:
         {
-            ERROR_ReportError("MacDot11Layer: "
-                "Unknown message event type.\n");
-
-            MESSAGE_Free(node, msg);
+            ERROR_ReportError("MacDot11ManagementHandleTimer: "
+                "Unknown timer type.\n");
             break;
 
         }
     }
 
-} //MacDot11ManagementHandleTimeout
+} //MacDot11ManagementHandleTimer
 
 
 //--------------------------------------------------------------------------
@@ -5273,6 +5465,63 @@ BOOL MacDot11ManagementAttemptToTransmitFrame(
                 buf);
         }
 
+        if(mngmtVars->scanType == DOT11_SCAN_ACTIVE && !MacDot11IsAp(dot11))
+        {
+            DOT11_ScanStats* stats = &dot11->scanStats;
+            const char* label[] = {
+                "Active scans completed",
+                "Active scan channels scanned",
+                "Active scan channels left at minimum channel time",
+                "Active scan channels extended",
+                "Active scan channels held to maximum channel time" };
+            int value[] = {
+                stats->numScans,
+                stats->channelsScanned,
+                stats->channelsLeftAtMinTime,
+                stats->channelsExtended,
+                stats->channelsAtMaxTime };
+            int i;
+
+            for (i = 0; i < 5; i++)
+            {
+                sprintf(buf, "%s = %d", label[i], value[i]);
+
+                IO_PrintStat(
+                    node,
+                    "MAC",
+                    DOT11_MANAGEMENT_STATS_LABEL,
+                    ANY_DEST,
+                    interfaceIndex,
+                    buf);
+            }
+
+            // Scan time is the outage of a channel switch; time saved is
+            // against dwelling MaxChannelTime on every channel.
+            sprintf(buf, "Active scan average duration (s) = %f",
+                   stats->numScans == 0 ? 0.0 :
+                   (double) stats->totalScanTime / SECOND / stats->numScans);
+
+            IO_PrintStat(
+                node,
+                "MAC",
+                DOT11_MANAGEMENT_STATS_LABEL,
+                ANY_DEST,
+                interfaceIndex,
+                buf);
+
+            sprintf(buf, "Active scan average time saved (s) = %f",
+                   stats->numScans == 0 ? 0.0 :
+                   (double) stats->totalTimeSaved / SECOND / stats->numScans);
+
+            IO_PrintStat(
+                node,
+                "MAC",
+                DOT11_MANAGEMENT_STATS_LABEL,
+                ANY_DEST,
+                interfaceIndex,
+                buf);
+        }
+
         if(mngmtVars->scanType == DOT11_SCAN_ACTIVE ||MacDot11IsAp(dot11))
          {
             sprintf(buf, "Management probe response dropped = %d",
@@ -5826,6 +6075,93 @@ void MacDot11ManagementCheckHeaderSizes()
 }//MacDot11ManagementCheckHeaderSizes
 
 
+//--------------------------------------------------------------------------
+/*!
+ * \brief  Read the active scan channel dwell times.
+ *
+ * \param node      Node*           : Pointer to node
+ * \param nodeInput NodeInput*      : Node input configuration
+ * \param dot11     MacDataDot11*   : Pointer to Dot11 structure
+ * \param mngmtVars DOT11_ManagementVars* : Management variables
+ * \param address   Address*        : Address of the interface
+
+ * \return          None.
+ */
+//--------------------------------------------------------------------------
+static
+void MacDot11ManagementReadScanChannelTimes(
+    Node* node,
+    const NodeInput* nodeInput,
+    MacDataDot11* dot11,
+    DOT11_ManagementVars* mngmtVars,
+    Address* address)
+{
+    BOOL wasFound = FALSE;
+    int channelTime = 0;
+
+    // MAC-DOT11-SCAN-MIN-CHANNEL-TIME <TUs>
+    // Time to wait for any activity after a probe request before moving
+    // on to the next channel.
+    IO_ReadInt(
+               node->nodeId,
+               address,
+               nodeInput,
+               "MAC-DOT11-SCAN-MIN-CHANNEL-TIME",
+               &wasFound,
+               &channelTime);
+
+    if (!wasFound)
+    {
+        dot11->scanMinChannelTime = DOT11_SHORT_SCAN_TIMER_DEFAULT;
+    }
+    else if (channelTime <= 0 || channelTime > 65535)
+    {
+        ERROR_ReportError("MacDot11ManagementInit: "
+            "MAC-DOT11-SCAN-MIN-CHANNEL-TIME should be "
+            "between 1 and 65535 TUs.\n");
+    }
+    else
+    {
+        dot11->scanMinChannelTime =
+                MacDot11TUsToClocktype((unsigned short)channelTime);
+    }
+
+    // MAC-DOT11-SCAN-MAX-CHANNEL-TIME <TUs>
+    // Longest time spent on a channel that keeps answering, counted
+    // from the probe request like MinChannelTime.
+    IO_ReadInt(
+               node->nodeId,
+               address,
+               nodeInput,
+               "MAC-DOT11-SCAN-MAX-CHANNEL-TIME",
+               &wasFound,
+               &channelTime);
+
+    if (!wasFound)
+    {
+        mngmtVars->longScanTimer = DOT11_LONG_SCAN_TIMER_DEFAULT;
+    }
+    else if (channelTime <= 0 || channelTime > 65535)
+    {
+        ERROR_ReportError("MacDot11ManagementInit: "
+            "MAC-DOT11-SCAN-MAX-CHANNEL-TIME should be "
+            "between 1 and 65535 TUs.\n");
+    }
+    else
+    {
+        mngmtVars->longScanTimer =
+                MacDot11TUsToClocktype((unsigned short)channelTime);
+    }
+
+    if (mngmtVars->longScanTimer < dot11->scanMinChannelTime)
+    {
+        ERROR_ReportError("MacDot11ManagementInit: "
+            "MAC-DOT11-SCAN-MAX-CHANNEL-TIME should not be less than "
+            "MAC-DOT11-SCAN-MIN-CHANNEL-TIME.\n");
+    }
+}// MacDot11ManagementReadScanChannelTimes
+
+
 //--------------------------------------------------------------------------
 /*!
  * \brief  Initalize dynamic link management.
@@ -5903,6 +6239,8 @@ void MacDot11ManagementInit(
                 &address,
                 networkType);
 
+    dot11->scanMinChannelTime = DOT11_SHORT_SCAN_TIMER_DEFAULT;
+
     // The type of scan used for joining
     // MAC-DOT11-SCAN-TYPE DISABLED | PASSIVE | ACTIVE e.g.
     // [2] MAC-DOT11-SCAN-TYPE ACTIVE
@@ -5921,30 +6259,8 @@ void MacDot11ManagementInit(
 
         printf("node %d: MacDot11Init: enable active scanning for AP probe chanswitch \n", node->nodeId);
         mngmtVars->scanType = DOT11_SCAN_ACTIVE;
-        int longScanTimer = 0;
-        Address address;
-        NetworkGetInterfaceInfo(
-                    node,
-                    dot11->myMacData->interfaceIndex,
-                    &address,
-                    networkType);
-        IO_ReadInt(
-                   node->nodeId,
-                   &address,
-                   nodeInput,
-                   "MAC-DOT11-SCAN-MAX-CHANNEL-TIME",
-                   &wasFound,
-                   &longScanTimer);
-
-        if (!wasFound)
-        {
-            mngmtVars->longScanTimer = DOT11_LONG_SCAN_TIMER_DEFAULT;
-        }
-        else
-        {
-            mngmtVars->longScanTimer =
-                    MacDot11TUsToClocktype((unsigned short)longScanTimer);
-        }
+        MacDot11ManagementReadScanChannelTimes(
+            node, nodeInput, dot11, mngmtVars, &address);
 
 
     }else if ((!wasFound) || (strcmp(retString, "DISABLED") == 0)) {
@@ -5955,30 +6271,8 @@ void MacDot11ManagementInit(
 
     } else if (strcmp(retString, "ACTIVE") == 0) {
         mngmtVars->scanType = DOT11_SCAN_ACTIVE;
-        int longScanTimer = 0;
-        Address address;
-        NetworkGetInterfaceInfo(
-                    node,
-                    dot11->myMacData->interfaceIndex,
-                    &address,
-                    networkType);
-        IO_ReadInt(
-                   node->nodeId,
-                   &address,
-                   nodeInput,
-                   "MAC-DOT11-SCAN-MAX-CHANNEL-TIME",
-                   &wasFound,
-                   &longScanTimer);
-
-        if (!wasFound)
-        {
-            mngmtVars->longScanTimer = DOT11_LONG_SCAN_TIMER_DEFAULT;
-        }
-        else
-        {
-            mngmtVars->longScanTimer =
-                    MacDot11TUsToClocktype((unsigned short)longScanTimer);
-        }
+        MacDot11ManagementReadScanChannelTimes(
+            node, nodeInput, dot11, mngmtVars, &address);
 
     }  else {
         mngmtVars->scanType = DOT11_SCAN_DISABLED;
@@ -6176,7 +6470,8 @@ void MacDot11StationTransmitPSPollFrame(
     newHdr->frameType = DOT11_PS_POLL;
     newHdr->sourceAddr = dot11->selfAddr;
     newHdr->destAddr = destAddr;
-    newHdr->duration = 0;
+    newHdr->duration =
+        (UInt16)(DOT11_PS_POLL_AID_FLAGS | dot11->assignAssociationId);
     DOT11_FrameInfo* newframeInfo =
         (DOT11_FrameInfo*) MEM_malloc(sizeof(DOT11_FrameInfo));
 
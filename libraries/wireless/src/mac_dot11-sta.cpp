@@ -504,7 +504,9 @@ void MacDot11StationUnicastTransmitted(Node* node, MacDataDot11* dot11) {
         PHY_GetTransmissionDuration(
             node, dot11->myMacData->phyNumber,
             PHY_GetTxDataRateType(node, dot11->myMacData->phyNumber),
-            DOT11_SHORT_CTRL_FRAME_SIZE) +
+            MacDot11AmpduExchangeActive(dot11)
+            ? DOT11_BLOCK_ACK_FRAME_SIZE
+            : DOT11_SHORT_CTRL_FRAME_SIZE) +
         dot11->extraPropDelay +
         dot11->slotTime;
 
@@ -557,6 +559,8 @@ void MacDot11StationTransmissionHasFinished(
                     {
                         DOT11_ManagementVars * mngmtVars =
                             (DOT11_ManagementVars*) dot11->mngmtVars;
+                        // Channel dwell is timed from the probe request.
+                        dot11->scanChannelStartTime = getSimTime(node);
                         MacDot11ManagementStartTimerOfGivenType(
                                      node,
                                      dot11,
@@ -834,8 +838,24 @@ void MacDot11StationRetransmit(
                 Dot11s_PacketRetransmitEvent(node, dot11, dot11->txFrameInfo);
         }
     }
+    else if (MacDot11AmpduDropExchange(node, dot11)) {
+        // Only subframes sent along with it in an A-MPDU are lost; an
+        // earlier Block ACK acknowledged the local buffer frame itself.
+        MacDot11Trace(node, dot11, NULL,
+            "Drop subframes, exceeds retransmit count");
+
+        MacDot11StationUpdateForSuccessfullyReceivedAck(
+            node,
+            dot11,
+            dot11->currentNextHopAddress);
+
+        dot11->unicastPacketsSentDcf++;
+
+        MacDot11StationCheckForOutgoingPacket(node, dot11, TRUE);
+    }
     else {
         // Exceeded maximum retry count allowed, so drop frame
+        // and the subframes sent along with it in an A-MPDU.
         dot11->pktsDroppedDcf++;
 
         // Drop frame from queue
@@ -1265,6 +1285,11 @@ BOOL MacDot11IsUnicastPacketBufferedAtAP(
     int bitNo = associationId % 8;
     int octetNo = associationId / 8;
 
+    // Not associated yet: no bit of the bitmap is ours.
+    if (associationId <= 0 || associationId > DOT11_PS_MAX_ASSOCIATION_ID) {
+        return FALSE;
+    }
+
     // Check weather the bit is set or not for the received association ID.
     if((octetNo >= N1 && octetNo <= N2)){
         result = ((TIMElementPointer[octetNo - N1]
@@ -1274,6 +1299,100 @@ BOOL MacDot11IsUnicastPacketBufferedAtAP(
    return result;
 }// end of MacDot11IsUnicastPacketBufferedAtAP
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsIndexInit
+//  PURPOSE:     Clear the AID indexed station table.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      None
+//  ASSUMPTION:  apVars has been allocated.
+//--------------------------------------------------------------------------
+void MacDot11ApPsIndexInit(MacDataDot11* dot11)
+{
+    memset(dot11->apVars->psStationByAid, 0,
+           sizeof(dot11->apVars->psStationByAid));
+}// end of MacDot11ApPsIndexInit
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsAddStation
+//  PURPOSE:     Enter a newly associated station in the AID table.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               Mac802Address address
+//                  Address of the station
+//  RETURN:      None
+//  ASSUMPTION:  The station is already in the AP station list.
+//--------------------------------------------------------------------------
+void MacDot11ApPsAddStation(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address address)
+{
+    DOT11_ApStationListItem* stationItem =
+        MacDot11ApStationListGetItemWithGivenAddress(node, dot11, address);
+
+    if (stationItem == NULL) {
+        return;
+    }
+
+    DOT11_ApStation* station = stationItem->data;
+    if (station->assocId <= 0 ||
+        station->assocId > DOT11_PS_MAX_ASSOCIATION_ID)
+    {
+        return;
+    }
+
+    dot11->apVars->psStationByAid[station->assocId] = station;
+}// end of MacDot11ApPsAddStation
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsRemoveStation
+//  PURPOSE:     Drop a station from the AID table.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               DOT11_ApStation* station
+//                  Station being removed
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+void MacDot11ApPsRemoveStation(
+    MacDataDot11* dot11,
+    DOT11_ApStation* station)
+{
+    DOT11_ApVars* ap = dot11->apVars;
+
+    if (station->assocId <= 0 ||
+        station->assocId > DOT11_PS_MAX_ASSOCIATION_ID ||
+        ap->psStationByAid[station->assocId] != station)
+    {
+        return;
+    }
+
+    ap->psStationByAid[station->assocId] = NULL;
+}// end of MacDot11ApPsRemoveStation
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsGetStation
+//  PURPOSE:     Look up an associated station by its AID.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int assocId
+//                  Association ID of the station
+//  RETURN:      Station, or NULL if no station holds this AID
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+DOT11_ApStation* MacDot11ApPsGetStation(
+    MacDataDot11* dot11,
+    int assocId)
+{
+    if (assocId <= 0 || assocId > DOT11_PS_MAX_ASSOCIATION_ID) {
+        return NULL;
+    }
+    return dot11->apVars->psStationByAid[assocId];
+}// end of MacDot11ApPsGetStation
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11StationSleepIfNoData
 //  PURPOSE:     Station checks its status, if data present at both end STA
@@ -1598,35 +1717,81 @@ void MacDot11StationBeaconTransmittedOrReceived(
 }// MacDot11StationBeaconTransmittedOrReceived
 
 //--------------------------------------------------------------------------
-//  NAME:        MacDot11IsElementIdPresent
-//  PURPOSE:     Search element id from the beacon.
+//  NAME:        MacDot11IeIndexBuild
+//  PURPOSE:     Record the offset of each information element of a frame.
 //
-//  PARAMETERS:  DOT11_BeaconFrame* beacon
-//                  Received beacon message pointer
-//               DOT11_PS_TIMFrame elementId
-//  RETURN:      unsigned char pointer
+//  PARAMETERS:  DOT11_IeIndex* index
+//                  Index to fill in
+//               const unsigned char* frame
+//                  Received frame
+//               int size
+//                  Size of the frame
+//               int fixedSize
+//                  Size of the frame before the first element
+//  RETURN:      None
 //  ASSUMPTION:  None
 //--------------------------------------------------------------------------
-static // inline//
-unsigned char* MacDot11IsElementIdPresent(
-    DOT11_BeaconFrame* beacon,
-    DOT11_PS_ElementId elementId,
-    int length)
+static
+void MacDot11IeIndexBuild(
+    DOT11_IeIndex* index,
+    const unsigned char* frame,
+    int size,
+    int fixedSize)
 {
-    unsigned char* tempBeacon = (unsigned char* )beacon +
-        sizeof(DOT11_BeaconFrame);
-    unsigned char* retPointer = NULL;
+    int offset = fixedSize;
+
+    index->frame = frame;
+    index->size = size;
+    index->firstOffset = fixedSize;
+    memset(index->offset, 0, sizeof(index->offset));
+    memset(index->length, 0, sizeof(index->length));
 
     // here element id data is present in TLV(Tag, Length, Value) format
-    while(tempBeacon < ((unsigned char* )beacon + length)){
-        if(*tempBeacon == (unsigned char)elementId){
-            retPointer = tempBeacon;
+    while (offset + DOT11_IE_HDR_LENGTH <= size) {
+        unsigned char id = frame[offset];
+        unsigned char length = frame[offset + 1];
+
+        if (offset + DOT11_IE_HDR_LENGTH + length > size) {
             break;
-        }// end of if
-       tempBeacon += (*(tempBeacon + 1)) + 2;
-    }// end of while
-    return retPointer;
-}// end of MacDot11IsElementIdPresent
+        }
+        if (id < DOT11_IE_INDEX_SIZE && index->offset[id] == 0) {
+            index->offset[id] = (UInt16) offset;
+            index->length[id] = length;
+        }
+        offset += DOT11_IE_HDR_LENGTH + length;
+    }
+}// end of MacDot11IeIndexBuild
+
+
+unsigned char* MacDot11IeIndexFind(
+    MacDataDot11* dot11,
+    Message* msg,
+    int fixedSize,
+    DOT11_PS_ElementId elementId,
+    int* offset)
+{
+    DOT11_IeIndex* index = &dot11->rxIeIndex;
+    unsigned char* frame = (unsigned char*) MESSAGE_ReturnPacket(msg);
+    int size = MESSAGE_ReturnPacketSize(msg);
+
+    if (index->frame != frame ||
+        index->size != size ||
+        index->firstOffset != fixedSize)
+    {
+        MacDot11IeIndexBuild(index, frame, size, fixedSize);
+    }
+
+    if (elementId >= DOT11_IE_INDEX_SIZE ||
+        index->offset[elementId] == 0)
+    {
+        return NULL;
+    }
+
+    if (offset != NULL) {
+        *offset = index->offset[elementId];
+    }
+    return frame + index->offset[elementId];
+}// end of MacDot11IeIndexFind
 
 
 //--------------------------------------------------------------------------
@@ -1709,7 +1874,6 @@ void MacDot11CfpStationProcessBeacon(
     MacDataDot11* dot11,
     Message* msg)
 {
-    int       offset;
     dot11->pcfEnable = FALSE;
     clocktype beaconTimeStamp = 0;
     clocktype newNAV = 0;
@@ -1725,9 +1889,7 @@ void MacDot11CfpStationProcessBeacon(
    if(Dot11_GetCfsetFromBeacon(node, dot11, msg, &cfSet))
     {
       dot11->pcfEnable = TRUE;
-      offset = ( sizeof(DOT11_BeaconFrame)+ sizeof(DOT11_CFParameterSet)+
-      DOT11_IE_HDR_LENGTH);
-      Dot11_GetTimFromBeacon(node, dot11, msg, offset, &timFrame);
+      Dot11_GetTimFromBeacon(node, dot11, msg, &timFrame);
       dot11->DTIMCount =  timFrame.dTIMCount;
       beaconTimeStamp = beacon->timeStamp;
       dot11->cfpMaxDuration = MacDot11TUsToClocktype(cfSet.cfpMaxDuration);
@@ -1879,12 +2041,12 @@ void MacDot11StationProcessBeacon(
 
     if(dot11->isPSModeEnabled == TRUE){
         unsigned char* TIMElementPointer = NULL;
-        int length = MESSAGE_ReturnPacketSize(msg);
 
-        TIMElementPointer = MacDot11IsElementIdPresent(
-            beacon,
-            DOT11_PS_TIM_ELEMENT_ID_TIM,
-            length);
+        TIMElementPointer = MacDot11IeIndexFind(
+            dot11,
+            msg,
+            sizeof(DOT11_BeaconFrame),
+            DOT11_PS_TIM_ELEMENT_ID_TIM);
         if(TIMElementPointer != NULL){
             MacDot11ParsePSModeElementID(
                 node,
@@ -31,6 +31,7 @@
 #include "mac_dot11s-frames.h"
 #include "mac_dot11s.h"
 #include "mac_dot11-pc.h"
+#include "phy_chanswitch.h"
 
 
 //#ifdef NETSEC_LIB
@@ -138,6 +139,12 @@ void MacDot11ManagementReset(
     Node* node,
     MacDataDot11* dot11);
 
+void MacDot11ManagementHandleTimer(
+    Node* node,
+    MacDataDot11* dot11,
+    int timerType,
+    unsigned int timerSequenceNumber);
+
 static //inline
 void MacDot11StationSetState(
     Node* node,
@@ -1294,32 +1301,13 @@ BOOL Dot11_GetCfsetFromBeacon(
     ERROR_Assert(frameHdr->frameType == DOT11_BEACON,
         "Dot11_GetCfsetFromBeacon: Wrong frame type.\n");
 
-    int offset = sizeof(DOT11_BeaconFrame);
+    int offset;
     int rxFrameSize = MESSAGE_ReturnPacketSize(msg);
-
-    if (offset >= rxFrameSize)
-    {
-        return isFound;
-    }
-
     DOT11_Ie element;
-    DOT11_IeHdr ieHdr;
     unsigned char* rxFrame = (unsigned char *) frameHdr;
 
-    ieHdr = rxFrame + offset;
-
-    // The first expected IE is cfSet
-    while (ieHdr.id != DOT11_CF_PARAMETER_SET_ID)
-    {
-        offset += ieHdr.length + 2;
-        if (offset >= rxFrameSize)
-        {
-            return isFound;
-        }
-        ieHdr = rxFrame + offset;
-    }
-
-    if (ieHdr.id == DOT11_CF_PARAMETER_SET_ID)
+    if (MacDot11IeIndexFind(dot11, msg, sizeof(DOT11_BeaconFrame),
+            DOT11_CF_PARAMETER_SET_ID, &offset) != NULL)
     {
         Dot11s_AssignToElement(&element, rxFrame, &offset, rxFrameSize);
         Dot11_ParseCfsetIdElement(node, &element, cfSet);
@@ -1345,39 +1333,22 @@ void Dot11_GetTimFromBeacon(
     Node* node,
     MacDataDot11* dot11,
     Message* msg,
-    int offset,
      DOT11_TIMFrame* timFrame)
 {
-    BOOL isFound=FALSE;
     DOT11_FrameHdr* frameHdr = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(msg);
     ERROR_Assert(frameHdr->frameType == DOT11_BEACON,
         "Dot11_GetTimFromBeacon: Wrong frame type.\n");
 
+    int offset;
     int rxFrameSize = MESSAGE_ReturnPacketSize(msg);
-
     DOT11_Ie element;
-    DOT11_IeHdr ieHdr;
     unsigned char* rxFrame = (unsigned char *) frameHdr;
 
-    ieHdr = rxFrame + offset;
-
-    while (ieHdr.id != DOT11_PS_TIM_ELEMENT_ID_TIM)
-    {
-        offset += ieHdr.length + 2;
-        if (offset >= rxFrameSize)
-        {
-            return;
-        }
-        ieHdr = rxFrame + offset;
-
-    }
-
-    if (ieHdr.id == DOT11_PS_TIM_ELEMENT_ID_TIM)
+    if (MacDot11IeIndexFind(dot11, msg, sizeof(DOT11_BeaconFrame),
+            DOT11_PS_TIM_ELEMENT_ID_TIM, &offset) != NULL)
     {
         Dot11s_AssignToElement(&element, rxFrame, &offset, rxFrameSize);
         Dot11_ParseTimIdElement(node, &element, timFrame);
-
-        isFound = TRUE;
     }
 }//Dot11_GetTimFromBeacon
 
@@ -1452,6 +1423,8 @@ DOT11_SeqNoEntry* MacDot11StationGetSeqNo(
         entry->ipAddress = destAddr;
         entry->fromSeqNo = 0;
         entry->toSeqNo = 0;
+        entry->ampduWinEnd = 0;
+        entry->ampduRxBitmap = 0;
         entry->next = NULL;
         dot11->seqNoHead = entry;
         return entry;
@@ -1472,6 +1445,8 @@ DOT11_SeqNoEntry* MacDot11StationGetSeqNo(
     entry->ipAddress = destAddr;
     entry->fromSeqNo = 0;
     entry->toSeqNo = 0;
+    entry->ampduWinEnd = 0;
+    entry->ampduRxBitmap = 0;
     entry->next = NULL;
 
     prev->next = entry;
@@ -1524,6 +1499,8 @@ DOT11_SeqNoEntry* MacDot11StationGetSeqNo(
         entry->ipAddress = destAddr;
         entry->fromSeqNo = 0;
         entry->toSeqNo = 0;
+        entry->ampduWinEnd = 0;
+        entry->ampduRxBitmap = 0;
         entry->next = NULL;
         *head = entry;
         return entry;
@@ -1544,6 +1521,8 @@ DOT11_SeqNoEntry* MacDot11StationGetSeqNo(
     entry->ipAddress = destAddr;
     entry->fromSeqNo = 0;
     entry->toSeqNo = 0;
+    entry->ampduWinEnd = 0;
+    entry->ampduRxBitmap = 0;
     entry->next = NULL;
 
     prev->next = entry;
@@ -2046,12 +2025,62 @@ void MacDot11StationResetBackoffAndAckVariables(
 //--------------------------------------------------------------------------
 
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11StationTimerHandle
+//  PURPOSE:     Handle that keeps the pending timer of a given type.
+//
+//               MSG_MAC_TimerExpired and the probe delay are checked
+//               against timerSequenceNumber and share stationTimer. The
+//               beacon, awake and CFP end timers are checked against the
+//               sequence number saved after they are set, so a new one
+//               makes the pending one obsolete. The channel switch and
+//               ATIM window timers carry no check: every one set fires,
+//               as with the kernel timers, so they get no handle.
+//
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int timerType
+//                  type of timer
+//  RETURN:      Handle of the timer type, NULL if it has none
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static //inline
+DOT11_Timer** MacDot11StationTimerHandle(
+    MacDataDot11* dot11,
+    int timerType)
+{
+    switch (timerType) {
+        case MSG_MAC_DOT11_Beacon:
+            return &dot11->beaconTimer;
+        case MSG_MAC_DOT11_PSStartListenTxChannel:
+            return &dot11->awakeTimer;
+        case MSG_MAC_DOT11_CfpEnd:
+            return &dot11->cfpEndTimer;
+        case MSG_MAC_DOT11_ATIMWindowTimerExpired:
+        case MSG_MAC_DOT11_ChanSwitchRxReturnPrevChannel:
+        case MSG_MAC_DOT11_ChanSwitchInitialDelay:
+        case MSG_MAC_DOT11_ChanSwitchRxProbe:
+        case MSG_MAC_DOT11_ChanSwitchTxDelay:
+        case MSG_MAC_DOT11_ChanSwitchSinrProbeChanSwitch:
+        case MSG_MAC_DOT11_ChanSwitchWaitForTX:
+        case MSG_MAC_DOT11_ChanSwitchSinrProbe:
+        case MSG_MAC_DOT11_ChanSwitchTimerExpired:
+            return NULL;
+        default:
+            break;
+    }
+    return &dot11->stationTimer;
+}// MacDot11StationTimerHandle
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11StationStartTimerOfGivenType
 //  PURPOSE:     Set a timer of given message/event type.
 //
 //               Similar to MacDot11StartTimer which sets timer for
-//               MSG_MAC_TimerExpired only.
+//               MSG_MAC_TimerExpired only. Bumping the sequence number
+//               makes the pending MSG_MAC_TimerExpired timer obsolete,
+//               so it is taken out of the timer wheel, as is the pending
+//               timer of the same type if the type has a handle.
 //
 //  PARAMETERS:  Node* node
 //                  Pointer to node
@@ -2073,19 +2102,14 @@ void MacDot11StationStartTimerOfGivenType(
     clocktype timerDelay,
     int timerType)
 {
-    Message* newMsg;
+    DOT11_Timer** handle = MacDot11StationTimerHandle(dot11, timerType);
 
     dot11->timerSequenceNumber++;
+    MacDot11TimerWheelCancel(node, dot11, &dot11->stationTimer);
+    MacDot11TimerWheelCancel(node, dot11, handle);
 
-    newMsg = MESSAGE_Alloc(node, MAC_LAYER, MAC_PROTOCOL_DOT11,
-                           timerType);
-    MESSAGE_SetInstanceId(newMsg, (short) dot11->myMacData->interfaceIndex);
-
-    MESSAGE_InfoAlloc(node, newMsg, sizeof(dot11->timerSequenceNumber));
-    *((int*)(MESSAGE_ReturnInfo(newMsg))) = dot11->timerSequenceNumber;
-    newMsg->originatingNodeId = node->nodeId;
-
-    MESSAGE_Send(node, newMsg, timerDelay);
+    MacDot11TimerWheelSet(node, dot11, timerDelay, timerType,
+                          dot11->timerSequenceNumber, handle);
 }// MacDot11StationStartTimerOfGivenType
 
 //--------------------------------------------------------------------------
@@ -2142,20 +2166,11 @@ void MacDot11StationStartTimer(
     MacDataDot11* dot11,
     clocktype timerDelay)
 {
-    Message *newMsg;
-
     dot11->timerSequenceNumber++;
+    MacDot11TimerWheelCancel(node, dot11, &dot11->stationTimer);
 
-    newMsg = MESSAGE_Alloc(node, MAC_LAYER, MAC_PROTOCOL_DOT11,
-                           MSG_MAC_TimerExpired);
-    MESSAGE_SetInstanceId(newMsg, (short) dot11->myMacData->interfaceIndex);
-
-    MESSAGE_InfoAlloc(node, newMsg, sizeof(dot11->timerSequenceNumber));
-    *((int*)(MESSAGE_ReturnInfo(newMsg))) = dot11->timerSequenceNumber;
-
-    newMsg->originatingNodeId = node->nodeId;
-
-    MESSAGE_Send(node, newMsg, timerDelay);
+    MacDot11TimerWheelSet(node, dot11, timerDelay, MSG_MAC_TimerExpired,
+                          dot11->timerSequenceNumber, &dot11->stationTimer);
 
 }// MacDot11StationStartTimer
 
@@ -2177,6 +2192,7 @@ void MacDot11StationCancelTimer(
 {
     // Has the effect of making the current timer "obsolete".
     dot11->timerSequenceNumber++;
+    MacDot11TimerWheelCancel(node, dot11, &dot11->stationTimer);
 
 }// MacDot11StationCancelTimer
 
@@ -2957,6 +2973,30 @@ DOT11_DataRateEntry* MacDot11StationGetDataRateEntry(
 }// MacDot11StationGetDataRateEntry
 
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11StationUsesChanSwitchRateControl
+//  PURPOSE:     Check whether the current data rate entry is driven by
+//               the PHY_CHANSWITCH SINR/ACK rate controller instead of ARF.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      TRUE if the PHY controller picks the unicast rate
+//  ASSUMPTION:  dot11->dataRateInfo is set.
+//--------------------------------------------------------------------------
+static //inline
+BOOL MacDot11StationUsesChanSwitchRateControl(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    int phyIndex = dot11->myMacData->phyNumber;
+
+    return (dot11->dataRateInfo->ipAddress != ANY_MAC802 &&
+            PHY_GetModel(node, phyIndex) == PHY_CHANSWITCH &&
+            PhyChanSwitchRateAdaptationEnabled(node, phyIndex));
+}
+
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11StationAdjustDataRateForNewOutgoingPacket
 //  PURPOSE:     When a packet is dequeued to the local buffer,
@@ -2973,6 +3013,13 @@ void MacDot11StationAdjustDataRateForNewOutgoingPacket(
     Node* node,
     MacDataDot11* dot11)
 {
+    if (MacDot11StationUsesChanSwitchRateControl(node, dot11)) {
+        dot11->dataRateInfo->dataRateType =
+            PhyChanSwitchSelectTxDataRateType(
+                node, dot11->myMacData->phyNumber);
+        return;
+    }
+
     if ( (dot11->dataRateInfo->ipAddress != ANY_MAC802 &&
           dot11->dataRateInfo->dataRateTimer < getSimTime(node)) ||
          (dot11->dataRateInfo->numAcksInSuccess ==
@@ -3009,6 +3056,15 @@ void MacDot11StationAdjustDataRateForResponseTimeout(
     Node* node,
     MacDataDot11* dot11)
 {
+    if (MacDot11StationUsesChanSwitchRateControl(node, dot11)) {
+        PhyChanSwitchReportTxOutcome(
+            node, dot11->myMacData->phyNumber, FALSE);
+        dot11->dataRateInfo->dataRateType =
+            PhyChanSwitchSelectTxDataRateType(
+                node, dot11->myMacData->phyNumber);
+        return;
+    }
+
     if ((dot11->dataRateInfo->numAcksFailed ==
          DOT11_NUM_ACKS_FOR_RATE_DECREASE) ||
         (dot11->dataRateInfo->numAcksFailed == 1 &&
@@ -5000,31 +5056,17 @@ void MacDot11ManagementStartTimerOfGivenType(
     MacDataDot11* dot11,
     clocktype timerDelay,int TimerType)
 {
-    Message* newMsg;
-
     dot11->timerSequenceNumber++;
+    MacDot11TimerWheelCancel(node, dot11, &dot11->stationTimer);
+    MacDot11TimerWheelCancel(node, dot11, &dot11->managementTimer);
 
-    newMsg = MESSAGE_Alloc(
-                node,
-                MAC_LAYER,
-                MAC_PROTOCOL_DOT11,
-                TimerType);
-
-    MESSAGE_SetInstanceId(
-        newMsg,
-        (short) dot11->myMacData->interfaceIndex);
-
-    MESSAGE_InfoAlloc(
+    MacDot11TimerWheelSet(
         node,
-        newMsg,
-        sizeof(dot11->timerSequenceNumber));
-
-    *((int*)MESSAGE_ReturnInfo(newMsg)) = dot11->timerSequenceNumber;
-
-    MESSAGE_Send(
-        node,
-        newMsg,
-        timerDelay);
+        dot11,
+        timerDelay,
+        TimerType,
+        dot11->timerSequenceNumber,
+        &dot11->managementTimer);
 
     dot11->managementSequenceNumber = dot11->timerSequenceNumber;
 
@@ -6448,6 +6490,11 @@ else if (MacDot11IsQoSEnabled(node, dot11)&& isEncrypt)
                 transmitDelay += dot11->delayUntilSignalAirborn;
             }
 
+            // Frames queued behind this one for the same receiver may
+            // go out with it in an A-MPDU.
+            pktToPhy = MacDot11AmpduBuildFrame(
+                node, dot11, pktToPhy, dataRateType);
+
             if (!dot11->useDvcs) {
                 MacDot11StationStartTransmittingPacket(
                     node, dot11, pktToPhy, transmitDelay);
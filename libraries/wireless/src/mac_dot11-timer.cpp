@@ -0,0 +1,653 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file mac_dot11-timer.cpp
+ * \brief Per-interface timer wheel for the station timers.
+ *
+ * A timer sits on level 0 while its tick is in the same level 0 turn as
+ * the wheel cursor, on level 1 while it is in the same level 1 turn, and
+ * so on. When the cursor enters a new turn the matching slot of the
+ * level above is cascaded down. Every level is therefore later than the
+ * levels below it, and within a level the lowest occupied slot holds the
+ * earliest timers, which is all the arming code needs.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api.h"
+#include "partition.h"
+#include "mac_dot11.h"
+
+#define DOT11_TIMER_WHEEL_SLOT_MASK ((clocktype)DOT11_TIMER_WHEEL_SLOTS - 1)
+
+
+//-------------------------------------------------------------------------
+// Static Functions
+//-------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelLowestBit
+//  PURPOSE:     Index of the lowest set bit of a non-zero slot bitmap.
+//  PARAMETERS:  UInt64 bits
+//                  Bitmap, not zero
+//  RETURN:      Bit index
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+int MacDot11TimerWheelLowestBit(UInt64 bits)
+{
+    int index = 0;
+
+    if ((bits & 0xFFFFFFFF) == 0) { bits >>= 32; index += 32; }
+    if ((bits & 0xFFFF) == 0)     { bits >>= 16; index += 16; }
+    if ((bits & 0xFF) == 0)       { bits >>= 8;  index += 8;  }
+    if ((bits & 0xF) == 0)        { bits >>= 4;  index += 4;  }
+    if ((bits & 0x3) == 0)        { bits >>= 2;  index += 2;  }
+    if ((bits & 0x1) == 0)        { index += 1; }
+
+    return index;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelBitsAbove
+//  PURPOSE:     Occupied slots of a level strictly after the given slot.
+//  PARAMETERS:  UInt64 bits
+//                  Slot bitmap of the level
+//               int slot
+//                  Current slot of the level
+//  RETURN:      Bitmap of the occupied slots after slot
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+UInt64 MacDot11TimerWheelBitsAbove(UInt64 bits, int slot)
+{
+    if (slot == DOT11_TIMER_WHEEL_SLOTS - 1) {
+        return 0;
+    }
+    return bits & (~(UInt64)0 << (slot + 1));
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelInsert
+//  PURPOSE:     Link a timer into the level and slot matching its deadline.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//               DOT11_Timer* timer
+//                  Timer with its deadline set
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelInsert(
+    DOT11_TimerWheel* wheel,
+    DOT11_Timer* timer)
+{
+    clocktype tick = timer->deadline >> DOT11_TIMER_WHEEL_TICK_BITS;
+    DOT11_Timer** list = &wheel->overflow;
+    int level;
+
+    if (tick < wheel->currentTick) {
+        tick = wheel->currentTick;
+    }
+
+    timer->level = DOT11_TIMER_WHEEL_OVERFLOW;
+    timer->slot = 0;
+
+    for (level = 0; level < DOT11_TIMER_WHEEL_LEVELS; level++) {
+        int turnShift = DOT11_TIMER_WHEEL_SLOT_BITS * (level + 1);
+
+        if ((tick >> turnShift) == (wheel->currentTick >> turnShift)) {
+            timer->level = level;
+            timer->slot = (int)((tick >> (turnShift -
+                                          DOT11_TIMER_WHEEL_SLOT_BITS))
+                                & DOT11_TIMER_WHEEL_SLOT_MASK);
+            list = &wheel->slots[level][timer->slot];
+            wheel->occupied[level] |= (UInt64)1 << timer->slot;
+            break;
+        }
+    }
+
+    timer->prev = NULL;
+    timer->next = *list;
+    if (*list != NULL) {
+        (*list)->prev = timer;
+    }
+    *list = timer;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelUnlink
+//  PURPOSE:     Take a timer out of its slot.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//               DOT11_Timer* timer
+//                  Linked timer
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelUnlink(
+    DOT11_TimerWheel* wheel,
+    DOT11_Timer* timer)
+{
+    DOT11_Timer** list;
+
+    if (timer->level == DOT11_TIMER_WHEEL_OVERFLOW) {
+        list = &wheel->overflow;
+    }
+    else {
+        list = &wheel->slots[timer->level][timer->slot];
+    }
+
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    }
+    else {
+        *list = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+
+    if (*list == NULL && timer->level != DOT11_TIMER_WHEEL_OVERFLOW) {
+        wheel->occupied[timer->level] &= ~((UInt64)1 << timer->slot);
+    }
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelCascade
+//  PURPOSE:     Re-insert the timers of a slot, or of the overflow list
+//               when level is DOT11_TIMER_WHEEL_OVERFLOW, after the cursor
+//               moved into their turn.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//               int level
+//                  Level of the slot
+//               int slot
+//                  Slot to cascade
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelCascade(
+    DOT11_TimerWheel* wheel,
+    int level,
+    int slot)
+{
+    DOT11_Timer* timer;
+
+    if (level == DOT11_TIMER_WHEEL_OVERFLOW) {
+        timer = wheel->overflow;
+        wheel->overflow = NULL;
+    }
+    else {
+        timer = wheel->slots[level][slot];
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level] &= ~((UInt64)1 << slot);
+    }
+
+    while (timer != NULL) {
+        DOT11_Timer* next = timer->next;
+        MacDot11TimerWheelInsert(wheel, timer);
+        timer = next;
+    }
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelAdvance
+//  PURPOSE:     Move the cursor towards targetTick, stopping early at the
+//               first tick that still holds timers. Empty stretches are
+//               skipped a whole turn at a time.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//               clocktype targetTick
+//                  Tick of the current simulation time
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelAdvance(
+    DOT11_TimerWheel* wheel,
+    clocktype targetTick)
+{
+    while (wheel->currentTick < targetTick) {
+        clocktype cur = wheel->currentTick;
+        clocktype next;
+        int level;
+
+        if (wheel->occupied[0] &
+            ((UInt64)1 << (cur & DOT11_TIMER_WHEEL_SLOT_MASK)))
+        {
+            return;
+        }
+
+        // The next tick where something can happen is the first occupied
+        // slot ahead of the cursor on the lowest level that has one, or
+        // the start of the next overflow turn.
+        next = ((cur >> (DOT11_TIMER_WHEEL_SLOT_BITS *
+                         DOT11_TIMER_WHEEL_LEVELS)) + 1)
+               << (DOT11_TIMER_WHEEL_SLOT_BITS * DOT11_TIMER_WHEEL_LEVELS);
+
+        for (level = 0; level < DOT11_TIMER_WHEEL_LEVELS; level++) {
+            int shift = DOT11_TIMER_WHEEL_SLOT_BITS * level;
+            int turnShift = shift + DOT11_TIMER_WHEEL_SLOT_BITS;
+            UInt64 ahead = MacDot11TimerWheelBitsAbove(
+                wheel->occupied[level],
+                (int)((cur >> shift) & DOT11_TIMER_WHEEL_SLOT_MASK));
+
+            if (ahead != 0) {
+                next = ((cur >> turnShift) << turnShift) +
+                       ((clocktype)MacDot11TimerWheelLowestBit(ahead)
+                        << shift);
+                break;
+            }
+        }
+
+        if (next > targetTick) {
+            wheel->currentTick = targetTick;
+            return;
+        }
+
+        wheel->currentTick = next;
+
+        // Entering a new turn: cascade from the top level down so that
+        // timers land on the lowest level they belong to.
+        for (level = DOT11_TIMER_WHEEL_LEVELS; level >= 1; level--) {
+            int shift = DOT11_TIMER_WHEEL_SLOT_BITS * level;
+
+            if ((next & ((((clocktype)1) << shift) - 1)) != 0) {
+                continue;
+            }
+            if (level == DOT11_TIMER_WHEEL_LEVELS) {
+                MacDot11TimerWheelCascade(
+                    wheel, DOT11_TIMER_WHEEL_OVERFLOW, 0);
+            }
+            else {
+                MacDot11TimerWheelCascade(
+                    wheel,
+                    level,
+                    (int)((next >> shift) & DOT11_TIMER_WHEEL_SLOT_MASK));
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelEarliestInList
+//  PURPOSE:     Earliest timer of a slot list, set order breaking ties.
+//  PARAMETERS:  DOT11_Timer* timer
+//                  Head of the list, not NULL
+//  RETURN:      Earliest timer
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+DOT11_Timer* MacDot11TimerWheelEarliestInList(DOT11_Timer* timer)
+{
+    DOT11_Timer* earliest = timer;
+
+    for (timer = timer->next; timer != NULL; timer = timer->next) {
+        if (timer->deadline < earliest->deadline ||
+            (timer->deadline == earliest->deadline &&
+             (int)(timer->serial - earliest->serial) < 0))
+        {
+            earliest = timer;
+        }
+    }
+    return earliest;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelEarliest
+//  PURPOSE:     Earliest pending timer of the wheel.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//  RETURN:      Earliest timer, NULL if the wheel is empty
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+DOT11_Timer* MacDot11TimerWheelEarliest(DOT11_TimerWheel* wheel)
+{
+    int level;
+
+    for (level = 0; level < DOT11_TIMER_WHEEL_LEVELS; level++) {
+        if (wheel->occupied[level] != 0) {
+            int slot = MacDot11TimerWheelLowestBit(wheel->occupied[level]);
+            return MacDot11TimerWheelEarliestInList(
+                       wheel->slots[level][slot]);
+        }
+    }
+    if (wheel->overflow != NULL) {
+        return MacDot11TimerWheelEarliestInList(wheel->overflow);
+    }
+    return NULL;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelRelease
+//  PURPOSE:     Return an unlinked timer to the free list.
+//  PARAMETERS:  DOT11_TimerWheel* wheel
+//                  Timer wheel
+//               DOT11_Timer* timer
+//                  Unlinked timer
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelRelease(
+    DOT11_TimerWheel* wheel,
+    DOT11_Timer* timer)
+{
+    if (timer->handle != NULL) {
+        *timer->handle = NULL;
+        timer->handle = NULL;
+    }
+    timer->next = wheel->freeList;
+    wheel->freeList = timer;
+    wheel->numTimers--;
+}
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11TimerWheelArm
+//  PURPOSE:     Make sure the kernel timer fires no later than the earliest
+//               deadline. A kernel timer armed earlier than needed is left
+//               alone; it finds nothing due and re-arms.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static
+void MacDot11TimerWheelArm(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+    DOT11_Timer* earliest;
+    Message* newMsg;
+
+    if (wheel->dispatching) {
+        return;
+    }
+
+    earliest = MacDot11TimerWheelEarliest(wheel);
+    if (earliest == NULL) {
+        return;
+    }
+    if (wheel->kernelTimer != NULL) {
+        if (wheel->armedTime <= earliest->deadline) {
+            return;
+        }
+        MESSAGE_CancelSelfMsg(node, wheel->kernelTimer);
+        wheel->kernelTimer = NULL;
+    }
+
+    newMsg = MESSAGE_Alloc(node, MAC_LAYER, MAC_PROTOCOL_DOT11,
+                           MSG_MAC_DOT11_TimerWheelExpired);
+    MESSAGE_SetInstanceId(newMsg, (short) dot11->myMacData->interfaceIndex);
+
+    wheel->kernelTimer = newMsg;
+    wheel->armedTime = earliest->deadline;
+    wheel->kernelTimersSent++;
+
+    MESSAGE_Send(node, newMsg, earliest->deadline - getSimTime(node));
+}
+
+
+//-------------------------------------------------------------------------
+// Interface Functions
+//-------------------------------------------------------------------------
+
+/**
+FUNCTION   :: MacDot11TimerWheelSet
+LAYER      :: MAC
+PURPOSE    :: Add a timer to the interface timer wheel and make sure the
+              kernel timer is armed for the earliest deadline.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ timerDelay : clocktype    : delay until the timer fires
++ timerType : int           : timer type given to MacDot11HandleTimer
++ sequenceNumber : unsigned int : sequence number given to
+                              MacDot11HandleTimer
++ handle    : DOT11_Timer** : set to the timer, cleared when it fires or
+                              is cancelled. May be NULL.
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelSet(
+    Node* node,
+    MacDataDot11* dot11,
+    clocktype timerDelay,
+    int timerType,
+    unsigned int sequenceNumber,
+    DOT11_Timer** handle)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+    DOT11_Timer* timer;
+
+    if (wheel == NULL) {
+        wheel = (DOT11_TimerWheel*) MEM_malloc(sizeof(DOT11_TimerWheel));
+        memset(wheel, 0, sizeof(DOT11_TimerWheel));
+        wheel->currentTick =
+            getSimTime(node) >> DOT11_TIMER_WHEEL_TICK_BITS;
+        dot11->timerWheel = wheel;
+    }
+
+    if (wheel->freeList == NULL) {
+        DOT11_TimerChunk* chunk =
+            (DOT11_TimerChunk*) MEM_malloc(sizeof(DOT11_TimerChunk));
+        int i;
+
+        chunk->next = wheel->chunks;
+        wheel->chunks = chunk;
+        for (i = 0; i < DOT11_TIMER_WHEEL_POOL_CHUNK; i++) {
+            chunk->timers[i].next = wheel->freeList;
+            wheel->freeList = &chunk->timers[i];
+        }
+    }
+
+    timer = wheel->freeList;
+    wheel->freeList = timer->next;
+
+    ERROR_Assert(timerDelay >= 0,
+        "MacDot11TimerWheelSet: negative timer delay.\n");
+
+    timer->deadline = getSimTime(node) + timerDelay;
+    timer->timerType = timerType;
+    timer->sequenceNumber = sequenceNumber;
+    timer->serial = wheel->nextSerial++;
+    timer->handle = handle;
+    if (handle != NULL) {
+        *handle = timer;
+    }
+
+    MacDot11TimerWheelInsert(wheel, timer);
+    wheel->numTimers++;
+    wheel->timersSet++;
+
+    MacDot11TimerWheelArm(node, dot11);
+}
+
+/**
+FUNCTION   :: MacDot11TimerWheelCancel
+LAYER      :: MAC
+PURPOSE    :: Remove a pending timer from the timer wheel. Does nothing
+              if the handle is NULL.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ handle    : DOT11_Timer** : handle given to MacDot11TimerWheelSet
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelCancel(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11_Timer** handle)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+
+    if (handle == NULL || *handle == NULL) {
+        return;
+    }
+
+    MacDot11TimerWheelUnlink(wheel, *handle);
+    MacDot11TimerWheelRelease(wheel, *handle);
+    wheel->timersCancelled++;
+}
+
+/**
+FUNCTION   :: MacDot11TimerWheelExpire
+LAYER      :: MAC
+PURPOSE    :: Handle the kernel timer of the timer wheel: deliver every
+              timer whose deadline has passed to MacDot11HandleTimer, in
+              deadline order, then re-arm for the next deadline.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : the kernel timer message, freed here
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelExpire(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+    clocktype now = getSimTime(node);
+
+    ERROR_Assert(wheel != NULL && wheel->kernelTimer == msg,
+        "MacDot11TimerWheelExpire: unexpected timer wheel message.\n");
+
+    wheel->kernelTimer = NULL;
+    MESSAGE_Free(node, msg);
+
+    // Timers set by the handlers go into the wheel; arm once at the end.
+    wheel->dispatching = TRUE;
+
+    while (TRUE) {
+        DOT11_Timer* timer;
+        int timerType;
+        unsigned int sequenceNumber;
+
+        MacDot11TimerWheelAdvance(
+            wheel, now >> DOT11_TIMER_WHEEL_TICK_BITS);
+
+        if ((wheel->occupied[0] &
+             ((UInt64)1 << (wheel->currentTick &
+                            DOT11_TIMER_WHEEL_SLOT_MASK))) == 0)
+        {
+            break;
+        }
+        timer = MacDot11TimerWheelEarliestInList(
+                    wheel->slots[0][wheel->currentTick &
+                                    DOT11_TIMER_WHEEL_SLOT_MASK]);
+        if (timer->deadline > now) {
+            break;
+        }
+
+        timerType = timer->timerType;
+        sequenceNumber = timer->sequenceNumber;
+        MacDot11TimerWheelUnlink(wheel, timer);
+        MacDot11TimerWheelRelease(wheel, timer);
+        wheel->timersFired++;
+
+        MacDot11HandleTimer(node, dot11, timerType, sequenceNumber);
+    }
+
+    wheel->dispatching = FALSE;
+    MacDot11TimerWheelArm(node, dot11);
+}
+
+/**
+FUNCTION   :: MacDot11TimerWheelPrintStats
+LAYER      :: MAC
+PURPOSE    :: Print the timer wheel counters.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ interfaceIndex : int      : interface index
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelPrintStats(
+    Node* node,
+    MacDataDot11* dot11,
+    int interfaceIndex)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+    char buf[MAX_STRING_LENGTH];
+
+    if (wheel == NULL) {
+        return;
+    }
+
+    sprintf(buf, "Timers set = %d", wheel->timersSet);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Timers cancelled = %d", wheel->timersCancelled);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Timers fired = %d", wheel->timersFired);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Timer wheel kernel events = %d", wheel->kernelTimersSent);
+    IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+}
+
+/**
+FUNCTION   :: MacDot11TimerWheelFinalize
+LAYER      :: MAC
+PURPOSE    :: Free the timer wheel and its timer pool. The pending kernel
+              timer, if any, is left to the kernel.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelFinalize(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11_TimerWheel* wheel = dot11->timerWheel;
+
+    if (wheel == NULL) {
+        return;
+    }
+
+    while (wheel->chunks != NULL) {
+        DOT11_TimerChunk* chunk = wheel->chunks;
+        wheel->chunks = chunk->next;
+        MEM_free(chunk);
+    }
+    MEM_free(wheel);
+    dot11->timerWheel = NULL;
+
+    dot11->stationTimer = NULL;
+    dot11->beaconTimer = NULL;
+    dot11->awakeTimer = NULL;
+    dot11->cfpEndTimer = NULL;
+    dot11->managementTimer = NULL;
+}
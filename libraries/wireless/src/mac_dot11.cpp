@@ -36,6 +36,7 @@
 #include "mac_dot11s.h"
 #include "phy_802_11.h"
 #include "phy_chanswitch.h"
+#include "util_dbconv.h"
 #include "mac_dot11-pc.h"
 //--------------------HCCA-Updates Start---------------------------------//
 #include "mac_dot11-hcca.h"
@@ -367,6 +368,29 @@ void MacDot11ReceiveNetworkLayerPacket(
     MacDot11DataQueue_EnqueuePacket(node, dot11, newFrameInfo);
 
 }
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11FrameNavDuration.
+//  PURPOSE:     NAV duration carried by an overheard frame.
+//  PARAMETERS:  UInt8 frameType
+//                  Type of the frame
+//               UInt16 duration
+//                  Duration/ID field of the frame
+//               clocktype elapsed
+//                  Time of the frame already past
+//  RETURN:      NAV duration, zero for a PS-Poll whose field is the AID
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+static //inline//
+clocktype MacDot11FrameNavDuration(
+    UInt8 frameType, UInt16 duration, clocktype elapsed)
+{
+    if (frameType == DOT11_PS_POLL) {
+        return 0;
+    }
+    return MacDot11MicroToNanosecond(duration) - elapsed;
+}
+
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11ProcessNotMyFrame.
 //  PURPOSE:     Handle frames that don't belong to this node.
@@ -612,6 +636,17 @@ void MacDot11ProcessFrame(
                          flag = TRUE;
                     }
              }
+            else if (dot11->ampduEnabled ||
+                     dot11->ampdu->aggregatesReceived > 0)
+            {
+                // With A-MPDU retries come out of order and a dropped
+                // aggregate skips numbers; the Block ACK scoreboard
+                // filters duplicates instead.
+                flag = MacDot11AmpduCheckSeqNo(node,
+                    dot11,
+                    sourceAddr,
+                    hdr->seqNo);
+            }
             else
             {
                  flag = FALSE;
@@ -803,6 +838,11 @@ void MacDot11NetworkLayerChanswitch(
                 break;
             }
         }
+        // dot11s. A mesh point takes its neighbours along.
+        if (dot11->isMP) {
+            Dot11s_ProposeChannelSwitch(node, dot11, newChannel);
+            return;
+        }
         //only change state if idle and is TX
         // printf("MacDot11NetworkLayerChanswitch: IP Queue %4.2f %% full. State %d \n", dot11->chanswitchThreshold,dot11->simple_state);
         if(dot11->simple_state == TX_N_IDLE && dot11->is_rx == FALSE) {
@@ -978,6 +1018,13 @@ void MacDot11HandleChannelSwitchTimer(
 			}
 		}
 
+		// dot11s. A mesh point moves with its neighbours, announced
+		// ahead of time, instead of dropping the current exchange.
+		if (dot11->isMP) {
+			Dot11s_ProposeChannelSwitch(node, dot11, newChannel);
+			return;
+		}
+
 		//cancel current transactions
 		if (MacDot11StationPhyStatus(node, dot11) != PHY_IDLE){
 			if (MacDot11StationPhyStatus(node, dot11) == PHY_TRANSMITTING){
@@ -1102,6 +1149,51 @@ void MacDot11HandleChannelSwitchTimerAfterPkt(
 	}
 }
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11SetOperatingChannel
+//  PURPOSE:     Move transmission and listening to another channel.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int newChannel
+//                  Channel to move to
+//  RETURN:      Previous transmission channel
+//  ASSUMPTION:  The MAC is not in a frame exchange.
+//--------------------------------------------------------------------------
+int MacDot11SetOperatingChannel(
+    Node* node,
+    MacDataDot11* dot11,
+    int newChannel)
+{
+    int phyIndex = dot11->myMacData->phyNumber;
+    int oldChannel;
+
+    PHY_GetTransmissionChannel(node, phyIndex, &oldChannel);
+    if (oldChannel == newChannel) {
+        return oldChannel;
+    }
+
+    // A frame arriving on the old channel is lost with the move.
+    if (MacDot11StationPhyStatus(node, dot11) == PHY_RECEIVING) {
+        BOOL frameHeaderHadError;
+        clocktype endSignalTime;
+
+        PHY_TerminateCurrentReceive(node, phyIndex, FALSE,
+            &frameHeaderHadError, &endSignalTime);
+    }
+
+    if (PHY_IsListeningToChannel(node, phyIndex, oldChannel)) {
+        PHY_StopListeningToChannel(node, phyIndex, oldChannel);
+    }
+    if (!PHY_IsListeningToChannel(node, phyIndex, newChannel)) {
+        PHY_StartListeningToChannel(node, phyIndex, newChannel);
+    }
+    PHY_SetTransmissionChannel(node, phyIndex, newChannel);
+
+    return oldChannel;
+}
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11SendChanSwitchPacket
 //  PURPOSE:     Send the channel change/stay alert pkt (chanswitch master)
@@ -1182,6 +1274,45 @@ void MacDot11SendChanSwitchPacket(
 }
 
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11FlushIntnoiseSamples
+//  PURPOSE:     Convert the buffered interference probe samples to dB in
+//               one batch and add them to the channel's average.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      None
+//  ASSUMPTION:  None
+//  NOTES:       Only used by Channel Switching PHY protocol
+//
+//--------------------------------------------------------------------------
+static
+void MacDot11FlushIntnoiseSamples(
+    Node* node,
+    MacDataDot11* dot11){
+
+    PhyData *thisPhy = node->phyData[dot11->myMacData->phyNumber];
+    double sum_dB = 0.0;
+    int i;
+
+    if (dot11->numIntnoiseSamples == 0) {
+        return;
+    }
+
+    DBCONV_InDbBatch(dot11->intnoiseSamples_mW,
+                     dot11->intnoiseSamples_mW,
+                     dot11->numIntnoiseSamples);
+
+    for (i = 0; i < dot11->numIntnoiseSamples; i++) {
+        sum_dB += dot11->intnoiseSamples_mW[i];
+    }
+    thisPhy->avg_intnoise_dB[dot11->intnoiseSampleChannel] +=
+        DOT11_INTNOISE_SAMPLE_WEIGHT * sum_dB;
+
+    dot11->numIntnoiseSamples = 0;
+}
+
 
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11HandleSinrProbeChanSwitch
@@ -1232,6 +1363,9 @@ void MacDot11HandleSinrProbeChanSwitch(
 
     PHY_GetTransmissionChannel(node,phyIndex,&oldChannel);
 
+    //the average for this channel is complete once its samples are in
+    MacDot11FlushIntnoiseSamples(node, dot11);
+
     //we've checked it
     thisPhy->channelChecked[oldChannel] = TRUE;
 
@@ -1380,6 +1514,7 @@ void MacDot11InterferenceScan(Node* node, MacDataDot11* dot11, clocktype delay){
     PHY_GetTransmissionChannel(node,phyIndex,&channel);
     thisPhy->avg_intnoise_dB[channel] = 0.0;
     thisPhy->worst_intnoise_dB[channel] = thisPhy->noise_mW_hz * PHY_CHANSWITCH_CHANNEL_BANDWIDTH; //start with base noise
+    dot11->numIntnoiseSamples = 0;
 
     
     MacDot11StationStartTimerOfGivenType(
@@ -1451,11 +1586,7 @@ void MacDot11ProcessBeacon(
     if(Dot11_GetCfsetFromBeacon(node, dot11, msg, &cfSet))
         {
          dot11->pcfEnable = TRUE;
-         int offset = ( sizeof(DOT11_BeaconFrame)+
-         sizeof(DOT11_CFParameterSet)+
-         DOT11_IE_HDR_LENGTH);
-         Dot11_GetTimFromBeacon(node, dot11, msg,
-         offset, &timFrame);
+         Dot11_GetTimFromBeacon(node, dot11, msg, &timFrame);
          dot11->DTIMCount =  timFrame.dTIMCount;
     }
 
@@ -2013,7 +2144,8 @@ void MacDot11ProcessMyFrame(
         case DOT11_DATA:
         case DOT11_QOS_DATA:
         case DOT11_MESH_DATA:
-        case DOT11_CF_DATA_ACK: {
+        case DOT11_CF_DATA_ACK:
+        case DOT11_AMPDU: {
 
             if(dot11->chanswitchMaster){
                 int phyIndex = dot11->myMacData->phyNumber;
@@ -2099,7 +2231,12 @@ void MacDot11ProcessMyFrame(
                 // This is not in the standard, but ns-2 does.
                 // dot11->SSRC = 0;
 
-                MacDot11ProcessFrame(node, dot11, msg);
+                if (hdr->frameType == DOT11_AMPDU) {
+                    MacDot11AmpduReceiveFrame(node, dot11, msg);
+                }
+                else {
+                    MacDot11ProcessFrame(node, dot11, msg);
+                }
             }
             else {
                 MacDot11Trace(node, dot11, NULL,
@@ -2173,12 +2310,36 @@ void MacDot11ProcessMyFrame(
 
             dot11->dataRateInfo->numAcksInSuccess++;
 
+            if (MacDot11StationUsesChanSwitchRateControl(node, dot11)) {
+                PhyChanSwitchReportTxOutcome(
+                    node, dot11->myMacData->phyNumber, TRUE);
+            }
+
             MacDot11StationCancelTimer(node, dot11);
 
             MacDot11StationProcessAck(node, dot11, msg);
             MESSAGE_Free(node, msg);
             break;
         }
+
+        case DOT11_BLOCK_ACK: {
+            MacDot11Trace(node, dot11, msg, "Receive");
+
+            // A late Block ACK after the exchange timed out is ignored,
+            // the subframes are sent again anyway.
+            if (dot11->state != DOT11_S_WFACK ||
+                !MacDot11AmpduExchangeActive(dot11))
+            {
+                MESSAGE_Free(node, msg);
+                break;
+            }
+
+            MacDot11StationCancelTimer(node, dot11);
+
+            MacDot11AmpduProcessBlockAck(node, dot11, msg);
+            MESSAGE_Free(node, msg);
+            break;
+        }
 //--------------------HCCA-Updates Start---------------------------------//
         case DOT11_QOS_DATA_POLL:
         case DOT11_QOS_CF_POLL:{
@@ -2221,19 +2382,30 @@ void MacDot11ProcessMyFrame(
             if(DEBUG_PS && DEBUG_PS_PSPOLL){
                 MacDot11Trace(node, dot11, msg, "AP Received PS POLL Frame");
             }
-            Mac802Address sourceNodeAddress = ((DOT11_FrameHdr*)
-                MESSAGE_ReturnPacket(msg))->sourceAddr;
+            DOT11_LongControlFrame* pollHdr =
+                (DOT11_LongControlFrame*) MESSAGE_ReturnPacket(msg);
+            Mac802Address sourceNodeAddress = pollHdr->sourceAddr;
+            DOT11_ApStation* station = NULL;
 
              if(MacDot11IsAp(dot11))
              {
-                   DOT11_ApStationListItem* stationItem =
-                   MacDot11ApStationListGetItemWithGivenAddress(
-                        node,
+                    // The Duration/ID field carries the AID of the sender
+                    station = MacDot11ApPsGetStation(
                         dot11,
-                        sourceNodeAddress);
-                    if (stationItem) {
+                        pollHdr->duration & ~DOT11_PS_POLL_AID_FLAGS);
+                    if (station == NULL ||
+                        station->macAddr != sourceNodeAddress)
+                    {
+                        DOT11_ApStationListItem* stationItem =
+                            MacDot11ApStationListGetItemWithGivenAddress(
+                                node,
+                                dot11,
+                                sourceNodeAddress);
+                        station = stationItem ? stationItem->data : NULL;
+                    }
+                    if (station) {
 
-                         stationItem->data->LastFrameReceivedTime =
+                         station->LastFrameReceivedTime =
                                                    getSimTime(node);
                     }
              }
@@ -2367,6 +2539,9 @@ void MacDot11ReceivePacketFromPhy(
 
     dot11->IsInExtendedIfsMode = FALSE;
 
+    // A new frame; its elements are indexed on the first lookup.
+    dot11->rxIeIndex.frame = NULL;
+
     int phyIndex = dot11->myMacData->phyNumber;
     PhyData *thisPhy = node->phyData[phyIndex];
 
@@ -2382,7 +2557,8 @@ void MacDot11ReceivePacketFromPhy(
             ->sourceAddr;
     }
     else if (hdr->frameType == DOT11_DATA
-          || hdr->frameType == DOT11_MESH_DATA)   // dot11s
+          || hdr->frameType == DOT11_MESH_DATA   // dot11s
+          || hdr->frameType == DOT11_AMPDU)
     {
         sourceAddr =
             ((DOT11_FrameHdr*)MESSAGE_ReturnPacket(msg))
@@ -2407,7 +2583,8 @@ void MacDot11ReceivePacketFromPhy(
         int channel;
         double noise =
             phychanswitch->thisPhy->noise_mW_hz * phychanswitch->channelBandwidth;
-        double intnoise_dB = IN_DB(phychanswitch->interferencePower_mW + noise);
+        double intnoise_dB =
+            DBCONV_InDb(phychanswitch->interferencePower_mW + noise);
         PHY_GetTransmissionChannel(node,phyIndex,&channel);
         // printf("saw a packet - interference is %f \n",intnoise_dB);
 
@@ -2482,7 +2659,8 @@ void MacDot11ReceivePacketFromPhy(
 
 //--------------------HCCA-Updates Start---------------------------------//
         MacDot11ProcessNotMyFrame(
-            node, dot11, MacDot11MicroToNanosecond(hdr->duration),
+            node, dot11,
+            MacDot11FrameNavDuration(hdr->frameType, hdr->duration, 0),
             (hdr->frameType == DOT11_RTS),
             (hdr->frameType == DOT11_QOS_CF_POLL));
 //--------------------HCCA-Updates End-----------------------------------//
@@ -2760,6 +2938,10 @@ void MacDot11ReceivePhyStatusChangeNotification(
 //                  Pointer to node
 //               MacDataDot11* dot11
 //                  Pointer to Dot11 structure
+//               int timerType
+//                  Event type of the timer
+//               unsigned int timerSequenceNumber
+//                  Sequence number of the timer
 //  RETURN:      None.
 //  ASSUMPTION:  None.
 //--------------------------------------------------------------------------
@@ -2767,7 +2949,8 @@ static //inline//
 void MacDot11HandleTimeout(
     Node* node,
     MacDataDot11* dot11,
-    Message* msg)
+    int timerType,
+    unsigned int timerSequenceNumber)
 {
 
     if (dot11->beaconIsDue
@@ -2998,8 +3181,10 @@ void MacDot11HandleTimeout(
 //--------------------HCCA-Updates Start---------------------------------//
                     MacDot11ProcessNotMyFrame(
                         node, dot11,
-                        (MacDot11MicroToNanosecond(hdr->duration)
-                            - headerCheckDelay),
+                        MacDot11FrameNavDuration(
+                            hdr->frameType,
+                            hdr->duration,
+                            headerCheckDelay),
                         (hdr->frameType == DOT11_RTS),
                         (hdr->frameType == DOT11_QOS_CF_POLL));
 //--------------------HCCA-Updates End-----------------------------------//
@@ -3015,7 +3200,8 @@ void MacDot11HandleTimeout(
         }
 
         case DOT11_S_WFJOIN: {
-            MacDot11ManagementHandleTimeout(node, dot11,msg);
+            MacDot11ManagementHandleTimer(
+                node, dot11, timerType, timerSequenceNumber);
             break;
         }
 
@@ -3096,31 +3282,31 @@ void MacDot11DeleteAssociationId(Node* node,
         tempVal ^= (0x01 << bitLocation);
     }
     dot11->apVars->AssociationVector[arrayIndex] = tempVal;
+
+    MacDot11ApPsRemoveStation(dot11, stationItem->data);
  }
 //--------------------------------------------------------------------------
-//  NAME:        MacDot11Layer.
-//  PURPOSE:     Handle timers and layer messages.
+//  NAME:        MacDot11HandleTimer.
+//  PURPOSE:     Handle a station timer fired by the timer wheel.
 //  PARAMETERS:  Node* node
-//                  Node handling the incoming messages
-//               int interfaceIndex
-//                  Interface index
-//               Message* msg
-//                  Message for node to interpret.
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int timerType
+//                  Event type the timer was set with
+//               unsigned int timerSequenceNumber
+//                  Sequence number the timer was set with
 //  RETURN:      None.
 //  ASSUMPTION:  None.
 //--------------------------------------------------------------------------
-void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
+void MacDot11HandleTimer(
+    Node* node,
+    MacDataDot11* dot11,
+    int timerType,
+    unsigned int timerSequenceNumber)
 {
-    MacDataDot11* dot11 =
-        (MacDataDot11*)node->macData[interfaceIndex]->macVar;
-
-    // dot11s. Some Mesh/HWMP timers do not use sequence numbers.
-    //unsigned timerSequenceNumber = *(int*)(MESSAGE_ReturnInfo(msg));
-
-    switch (msg->eventType) {
+    switch (timerType) {
         case MSG_MAC_TimerExpired: {
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 //---------------------------Power-Save-Mode-Updates---------------------//
@@ -3133,13 +3319,13 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
             }
 //---------------------------Power-Save-Mode-End-Updates-----------------//
             if (timerSequenceNumber == dot11->timerSequenceNumber) {
-                MacDot11HandleTimeout(node, dot11,msg);
+                MacDot11HandleTimeout(
+                    node, dot11, timerType, timerSequenceNumber);
             }
 
-            MESSAGE_Free(node, msg);
             break;
         }
-								   
+
 	case MSG_MAC_DOT11_ChanSwitchTimerExpired: {
             if (DEBUG_PS_TIMERS) {
                 MacDot11Trace(
@@ -3149,8 +3335,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                     "MSG_MAC_DOT11_ChanSwitchTimerExpired Timer expired");
             }
 
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3172,7 +3356,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
 						delay,
 						MSG_MAC_DOT11_ChanSwitchTimerExpired);
 						*/
-           MESSAGE_Free(node, msg);
            break;
     }
 
@@ -3187,8 +3370,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 NULL,
                 "MSG_MAC_DOT11_ChanSwitchSinrProbe Timer expired");
         }
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3201,11 +3382,16 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         double BER;
         double noise =
             phychanswitch->thisPhy->noise_mW_hz * phychanswitch->channelBandwidth;
-        double intnoise_dB = IN_DB(phychanswitch->interferencePower_mW + noise);
         PHY_GetTransmissionChannel(node,phyIndex,&channel);
-        //add to the average
-        thisPhy->avg_intnoise_dB[channel] +=
-            DOT11_INTNOISE_SAMPLE_WEIGHT * intnoise_dB;
+        //add to the average; samples are converted to dB a batch at a time
+        if (dot11->numIntnoiseSamples == DOT11_INTNOISE_BATCH_SIZE ||
+            (dot11->numIntnoiseSamples > 0 &&
+             dot11->intnoiseSampleChannel != channel)) {
+            MacDot11FlushIntnoiseSamples(node, dot11);
+        }
+        dot11->intnoiseSampleChannel = channel;
+        dot11->intnoiseSamples_mW[dot11->numIntnoiseSamples++] =
+            phychanswitch->interferencePower_mW + noise;
             // printf("avg_intnoise_dB: %f \n", thisPhy->avg_intnoise_dB[channel]);
         // thisPhy->avg_intnoise_dB[channel] =
         //     (1 - 0.1) * thisPhy->avg_intnoise_dB[channel] + 
@@ -3230,7 +3416,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                             delay,
                             MSG_MAC_DOT11_ChanSwitchSinrProbe);
         }
-        MESSAGE_Free(node, msg);
         break;
 
     }
@@ -3246,8 +3431,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         }
 
 
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3259,7 +3442,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
             printf("MSG_MAC_DOT11_ChanSwitchInitialDelay timer expired (got ACK already), return to TX_N_IDLE \n");
             dot11->simple_state = TX_N_IDLE;
         }
-        MESSAGE_Free(node, msg);
         break;
     }
 
@@ -3274,8 +3456,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         }
 
 
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3288,7 +3468,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
             dot11->simple_state = TX_N_IDLE;
         }
         printf("test: node %d done waiting on the initial channel \n", node->nodeId);
-        MESSAGE_Free(node, msg);
         break;
     }
 
@@ -3303,8 +3482,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         }
 
 
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3387,7 +3564,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         delay,
         MSG_MAC_DOT11_ChanSwitchRxProbe);  
 
-        MESSAGE_Free(node, msg);
         break;
     }
 
@@ -3402,8 +3578,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         }
 
 
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3423,7 +3597,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
 
         dot11->simple_state = RX_N_IDLE;
 
-        MESSAGE_Free(node, msg);
         break;
     }
 
@@ -3438,14 +3611,11 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         }
 
 
-        unsigned timerSequenceNumber =
-            (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
         ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
             "MacDot11Layer: Received invalid timer message.\n");
 
 
         MacDot11HandleSinrProbeChanSwitch(node,dot11);
-        MESSAGE_Free(node, msg);
         break;
     }
 
@@ -3458,12 +3628,9 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                     "MSG_MAC_DOT11_ChanSwitchWaitForTX Timer expired");
             }
 
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 			MacDot11HandleChannelSwitchTimerAfterPkt(node,dot11);
-            MESSAGE_Free(node, msg);
             break; 
 
        }
@@ -3479,8 +3646,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 "MSG_MAC_DOT11_Beacon Timer expired");
                 }
 
-            unsigned timerSequenceNumber =
-                 (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3520,7 +3685,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 MacDot11StationCanHandleDueBeacon(node, dot11);
           }
 
-          MESSAGE_Free(node, msg);
           break;
         }
         case MSG_MAC_DOT11_ATIMWindowTimerExpired: {
@@ -3533,8 +3697,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                     "MSG_MAC_DOT11_ATIMWindowTimerExpired Timer expired");
             }
 
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3550,7 +3712,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                     dot11,
                     FALSE);
        }
-       MESSAGE_Free(node, msg);
        break;
     // Start listening the transmission channel
         case MSG_MAC_DOT11_PSStartListenTxChannel: {
@@ -3561,8 +3722,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 NULL,
                 "MSG_MAC_DOT11_PSStartListenTxChannel Timer expired");
 
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3579,15 +3738,12 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 //      transmission channel
                 MacDot11StationStartListening(node, dot11);
             }
-            MESSAGE_Free(node, msg);
             break;
         }// end of case MSG_MAC_DOT11_ PSStartListenTxChannel
 
 //---------------------------Power-Save-Mode-End-Updates-----------------//
 
         case MSG_MAC_DOT11_Management: {
-            unsigned timerSequenceNumber =
-                (unsigned)(*(int*)(MESSAGE_ReturnInfo(msg)));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3604,13 +3760,12 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
 //---------------------------Power-Save-Mode-End-Updates-----------------//
             if (timerSequenceNumber == dot11->managementSequenceNumber) {
                 dot11->mgmtSendResponse = FALSE;
-                MacDot11ManagementHandleTimeout(node, dot11,msg);
+                MacDot11ManagementHandleTimer(
+                    node, dot11, timerType, timerSequenceNumber);
             }
-            MESSAGE_Free(node, msg);
             break;
         }
         case MSG_MAC_DOT11_CfpEnd: {
-            unsigned timerSequenceNumber = (unsigned)*(int*)(MESSAGE_ReturnInfo(msg));
             ERROR_Assert(timerSequenceNumber <= dot11->timerSequenceNumber,
                 "MacDot11Layer: Received invalid timer message.\n");
 
@@ -3618,7 +3773,87 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
                 MacDot11CfpHandleEndTimer(node, dot11);
             }
 
-            MESSAGE_Free(node, msg);
+            break;
+        }
+
+        case MSG_MAC_DOT11_Probe_Delay_Timer:
+        {
+            if (timerSequenceNumber == dot11->timerSequenceNumber)
+            {
+                DOT11_ManagementVars * mngmtVars =
+                    (DOT11_ManagementVars*) dot11->mngmtVars;
+                if (mngmtVars)
+                {
+                    mngmtVars->probeResponseRecieved = FALSE;
+                    mngmtVars->channelInfo->dwellTime =
+                                      dot11->scanMinChannelTime;
+                }
+
+                dot11->waitForProbeDelay = FALSE;
+                printf("Calling MacDot11StationCheckForOutgoingPacket node %d \n", node->nodeId);
+                MacDot11StationCheckForOutgoingPacket(node, dot11, FALSE);
+                dot11->ActiveScanShortTimerFunctional = FALSE;
+                dot11->MayReceiveProbeResponce = FALSE;
+            }
+            break;
+        }
+//---------------------------Power-Save-Mode-End-Updates-----------------//
+        case MSG_MAC_DOT11_Active_Scan_Short_Timer:
+        case MSG_MAC_DOT11_Active_Scan_Long_Timer:
+        case MSG_MAC_DOT11_Management_Authentication:
+        case MSG_MAC_DOT11_Management_Association:
+        case MSG_MAC_DOT11_Management_Reassociation:
+        case MSG_MAC_DOT11_Beacon_Wait_Timer:
+        case MSG_MAC_DOT11_Authentication_Start_Timer:
+        case MSG_MAC_DOT11_Reassociation_Start_Timer:
+        case MSG_MAC_DOT11_Scan_Start_Timer:
+        case MSG_MAC_DOT11_Enable_Management_Timer:
+        case MSG_MAC_DOT11_ChanswitchRequest:
+        case MSG_MAC_DOT11_ChangeChannelRequest:
+        case MSG_MAC_DOT11_MACAddressRequest:
+        {
+
+//---------------------------Power-Save-Mode-End-Updates-----------------//
+            if (timerSequenceNumber == dot11->managementSequenceNumber)
+            {
+                 MacDot11ManagementHandleTimer(
+                    node, dot11, timerType, timerSequenceNumber);
+            }
+            break;
+        }
+
+        default: {
+            ERROR_ReportError("MacDot11HandleTimer: "
+                "Unknown timer type.\n");
+            break;
+        }
+    } //switch
+}//MacDot11HandleTimer
+
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11Layer.
+//  PURPOSE:     Handle timers and layer messages.
+//  PARAMETERS:  Node* node
+//                  Node handling the incoming messages
+//               int interfaceIndex
+//                  Interface index
+//               Message* msg
+//                  Message for node to interpret.
+//  RETURN:      None.
+//  ASSUMPTION:  None.
+//--------------------------------------------------------------------------
+void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
+{
+    MacDataDot11* dot11 =
+        (MacDataDot11*)node->macData[interfaceIndex]->macVar;
+
+    // dot11s. Some Mesh/HWMP timers do not use sequence numbers.
+    //unsigned timerSequenceNumber = *(int*)(MESSAGE_ReturnInfo(msg));
+
+    switch (msg->eventType) {
+        case MSG_MAC_DOT11_TimerWheelExpired: {
+            MacDot11TimerWheelExpire(node, dot11, msg);
             break;
         }
 
@@ -3634,6 +3869,7 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
         case MSG_MAC_DOT11s_PannPropagationTimeout:
         case MSG_MAC_DOT11s_LinkStateFrameTimeout:
         case MSG_MAC_DOT11s_QueueAgingTimer:
+        case MSG_MAC_DOT11s_ChannelSwitchTimer:
         case MSG_MAC_DOT11s_HwmpActiveRouteTimeout:
         case MSG_MAC_DOT11s_HwmpDeleteRouteTimeout:
         case MSG_MAC_DOT11s_HwmpRreqReplyTimeout:
@@ -3701,56 +3937,6 @@ void MacDot11Layer(Node* node, int interfaceIndex, Message* msg)
            break;
         }
 
-        case MSG_MAC_DOT11_Probe_Delay_Timer:
-        {
-
-            unsigned timerSequenceNumber = *(int*)(MESSAGE_ReturnInfo(msg));
-
-            if (timerSequenceNumber == dot11->timerSequenceNumber)
-            {
-                DOT11_ManagementVars * mngmtVars =
-                    (DOT11_ManagementVars*) dot11->mngmtVars;
-                if (mngmtVars)
-                {
-                    mngmtVars->probeResponseRecieved = FALSE;
-                    mngmtVars->channelInfo->dwellTime =
-                                      DOT11_SHORT_SCAN_TIMER_DEFAULT;
-                }
-
-                dot11->waitForProbeDelay = FALSE;
-                printf("Calling MacDot11StationCheckForOutgoingPacket node %d \n", node->nodeId);
-                MacDot11StationCheckForOutgoingPacket(node, dot11, FALSE);
-                dot11->ActiveScanShortTimerFunctional = FALSE;
-                dot11->MayReceiveProbeResponce = FALSE;
-            }
-            MESSAGE_Free(node, msg);
-            break;
-        }
-//---------------------------Power-Save-Mode-End-Updates-----------------//
-        case MSG_MAC_DOT11_Active_Scan_Short_Timer:
-        case MSG_MAC_DOT11_Active_Scan_Long_Timer:
-        case MSG_MAC_DOT11_Management_Authentication:
-        case MSG_MAC_DOT11_Management_Association:
-        case MSG_MAC_DOT11_Management_Reassociation:
-        case MSG_MAC_DOT11_Beacon_Wait_Timer:
-        case MSG_MAC_DOT11_Authentication_Start_Timer:
-        case MSG_MAC_DOT11_Reassociation_Start_Timer:
-        case MSG_MAC_DOT11_Scan_Start_Timer:
-        case MSG_MAC_DOT11_Enable_Management_Timer:
-        case MSG_MAC_DOT11_ChanswitchRequest:
-        case MSG_MAC_DOT11_ChangeChannelRequest:
-        case MSG_MAC_DOT11_MACAddressRequest:
-        {
-            unsigned timerSequenceNumber = *(int*)(MESSAGE_ReturnInfo(msg));
-
-//---------------------------Power-Save-Mode-End-Updates-----------------//
-            if (timerSequenceNumber == dot11->managementSequenceNumber)
-            {
-                 MacDot11ManagementHandleTimeout(node, dot11,msg);
-            }
-            MESSAGE_Free(node, msg);
-            break;
-        }
 
         //SINR-based, start interference scan of each channel
         case MSG_MAC_FromAppInitiateSinrScanRequest: {
@@ -4039,6 +4225,7 @@ void MacDot11BssInit(
                     subnetList, nodesInSubnet, subnetListIndex,
                     subnetAddress, numHostBits, networkType);
             }
+            MacDot11ApPsIndexInit(dot11);
         }
         else
         {
@@ -4296,6 +4483,7 @@ void MacDot11BssDynamicInit(
                 subnetList, nodesInSubnet, subnetListIndex,
                 subnetAddress, numHostBits, networkType);
         }
+        MacDot11ApPsIndexInit(dot11);
         // Set inital state
         MacDot11StationSetState(node, dot11, DOT11_S_IDLE);
     }
@@ -4474,6 +4662,7 @@ void MacDot11IbssDynamicInit(
                 subnetList, nodesInSubnet, subnetListIndex,
                 subnetAddress, numHostBits, networkType);
         }
+        MacDot11ApPsIndexInit(dot11);
         // Set inital state
         MacDot11StationSetState(node, dot11, DOT11_S_IDLE);
     }
@@ -5144,6 +5333,105 @@ void MacDot11Init(
         dot11->chanswitchThreshold = DOT11_CHANSWITCH_THRESHOLD;
 
     }
+
+    //Determine the queue filled percentage below which the queue-fill
+    //trigger re-arms. Defaults to the threshold minus a fixed hysteresis.
+    IO_ReadDouble(
+         node->nodeId,
+         &address,
+         nodeInput,
+         "MAC-DOT11-CHANSWITCH-LOW-THRESHOLD",
+         &wasFound,
+         &aDouble);
+
+    if (wasFound) {
+        if (aDouble < 0.0 || aDouble > dot11->chanswitchThreshold) {
+            ERROR_ReportError(
+                "MAC-DOT11-CHANSWITCH-LOW-THRESHOLD must be between 0 "
+                "and MAC-DOT11-CHANSWITCH-THRESHOLD\n");
+        }
+        dot11->chanswitchLowThreshold = aDouble;
+    }
+    else {
+        dot11->chanswitchLowThreshold =
+            MAX(dot11->chanswitchThreshold - DOT11_CHANSWITCH_HYSTERESIS,
+                0.0);
+    }
+
+    //Determine how long a queue-fill trigger stays outstanding before
+    //another one may be sent while the queue is still above the threshold.
+    IO_ReadTime(
+         node->nodeId,
+         &address,
+         nodeInput,
+         "MAC-DOT11-CHANSWITCH-TRIGGER-INTERVAL",
+         &wasFound,
+         &dot11->chanswitchTriggerInterval);
+
+    if (!wasFound) {
+        dot11->chanswitchTriggerInterval = DOT11_CHANSWITCH_TRIGGER_INTERVAL;
+    }
+    else if (dot11->chanswitchTriggerInterval < 0) {
+        ERROR_ReportError(
+            "MAC-DOT11-CHANSWITCH-TRIGGER-INTERVAL should not be negative\n");
+    }
+
+    //Determine what the queue trigger looks at: the percentage of the
+    //queue filled or the head-of-line sojourn time over all priorities.
+    IO_ReadString(
+    node->nodeId,
+    &address,
+    nodeInput,
+    "MAC-DOT11-CHANSWITCH-QUEUE-METRIC",
+    &wasFound,
+    retString);
+
+    if ((!wasFound) || (strcmp(retString, "FILL") == 0))
+    {
+        dot11->chanswitchQueueMetric = DOT11_CHANSWITCH_QUEUE_METRIC_FILL;
+    }
+    else if (strcmp(retString, "SOJOURN-TIME") == 0)
+    {
+        dot11->chanswitchQueueMetric = DOT11_CHANSWITCH_QUEUE_METRIC_SOJOURN;
+    }
+    else
+    {
+        ERROR_ReportError(
+            "MAC-DOT11-CHANSWITCH-QUEUE-METRIC should be FILL or "
+            "SOJOURN-TIME\n");
+    }
+
+    IO_ReadTime(
+         node->nodeId,
+         &address,
+         nodeInput,
+         "MAC-DOT11-CHANSWITCH-SOJOURN-TARGET",
+         &wasFound,
+         &dot11->chanswitchSojournTarget);
+
+    if (!wasFound) {
+        dot11->chanswitchSojournTarget = DOT11_CHANSWITCH_SOJOURN_TARGET;
+    }
+    else if (dot11->chanswitchSojournTarget <= 0) {
+        ERROR_ReportError(
+            "MAC-DOT11-CHANSWITCH-SOJOURN-TARGET should be positive\n");
+    }
+
+    IO_ReadTime(
+         node->nodeId,
+         &address,
+         nodeInput,
+         "MAC-DOT11-CHANSWITCH-SOJOURN-INTERVAL",
+         &wasFound,
+         &dot11->chanswitchSojournInterval);
+
+    if (!wasFound) {
+        dot11->chanswitchSojournInterval = DOT11_CHANSWITCH_SOJOURN_INTERVAL;
+    }
+    else if (dot11->chanswitchSojournInterval < 0) {
+        ERROR_ReportError(
+            "MAC-DOT11-CHANSWITCH-SOJOURN-INTERVAL should not be negative\n");
+    }
 	
     //Determine when RX node looks for TX node.
     IO_ReadDouble(
@@ -5394,6 +5682,8 @@ void MacDot11Init(
         dot11->stopReceivingAfterHeaderMode = TRUE;
     }
 
+    MacDot11AmpduInit(node, dot11, nodeInput, &address);
+
     IO_ReadString(
         node->nodeId,
         &address,
@@ -5897,6 +6187,20 @@ void MacDot11PrintStats(Node* node, MacDataDot11* dot11,
            dot11->pktsDroppedDcf);
     IO_PrintStat(node, "MAC", DOT11_DCF_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
 
+    if (dot11->chanswitchTriggersSent > 0) {
+        sprintf(buf, "Queue channel switch triggers sent = %d",
+               dot11->chanswitchTriggersSent);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+
+        sprintf(buf, "Queue channel switch triggers suppressed = %d",
+               dot11->chanswitchTriggersSuppressed);
+        IO_PrintStat(node, "MAC", DOT11_MAC_STATS_LABEL, ANY_DEST, interfaceIndex, buf);
+    }
+
+    MacDot11TimerWheelPrintStats(node, dot11, interfaceIndex);
+
+    MacDot11AmpduPrintStats(node, dot11, interfaceIndex);
+
 }//MacDot11PrintStats
 
 
@@ -5974,6 +6278,9 @@ void MacDot11Finalize(
         MEM_free(entry);
     }
 
+    MacDot11AmpduFinalize(node, dot11);
+    MacDot11TimerWheelFinalize(node, dot11);
+
         if(MacDot11IsQoSEnabled(node,dot11))
         {
             for(int AcIndex =0; AcIndex<4; AcIndex++)
@@ -82,6 +82,9 @@ struct DOT11s_Data;
 // Address4 field not considered.
 #define DOT11_DATA_FRAME_HDR_SIZE           28
 
+// Compressed bitmap Block ACK, BA control included.
+#define DOT11_BLOCK_ACK_FRAME_SIZE          32
+
 // Binary expon backoff lower bound and upper bound
 #define DOT11_802_11a_CW_MIN          15
 #define DOT11_802_11a_CW_MAX          1023
@@ -168,6 +171,7 @@ struct DOT11s_Data;
 #define DOT11_CFP_REPETITION_INTERVAL_DEFAULT 1
 #define DOT11_CFP_REPETITION_INTERVAL_MAX 10
 
+// Active scan MinChannelTime and MaxChannelTime, from the probe request.
 #define DOT11_SHORT_SCAN_TIMER_DEFAULT     (6 * MILLI_SECOND)
 #define DOT11_LONG_SCAN_TIMER_DEFAULT      (24 * MILLI_SECOND)
 
@@ -177,10 +181,15 @@ struct DOT11s_Data;
 #define DOT11_RX_PROBE_BEGIN_TIME   1 * SECOND //simulation time (in seconds) to begin looking at interference
 #define DOT11_RX_SCAN_CHAN_SAMPLE_TIME (100 * MILLI_SECOND) //simulation time (in seconds) to look at interference on each channel
 #define DOT11_INTNOISE_SAMPLE_WEIGHT 0.0001 //weight to each sample in average = DOT11_RX_SCAN_INTERVAL / DOT11_RX_SCAN_CHAN_SAMPLE_TIME (hardcode cause grossness)
+#define DOT11_INTNOISE_BATCH_SIZE 64 //probe samples held in mW and converted to dB together
 #define DOT11_CHANSWITCH_MASTER FALSE
 #define DOT11_TX_CHANSWITCH_DELAY 2.0     //time (seconds) between TX node channel switch when queue is full
 #define DOT11_RX_DISCONNECT_TIMEOUT 0.5     //how often RX nodes should check to see if they've been disconnected
 #define DOT11_CHANSWITCH_THRESHOLD 75.0 //percentage of queue filled to change channels
+#define DOT11_CHANSWITCH_HYSTERESIS 25.0 //default gap (percent) between the high and low queue-fill watermarks
+#define DOT11_CHANSWITCH_TRIGGER_INTERVAL (1 * SECOND) //minimum time between two queue-fill triggers
+#define DOT11_CHANSWITCH_SOJOURN_TARGET (5 * MILLI_SECOND) //head-of-line delay above which the queue counts as congested
+#define DOT11_CHANSWITCH_SOJOURN_INTERVAL (20 * MILLI_SECOND) //how long the delay must stay above the target before a trigger
 #define DOT11_CHANSWITCH_INITIAL_DELAY 3.0 //time to stay on the initial SINR selected channel
 #define DOT11_CHANSWITCH_RX_RETURN_PREV_CHANNEL 3.0 //time when RX returns to original channel if TX cannot be found
 //---- Channel switching defines --------------------------------------//
@@ -191,6 +200,9 @@ struct DOT11s_Data;
 #define DOT11_CHANSWITCH_TRIGGER_NONE           0 //ASDCS and SINR-based - initial channel switch only
 #define DOT11_CHANSWITCH_TRIGGER_QUEUE          1 //ASDCS and SINR-based - channel switch activates when TX queue exceeds threshold
 #define DOT11_CHANSWITCH_TRIGGER_PRED_DROP      2 //ASDCS and SINR-based - channel switch based on predicted drop method
+
+#define DOT11_CHANSWITCH_QUEUE_METRIC_FILL      0 //queue trigger on percentage of priority 0 queue filled
+#define DOT11_CHANSWITCH_QUEUE_METRIC_SOJOURN   1 //queue trigger on head-of-line delay over all priorities
 //States of Next Channel
  //tx (client) states
  enum {
@@ -214,6 +226,11 @@ struct DOT11s_Data;
 #define DOT11_DTIM_PERIOD                  3
 #define DOT11_PS_IBSS_ATIM_DURATION       20
 #define DOT11_PS_SIZE_OF_MAX_PARTIAL_VIRTUAL_BITMAP 251
+// highest association ID an AP hands out, section 7.3.1.8 RFC 802.11
+#define DOT11_PS_MAX_ASSOCIATION_ID       2007
+// the Duration/ID field of a PS-Poll holds the AID with both top bits set,
+// section 7.1.3.2 RFC 802.11
+#define DOT11_PS_POLL_AID_FLAGS           0xC000
 #define DOT11_MAX_BEACON_SIZE             1024
 //---------------------------Power-Save-Mode-End-Updates-----------------//
 
@@ -512,6 +529,7 @@ typedef enum {
     //---------HCCA-UPDATES-END-----------------
 
     // Control frame types
+    DOT11_BLOCK_ACK           = 0x19, // 01 1001
     DOT11_PS_POLL             = 0x1A, // 01 1010
     DOT11_RTS                 = 0x1B, // 01 1011
     DOT11_CTS                 = 0x1C, // 01 1100
@@ -545,6 +563,9 @@ typedef enum {
 //-------------------Channel Switching----------------------------------//
 	DOT11_CHANSWITCH		  = 0x31,  // 11 0001
 
+    // Aggregate of DOT11_DATA frames (A-MPDU)
+    DOT11_AMPDU               = 0x32, // 11 0010
+
     DOT11_CF_NONE             = 0x3F  // 11 1111 Reserved
 } DOT11_MacFrameType;
 
@@ -619,6 +640,19 @@ enum {
 typedef unsigned char DOT11_PS_ElementId;
 //---------------------------Power-Save-Mode-End-Updates-----------------//
 
+// Offsets of the information elements of the management frame being
+// received, found in one pass on the first lookup. Only IDs below
+// DOT11_IE_INDEX_SIZE are indexed; of repeated IDs the first counts.
+#define DOT11_IE_INDEX_SIZE     64
+
+typedef struct {
+    const unsigned char* frame;           // frame indexed, NULL if none
+    int size;
+    int firstOffset;
+    UInt16 offset[DOT11_IE_INDEX_SIZE];   // 0 if the element is absent
+    UInt8 length[DOT11_IE_INDEX_SIZE];
+} DOT11_IeIndex;
+
 //--------------------------------------------------------------------------
 // typedef's struct
 //--------------------------------------------------------------------------
@@ -669,6 +703,150 @@ typedef struct struct_mac_dot11_data_rate_entry_t {
     struct struct_mac_dot11_data_rate_entry_t* next;
 } DOT11_DataRateEntry;
 
+//
+// Visible node table for the AP_PROBE chanswitch mode. Entries live in a
+// fixed pool and stay threaded on dot11->visibleNodeList, which is the
+// list handed to the chanswitch application. An open addressing index
+// keyed by MAC address finds an entry in O(1) from the per-frame receive
+// path. When the pool is full the least recently seen node is replaced
+// in place, so memory stays flat however many neighbours come and go.
+//
+#define DOT11_VISIBLE_NODE_MAX              64
+#define DOT11_VISIBLE_NODE_HASH_SIZE        128  // power of two, >= 2 * MAX
+#define DOT11_VISIBLE_NODE_RSS_EWMA_WEIGHT  0.125
+
+typedef struct dot11_visible_node_table_str {
+    DOT11_VisibleNodeInfo nodes[DOT11_VISIBLE_NODE_MAX];
+    short index[DOT11_VISIBLE_NODE_HASH_SIZE];  // pool slot or -1
+    int numNodes;
+    int numEvictions;
+} DOT11_VisibleNodeTable;
+
+//
+// Per-interface hierarchical timer wheel for the station timers. Level 0
+// has one slot per tick, each higher level one slot per full turn of the
+// level below; timers beyond the last level wait on an overflow list.
+// Slots only bucket the timers, a timer still fires at its exact
+// deadline: one kernel message is armed for the earliest deadline and
+// the expired timers are dispatched from it. Timers are unlinked on
+// cancel, so a cancelled timer costs neither a Message nor an event.
+//
+#define DOT11_TIMER_WHEEL_TICK_BITS     14   // 16.384 us per level 0 slot
+#define DOT11_TIMER_WHEEL_SLOT_BITS     6
+#define DOT11_TIMER_WHEEL_SLOTS         (1 << DOT11_TIMER_WHEEL_SLOT_BITS)
+#define DOT11_TIMER_WHEEL_LEVELS        3
+#define DOT11_TIMER_WHEEL_OVERFLOW      DOT11_TIMER_WHEEL_LEVELS
+#define DOT11_TIMER_WHEEL_POOL_CHUNK    16
+
+typedef struct dot11_timer_str {
+    clocktype deadline;
+    int timerType;
+    unsigned int sequenceNumber;
+    unsigned int serial;                 // set order, breaks deadline ties
+    struct dot11_timer_str** handle;     // cleared when the timer goes
+    struct dot11_timer_str* prev;
+    struct dot11_timer_str* next;
+    int level;
+    int slot;
+} DOT11_Timer;
+
+typedef struct dot11_timer_chunk_str {
+    DOT11_Timer timers[DOT11_TIMER_WHEEL_POOL_CHUNK];
+    struct dot11_timer_chunk_str* next;
+} DOT11_TimerChunk;
+
+typedef struct dot11_timer_wheel_str {
+    DOT11_Timer* slots[DOT11_TIMER_WHEEL_LEVELS][DOT11_TIMER_WHEEL_SLOTS];
+    UInt64 occupied[DOT11_TIMER_WHEEL_LEVELS];  // non-empty slot bitmap
+    DOT11_Timer* overflow;
+    clocktype currentTick;
+    DOT11_Timer* freeList;
+    DOT11_TimerChunk* chunks;            // every chunk, freed at finalize
+    unsigned int nextSerial;
+    int numTimers;
+
+    Message* kernelTimer;
+    clocktype armedTime;
+    BOOL dispatching;
+
+    int timersSet;
+    int timersCancelled;
+    int timersFired;
+    int kernelTimersSent;
+} DOT11_TimerWheel;
+
+//
+// A-MPDU aggregation. DCF unicast data frames queued for the same
+// receiver go out as one PHY frame: a DOT11_AMPDU header for the
+// addressing, then per subframe a delimiter and the data frame with its
+// own MAC header. The receiver checks each subframe against its own
+// error draw and answers with a Block ACK bitmap that starts at the
+// sequence number of the first subframe.
+//
+#define DOT11_AMPDU_MAX_SUBFRAMES           64
+#define DOT11_AMPDU_DEFAULT_MAX_LENGTH      65535
+#define DOT11_AMPDU_DEFAULT_MAX_DURATION    (4 * MILLI_SECOND)
+#define DOT11_AMPDU_SIZE_BUCKETS            7    // 1, 2, 3-4, ..., 33-64
+#define DOT11_SEQNO_MODULO                  4096
+
+// The 802.11n delimiter holds a 12 bit length, a CRC and a signature
+// byte; here its four bytes give the real and virtual lengths of the
+// subframe, so the receiver can rebuild it. Padding to a four byte
+// boundary is not modelled.
+typedef struct {
+    UInt16 mpduLength;
+    UInt16 virtualLength;
+} DOT11_AmpduDelimiter;
+
+typedef struct {
+    Message* msg;                 // data frame, dot11 header included
+    int seqNo;
+    Mac802Address ipNextHopAddr;  // for the drop notification
+    BOOL acked;
+} DOT11_AmpduSubframe;
+
+typedef struct dot11_ampdu_link_stats_str {
+    Mac802Address address;
+    int aggregatesSent;
+    int sizeCount[DOT11_AMPDU_SIZE_BUCKETS];
+    int subframesSent;
+    int subframesAcked;
+    int subframesDropped;
+    struct dot11_ampdu_link_stats_str* next;
+} DOT11_AmpduLinkStats;
+
+typedef struct dot11_ampdu_str {
+    // Outstanding aggregate. Subframe 0 is the local buffer message and
+    // stays owned by it; the others were taken from the output queue.
+    DOT11_AmpduSubframe subframe[DOT11_AMPDU_MAX_SUBFRAMES];
+    int numSubframes;
+    int numAcked;
+    Mac802Address receiverAddr;
+    DOT11_AmpduLinkStats* link;
+
+    DOT11_AmpduLinkStats* linkStatsHead;
+
+    int aggregatesReceived;
+    int subframesReceived;
+    int subframesWithErrors;
+    int duplicateSubframes;
+    int blockAcksSent;
+    int blockAcksReceived;
+} DOT11_Ampdu;
+
+// Active scan dwell statistics. Time saved is counted against dwelling
+// MaxChannelTime on every channel.
+typedef struct {
+    int numScans;
+    int channelsScanned;
+    int channelsLeftAtMinTime;
+    int channelsExtended;
+    int channelsAtMaxTime;
+    clocktype totalScanTime;
+    clocktype totalTimeSaved;
+    clocktype currentScanTimeSaved;
+} DOT11_ScanStats;
+
 // Keeps track of sequence numbers of frames.
 
 typedef struct struct_mac_dot11_seqno_entry_t {
@@ -677,6 +855,10 @@ typedef struct struct_mac_dot11_seqno_entry_t {
                       fromSeqNo: 12;
     unsigned short    padd2: 4,
                       toSeqNo:12;
+    // A-MPDU receive scoreboard: one past the highest sequence number
+    // received, and which of the 64 numbers before it were seen.
+    unsigned short    ampduWinEnd;
+    UInt64            ampduRxBitmap;
     struct struct_mac_dot11_seqno_entry_t* next;
 } DOT11_SeqNoEntry;
 
@@ -806,6 +988,21 @@ typedef struct {
 } DOT11_LongControlFrame;           //----------------------
                                     //     20        20
 
+// Block ACK frames, compressed bitmap. Bit i of the bitmap acknowledges
+// sequence number startSeqNo + i.
+typedef struct {
+                                    //  Should Be  Actually
+    UInt8             frameType;    //      -         -
+    UInt8             frameFlags;   //      2         2
+    UInt16            duration;     //      2         2
+    Mac802Address     destAddr;     //      6         6
+    Mac802Address     sourceAddr;   //      6         6
+    UInt16            startSeqNo;   //      4         2
+    UInt8             bitmap[8];    //      8         8
+    char              FCS[4];       //      4         4
+} DOT11_BlockAckFrame;              //----------------------
+                                    //     32        30
+
 // Data frame header.
 // Note: - Actual frame size need not match standard here since
 //         we use DOT11_DATA_FRAME_HDR_SIZE to determine frame size.
@@ -913,6 +1110,10 @@ typedef struct struct_mac_dot11_ApVars {
     DOT11_ApStationListItem*  prevStationItem;        // Prev polled this CFP
     DOT11_TIMFrame            timFrame;
     unsigned char              AssociationVector[DOT11_PS_SIZE_OF_MAX_PARTIAL_VIRTUAL_BITMAP];
+//---------------------------Power-Save-Mode-Updates---------------------//
+    // Associated stations by AID, for the PS-Poll lookup
+    DOT11_ApStation*    psStationByAid[DOT11_PS_MAX_ASSOCIATION_ID + 1];
+//---------------------------Power-Save-Mode-End-Updates-----------------//
 } DOT11_ApVars;
 
 typedef struct struct_mac_dot11_CFParameterSet {
@@ -943,6 +1144,41 @@ typedef struct struct_mac_dot11_PS_IBSSParameter {
 } DOT11_PS_IBSSParameter;
 
 //---------------------------Power-Save-Mode-End-Updates-----------------//
+
+// Channel Switch Announcement action frame, sections 7.3.2.20 and
+// 7.4.1.5 RFC 802.11h. The body follows a DOT11_FrameHdr. Mesh points
+// append the exact time to go, little endian, after the element.
+#define DOT11_ACTION_CATEGORY_SPECTRUM_MGMT        0
+#define DOT11_SPECTRUM_MGMT_CHANNEL_SWITCH         4
+#define DOT11_IE_ID_CHANNEL_SWITCH                 37
+#define DOT11_CHANNEL_SWITCH_ANNOUNCEMENT_SIZE     11
+
+typedef struct struct_mac_dot11_ChannelSwitchAnnouncement {
+    unsigned char         category;
+    unsigned char         actionFieldId;
+    unsigned char         elementId;
+    unsigned char         length;
+    unsigned char         switchMode;
+    unsigned char         newChannel;
+    unsigned char         switchCount;      // beacon intervals to go
+    unsigned char         switchDelay[4];   // microseconds to go, dot11s
+} DOT11_ChannelSwitchAnnouncement;
+
+// dot11s. Mesh wide channel switch. Every mesh point that hears the
+// announcement moves at the same absolute time, so peer links stay up.
+typedef struct struct_mac_dot11s_ChannelSwitch {
+    BOOL                  isPending;
+    int                   newChannel;
+    clocktype             switchTime;
+    Message*              timerMsg;
+    int                   switchCount;      // configured countdown
+
+    int                   proposals;
+    int                   announcementsSent;
+    int                   announcementsReceived;
+    int                   conflictsIgnored;
+    int                   switches;
+} DOT11s_ChannelSwitch;
 // /**
 // STRUCT      :: DOT11e_CapabilityInfo
 // DESCRIPTION :: Structure to hold capability related information of 802.11e
@@ -1454,6 +1690,15 @@ struct MacDataDot11 {
     clocktype lastBOTimeStamp;
 
     unsigned int timerSequenceNumber;
+    // Pending timers in the timer wheel: MSG_MAC_TimerExpired or probe
+    // delay, then one per separately checked timer. Channel switch and
+    // ATIM window timers have no handle and may be pending together.
+    DOT11_Timer* stationTimer;
+    DOT11_Timer* beaconTimer;
+    DOT11_Timer* awakeTimer;
+    DOT11_Timer* cfpEndTimer;
+    DOT11_Timer* managementTimer;
+    DOT11_TimerWheel* timerWheel;
 
     char PartialFrame[MAX_NW_PKT_SIZE];
 
@@ -1467,6 +1712,14 @@ struct MacDataDot11 {
     int directionalShortRetryLimit;
     BOOL stopReceivingAfterHeaderMode;
     int rtsThreshold;
+
+    // A-MPDU aggregation
+    BOOL ampduEnabled;
+    int ampduMaxLength;
+    clocktype ampduMaxDuration;
+    int ampduMaxSubframes;
+    DOT11_Ampdu* ampdu;
+
     int SSRC;
     int SLRC;
     Mac802Address waitingForAckOrCtsFromAddress;
@@ -1767,10 +2020,18 @@ struct MacDataDot11 {
     LinkedList* mgmtQueue;
     LinkedList* dataQueue;
     DOT11s_FrameInfo* txFrameInfo;
+    DOT11s_ChannelSwitch meshChanSwitch;
 
     LinkedList* mngmtQueue;             //use these in Dot11 Management
     BOOL ActiveScanShortTimerFunctional;
     BOOL MayReceiveProbeResponce;
+    // Active scan MinChannelTime; MaxChannelTime is the long scan timer
+    // of the management variables.
+    clocktype scanMinChannelTime;
+    clocktype scanChannelStartTime;
+    DOT11_ScanStats scanStats;
+    // Information elements of the frame being received
+    DOT11_IeIndex rxIeIndex;
     BOOL managementFrameDequeued;
     DOT11_FrameInfo* dot11TxFrameInfo;
     BOOL mgmtSendResponse;
@@ -1797,6 +2058,26 @@ struct MacDataDot11 {
     BOOL chanswitchAfterStart;
     //determine the percentage of queue fill when we switch packets
     double chanswitchThreshold;
+    //queue fill (percent) below which the queue-fill trigger re-arms
+    double chanswitchLowThreshold;
+    //fill percentage or head-of-line sojourn time
+    int chanswitchQueueMetric;
+    clocktype chanswitchSojournTarget;
+    clocktype chanswitchSojournInterval;
+    //time at which a sojourn continuously above target becomes congestion
+    clocktype chanswitchSojournAboveTime;
+    //time after which a pending queue-fill trigger re-arms anyway
+    clocktype chanswitchTriggerInterval;
+    //TRUE from a queue trigger until it re-arms (one outstanding request)
+    BOOL chanswitchTriggerPending;
+    clocktype chanswitchLastTriggerTime;
+    //queue triggers sent and suppressed while one was pending
+    int chanswitchTriggersSent;
+    int chanswitchTriggersSuppressed;
+    //IP layer timer re-checking the queue trigger while the queue is busy
+    Message* chanswitchQueueTimer;
+    //simple switch requested from a MAC dequeue, sent from the timer
+    BOOL chanswitchQueueRequestDeferred;
     //determine time in seconds when RX node should look for TX node
     double chanswitchRxDisconnectProbe;
     //determine how long TX should wait on new channel
@@ -1807,6 +2088,8 @@ struct MacDataDot11 {
     double chanswitchRxReturnPrevChannel;
     //AP active probing method
     DOT11_VisibleNodeInfo* visibleNodeList;
+    //hash index and storage behind visibleNodeList
+    DOT11_VisibleNodeTable* visibleNodeTable;
     //remember if TX or RX for active probing
     int appType;
     //connection id for app layer
@@ -1820,6 +2103,10 @@ struct MacDataDot11 {
     BOOL firstScan; //true if ASDCS first scan
     //sinr-based only - signal strength of other node (TX/RX). this would break if TX or RX were getting unicast pkts from anywhere else
     double pairRss; 
+    //sinr-based only - probe samples (mW) not yet added to avg_intnoise_dB
+    double intnoiseSamples_mW[DOT11_INTNOISE_BATCH_SIZE];
+    int numIntnoiseSamples;
+    int intnoiseSampleChannel;
     BOOL      is_rx;               //true if this node is the RX node (Next Channel only)
     int simple_state;   //state for Next Channel chanswitch mode
     BOOL first_pkt; //used by Next Channel RX node - start RX probe if this is the first packet
@@ -1872,6 +2159,63 @@ void MacDot11DeleteAssociationId(Node* node,
      MacDataDot11* dot11,
      DOT11_ApStationListItem* stationItem);
 
+//---------------------------Power-Save-Mode-Updates---------------------//
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsIndexInit
+//  PURPOSE:     Clear the AID indexed station table.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//  RETURN:      None
+//  ASSUMPTION:  apVars has been allocated.
+//--------------------------------------------------------------------------
+void MacDot11ApPsIndexInit(MacDataDot11* dot11);
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsAddStation
+//  PURPOSE:     Enter a newly associated station in the AID table.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               Mac802Address address
+//                  Address of the station
+//  RETURN:      None
+//  ASSUMPTION:  The station is already in the AP station list.
+//--------------------------------------------------------------------------
+void MacDot11ApPsAddStation(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address address);
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsRemoveStation
+//  PURPOSE:     Drop a station from the AID table.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               DOT11_ApStation* station
+//                  Station being removed
+//  RETURN:      None
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+void MacDot11ApPsRemoveStation(
+    MacDataDot11* dot11,
+    DOT11_ApStation* station);
+
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11ApPsGetStation
+//  PURPOSE:     Look up an associated station by its AID.
+//  PARAMETERS:  MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int assocId
+//                  Association ID of the station
+//  RETURN:      Station, or NULL if no station holds this AID
+//  ASSUMPTION:  None
+//--------------------------------------------------------------------------
+DOT11_ApStation* MacDot11ApPsGetStation(
+    MacDataDot11* dot11,
+    int assocId);
+//---------------------------Power-Save-Mode-End-Updates-----------------//
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11Trace
 //  PURPOSE:     Common entry routine for trace.
@@ -2470,6 +2814,301 @@ void MacDot11DataQueue_Finalize(
     Node* node,
     MacDataDot11* dot11);
 
+/**
+FUNCTION   :: MacDot11TimerWheelSet
+LAYER      :: MAC
+PURPOSE    :: Add a timer to the interface timer wheel and make sure the
+              kernel timer is armed for the earliest deadline.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ timerDelay : clocktype    : delay until the timer fires
++ timerType : int           : timer type given to MacDot11HandleTimer
++ sequenceNumber : unsigned int : sequence number given to
+                              MacDot11HandleTimer
++ handle    : DOT11_Timer** : set to the timer, cleared when it fires or
+                              is cancelled. May be NULL.
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelSet(
+    Node* node,
+    MacDataDot11* dot11,
+    clocktype timerDelay,
+    int timerType,
+    unsigned int sequenceNumber,
+    DOT11_Timer** handle);
+
+/**
+FUNCTION   :: MacDot11TimerWheelCancel
+LAYER      :: MAC
+PURPOSE    :: Remove a pending timer from the timer wheel. Does nothing
+              if the handle is NULL.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ handle    : DOT11_Timer** : handle given to MacDot11TimerWheelSet
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelCancel(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11_Timer** handle);
+
+/**
+FUNCTION   :: MacDot11TimerWheelExpire
+LAYER      :: MAC
+PURPOSE    :: Handle the kernel timer of the timer wheel: deliver every
+              timer whose deadline has passed to MacDot11HandleTimer, in
+              deadline order, then re-arm for the next deadline.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : the kernel timer message, freed here
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelExpire(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+/**
+FUNCTION   :: MacDot11TimerWheelPrintStats
+LAYER      :: MAC
+PURPOSE    :: Print the timer wheel counters.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ interfaceIndex : int      : interface index
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelPrintStats(
+    Node* node,
+    MacDataDot11* dot11,
+    int interfaceIndex);
+
+/**
+FUNCTION   :: MacDot11TimerWheelFinalize
+LAYER      :: MAC
+PURPOSE    :: Free the timer wheel and its timer pool.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+void MacDot11TimerWheelFinalize(
+    Node* node,
+    MacDataDot11* dot11);
+
+/**
+FUNCTION   :: MacDot11HandleTimer
+LAYER      :: MAC
+PURPOSE    :: Handle a station timer fired by the timer wheel.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ timerType : int           : event type the timer was set with
++ timerSequenceNumber : unsigned int : sequence number the timer was
+                              set with
+RETURN     :: void
+**/
+
+void MacDot11HandleTimer(
+    Node* node,
+    MacDataDot11* dot11,
+    int timerType,
+    unsigned int timerSequenceNumber);
+
+/**
+FUNCTION   :: MacDot11AmpduInit
+LAYER      :: MAC
+PURPOSE    :: Read the A-MPDU parameters and allocate the aggregation
+              state when aggregation is enabled.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ nodeInput : const NodeInput* : pointer to user configuration data
++ address   : Address*      : address of the interface
+RETURN     :: void
+**/
+
+void MacDot11AmpduInit(
+    Node* node,
+    MacDataDot11* dot11,
+    const NodeInput* nodeInput,
+    Address* address);
+
+/**
+FUNCTION   :: MacDot11AmpduExchangeActive
+LAYER      :: MAC
+PURPOSE    :: Whether the frame in the local buffer went out as part of
+              an aggregate that is not fully acknowledged yet.
+PARAMETERS ::
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: BOOL          : TRUE if a Block ACK is expected
+**/
+
+BOOL MacDot11AmpduExchangeActive(
+    MacDataDot11* dot11);
+
+/**
+FUNCTION   :: MacDot11AmpduBuildFrame
+LAYER      :: MAC
+PURPOSE    :: Turn the outgoing data frame into an A-MPDU. A first
+              attempt adds the frames queued behind it for the same
+              receiver, up to the configured length, duration and
+              subframe limits; a retry resends the subframes that are
+              not acknowledged yet. A frame that does not qualify, or
+              finds nothing to aggregate with, is returned unchanged.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ frame     : Message*      : copy of the local buffer frame, with its
+                              sequence number and duration set
++ dataRateType : int        : transmit data rate type
+RETURN     :: Message*      : frame to hand to the PHY
+**/
+
+Message* MacDot11AmpduBuildFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* frame,
+    int dataRateType);
+
+/**
+FUNCTION   :: MacDot11AmpduReceiveFrame
+LAYER      :: MAC
+PURPOSE    :: Receive an A-MPDU addressed to this station: decide which
+              subframes survived the channel, hand the new ones to the
+              upper layer and answer with a Block ACK.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : the aggregate, freed here
+RETURN     :: void
+**/
+
+void MacDot11AmpduReceiveFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+/**
+FUNCTION   :: MacDot11AmpduProcessBlockAck
+LAYER      :: MAC
+PURPOSE    :: Apply a Block ACK to the outstanding aggregate. Completes
+              the exchange when every subframe is acknowledged,
+              otherwise schedules a retry of the rest.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : the Block ACK, not freed here
+RETURN     :: void
+**/
+
+void MacDot11AmpduProcessBlockAck(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+/**
+FUNCTION   :: MacDot11AmpduCheckSeqNo
+LAYER      :: MAC
+PURPOSE    :: Duplicate check of a received data frame against the
+              receive scoreboard of its sender, which tolerates the
+              gaps and reordering that aggregate retries cause.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ sourceAddr : Mac802Address : transmitter of the frame
++ seqNo     : int           : sequence number of the frame
+RETURN     :: BOOL          : TRUE if the frame was not seen before
+**/
+
+BOOL MacDot11AmpduCheckSeqNo(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address sourceAddr,
+    int seqNo);
+
+/**
+FUNCTION   :: MacDot11AmpduDropExchange
+LAYER      :: MAC
+PURPOSE    :: Give up on the outstanding aggregate once the retry limit
+              is reached. The unacknowledged subframes taken from the
+              output queue are dropped; the local buffer frame is left
+              to the caller.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: BOOL          : TRUE if an earlier Block ACK acknowledged
+                              the local buffer frame. The caller then
+                              completes it as acknowledged, which steps
+                              the sequence number past it.
+**/
+
+BOOL MacDot11AmpduDropExchange(
+    Node* node,
+    MacDataDot11* dot11);
+
+/**
+FUNCTION   :: MacDot11AmpduPrintStats
+LAYER      :: MAC
+PURPOSE    :: Print the aggregation counters and, per receiver, the
+              distribution of aggregate sizes.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ interfaceIndex : int      : interface index
+RETURN     :: void
+**/
+
+void MacDot11AmpduPrintStats(
+    Node* node,
+    MacDataDot11* dot11,
+    int interfaceIndex);
+
+/**
+FUNCTION   :: MacDot11IeIndexFind
+LAYER      :: MAC
+PURPOSE    :: Look up an information element of a received management
+              frame. The frame is indexed on the first lookup; further
+              lookups in the same frame read the index.
+PARAMETERS ::
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : received frame
++ fixedSize : int           : size of the frame before the first element
++ elementId : DOT11_PS_ElementId : element to look up
++ offset    : int*          : offset of the element in the frame, may be
+                              NULL
+RETURN     :: unsigned char* : the element header, NULL if absent
+**/
+
+unsigned char* MacDot11IeIndexFind(
+    MacDataDot11* dot11,
+    Message* msg,
+    int fixedSize,
+    DOT11_PS_ElementId elementId,
+    int* offset = NULL);
+
+/**
+FUNCTION   :: MacDot11AmpduFinalize
+LAYER      :: MAC
+PURPOSE    :: Free the aggregation state.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+void MacDot11AmpduFinalize(
+    Node* node,
+    MacDataDot11* dot11);
+
 /**
 FUNCTION   :: MacDot11ReceiveNetworkLayerPacket
 LAYER      :: MAC
@@ -3003,6 +3642,40 @@ void MacDot11SendChanSwitchPacket(
     Node* node,
     MacDataDot11* dot11);
 
+//--------------------------------------------------------------------------
+//  NAME:        MacDot11SetOperatingChannel
+//  PURPOSE:     Move transmission and listening to another channel.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int newChannel
+//                  Channel to move to
+//  RETURN:      Previous transmission channel
+//  ASSUMPTION:  The MAC is not in a frame exchange.
+//--------------------------------------------------------------------------
+int MacDot11SetOperatingChannel(
+    Node* node,
+    MacDataDot11* dot11,
+    int newChannel);
+
+//--------------------------------------------------------------------------
+//  NAME:        Dot11s_ProposeChannelSwitch
+//  PURPOSE:     dot11s. Announce a mesh wide move to another channel.
+//  PARAMETERS:  Node* node
+//                  Pointer to node
+//               MacDataDot11* dot11
+//                  Pointer to Dot11 structure
+//               int newChannel
+//                  Proposed channel
+//  RETURN:      None
+//  ASSUMPTION:  dot11->isMP is TRUE.
+//--------------------------------------------------------------------------
+void Dot11s_ProposeChannelSwitch(
+    Node* node,
+    MacDataDot11* dot11,
+    int newChannel);
+
 //--------------------------------------------------------------------------
 //  NAME:        MacDot11HandleSinrProbeChanSwitch
 //  PURPOSE:     Called when SinrProbeSampleTime timer expires
@@ -0,0 +1,311 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file mac_dot11s-index.h
+ * \brief Address index of the 802.11s mesh tables.
+ *
+ * An open addressing hash table, linear probing, from one or two MAC
+ * addresses to the list item that holds the table entry.
+ */
+
+#ifndef MAC_DOT11S_INDEX_H
+#define MAC_DOT11S_INDEX_H
+
+#include <string.h>
+
+#include "api.h"
+
+// Initial slot count of an address index; a power of 2.
+#define DOT11s_ADDR_INDEX_SIZE 16
+
+struct DOT11s_AddrKey
+{
+    Mac802Address addr1;
+    Mac802Address addr2;
+};
+
+struct DOT11s_AddrIndexSlot
+{
+    DOT11s_AddrKey key;
+    ListItem* listItem;         // NULL if the slot is empty
+};
+
+struct DOT11s_AddrIndex
+{
+    DOT11s_AddrIndexSlot* slots;
+    unsigned int numSlots;
+    int numKeys;
+};
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Key
+LAYER      :: MAC
+PURPOSE    :: Build an index key of one or two addresses.
+PARAMETERS ::
++ addr1     : Mac802Address : first address
++ addr2     : Mac802Address : second address, left invalid for
+                                tables keyed on a single address
+RETURN     :: DOT11s_AddrKey : key
+**/
+
+static
+DOT11s_AddrKey Dot11sAddrIndex_Key(
+    Mac802Address addr1,
+    Mac802Address addr2 = Mac802Address())
+{
+    DOT11s_AddrKey key;
+    key.addr1 = addr1;
+    key.addr2 = addr2;
+    return key;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Hash
+LAYER      :: MAC
+PURPOSE    :: Hash an index key.
+PARAMETERS ::
++ key       : const DOT11s_AddrKey& : key
+RETURN     :: unsigned int  : hash value
+NOTES      :: FNV-1a; the byte sum of Mac802Address::hash() clusters
+                badly for the sequential addresses QualNet hands out.
+**/
+
+static
+unsigned int Dot11sAddrIndex_Hash(
+    const DOT11s_AddrKey& key)
+{
+    unsigned int hash = 2166136261U;
+    int i;
+
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++)
+    {
+        hash = (hash ^ key.addr1.byte[i]) * 16777619U;
+    }
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++)
+    {
+        hash = (hash ^ key.addr2.byte[i]) * 16777619U;
+    }
+
+    return hash;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Init
+LAYER      :: MAC
+PURPOSE    :: Allocate an empty address index.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex** : index to allocate
+RETURN     :: void
+**/
+
+static
+void Dot11sAddrIndex_Init(
+    DOT11s_AddrIndex** index)
+{
+    DOT11s_AddrIndex* newIndex =
+        (DOT11s_AddrIndex*) MEM_malloc(sizeof(DOT11s_AddrIndex));
+    memset(newIndex, 0, sizeof(DOT11s_AddrIndex));
+
+    newIndex->numSlots = DOT11s_ADDR_INDEX_SIZE;
+    newIndex->slots = (DOT11s_AddrIndexSlot*)
+        MEM_malloc(newIndex->numSlots * sizeof(DOT11s_AddrIndexSlot));
+    memset(newIndex->slots, 0,
+        newIndex->numSlots * sizeof(DOT11s_AddrIndexSlot));
+
+    *index = newIndex;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Free
+LAYER      :: MAC
+PURPOSE    :: Free an address index. The list items it refers to
+                are not touched.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex* : index to free
+RETURN     :: void
+**/
+
+static
+void Dot11sAddrIndex_Free(
+    DOT11s_AddrIndex* index)
+{
+    if (index == NULL)
+    {
+        return;
+    }
+
+    MEM_free(index->slots);
+    MEM_free(index);
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_FindSlot
+LAYER      :: MAC
+PURPOSE    :: Find the slot holding a key, or the empty slot where
+                it would be inserted.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex* : address index
++ key       : const DOT11s_AddrKey& : key
+RETURN     :: unsigned int  : slot
+**/
+
+static
+unsigned int Dot11sAddrIndex_FindSlot(
+    DOT11s_AddrIndex* index,
+    const DOT11s_AddrKey& key)
+{
+    const unsigned int mask = index->numSlots - 1;
+    unsigned int slot = Dot11sAddrIndex_Hash(key) & mask;
+
+    // The index is never more than half full, so this terminates.
+    while (index->slots[slot].listItem != NULL
+           && !(index->slots[slot].key.addr1 == key.addr1
+                && index->slots[slot].key.addr2 == key.addr2))
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Lookup
+LAYER      :: MAC
+PURPOSE    :: Find the list item of a key.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex* : address index
++ key       : const DOT11s_AddrKey& : key
+RETURN     :: ListItem*     : list item or NULL
+**/
+
+static
+ListItem* Dot11sAddrIndex_Lookup(
+    DOT11s_AddrIndex* index,
+    const DOT11s_AddrKey& key)
+{
+    return index->slots[Dot11sAddrIndex_FindSlot(index, key)].listItem;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Insert
+LAYER      :: MAC
+PURPOSE    :: Index a list item under a key. The slot table doubles
+                before it gets more than half full.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex* : address index
++ key       : const DOT11s_AddrKey& : key, not yet in the index
++ listItem  : ListItem*     : list item
+RETURN     :: void
+**/
+
+static
+void Dot11sAddrIndex_Insert(
+    DOT11s_AddrIndex* index,
+    const DOT11s_AddrKey& key,
+    ListItem* listItem)
+{
+    if ((unsigned int) (index->numKeys + 1) * 2 > index->numSlots)
+    {
+        DOT11s_AddrIndexSlot* oldSlots = index->slots;
+        unsigned int oldNumSlots = index->numSlots;
+        unsigned int i;
+
+        index->numSlots = oldNumSlots * 2;
+        index->slots = (DOT11s_AddrIndexSlot*)
+            MEM_malloc(index->numSlots * sizeof(DOT11s_AddrIndexSlot));
+        memset(index->slots, 0,
+            index->numSlots * sizeof(DOT11s_AddrIndexSlot));
+
+        for (i = 0; i < oldNumSlots; i++)
+        {
+            if (oldSlots[i].listItem != NULL)
+            {
+                index->slots[Dot11sAddrIndex_FindSlot(
+                    index, oldSlots[i].key)] = oldSlots[i];
+            }
+        }
+
+        MEM_free(oldSlots);
+    }
+
+    unsigned int slot = Dot11sAddrIndex_FindSlot(index, key);
+    ERROR_Assert(index->slots[slot].listItem == NULL,
+        "Dot11sAddrIndex_Insert: Key is already indexed.\n");
+
+    index->slots[slot].key = key;
+    index->slots[slot].listItem = listItem;
+    index->numKeys++;
+}
+
+
+/**
+FUNCTION   :: Dot11sAddrIndex_Remove
+LAYER      :: MAC
+PURPOSE    :: Remove a key from the index. Later entries of the probe
+                run are shifted back so lookups need no tombstones.
+PARAMETERS ::
++ index     : DOT11s_AddrIndex* : address index
++ key       : const DOT11s_AddrKey& : key
+RETURN     :: void
+**/
+
+static
+void Dot11sAddrIndex_Remove(
+    DOT11s_AddrIndex* index,
+    const DOT11s_AddrKey& key)
+{
+    const unsigned int mask = index->numSlots - 1;
+    unsigned int slot = Dot11sAddrIndex_FindSlot(index, key);
+    unsigned int next = slot;
+
+    if (index->slots[slot].listItem == NULL)
+    {
+        return;
+    }
+
+    while (TRUE)
+    {
+        next = (next + 1) & mask;
+        if (index->slots[next].listItem == NULL)
+        {
+            break;
+        }
+
+        // Move the entry back unless its home lies cyclically in
+        // (slot, next], where it is still reachable without the move.
+        unsigned int home =
+            Dot11sAddrIndex_Hash(index->slots[next].key) & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            index->slots[slot] = index->slots[next];
+            slot = next;
+        }
+    }
+
+    index->slots[slot].listItem = NULL;
+    index->numKeys--;
+}
+
+#endif // MAC_DOT11S_INDEX_H
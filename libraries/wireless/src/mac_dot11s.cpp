@@ -31,11 +31,24 @@
 #include "mac_dot11s-frames.h"
 #include "mac_dot11s-hwmp.h"
 #include "mac_dot11s.h"
+#include "mac_dot11s-index.h"
 
 
 // Enable for debug trace.
 #define DOT11s_TraceComments 0
 
+// Weight of the latest transmit outcome in a neighbor's PER estimate.
+#define DOT11s_PER_EWMA_WEIGHT 0.125f
+
+// Initial hash table size of the data seen set; a power of 2.
+#define DOT11s_DATA_SEEN_HASH_SIZE 256
+
+// Beacon intervals between a channel switch proposal and the switch.
+#define DOT11s_CHANNEL_SWITCH_COUNT_DEFAULT 5
+
+// Recheck interval while a frame exchange delays a channel switch.
+#define DOT11s_CHANNEL_SWITCH_RETRY_DELAY   (100 * MICRO_SECOND)
+
 static
 void Dot11sAssoc_SetState(
     Node* node,
@@ -1332,382 +1345,954 @@ void Dot11s_SetNeighborState(
 
 
 /**
-FUNCTION   :: Dot11sNeighborList_Lookup
+FUNCTION   :: Dot11s_UpdatePerEstimate
 LAYER      :: MAC
-PURPOSE    :: Search Neighbor list for an address.
+PURPOSE    :: Fold the outcome of one transmit to a neighbor into its
+                exponentially weighted PER estimate.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-+ neighborAddr : Mac802Address : address to be looked up
-RETURN     :: DOT11s_NeighborItem* : neighbor item or NULL
++ neighborItem : DOT11s_NeighborItem* : Pointer to neighbor item
++ isFailure : BOOL          : TRUE if the frame was not acknowledged
+RETURN     :: void
 **/
 
 static
-DOT11s_NeighborItem* Dot11sNeighborList_Lookup(
-    Node* node,
-    MacDataDot11* dot11,
-    Mac802Address neighborAddr)
+void Dot11s_UpdatePerEstimate(
+    DOT11s_NeighborItem* neighborItem,
+    BOOL isFailure)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* neighborList = mp->neighborList;
-
-    ListItem* listItem = neighborList->first;
-    DOT11s_NeighborItem* neighborItem = NULL;
-    BOOL isNeighborFound = FALSE;
-
-    while (listItem != NULL)
-    {
-        neighborItem = (DOT11s_NeighborItem*) listItem->data;
-        if (neighborItem->neighborAddr == neighborAddr)
-        {
-            isNeighborFound = TRUE;
-            break;
-        }
-        listItem = listItem->next;
-    }
+    float sample = isFailure ? 1.0f : 0.0f;
 
-    return (isNeighborFound ? neighborItem : NULL);
+    neighborItem->perEstimate +=
+        DOT11s_PER_EWMA_WEIGHT * (sample - neighborItem->perEstimate);
 }
 
 
 /**
-FUNCTION   :: Dot11sNeighborList_Finalize
+FUNCTION   :: Dot11s_SetLinkMetricInputs
 LAYER      :: MAC
-PURPOSE    :: Free neighbor list and contained items.
+PURPOSE    :: Set the data rate and PER the link metric of a neighbor
+                is computed from. The cached metric is invalidated only
+                if one of them actually changes.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ neighborItem : DOT11s_NeighborItem* : Pointer to neighbor item
++ dataRateInMbps : int      : current data rate to the neighbor
++ PER       : float         : packet error rate [0, 1)
 RETURN     :: void
 **/
 
 static
-void Dot11sNeighborList_Finalize(
-    Node* node,
-    MacDataDot11* dot11)
+void Dot11s_SetLinkMetricInputs(
+    DOT11s_NeighborItem* neighborItem,
+    int dataRateInMbps,
+    float PER)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* neighborList = mp->neighborList;
-
-    if (neighborList == NULL)
+    if (neighborItem->dataRateInMbps != dataRateInMbps
+        || neighborItem->PER != PER)
     {
-        return;
+        neighborItem->dataRateInMbps = dataRateInMbps;
+        neighborItem->PER = PER;
+        neighborItem->isLinkMetricValid = FALSE;
     }
+}
 
-    if (DOT11s_TraceComments)
-    {
-        char traceStr[MAX_STRING_LENGTH];
-        sprintf(traceStr, "Dot11sNeighborList_Finalize: "
-            "Freed %d items",
-            ListGetSize(node, neighborList));
-        MacDot11Trace(node, dot11, NULL, traceStr);
-    }
 
-    ListFree(node, neighborList, FALSE);
-}
+// ------------------------------------------------------------------
+// Item pools
+//
+// Neighbor, proxy, forwarding and data seen items are allocated from
+// per node slab pools, one per item type. A slab holds a fixed number
+// of items; freed items go on the pool's free list and are handed out
+// again before a new slab is allocated. Slabs are only released at
+// finalization. Items in a pool must not be freed with MEM_free, so
+// lists holding them are cleared with Dot11sSlabPool_ListFree.
+
+// Items per slab
+#define DOT11s_SLAB_POOL_ITEMS_PER_SLAB 64
+
+// Alignment of items within a slab
+#define DOT11s_SLAB_POOL_ALIGNMENT      8
+
+struct DOT11s_Slab
+{
+    DOT11s_Slab* next;
+};
+
+struct DOT11s_SlabPool
+{
+    const char* name;
+    size_t itemSize;
+    size_t itemOffset;          // offset of the first item in a slab
+
+    DOT11s_Slab* slabList;
+    void* freeList;
+
+    // Freed items are pushed on the free list above the items of the
+    // last slab that were never handed out, so the first numFreed
+    // items on the list are the ones allocated before.
+    int numFreed;
+
+    int numSlabs;
+    int numInUse;
+    int peakInUse;
+    int numAllocs;
+    int numFrees;
+    int numReuses;
+};
+
+struct DOT11s_ItemPools
+{
+    DOT11s_SlabPool neighborPool;
+    DOT11s_SlabPool proxyPool;
+    DOT11s_SlabPool fwdPool;
+    DOT11s_SlabPool dataSeenPool;
+};
 
 
 /**
-FUNCTION   :: Dot11s_IsAssociatedNeighbor
+FUNCTION   :: Dot11sSlabPool_Init
 LAYER      :: MAC
-PURPOSE    :: Check if neighbor is associated.
+PURPOSE    :: Initialize an empty pool for items of a given size.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-+ neighborAddr : Mac802Address : neighbor address to check for association.
-RETURN     :: BOOL          : TRUE if neighbor is associated.
-NOTES      :: Assumes neighbor is associated as well as in UP state.
++ pool      : DOT11s_SlabPool* : pool
++ name      : const char*   : item name used in statistics
++ itemSize  : size_t        : size of an item
+RETURN     :: void
 **/
 
 static
-BOOL Dot11s_IsAssociatedNeighbor(
-    Node* node,
-    MacDataDot11* dot11,
-    Mac802Address neighborAddr)
+void Dot11sSlabPool_Init(
+    DOT11s_SlabPool* pool,
+    const char* name,
+    size_t itemSize)
 {
-    DOT11s_NeighborItem* neighborItem =
-        Dot11sNeighborList_Lookup(node, dot11, neighborAddr);
+    const size_t alignMask = DOT11s_SLAB_POOL_ALIGNMENT - 1;
 
-    if (neighborItem == NULL)
+    // A free item holds the free list link.
+    if (itemSize < sizeof(void*))
     {
-        return FALSE;
-    }
-    if (neighborItem->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
-        || neighborItem->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
-    {
-        return TRUE;
+        itemSize = sizeof(void*);
     }
-    return FALSE;
+
+    memset(pool, 0, sizeof(DOT11s_SlabPool));
+    pool->name = name;
+    pool->itemSize = (itemSize + alignMask) & ~alignMask;
+    pool->itemOffset = (sizeof(DOT11s_Slab) + alignMask) & ~alignMask;
 }
 
 
 /**
-FUNCTION   :: Dot11sPortalList_AgeItems
+FUNCTION   :: Dot11sSlabPool_Alloc
 LAYER      :: MAC
-PURPOSE    :: Mark portals as inactive if portal active time has
-                elapsed since the last PANN was received.
+PURPOSE    :: Get a zeroed item from a pool.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-RETURN     :: void
++ pool      : DOT11s_SlabPool* : pool
+RETURN     :: void*         : item
 **/
 
 static
-void Dot11sNeighborList_AgeItems(
-    Node* node,
-    MacDataDot11* dot11)
+void* Dot11sSlabPool_Alloc(
+    DOT11s_SlabPool* pool)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* neighborList = mp->neighborList;
-
-    clocktype agingTime = getSimTime(node) - DOT11s_ASSOC_ACTIVE_TIMEOUT;
-    if (agingTime < 0)
-    {
-        return;
-    }
-
-    ListItem* listItem = neighborList->first;
-    DOT11s_NeighborItem* neighborItem = NULL;
-    BOOL ageItem;
-
-    while (listItem != NULL)
+    if (pool->freeList == NULL)
     {
-        ageItem = FALSE;
+        DOT11s_Slab* slab = (DOT11s_Slab*) MEM_malloc(pool->itemOffset
+            + DOT11s_SLAB_POOL_ITEMS_PER_SLAB * pool->itemSize);
+        slab->next = pool->slabList;
+        pool->slabList = slab;
+        pool->numSlabs++;
 
-        neighborItem = (DOT11s_NeighborItem*) listItem->data;
-        if ((neighborItem->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
-                || neighborItem->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
-            && neighborItem->lastLinkStateTime < agingTime)
+        // Thread the new items on the free list, first item at the head.
+        char* item = (char*) slab + pool->itemOffset
+            + (DOT11s_SLAB_POOL_ITEMS_PER_SLAB - 1) * pool->itemSize;
+        int i;
+        for (i = 0; i < DOT11s_SLAB_POOL_ITEMS_PER_SLAB; i++)
         {
-            ageItem = TRUE;
+            *(void**) item = pool->freeList;
+            pool->freeList = item;
+            item -= pool->itemSize;
         }
+    }
 
-        if (DOT11s_TraceComments)
-        {
-            //char traceStr[MAX_STRING_LENGTH];
-            //char neighborStr[MAX_STRING_LENGTH];
-            //Dot11s_AddrAsDotIP(neighborStr, neighborItem->neighborAddr);
-            //sprintf(traceStr, "Dot11sNeighborList_AgeItems: "
-            //    "Neighbor %s, state %d", neighborStr, neighborItem->state);
-            //MacDot11Trace(node, dot11, NULL, traceStr);
-        }
+    void* item = pool->freeList;
+    pool->freeList = *(void**) item;
+    memset(item, 0, pool->itemSize);
 
-        if (ageItem)
-        {
-            if (DOT11s_TraceComments)
-            {
-                char traceStr[MAX_STRING_LENGTH];
-                char neighborStr[MAX_STRING_LENGTH];
-                Dot11s_AddrAsDotIP(neighborStr, &neighborItem->neighborAddr);
-                sprintf(traceStr, "Dot11sNeighborList_AgeItems: "
-                    "Closing link with %s ", neighborStr);
-                MacDot11Trace(node, dot11, NULL, traceStr);
-            }
+    if (pool->numFreed > 0)
+    {
+        pool->numFreed--;
+        pool->numReuses++;
+    }
 
-            mp->assocStateData.event = DOT11s_ASSOC_S_EVENT_CANCEL_LINK;
-            mp->assocStateData.neighborItem = neighborItem;
-            neighborItem->assocStateFn(node, dot11, mp);
-        }
-        listItem = listItem->next;
+    pool->numAllocs++;
+    pool->numInUse++;
+    if (pool->numInUse > pool->peakInUse)
+    {
+        pool->peakInUse = pool->numInUse;
     }
+
+    return item;
 }
 
 
 /**
-FUNCTION   :: Dot11s_GetAssociatedNeighborCount
+FUNCTION   :: Dot11sSlabPool_Free
 LAYER      :: MAC
-PURPOSE    :: Get count of associated neighbors.
+PURPOSE    :: Return an item to its pool.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-+ neighborAddr : Mac802Address : neighbor address to check for association.
-RETURN     :: int           : count of associated neighbors.
-NOTES      :: Neighbor is both associated as well as in UP state.
++ pool      : DOT11s_SlabPool* : pool
++ item      : void*         : item allocated from the pool
+RETURN     :: void
 **/
 
-int Dot11s_GetAssociatedNeighborCount(
-    Node* node,
-    MacDataDot11* dot11)
+static
+void Dot11sSlabPool_Free(
+    DOT11s_SlabPool* pool,
+    void* item)
 {
-    LinkedList* list = dot11->mp->neighborList;
-    ListItem* listItem = list->first;
-    DOT11s_NeighborItem* item = NULL;
-    int count = 0;
+    ERROR_Assert(pool->numInUse > 0,
+        "Dot11sSlabPool_Free: Pool has no items in use.\n");
 
-    while (listItem != NULL)
-    {
-        item = (DOT11s_NeighborItem*) listItem->data;
-        if (item->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
-            || item->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
-        {
-            count++;
-        }
-        listItem = listItem->next;
-    }
+    *(void**) item = pool->freeList;
+    pool->freeList = item;
+    pool->numFreed++;
 
-    return count;
+    pool->numFrees++;
+    pool->numInUse--;
 }
 
 
 /**
-FUNCTION   :: Dot11sPortalList_Lookup
+FUNCTION   :: Dot11sSlabPool_Finalize
 LAYER      :: MAC
-PURPOSE    :: Search Portal list for an address.
+PURPOSE    :: Release all slabs of a pool, including items in use.
 PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-+ portalAddr : Mac802Address : address to be looked up
-RETURN     :: DOT11s_PortalItem* : portal item or NULL
++ pool      : DOT11s_SlabPool* : pool
+RETURN     :: void
 **/
 
 static
-DOT11s_PortalItem* Dot11sPortalList_Lookup(
-    Node* node,
-    MacDataDot11* dot11,
-    Mac802Address portalAddr)
+void Dot11sSlabPool_Finalize(
+    DOT11s_SlabPool* pool)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* portalList = mp->portalList;
-
-    ListItem* listItem = portalList->first;
-    DOT11s_PortalItem* portalItem = NULL;
-    BOOL isFound = FALSE;
-
-    while (listItem != NULL)
+    DOT11s_Slab* slab = pool->slabList;
+    while (slab != NULL)
     {
-        portalItem = (DOT11s_PortalItem*) listItem->data;
-        if (portalItem->portalAddr == portalAddr)
-        {
-            isFound = TRUE;
-            break;
-        }
-        listItem = listItem->next;
+        DOT11s_Slab* nextSlab = slab->next;
+        MEM_free(slab);
+        slab = nextSlab;
     }
 
-    return (isFound ? portalItem : NULL);
+    pool->slabList = NULL;
+    pool->freeList = NULL;
+    pool->numFreed = 0;
+    pool->numSlabs = 0;
+    pool->numInUse = 0;
 }
 
 
 /**
-FUNCTION   :: Dot11sPortalList_Finalize
+FUNCTION   :: Dot11sSlabPool_PrintStats
 LAYER      :: MAC
-PURPOSE    :: Free portal list and contained items.
+PURPOSE    :: Print occupancy statistics of a pool.
 PARAMETERS ::
 + node      : Node*         : pointer to node
 + dot11     : MacDataDot11* : pointer to Dot11 data structure
++ interfaceIndex : int      : interface index
++ pool      : DOT11s_SlabPool* : pool
 RETURN     :: void
 **/
 
 static
-void Dot11sPortalList_Finalize(
+void Dot11sSlabPool_PrintStats(
     Node* node,
-    MacDataDot11* dot11)
+    MacDataDot11* dot11,
+    int interfaceIndex,
+    DOT11s_SlabPool* pool)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* portalList = mp->portalList;
+    char buf[MAX_STRING_LENGTH];
 
-    if (portalList == NULL)
-    {
-        return;
-    }
+    sprintf(buf, "Mesh %s pool slabs = %d",
+        pool->name, pool->numSlabs);
+    DOT11s_STATS_PRINT;
 
-    if (DOT11s_TraceComments)
-    {
-        char traceStr[MAX_STRING_LENGTH];
-        sprintf(traceStr, "Dot11sPortalList_Finalize: "
-            "Freed %d items",
-            ListGetSize(node, portalList));
-        MacDot11Trace(node, dot11, NULL, traceStr);
-    }
+    sprintf(buf, "Mesh %s pool capacity = %d",
+        pool->name, pool->numSlabs * DOT11s_SLAB_POOL_ITEMS_PER_SLAB);
+    DOT11s_STATS_PRINT;
 
-    ListFree(node, portalList, FALSE);
+    sprintf(buf, "Mesh %s pool items in use = %d",
+        pool->name, pool->numInUse);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh %s pool peak items in use = %d",
+        pool->name, pool->peakInUse);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh %s pool allocations = %d",
+        pool->name, pool->numAllocs);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh %s pool items freed = %d",
+        pool->name, pool->numFrees);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh %s pool items recycled = %d",
+        pool->name, pool->numReuses);
+    DOT11s_STATS_PRINT;
 }
 
 
 /**
-FUNCTION   :: Dot11sPortalList_AgeItems
+FUNCTION   :: Dot11sSlabPool_ListFree
 LAYER      :: MAC
-PURPOSE    :: Mark portals as inactive if portal active time has
-                elapsed since the last PANN was received.
+PURPOSE    :: Free a list whose items belong to a pool. The items are
+                left to the pool.
 PARAMETERS ::
 + node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ list      : LinkedList*   : list
 RETURN     :: void
 **/
 
 static
-void Dot11sPortalList_AgeItems(
+void Dot11sSlabPool_ListFree(
     Node* node,
-    MacDataDot11* dot11)
+    LinkedList* list)
 {
-    DOT11s_Data* mp = dot11->mp;
-    LinkedList* portalList = mp->portalList;
-
-    clocktype agingTime =
-        getSimTime(node) - mp->portalTimeout;
-    if (agingTime < 0)
+    while (list->first != NULL)
     {
-        return;
+        ListGet(node, list, list->first, FALSE, FALSE);
     }
 
-    ListItem* listItem = portalList->first;
-    DOT11s_PortalItem* portalItem = NULL;
-
-    while (listItem != NULL)
-    {
-        portalItem = (DOT11s_PortalItem*) listItem->data;
-        if (portalItem->lastPannTime < agingTime)
-        {
-            if (DOT11s_TraceComments)
-            {
-                char traceStr[MAX_STRING_LENGTH];
-                char portalStr[MAX_STRING_LENGTH];
-                Dot11s_AddrAsDotIP(portalStr, &portalItem->portalAddr);
-                sprintf(traceStr, "Dot11sPortalList_AgeItems: "
-                    "Marking %s as inactive", portalStr);
-                MacDot11Trace(node, dot11, NULL, traceStr);
-            }
-
-            portalItem->isActive = FALSE;
-        }
-        listItem = listItem->next;
-    }
+    ListFree(node, list, FALSE);
 }
 
-/**
-FUNCTION   :: Dot11sProxyList_Lookup
-LAYER      :: MAC
-PURPOSE    :: Search proxy list for a station address.
-PARAMETERS ::
-+ node      : Node*         : pointer to node
-+ dot11     : MacDataDot11* : pointer to Dot11 data structure
-+ staAddr   : Mac802Address : address of station
-RETURN     :: DOT11s_ProxyItem* : proxy item or NULL
-**/
 
-DOT11s_ProxyItem* Dot11sProxyList_Lookup(
+// ------------------------------------------------------------------
+// Aging deadlines
+//
+// Neighbors and portals are aged from deadline queues instead of a scan
+// of the whole table every second. Each item has exactly one entry, a
+// binary min-heap keyed on the time at which the item would next
+// expire. Refreshing an item does not touch its entry. When an entry
+// comes due, the item is checked against its current timestamp; if it
+// was refreshed in the meantime the entry is pushed back with the new
+// deadline, otherwise the item is aged. Items that are not subject to
+// aging, such as neighbors whose link is down, are checked again one
+// timeout later.
+//
+// The data seen set is already kept in expiry order, so its oldest
+// item is its next deadline.
+//
+// The maintenance timer sleeps until the earliest deadline of all
+// tables, rounded up to a whole DOT11s_AGING_RESOLUTION so that bursts
+// of deadlines are handled by a single timer event. Items therefore
+// expire at most one resolution after their deadline, as they did with
+// the fixed one second maintenance timer.
+
+// Granularity of the maintenance timer
+#define DOT11s_AGING_RESOLUTION SECOND
+
+// Initial capacity of a deadline queue
+#define DOT11s_DEADLINE_HEAP_SIZE 16
+
+struct DOT11s_Deadline
+{
+    clocktype deadline;
+    void* item;
+};
+
+struct DOT11s_DeadlineHeap
+{
+    DOT11s_Deadline* entries;
+    int numEntries;
+    int maxEntries;
+};
+
+struct DOT11s_Aging
+{
+    DOT11s_DeadlineHeap neighborDeadlines;
+    DOT11s_DeadlineHeap portalDeadlines;
+
+    BOOL isStarted;
+    Message* timerMsg;
+    clocktype timerExpiry;
+};
+
+
+/**
+FUNCTION   :: Dot11sDeadlineHeap_Push
+LAYER      :: MAC
+PURPOSE    :: Add an item to a deadline queue.
+PARAMETERS ::
++ heap      : DOT11s_DeadlineHeap* : deadline queue
++ deadline  : clocktype     : time at which the item is due
++ item      : void*         : item
+RETURN     :: void
+**/
+
+static
+void Dot11sDeadlineHeap_Push(
+    DOT11s_DeadlineHeap* heap,
+    clocktype deadline,
+    void* item)
+{
+    if (heap->numEntries == heap->maxEntries)
+    {
+        int maxEntries = heap->maxEntries > 0
+            ? heap->maxEntries * 2
+            : DOT11s_DEADLINE_HEAP_SIZE;
+        DOT11s_Deadline* entries = (DOT11s_Deadline*)
+            MEM_malloc(maxEntries * sizeof(DOT11s_Deadline));
+        if (heap->entries != NULL)
+        {
+            memcpy(entries, heap->entries,
+                heap->numEntries * sizeof(DOT11s_Deadline));
+            MEM_free(heap->entries);
+        }
+        heap->entries = entries;
+        heap->maxEntries = maxEntries;
+    }
+
+    int i = heap->numEntries++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (heap->entries[parent].deadline <= deadline)
+        {
+            break;
+        }
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i].deadline = deadline;
+    heap->entries[i].item = item;
+}
+
+
+/**
+FUNCTION   :: Dot11sDeadlineHeap_Pop
+LAYER      :: MAC
+PURPOSE    :: Remove the earliest item from a non-empty deadline queue.
+PARAMETERS ::
++ heap      : DOT11s_DeadlineHeap* : deadline queue
+RETURN     :: void*         : item
+**/
+
+static
+void* Dot11sDeadlineHeap_Pop(
+    DOT11s_DeadlineHeap* heap)
+{
+    ERROR_Assert(heap->numEntries > 0,
+        "Dot11sDeadlineHeap_Pop: Deadline queue is empty.\n");
+
+    void* item = heap->entries[0].item;
+    DOT11s_Deadline last = heap->entries[--heap->numEntries];
+
+    int i = 0;
+    while (TRUE)
+    {
+        int child = 2 * i + 1;
+        if (child >= heap->numEntries)
+        {
+            break;
+        }
+        if (child + 1 < heap->numEntries
+            && heap->entries[child + 1].deadline
+                < heap->entries[child].deadline)
+        {
+            child++;
+        }
+        if (last.deadline <= heap->entries[child].deadline)
+        {
+            break;
+        }
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+
+    return item;
+}
+
+
+/**
+FUNCTION   :: Dot11sDeadlineHeap_IsDue
+LAYER      :: MAC
+PURPOSE    :: Check if the earliest item of a deadline queue is due.
+PARAMETERS ::
++ heap      : DOT11s_DeadlineHeap* : deadline queue
++ now       : clocktype     : current time
+RETURN     :: BOOL          : TRUE if an item has a deadline before now
+**/
+
+static
+BOOL Dot11sDeadlineHeap_IsDue(
+    DOT11s_DeadlineHeap* heap,
+    clocktype now)
+{
+    return heap->numEntries > 0 && heap->entries[0].deadline < now;
+}
+
+
+/**
+FUNCTION   :: Dot11sDeadlineHeap_Free
+LAYER      :: MAC
+PURPOSE    :: Free the entries of a deadline queue. Items are not
+                touched.
+PARAMETERS ::
++ heap      : DOT11s_DeadlineHeap* : deadline queue
+RETURN     :: void
+**/
+
+static
+void Dot11sDeadlineHeap_Free(
+    DOT11s_DeadlineHeap* heap)
+{
+    if (heap->entries != NULL)
+    {
+        MEM_free(heap->entries);
+    }
+    memset(heap, 0, sizeof(DOT11s_DeadlineHeap));
+}
+
+
+static
+void Dot11s_ScheduleMaintenance(
+    Node* node,
+    MacDataDot11* dot11);
+
+
+// ------------------------------------------------------------------
+// Keyed lists
+//
+// The neighbor, proxy, forwarding, station and end to end tables are
+// linked lists kept in insertion order for iteration and printing. Each
+// list has an address index beside it, an open addressing hash table
+// from the item key to its list item, so that lookups need not walk
+// the list. Items are added and removed through
+// Dot11sKeyedList_Append and Dot11sKeyedList_Delete to keep the two in
+// step. The index itself is in mac_dot11s-index.h.
+
+
+/**
+FUNCTION   :: Dot11sKeyedList_Append
+LAYER      :: MAC
+PURPOSE    :: Append an item to a list and index it.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ list      : LinkedList*   : list
++ index     : DOT11s_AddrIndex* : index of the list
++ key       : const DOT11s_AddrKey& : key of the item
++ data      : void*         : item
+RETURN     :: void
+**/
+
+static
+void Dot11sKeyedList_Append(
+    Node* node,
+    LinkedList* list,
+    DOT11s_AddrIndex* index,
+    const DOT11s_AddrKey& key,
+    void* data)
+{
+    ListAppend(node, list, 0, data);
+    Dot11sAddrIndex_Insert(index, key, list->last);
+}
+
+
+/**
+FUNCTION   :: Dot11sKeyedList_Delete
+LAYER      :: MAC
+PURPOSE    :: Remove an item from a list and its index, and free it.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ list      : LinkedList*   : list
++ index     : DOT11s_AddrIndex* : index of the list
++ pool      : DOT11s_SlabPool* : pool of the item, NULL if the item
+                                was allocated with MEM_malloc
++ key       : const DOT11s_AddrKey& : key of the item
++ listItem  : ListItem*     : list item of the item
+RETURN     :: void
+**/
+
+static
+void Dot11sKeyedList_Delete(
+    Node* node,
+    LinkedList* list,
+    DOT11s_AddrIndex* index,
+    DOT11s_SlabPool* pool,
+    const DOT11s_AddrKey& key,
+    ListItem* listItem)
+{
+    Dot11sAddrIndex_Remove(index, key);
+
+    if (pool == NULL)
+    {
+        ListDelete(node, list, listItem, FALSE);
+    }
+    else
+    {
+        void* data = listItem->data;
+        ListGet(node, list, listItem, FALSE, FALSE);
+        Dot11sSlabPool_Free(pool, data);
+    }
+}
+
+
+/**
+FUNCTION   :: Dot11sNeighborList_Lookup
+LAYER      :: MAC
+PURPOSE    :: Search Neighbor list for an address.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ neighborAddr : Mac802Address : address to be looked up
+RETURN     :: DOT11s_NeighborItem* : neighbor item or NULL
+**/
+
+static
+DOT11s_NeighborItem* Dot11sNeighborList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address neighborAddr)
+{
+    DOT11s_Data* mp = dot11->mp;
+
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        mp->neighborIndex, Dot11sAddrIndex_Key(neighborAddr));
+
+    return (listItem != NULL
+        ? (DOT11s_NeighborItem*) listItem->data
+        : NULL);
+}
+
+
+/**
+FUNCTION   :: Dot11sNeighborList_Finalize
+LAYER      :: MAC
+PURPOSE    :: Free neighbor list and contained items.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+static
+void Dot11sNeighborList_Finalize(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_Data* mp = dot11->mp;
+    LinkedList* neighborList = mp->neighborList;
+
+    if (neighborList == NULL)
+    {
+        return;
+    }
+
+    if (DOT11s_TraceComments)
+    {
+        char traceStr[MAX_STRING_LENGTH];
+        sprintf(traceStr, "Dot11sNeighborList_Finalize: "
+            "Freed %d items",
+            ListGetSize(node, neighborList));
+        MacDot11Trace(node, dot11, NULL, traceStr);
+    }
+
+    Dot11sSlabPool_ListFree(node, neighborList);
+    Dot11sAddrIndex_Free(mp->neighborIndex);
+}
+
+
+/**
+FUNCTION   :: Dot11s_IsAssociatedNeighbor
+LAYER      :: MAC
+PURPOSE    :: Check if neighbor is associated.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ neighborAddr : Mac802Address : neighbor address to check for association.
+RETURN     :: BOOL          : TRUE if neighbor is associated.
+NOTES      :: Assumes neighbor is associated as well as in UP state.
+**/
+
+static
+BOOL Dot11s_IsAssociatedNeighbor(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address neighborAddr)
+{
+    DOT11s_NeighborItem* neighborItem =
+        Dot11sNeighborList_Lookup(node, dot11, neighborAddr);
+
+    if (neighborItem == NULL)
+    {
+        return FALSE;
+    }
+    if (neighborItem->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
+        || neighborItem->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
+    {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/**
+FUNCTION   :: Dot11sNeighborList_AgeItems
+LAYER      :: MAC
+PURPOSE    :: Close links to neighbors whose link state has not been
+                refreshed within the association active time.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+NOTES      :: Only neighbors whose deadline has passed are examined.
+**/
+
+static
+void Dot11sNeighborList_AgeItems(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_DeadlineHeap* deadlines = &mp->aging->neighborDeadlines;
+
+    clocktype now = getSimTime(node);
+    clocktype agingTime = now - DOT11s_ASSOC_ACTIVE_TIMEOUT;
+
+    while (Dot11sDeadlineHeap_IsDue(deadlines, now))
+    {
+        DOT11s_NeighborItem* neighborItem = (DOT11s_NeighborItem*)
+            Dot11sDeadlineHeap_Pop(deadlines);
+
+        if (neighborItem->state != DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
+            && neighborItem->state != DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
+        {
+            // Link state is refreshed when the link comes up.
+            Dot11sDeadlineHeap_Push(deadlines,
+                now + DOT11s_ASSOC_ACTIVE_TIMEOUT, neighborItem);
+            continue;
+        }
+
+        if (neighborItem->lastLinkStateTime >= agingTime)
+        {
+            // Refreshed since the entry was queued
+            Dot11sDeadlineHeap_Push(deadlines,
+                neighborItem->lastLinkStateTime
+                    + DOT11s_ASSOC_ACTIVE_TIMEOUT,
+                neighborItem);
+            continue;
+        }
+
+        if (DOT11s_TraceComments)
+        {
+            char traceStr[MAX_STRING_LENGTH];
+            char neighborStr[MAX_STRING_LENGTH];
+            Dot11s_AddrAsDotIP(neighborStr, &neighborItem->neighborAddr);
+            sprintf(traceStr, "Dot11sNeighborList_AgeItems: "
+                "Closing link with %s ", neighborStr);
+            MacDot11Trace(node, dot11, NULL, traceStr);
+        }
+
+        mp->assocStateData.event = DOT11s_ASSOC_S_EVENT_CANCEL_LINK;
+        mp->assocStateData.neighborItem = neighborItem;
+        neighborItem->assocStateFn(node, dot11, mp);
+
+        Dot11sDeadlineHeap_Push(deadlines,
+            now + DOT11s_ASSOC_ACTIVE_TIMEOUT, neighborItem);
+    }
+}
+
+
+/**
+FUNCTION   :: Dot11s_GetAssociatedNeighborCount
+LAYER      :: MAC
+PURPOSE    :: Get count of associated neighbors.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ neighborAddr : Mac802Address : neighbor address to check for association.
+RETURN     :: int           : count of associated neighbors.
+NOTES      :: Neighbor is both associated as well as in UP state.
+**/
+
+int Dot11s_GetAssociatedNeighborCount(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    LinkedList* list = dot11->mp->neighborList;
+    ListItem* listItem = list->first;
+    DOT11s_NeighborItem* item = NULL;
+    int count = 0;
+
+    while (listItem != NULL)
+    {
+        item = (DOT11s_NeighborItem*) listItem->data;
+        if (item->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
+            || item->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
+        {
+            count++;
+        }
+        listItem = listItem->next;
+    }
+
+    return count;
+}
+
+
+/**
+FUNCTION   :: Dot11sPortalList_Lookup
+LAYER      :: MAC
+PURPOSE    :: Search Portal list for an address.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ portalAddr : Mac802Address : address to be looked up
+RETURN     :: DOT11s_PortalItem* : portal item or NULL
+**/
+
+static
+DOT11s_PortalItem* Dot11sPortalList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address portalAddr)
+{
+    DOT11s_Data* mp = dot11->mp;
+    LinkedList* portalList = mp->portalList;
+
+    ListItem* listItem = portalList->first;
+    DOT11s_PortalItem* portalItem = NULL;
+    BOOL isFound = FALSE;
+
+    while (listItem != NULL)
+    {
+        portalItem = (DOT11s_PortalItem*) listItem->data;
+        if (portalItem->portalAddr == portalAddr)
+        {
+            isFound = TRUE;
+            break;
+        }
+        listItem = listItem->next;
+    }
+
+    return (isFound ? portalItem : NULL);
+}
+
+
+/**
+FUNCTION   :: Dot11sPortalList_Finalize
+LAYER      :: MAC
+PURPOSE    :: Free portal list and contained items.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+static
+void Dot11sPortalList_Finalize(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_Data* mp = dot11->mp;
+    LinkedList* portalList = mp->portalList;
+
+    if (portalList == NULL)
+    {
+        return;
+    }
+
+    if (DOT11s_TraceComments)
+    {
+        char traceStr[MAX_STRING_LENGTH];
+        sprintf(traceStr, "Dot11sPortalList_Finalize: "
+            "Freed %d items",
+            ListGetSize(node, portalList));
+        MacDot11Trace(node, dot11, NULL, traceStr);
+    }
+
+    ListFree(node, portalList, FALSE);
+}
+
+
+/**
+FUNCTION   :: Dot11sPortalList_AgeItems
+LAYER      :: MAC
+PURPOSE    :: Mark portals as inactive if portal active time has
+                elapsed since the last PANN was received.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+NOTES      :: Only portals whose deadline has passed are examined.
+**/
+
+static
+void Dot11sPortalList_AgeItems(
     Node* node,
-    MacDataDot11* dot11,
-    Mac802Address staAddr)
+    MacDataDot11* dot11)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* proxyList = mp->proxyList;
+    DOT11s_DeadlineHeap* deadlines = &mp->aging->portalDeadlines;
 
-    ListItem* listItem = proxyList->first;
-    DOT11s_ProxyItem* proxyItem = NULL;
-    BOOL isProxyFound = FALSE;
+    clocktype now = getSimTime(node);
+    clocktype agingTime = now - mp->portalTimeout;
 
-    while (listItem != NULL)
+    while (Dot11sDeadlineHeap_IsDue(deadlines, now))
     {
-        proxyItem = (DOT11s_ProxyItem*) listItem->data;
-        if (proxyItem->staAddr == staAddr)
+        DOT11s_PortalItem* portalItem = (DOT11s_PortalItem*)
+            Dot11sDeadlineHeap_Pop(deadlines);
+
+        if (portalItem->lastPannTime >= agingTime)
         {
-            isProxyFound = TRUE;
-            break;
+            // Refreshed since the entry was queued
+            Dot11sDeadlineHeap_Push(deadlines,
+                portalItem->lastPannTime + mp->portalTimeout,
+                portalItem);
+            continue;
         }
-        listItem = listItem->next;
+
+        if (DOT11s_TraceComments && portalItem->isActive)
+        {
+            char traceStr[MAX_STRING_LENGTH];
+            char portalStr[MAX_STRING_LENGTH];
+            Dot11s_AddrAsDotIP(portalStr, &portalItem->portalAddr);
+            sprintf(traceStr, "Dot11sPortalList_AgeItems: "
+                "Marking %s as inactive", portalStr);
+            MacDot11Trace(node, dot11, NULL, traceStr);
+        }
+
+        portalItem->isActive = FALSE;
+
+        Dot11sDeadlineHeap_Push(deadlines,
+            now + mp->portalTimeout, portalItem);
     }
+}
+
+/**
+FUNCTION   :: Dot11sProxyList_Lookup
+LAYER      :: MAC
+PURPOSE    :: Search proxy list for a station address.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ staAddr   : Mac802Address : address of station
+RETURN     :: DOT11s_ProxyItem* : proxy item or NULL
+**/
+
+DOT11s_ProxyItem* Dot11sProxyList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr)
+{
+    DOT11s_Data* mp = dot11->mp;
+
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        mp->proxyIndex, Dot11sAddrIndex_Key(staAddr));
 
-    return (isProxyFound ? proxyItem : NULL);
+    return (listItem != NULL
+        ? (DOT11s_ProxyItem*) listItem->data
+        : NULL);
 }
 
 
@@ -1744,13 +2329,15 @@ void Dot11sProxyList_Insert(
     proxyItem = Dot11sProxyList_Lookup(node, dot11, staAddr);
     if (proxyItem == NULL)
     {
-        Dot11s_Malloc(DOT11s_ProxyItem, proxyItem);
+        proxyItem = (DOT11s_ProxyItem*)
+            Dot11sSlabPool_Alloc(&mp->itemPools->proxyPool);
         proxyItem->staAddr = staAddr;
         proxyItem->inMesh = inMesh;
         proxyItem->isProxied = isProxied;
         proxyItem->proxyAddr = proxyAddr;
 
-        ListAppend(node, mp->proxyList, 0, proxyItem);
+        Dot11sKeyedList_Append(node, mp->proxyList, mp->proxyIndex,
+            Dot11sAddrIndex_Key(staAddr), proxyItem);
     }
     else
     {
@@ -1822,7 +2409,9 @@ void Dot11sProxyList_DeleteItems(
         if (proxyItem->proxyAddr == proxyAddr)
         {
             count++;
-            ListDelete(node, proxyList, tempItem, FALSE);
+            Dot11sKeyedList_Delete(node, proxyList, mp->proxyIndex,
+                &mp->itemPools->proxyPool,
+                Dot11sAddrIndex_Key(proxyItem->staAddr), tempItem);
         }
     }
 
@@ -1868,7 +2457,8 @@ void Dot11sProxyList_Finalize(
         MacDot11Trace(node, dot11, NULL, traceStr);
     }
 
-    ListFree(node, proxyList, FALSE);
+    Dot11sSlabPool_ListFree(node, proxyList);
+    Dot11sAddrIndex_Free(mp->proxyIndex);
 }
 
 
@@ -1889,24 +2479,13 @@ DOT11s_FwdItem* Dot11sFwdList_Lookup(
     Mac802Address addr)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* fwdList = mp->fwdList;
-
-    ListItem* listItem = fwdList->first;
-    DOT11s_FwdItem* fwdItem = NULL;
-    BOOL isFound = FALSE;
 
-    while (listItem != NULL)
-    {
-        fwdItem = (DOT11s_FwdItem*) listItem->data;
-        if (fwdItem->mpAddr == addr)
-        {
-            isFound = TRUE;
-            break;
-        }
-        listItem = listItem->next;
-    }
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        mp->fwdIndex, Dot11sAddrIndex_Key(addr));
 
-    return (isFound ? fwdItem : NULL);
+    return (listItem != NULL
+        ? (DOT11s_FwdItem*) listItem->data
+        : NULL);
 }
 
 
@@ -1938,12 +2517,14 @@ void Dot11sFwdList_Insert(
     fwdItem = Dot11sFwdList_Lookup(node, dot11, mpAddr);
     if (fwdItem == NULL)
     {
-        Dot11s_Malloc(DOT11s_FwdItem, fwdItem);
+        fwdItem = (DOT11s_FwdItem*)
+            Dot11sSlabPool_Alloc(&mp->itemPools->fwdPool);
         fwdItem->mpAddr = mpAddr;
         fwdItem->nextHopAddr = nextHopAddr;
         fwdItem->itemType = itemType;
 
-        ListAppend(node, mp->fwdList, 0, fwdItem);
+        Dot11sKeyedList_Append(node, mp->fwdList, mp->fwdIndex,
+            Dot11sAddrIndex_Key(mpAddr), fwdItem);
     }
     else
     {
@@ -2017,7 +2598,140 @@ void Dot11sFwdList_Finalize(
         MacDot11Trace(node, dot11, NULL, traceStr);
     }
 
-    ListFree(node, fwdList, FALSE);
+    Dot11sSlabPool_ListFree(node, fwdList);
+    Dot11sAddrIndex_Free(mp->fwdIndex);
+}
+
+
+// ------------------------------------------------------------------
+// Data seen set
+//
+// Mesh broadcasts are flooded, so every node checks each one against
+// the frames it has already seen. Items are hashed on DA/SA/E2E
+// sequence number and also chained in insertion order. Insertion times
+// never decrease, so that chain is the expiry order and aging only
+// visits the items it removes.
+
+struct DOT11s_DataSeenEntry
+{
+    DOT11s_DataSeenItem item;
+    DOT11s_DataSeenEntry* hashNext;
+    DOT11s_DataSeenEntry* expiryNext;
+};
+
+struct DOT11s_DataSeenSet
+{
+    DOT11s_DataSeenEntry** table;
+    unsigned int tableSize;
+    int numItems;
+
+    // Oldest item first
+    DOT11s_DataSeenEntry* expiryHead;
+    DOT11s_DataSeenEntry* expiryTail;
+};
+
+
+/**
+FUNCTION   :: Dot11sDataSeenSet_Hash
+LAYER      :: MAC
+PURPOSE    :: Hash a DA/SA/E2E sequence number tuple.
+PARAMETERS ::
++ DA        : const Mac802Address& : mesh destination
++ SA        : const Mac802Address& : mesh source
++ e2eSeqNo  : unsigned int  : end to end sequence number
+RETURN     :: unsigned int  : hash value
+**/
+
+static
+unsigned int Dot11sDataSeenSet_Hash(
+    const Mac802Address& DA,
+    const Mac802Address& SA,
+    unsigned int e2eSeqNo)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261U;
+    int i;
+
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++)
+    {
+        hash = (hash ^ DA.byte[i]) * 16777619U;
+    }
+    for (i = 0; i < MAC_ADDRESS_LENGTH_IN_BYTE; i++)
+    {
+        hash = (hash ^ SA.byte[i]) * 16777619U;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        hash = (hash ^ ((e2eSeqNo >> (8 * i)) & 0xFF)) * 16777619U;
+    }
+
+    return hash;
+}
+
+
+/**
+FUNCTION   :: Dot11sDataSeenSet_Init
+LAYER      :: MAC
+PURPOSE    :: Allocate an empty data seen set.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+static
+void Dot11sDataSeenSet_Init(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_DataSeenSet* seenSet;
+
+    Dot11s_MallocMemset0(DOT11s_DataSeenSet, seenSet);
+    seenSet->tableSize = DOT11s_DATA_SEEN_HASH_SIZE;
+    seenSet->table = (DOT11s_DataSeenEntry**)
+        MEM_malloc(seenSet->tableSize * sizeof(DOT11s_DataSeenEntry*));
+    memset(seenSet->table, 0,
+        seenSet->tableSize * sizeof(DOT11s_DataSeenEntry*));
+
+    mp->dataSeenSet = seenSet;
+}
+
+
+/**
+FUNCTION   :: Dot11sDataSeenSet_Grow
+LAYER      :: MAC
+PURPOSE    :: Double the hash table and rehash all items.
+PARAMETERS ::
++ seenSet   : DOT11s_DataSeenSet* : data seen set
+RETURN     :: void
+**/
+
+static
+void Dot11sDataSeenSet_Grow(
+    DOT11s_DataSeenSet* seenSet)
+{
+    unsigned int newSize = seenSet->tableSize * 2;
+    DOT11s_DataSeenEntry** newTable = (DOT11s_DataSeenEntry**)
+        MEM_malloc(newSize * sizeof(DOT11s_DataSeenEntry*));
+    memset(newTable, 0, newSize * sizeof(DOT11s_DataSeenEntry*));
+
+    DOT11s_DataSeenEntry* entry = seenSet->expiryHead;
+    while (entry != NULL)
+    {
+        unsigned int slot = Dot11sDataSeenSet_Hash(
+            entry->item.DA,
+            entry->item.SA,
+            (unsigned int) entry->item.fwdControl.GetE2eSeqNo())
+            & (newSize - 1);
+        entry->hashNext = newTable[slot];
+        newTable[slot] = entry;
+        entry = entry->expiryNext;
+    }
+
+    MEM_free(seenSet->table);
+    seenSet->table = newTable;
+    seenSet->tableSize = newSize;
 }
 
 
@@ -2046,7 +2760,7 @@ void Dot11sDataSeenList_Insert(
     }
 
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* dataSeenList = mp->dataSeenList;
+    DOT11s_DataSeenSet* seenSet = mp->dataSeenSet;
 
     DOT11_ShortControlFrame* hdr =
         (DOT11_ShortControlFrame*) MESSAGE_ReturnPacket(msg);
@@ -2056,7 +2770,9 @@ void Dot11sDataSeenList_Insert(
     DOT11s_FrameHdr meshHdr;
     Dot11s_ReturnMeshHeader(&meshHdr, msg);
 
-    Dot11s_MallocMemset0(DOT11s_DataSeenItem, dataSeenItem);
+    DOT11s_DataSeenEntry* entry = (DOT11s_DataSeenEntry*)
+        Dot11sSlabPool_Alloc(&mp->itemPools->dataSeenPool);
+    dataSeenItem = &entry->item;
     dataSeenItem->RA = meshHdr.destAddr;
     dataSeenItem->TA = meshHdr.sourceAddr;
     dataSeenItem->DA = meshHdr.address3;
@@ -2065,8 +2781,36 @@ void Dot11sDataSeenList_Insert(
     dataSeenItem->fwdControl.SetTTL(meshHdr.fwdControl.GetTTL());
     dataSeenItem->insertTime = getSimTime(node);
 
-    // Insert at the beginning
-    ListPrepend(node, dataSeenList, 0, dataSeenItem);
+    if (seenSet->numItems >= (int) seenSet->tableSize * 2)
+    {
+        Dot11sDataSeenSet_Grow(seenSet);
+    }
+
+    unsigned int slot = Dot11sDataSeenSet_Hash(
+        dataSeenItem->DA,
+        dataSeenItem->SA,
+        (unsigned int) dataSeenItem->fwdControl.GetE2eSeqNo())
+        & (seenSet->tableSize - 1);
+    entry->hashNext = seenSet->table[slot];
+    seenSet->table[slot] = entry;
+
+    // Newest item goes last in expiry order
+    if (seenSet->expiryTail == NULL)
+    {
+        seenSet->expiryHead = entry;
+    }
+    else
+    {
+        seenSet->expiryTail->expiryNext = entry;
+    }
+    seenSet->expiryTail = entry;
+
+    seenSet->numItems++;
+
+    if (seenSet->expiryHead == entry)
+    {
+        Dot11s_ScheduleMaintenance(node, dot11);
+    }
 }
 
 
@@ -2088,7 +2832,7 @@ DOT11s_DataSeenItem* Dot11sDataSeenList_Lookup(
     Message* msg)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* dataSeenList = mp->dataSeenList;
+    DOT11s_DataSeenSet* seenSet = mp->dataSeenSet;
 
     DOT11_ShortControlFrame* hdr =
         (DOT11_ShortControlFrame*) MESSAGE_ReturnPacket(msg);
@@ -2098,13 +2842,17 @@ DOT11s_DataSeenItem* Dot11sDataSeenList_Lookup(
     DOT11s_FrameHdr meshHdr;
     Dot11s_ReturnMeshHeader(&meshHdr, msg);
 
-    ListItem* listItem = dataSeenList->first;
-    DOT11s_DataSeenItem* dataSeenItem = NULL;
-    BOOL isDataItemFound = FALSE;
+    unsigned int slot = Dot11sDataSeenSet_Hash(
+        meshHdr.address3,
+        meshHdr.address4,
+        (unsigned int) meshHdr.fwdControl.GetE2eSeqNo())
+        & (seenSet->tableSize - 1);
 
-    while (listItem != NULL)
+    DOT11s_DataSeenEntry* entry = seenSet->table[slot];
+
+    while (entry != NULL)
     {
-        dataSeenItem = (DOT11s_DataSeenItem*) listItem->data;
+        DOT11s_DataSeenItem* dataSeenItem = &entry->item;
         if (dataSeenItem->DA == meshHdr.address3
             && dataSeenItem->SA == meshHdr.address4
             && dataSeenItem->fwdControl.GetE2eSeqNo()
@@ -2125,13 +2873,44 @@ DOT11s_DataSeenItem* Dot11sDataSeenList_Lookup(
                 MacDot11Trace(node, dot11, NULL, traceStr);
             }
 
-            isDataItemFound = TRUE;
-            break;
+            return dataSeenItem;
         }
-        listItem = listItem->next;
+        entry = entry->hashNext;
     }
 
-    return (isDataItemFound ? dataSeenItem : NULL);
+    return NULL;
+}
+
+
+/**
+FUNCTION   :: Dot11sDataSeenSet_Unhash
+LAYER      :: MAC
+PURPOSE    :: Unlink an entry from its hash chain.
+PARAMETERS ::
++ seenSet   : DOT11s_DataSeenSet* : data seen set
++ entry     : DOT11s_DataSeenEntry* : entry to unlink
+RETURN     :: void
+**/
+
+static
+void Dot11sDataSeenSet_Unhash(
+    DOT11s_DataSeenSet* seenSet,
+    DOT11s_DataSeenEntry* entry)
+{
+    unsigned int slot = Dot11sDataSeenSet_Hash(
+        entry->item.DA,
+        entry->item.SA,
+        (unsigned int) entry->item.fwdControl.GetE2eSeqNo())
+        & (seenSet->tableSize - 1);
+
+    DOT11s_DataSeenEntry** link = &seenSet->table[slot];
+    while (*link != entry)
+    {
+        ERROR_Assert(*link != NULL,
+            "Dot11sDataSeenSet_Unhash: Entry not in hash table.\n");
+        link = &(*link)->hashNext;
+    }
+    *link = entry->hashNext;
 }
 
 
@@ -2145,8 +2924,8 @@ PARAMETERS ::
 + dot11     : MacDataDot11* : pointer to Dot11 data structure
 RETURN     :: void
 NOTES      :: Aging time is approximate 4 * net traversal time.
-                Traverses the list from the rear as new items are
-                prepended to the list.
+                Removes from the head of the expiry order and stops
+                at the first item that is still current.
 **/
 
 static
@@ -2155,7 +2934,7 @@ void Dot11sDataSeenList_AgeItems(
     MacDataDot11* dot11)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* dataSeenList = mp->dataSeenList;
+    DOT11s_DataSeenSet* seenSet = mp->dataSeenSet;
 
     clocktype agingTime = getSimTime(node) - DOT11s_DATA_SEEN_AGING_TIME;
     if (agingTime < 0)
@@ -2163,21 +2942,23 @@ void Dot11sDataSeenList_AgeItems(
         return;
     }
 
-    ListItem* listItem = dataSeenList->last;
-    DOT11s_DataSeenItem* dataSeenItem = NULL;
+    DOT11s_DataSeenEntry* entry = seenSet->expiryHead;
 
-    while (listItem != NULL)
+    while (entry != NULL && entry->item.insertTime < agingTime)
     {
-        dataSeenItem = (DOT11s_DataSeenItem*) listItem->data;
-        if (dataSeenItem->insertTime < agingTime)
-        {
-            ListDelete(node, dataSeenList, listItem, FALSE);
-            listItem = dataSeenList->last;
-        }
-        else
-        {
-            break;
-        }
+        DOT11s_DataSeenEntry* nextEntry = entry->expiryNext;
+
+        Dot11sDataSeenSet_Unhash(seenSet, entry);
+        Dot11sSlabPool_Free(&mp->itemPools->dataSeenPool, entry);
+        seenSet->numItems--;
+
+        entry = nextEntry;
+    }
+
+    seenSet->expiryHead = entry;
+    if (entry == NULL)
+    {
+        seenSet->expiryTail = NULL;
     }
 }
 
@@ -2198,9 +2979,9 @@ void Dot11sDataSeenList_Finalize(
     MacDataDot11* dot11)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* dataSeenList = mp->dataSeenList;
+    DOT11s_DataSeenSet* seenSet = mp->dataSeenSet;
 
-    if (dataSeenList == NULL)
+    if (seenSet == NULL)
     {
         return;
     }
@@ -2210,11 +2991,94 @@ void Dot11sDataSeenList_Finalize(
         char traceStr[MAX_STRING_LENGTH];
         sprintf(traceStr, "Dot11sDataSeenList_Finalize: "
             "Freed %d items",
-            ListGetSize(node, dataSeenList));
+            seenSet->numItems);
         MacDot11Trace(node, dot11, NULL, traceStr);
     }
 
-    ListFree(node, dataSeenList, FALSE);
+    // Entries are left to the data seen pool.
+    MEM_free(seenSet->table);
+    MEM_free(seenSet);
+    mp->dataSeenSet = NULL;
+}
+
+
+/**
+FUNCTION   :: Dot11s_ScheduleMaintenance
+LAYER      :: MAC
+PURPOSE    :: Set the maintenance timer to the earliest aging deadline
+                of the mesh tables, rounded up to the aging resolution.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+NOTES      :: Call after adding a deadline. The timer is left alone
+                if it already fires early enough, and is not started
+                when nothing is left to age.
+**/
+
+static
+void Dot11s_ScheduleMaintenance(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_Aging* aging = mp->aging;
+
+    if (!aging->isStarted)
+    {
+        return;
+    }
+
+    BOOL isDeadlineFound = FALSE;
+    clocktype deadline = 0;
+
+    if (aging->neighborDeadlines.numEntries > 0)
+    {
+        deadline = aging->neighborDeadlines.entries[0].deadline;
+        isDeadlineFound = TRUE;
+    }
+    if (aging->portalDeadlines.numEntries > 0
+        && (!isDeadlineFound
+            || aging->portalDeadlines.entries[0].deadline < deadline))
+    {
+        deadline = aging->portalDeadlines.entries[0].deadline;
+        isDeadlineFound = TRUE;
+    }
+    if (mp->dataSeenSet->expiryHead != NULL)
+    {
+        clocktype dataSeenDeadline =
+            mp->dataSeenSet->expiryHead->item.insertTime
+            + DOT11s_DATA_SEEN_AGING_TIME;
+        if (!isDeadlineFound || dataSeenDeadline < deadline)
+        {
+            deadline = dataSeenDeadline;
+            isDeadlineFound = TRUE;
+        }
+    }
+
+    if (!isDeadlineFound)
+    {
+        return;
+    }
+
+    // Items expire once their deadline is strictly in the past.
+    clocktype expiry =
+        (deadline / DOT11s_AGING_RESOLUTION + 1) * DOT11s_AGING_RESOLUTION;
+
+    if (aging->timerMsg != NULL)
+    {
+        if (aging->timerExpiry <= expiry)
+        {
+            return;
+        }
+        MESSAGE_CancelSelfMsg(node, aging->timerMsg);
+    }
+
+    DOT11s_TimerInfo timerInfo;
+    aging->timerMsg = Dot11s_StartTimer(node, dot11, &timerInfo,
+        expiry - getSimTime(node),
+        MSG_MAC_DOT11s_MaintenanceTimer);
+    aging->timerExpiry = expiry;
 }
 
 
@@ -2235,37 +3099,29 @@ DOT11s_StationItem* Dot11sStationList_Lookup(
     Mac802Address staAddr)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* list = mp->stationList;
 
-    ListItem* listItem = list->first;
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        mp->stationIndex, Dot11sAddrIndex_Key(staAddr));
     DOT11s_StationItem* item = NULL;
-    BOOL isItemFound = FALSE;
 
-    while (listItem != NULL)
+    if (listItem != NULL)
     {
         item = (DOT11s_StationItem*) listItem->data;
-        if (item->staAddr == staAddr)
+        if (DOT11s_TraceComments)
         {
-            if (DOT11s_TraceComments)
-            {
-                //char traceStr[MAX_STRING_LENGTH];
-                //char staStr[MAX_STRING_LENGTH];
-                //Dot11s_AddrAsDotIP(staStr, item->staAddr);
-                //char prevApStr[MAX_STRING_LENGTH];
-                //Dot11s_AddrAsDotIP(prevApStr, item->prevApAddr);
-                //sprintf(traceStr, "Dot11sStationList_Lookup: "
-                //    "found sta=%s, prevAp=%s, status=%d",
-                //    staStr, prevApStr, item->status);
-                //MacDot11Trace(node, dot11, NULL, traceStr);
-            }
-
-            isItemFound = TRUE;
-            break;
+            //char traceStr[MAX_STRING_LENGTH];
+            //char staStr[MAX_STRING_LENGTH];
+            //Dot11s_AddrAsDotIP(staStr, item->staAddr);
+            //char prevApStr[MAX_STRING_LENGTH];
+            //Dot11s_AddrAsDotIP(prevApStr, item->prevApAddr);
+            //sprintf(traceStr, "Dot11sStationList_Lookup: "
+            //    "found sta=%s, prevAp=%s, status=%d",
+            //    staStr, prevApStr, item->status);
+            //MacDot11Trace(node, dot11, NULL, traceStr);
         }
-        listItem = listItem->next;
     }
 
-    return (isItemFound ? item : NULL);
+    return item;
 }
 
 
@@ -2314,14 +3170,14 @@ void Dot11sStationList_Insert(
     }
 
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* list = mp->stationList;
 
     Dot11s_MallocMemset0(DOT11s_StationItem, item);
     item->staAddr = staAddr;
     item->prevApAddr = previousAp;
     item->status = status;
 
-    ListAppend(node, list, 0, item);
+    Dot11sKeyedList_Append(node, mp->stationList, mp->stationIndex,
+        Dot11sAddrIndex_Key(staAddr), item);
 }
 
 
@@ -2345,30 +3201,28 @@ void Dot11sStationList_Delete(
     ERROR_Assert(dot11->isMAP,
         "Dot11sStationList_Delete: Not an MAP.\n");
 
-    LinkedList* list = dot11->mp->stationList;
-    ListItem* listItem = list->first;
-    DOT11s_StationItem* item = NULL;
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_AddrKey key = Dot11sAddrIndex_Key(staAddr);
 
-    while (listItem != NULL)
+    ListItem* listItem = Dot11sAddrIndex_Lookup(mp->stationIndex, key);
+    if (listItem == NULL)
     {
-        item = (DOT11s_StationItem*) listItem->data;
-        if (item->staAddr == staAddr)
-        {
-            if (DOT11s_TraceComments)
-            {
-                char traceStr[MAX_STRING_LENGTH];
-                char staStr[MAX_STRING_LENGTH];
-                Dot11s_AddrAsDotIP(staStr, &item->staAddr);
-                sprintf(traceStr, "Dot11sStationList_Delete: "
-                    "deleting sta=%s", staStr);
-                MacDot11Trace(node, dot11, NULL, traceStr);
-            }
+        return;
+    }
 
-            ListDelete(node, list, listItem, FALSE);
-            break;
-        }
-        listItem = listItem->next;
+    if (DOT11s_TraceComments)
+    {
+        DOT11s_StationItem* item = (DOT11s_StationItem*) listItem->data;
+        char traceStr[MAX_STRING_LENGTH];
+        char staStr[MAX_STRING_LENGTH];
+        Dot11s_AddrAsDotIP(staStr, &item->staAddr);
+        sprintf(traceStr, "Dot11sStationList_Delete: "
+            "deleting sta=%s", staStr);
+        MacDot11Trace(node, dot11, NULL, traceStr);
     }
+
+    Dot11sKeyedList_Delete(node, mp->stationList, mp->stationIndex,
+        NULL, key, listItem);
 }
 
 
@@ -2404,6 +3258,7 @@ void Dot11sStationList_Finalize(
     }
 
     ListFree(node, list, FALSE);
+    Dot11sAddrIndex_Free(dot11->mp->stationIndex);
 }
 
 
@@ -2453,7 +3308,6 @@ DOT11s_E2eItem* Dot11sE2eList_Insert(
     int seqNo)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* list = mp->e2eList;
 
     DOT11s_E2eItem* item;
     Dot11s_MallocMemset0(DOT11s_E2eItem, item);
@@ -2461,7 +3315,8 @@ DOT11s_E2eItem* Dot11sE2eList_Insert(
     item->SA = SA;
     item->seqNo = seqNo;
 
-    ListAppend(node, list, 0, item);
+    Dot11sKeyedList_Append(node, mp->e2eList, mp->e2eIndex,
+        Dot11sAddrIndex_Key(DA, SA), item);
 
     return item;
 }
@@ -2486,38 +3341,29 @@ DOT11s_E2eItem* Dot11sE2eList_Lookup(
     Mac802Address SA)
 {
     DOT11s_Data* mp = dot11->mp;
-    LinkedList* list = mp->e2eList;
-
-    ListItem* listItem = list->first;
-    DOT11s_E2eItem* e2eItem = NULL;
-    BOOL isFound = FALSE;
-
-    while (listItem != NULL)
-    {
-        e2eItem = (DOT11s_E2eItem*) listItem->data;
-        if (e2eItem->DA == DA
-            && e2eItem->SA == SA)
-        {
-            //if (DOT11s_TraceComments)
-            //{
-            //    char traceStr[MAX_STRING_LENGTH];
-            //    char addr1Str[MAX_STRING_LENGTH];
-            //    char addr2Str[MAX_STRING_LENGTH];
-            //    Dot11s_AddrAsDotIP(addr1Str, DA);
-            //    Dot11s_AddrAsDotIP(addr2Str, SA);
-            //    sprintf(traceStr, "Dot11sE2eList_Lookup: "
-            //        "found DA=%s, SA=%s, E2E=%d",
-            //        addr1Str, addr2Str, e2eItem->seqNo);
-            //    MacDot11Trace(node, dot11, NULL, traceStr);
-            //}
-
-            isFound = TRUE;
-            break;
-        }
-        listItem = listItem->next;
+
+    ListItem* listItem = Dot11sAddrIndex_Lookup(
+        mp->e2eIndex, Dot11sAddrIndex_Key(DA, SA));
+    DOT11s_E2eItem* e2eItem = NULL;
+
+    if (listItem != NULL)
+    {
+        e2eItem = (DOT11s_E2eItem*) listItem->data;
+        //if (DOT11s_TraceComments)
+        //{
+        //    char traceStr[MAX_STRING_LENGTH];
+        //    char addr1Str[MAX_STRING_LENGTH];
+        //    char addr2Str[MAX_STRING_LENGTH];
+        //    Dot11s_AddrAsDotIP(addr1Str, DA);
+        //    Dot11s_AddrAsDotIP(addr2Str, SA);
+        //    sprintf(traceStr, "Dot11sE2eList_Lookup: "
+        //        "found DA=%s, SA=%s, E2E=%d",
+        //        addr1Str, addr2Str, e2eItem->seqNo);
+        //    MacDot11Trace(node, dot11, NULL, traceStr);
+        //}
     }
 
-    return (isFound ? e2eItem : NULL);
+    return e2eItem;
 }
 
 
@@ -2587,6 +3433,7 @@ void Dot11sE2eList_Finalize(
     }
 
     ListFree(node, list, FALSE);
+    Dot11sAddrIndex_Free(mp->e2eIndex);
 }
 
 
@@ -2877,8 +3724,15 @@ void Dot11s_ReceiveBeaconFrame(
         if (neighborItem == NULL)
         {
             // Add neighbor to list
-            Dot11s_MallocMemset0(DOT11s_NeighborItem, neighborItem);
-            ListAppend(node, mp->neighborList, 0, neighborItem);
+            neighborItem = (DOT11s_NeighborItem*)
+                Dot11sSlabPool_Alloc(&mp->itemPools->neighborPool);
+            Dot11sKeyedList_Append(node, mp->neighborList,
+                mp->neighborIndex, Dot11sAddrIndex_Key(sourceAddr),
+                neighborItem);
+            Dot11sDeadlineHeap_Push(&mp->aging->neighborDeadlines,
+                getSimTime(node) + DOT11s_ASSOC_ACTIVE_TIMEOUT,
+                neighborItem);
+            Dot11s_ScheduleMaintenance(node, dot11);
 
             neighborItem->neighborAddr = sourceAddr;
             neighborItem->primaryAddr = dot11->selfAddr;
@@ -3382,8 +4236,15 @@ void Dot11s_ReceiveAssocRequestFrame(
         }
 
         // Add neighbor to list
-        Dot11s_MallocMemset0(DOT11s_NeighborItem, neighborItem);
-        ListAppend(node, mp->neighborList, 0, neighborItem);
+        neighborItem = (DOT11s_NeighborItem*)
+            Dot11sSlabPool_Alloc(&mp->itemPools->neighborPool);
+        Dot11sKeyedList_Append(node, mp->neighborList,
+            mp->neighborIndex, Dot11sAddrIndex_Key(sourceAddr),
+            neighborItem);
+        Dot11sDeadlineHeap_Push(&mp->aging->neighborDeadlines,
+            getSimTime(node) + DOT11s_ASSOC_ACTIVE_TIMEOUT,
+            neighborItem);
+        Dot11s_ScheduleMaintenance(node, dot11);
 
         // Fill in neighbor values
         neighborItem->neighborAddr = sourceAddr;
@@ -3711,26 +4572,23 @@ void Dot11s_SendLinkStateFrame(
     // Update neighbor's current rate
     DOT11_DataRateEntry* dataRateEntry =
         MacDot11StationGetDataRateEntry(node, dot11, destAddr);
-    neighborItem->dataRateInMbps =
+    int dataRateInMbps =
         Dot11s_GetDataRateInMbps(node,
         neighborItem->phyModel,
         dot11->myMacData->phyNumber,
         dataRateEntry->dataRateType);
 
-    float PER = 0;
-    if (neighborItem->framesSent > 0)
+    // Advertise the running PER estimate.
+    // Change this to the same granularity as used in frames
+    // else bi-directional comparison could be unequal.
+    // Float precision can only affect the limiting case.
+    float PER = neighborItem->perEstimate;
+    PER = (int) (PER / DOT11s_PER_MULTIPLE) * DOT11s_PER_MULTIPLE;
+    if (PER >= 1.0f)
     {
-        PER = neighborItem->framesResent / (float) neighborItem->framesSent;
-        // Change this to the same granularity as used in frames
-        // else bi-directional comparison could be unequal.
-        // Float precision can only affect the limiting case.
-        PER = (PER / DOT11s_PER_MULTIPLE) * DOT11s_PER_MULTIPLE;
-        if (PER >= 1.0f)
-        {
-            PER = 1.0f - DOT11s_PER_MULTIPLE;
-        }
+        PER = 1.0f - DOT11s_PER_MULTIPLE;
     }
-    neighborItem->PER = PER;
+    Dot11s_SetLinkMetricInputs(neighborItem, dataRateInMbps, PER);
 
     // Create and build frame.
     Dot11s_CreateLinkStateFrame(node, dot11,
@@ -3841,8 +4699,7 @@ void Dot11s_ReceiveLinkStateFrame(
         return;
     }
 
-    neighborItem->dataRateInMbps = r;
-    neighborItem->PER = e;
+    Dot11s_SetLinkMetricInputs(neighborItem, r, e);
     neighborItem->lastLinkStateTime = getSimTime(node);
 
     mp->stats.linkStateReceived++;
@@ -4000,6 +4857,9 @@ void Dot11s_ReceivePannFrame(
     {
         Dot11s_MallocMemset0(DOT11s_PortalItem, portalItem);
         ListAppend(node, mp->portalList, 0, portalItem);
+        Dot11sDeadlineHeap_Push(&mp->aging->portalDeadlines,
+            getSimTime(node) + mp->portalTimeout, portalItem);
+        Dot11s_ScheduleMaintenance(node, dot11);
 
         portalItem->portalAddr = pannData.portalAddr;
 
@@ -4060,6 +4920,333 @@ void Dot11s_ReceivePannFrame(
 }
 
 
+// ------------------------------------------------------------------
+// Mesh wide channel switch
+//
+// A mesh point proposes a channel with a countdown in beacon intervals.
+// Every mesh point that hears the announcement fixes the same absolute
+// switch time, relays the announcement at once and repeats it after
+// each of its own beacons until the switch. Neighbor and association
+// state is left alone; the mesh carries on over the new channel.
+
+
+/**
+FUNCTION   :: Dot11s_SendChannelSwitchFrame
+LAYER      :: MAC
+PURPOSE    :: Broadcast the pending channel switch with the number of
+                beacon intervals left and the exact time to go.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
+RETURN     :: void
+**/
+
+static
+void Dot11s_SendChannelSwitchFrame(
+    Node* node,
+    MacDataDot11* dot11)
+{
+    DOT11s_ChannelSwitch* chanSwitch = &dot11->meshChanSwitch;
+
+    // The count is rounded up for stations that only read the element;
+    // mesh points take the exact delay that follows it.
+    clocktype timeLeft = chanSwitch->switchTime - getSimTime(node);
+    clocktype switchCount = 0;
+    clocktype switchDelay = 0;
+    if (timeLeft > 0)
+    {
+        switchCount = (timeLeft + dot11->beaconInterval - 1)
+            / dot11->beaconInterval;
+        switchDelay = timeLeft / MICRO_SECOND;
+    }
+    if (switchCount > 255)
+    {
+        switchCount = 255;
+    }
+    if (switchDelay > 0xFFFFFFFF)
+    {
+        switchDelay = 0xFFFFFFFF;
+    }
+
+    int txFrameSize =
+        sizeof(DOT11_FrameHdr) + DOT11_CHANNEL_SWITCH_ANNOUNCEMENT_SIZE;
+
+    Message* msg = MESSAGE_Alloc(node, 0, 0, 0);
+    MESSAGE_PacketAlloc(node, msg, txFrameSize, TRACE_DOT11);
+    DOT11_FrameHdr* txFrame = (DOT11_FrameHdr*) MESSAGE_ReturnPacket(msg);
+    memset(txFrame, 0, (size_t)txFrameSize);
+
+    DOT11_ChannelSwitchAnnouncement* announcement =
+        (DOT11_ChannelSwitchAnnouncement*)
+        ((unsigned char*) txFrame + sizeof(DOT11_FrameHdr));
+    announcement->category = DOT11_ACTION_CATEGORY_SPECTRUM_MGMT;
+    announcement->actionFieldId = DOT11_SPECTRUM_MGMT_CHANNEL_SWITCH;
+    announcement->elementId = DOT11_IE_ID_CHANNEL_SWITCH;
+    announcement->length = 3;
+    // Transmissions continue on the current channel until the switch.
+    announcement->switchMode = 0;
+    announcement->newChannel = (unsigned char) chanSwitch->newChannel;
+    announcement->switchCount = (unsigned char) switchCount;
+    for (int i = 0; i < 4; i++)
+    {
+        announcement->switchDelay[i] =
+            (unsigned char) ((switchDelay >> (8 * i)) & 0xFF);
+    }
+
+    DOT11s_FrameInfo* newFrameInfo;
+    Dot11s_MallocMemset0(DOT11s_FrameInfo, newFrameInfo);
+    newFrameInfo->msg = msg;
+    newFrameInfo->frameType = DOT11_ACTION;
+    newFrameInfo->RA = ANY_MAC802;
+    newFrameInfo->TA = dot11->selfAddr;
+    newFrameInfo->SA = INVALID_802ADDRESS;
+    newFrameInfo->actionData.category = DOT11_ACTION_CATEGORY_SPECTRUM_MGMT;
+    newFrameInfo->actionData.fieldId = DOT11_SPECTRUM_MGMT_CHANNEL_SWITCH;
+
+    Dot11s_SetFieldsInMgmtFrameHdr(node, dot11, txFrame, newFrameInfo);
+    Dot11sMgmtQueue_EnqueuePacket(node, dot11, newFrameInfo);
+
+    chanSwitch->announcementsSent++;
+}
+
+
+/**
+FUNCTION   :: Dot11s_ScheduleChannelSwitch
+LAYER      :: MAC
+PURPOSE    :: Record a pending channel switch and start its timer.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ newChannel : int          : channel to move to
++ switchTime : clocktype    : absolute time of the move
+RETURN     :: void
+**/
+
+static
+void Dot11s_ScheduleChannelSwitch(
+    Node* node,
+    MacDataDot11* dot11,
+    int newChannel,
+    clocktype switchTime)
+{
+    DOT11s_ChannelSwitch* chanSwitch = &dot11->meshChanSwitch;
+
+    chanSwitch->isPending = TRUE;
+    chanSwitch->newChannel = newChannel;
+    chanSwitch->switchTime = switchTime;
+
+    DOT11s_TimerInfo timerInfo;
+    chanSwitch->timerMsg = Dot11s_StartTimer(node, dot11, &timerInfo,
+        switchTime - getSimTime(node),
+        MSG_MAC_DOT11s_ChannelSwitchTimer);
+
+    if (DOT11s_TraceComments)
+    {
+        char clockStr[MAX_STRING_LENGTH];
+        TIME_PrintClockInSecond(switchTime, clockStr);
+        char traceStr[MAX_STRING_LENGTH];
+        sprintf(traceStr,
+            "Mesh channel switch to %d at %s",
+            newChannel, clockStr);
+        MacDot11Trace(node, dot11, NULL, traceStr);
+    }
+}
+
+
+/**
+FUNCTION   :: Dot11s_ProposeChannelSwitch
+LAYER      :: MAC
+PURPOSE    :: Announce a mesh wide move to another channel.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ newChannel : int          : proposed channel
+RETURN     :: void
+NOTES      :: Ignored while another switch is pending; the mesh
+                follows the first proposal it hears.
+**/
+
+void Dot11s_ProposeChannelSwitch(
+    Node* node,
+    MacDataDot11* dot11,
+    int newChannel)
+{
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_ChannelSwitch* chanSwitch = &dot11->meshChanSwitch;
+    int phyIndex = dot11->myMacData->phyNumber;
+    int currentChannel;
+
+    PHY_GetTransmissionChannel(node, phyIndex, &currentChannel);
+
+    if (mp->state < DOT11s_S_INIT_COMPLETE
+        || chanSwitch->isPending
+        || newChannel == currentChannel
+        || newChannel < 0
+        || newChannel > 255
+        || newChannel >= PROP_NumberChannels(node)
+        || !PHY_CanListenToChannel(node, phyIndex, newChannel))
+    {
+        return;
+    }
+
+    chanSwitch->proposals++;
+
+    Dot11s_ScheduleChannelSwitch(node, dot11, newChannel,
+        getSimTime(node)
+        + chanSwitch->switchCount * dot11->beaconInterval);
+    Dot11s_SendChannelSwitchFrame(node, dot11);
+}
+
+
+/**
+FUNCTION   :: Dot11s_ReceiveChannelSwitchFrame
+LAYER      :: MAC
+PURPOSE    :: Receive a channel switch announcement from a neighbor.
+                The first announcement of a switch is adopted and
+                relayed; repeats and conflicting proposals are ignored.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : received message
++ dropFrame : BOOL*         : TRUE if the frame is malformed
+RETURN     :: void
+**/
+
+static
+void Dot11s_ReceiveChannelSwitchFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg,
+    BOOL* dropFrame)
+{
+    DOT11s_ChannelSwitch* chanSwitch = &dot11->meshChanSwitch;
+    int phyIndex = dot11->myMacData->phyNumber;
+
+    *dropFrame = TRUE;
+
+    if (MESSAGE_ReturnPacketSize(msg) < (int) sizeof(DOT11_FrameHdr)
+            + DOT11_CHANNEL_SWITCH_ANNOUNCEMENT_SIZE)
+    {
+        return;
+    }
+
+    DOT11_ChannelSwitchAnnouncement* announcement =
+        (DOT11_ChannelSwitchAnnouncement*)
+        (MESSAGE_ReturnPacket(msg) + sizeof(DOT11_FrameHdr));
+
+    if (announcement->elementId != DOT11_IE_ID_CHANNEL_SWITCH
+        || announcement->length != 3)
+    {
+        return;
+    }
+
+    int newChannel = announcement->newChannel;
+    if (newChannel >= PROP_NumberChannels(node)
+        || !PHY_CanListenToChannel(node, phyIndex, newChannel))
+    {
+        return;
+    }
+
+    *dropFrame = FALSE;
+    chanSwitch->announcementsReceived++;
+
+    if (chanSwitch->isPending)
+    {
+        if (chanSwitch->newChannel != newChannel)
+        {
+            chanSwitch->conflictsIgnored++;
+        }
+        MESSAGE_Free(node, msg);
+        return;
+    }
+
+    int currentChannel;
+    PHY_GetTransmissionChannel(node, phyIndex, &currentChannel);
+    if (newChannel != currentChannel)
+    {
+        // Switch when the sender does, not at a beacon boundary.
+        clocktype switchDelay = 0;
+        for (int i = 3; i >= 0; i--)
+        {
+            switchDelay = (switchDelay << 8) | announcement->switchDelay[i];
+        }
+        Dot11s_ScheduleChannelSwitch(node, dot11, newChannel,
+            getSimTime(node) + switchDelay * MICRO_SECOND);
+        Dot11s_SendChannelSwitchFrame(node, dot11);
+    }
+
+    MESSAGE_Free(node, msg);
+}
+
+
+/**
+FUNCTION   :: Dot11s_ChannelSwitchEvent
+LAYER      :: MAC
+PURPOSE    :: Move to the announced channel at the switch time.
+PARAMETERS ::
++ node      : Node*         : pointer to node
++ dot11     : MacDataDot11* : pointer to Dot11 data structure
++ msg       : Message*      : timer message
+RETURN     :: void
+NOTES      :: A frame exchange in progress is allowed to complete,
+                which delays the move by a few milliseconds at most.
+**/
+
+static
+void Dot11s_ChannelSwitchEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg)
+{
+    DOT11s_Data* mp = dot11->mp;
+    DOT11s_ChannelSwitch* chanSwitch = &dot11->meshChanSwitch;
+
+    if (!chanSwitch->isPending || chanSwitch->timerMsg != msg)
+    {
+        MESSAGE_Free(node, msg);
+        return;
+    }
+
+    if (MacDot11StationPhyStatus(node, dot11) == PHY_TRANSMITTING
+        || MacDot11IsTransmittingState(dot11->state)
+        || MacDot11IsWaitingForResponseState(dot11->state))
+    {
+        // Reuse message
+        MESSAGE_Send(node, msg, DOT11s_CHANNEL_SWITCH_RETRY_DELAY);
+        return;
+    }
+
+    int oldChannel = MacDot11SetOperatingChannel(
+        node, dot11, chanSwitch->newChannel);
+
+    chanSwitch->isPending = FALSE;
+    chanSwitch->timerMsg = NULL;
+    chanSwitch->switches++;
+
+    // Peers move at the same time. Restart link state aging so that
+    // the gap around the move does not close their links.
+    ListItem* listItem = mp->neighborList->first;
+    while (listItem != NULL)
+    {
+        DOT11s_NeighborItem* neighborItem =
+            (DOT11s_NeighborItem*) listItem->data;
+        if (neighborItem->state == DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP
+            || neighborItem->state == DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP)
+        {
+            neighborItem->lastLinkStateTime = getSimTime(node);
+        }
+        listItem = listItem->next;
+    }
+
+    char traceStr[MAX_STRING_LENGTH];
+    sprintf(traceStr, "Mesh channel switch from %d to %d",
+        oldChannel, chanSwitch->newChannel);
+    MacDot11Trace(node, dot11, NULL, traceStr);
+
+    MESSAGE_Free(node, msg);
+}
+
+
 /**
 FUNCTION   :: Dot11s_ReceiveMgmtBroadcast
 LAYER      :: MAC
@@ -4100,6 +5287,27 @@ BOOL Dot11s_ReceiveMgmtBroadcast(
             int offset = sizeof(DOT11_FrameHdr);
 
             unsigned char rxFrameCategory = *(rxFrame + offset);
+
+            // Channel switch announcement from a mesh neighbor
+            if (rxFrameCategory == DOT11_ACTION_CATEGORY_SPECTRUM_MGMT
+                && *(rxFrame + offset + 1)
+                    == DOT11_SPECTRUM_MGMT_CHANNEL_SWITCH)
+            {
+                msgIsProcessed = TRUE;
+
+                if (Dot11s_IsAssociatedNeighbor(node, dot11, sourceAddr)
+                    == FALSE)
+                {
+                    dropFrame = TRUE;
+                    break;
+                }
+
+                Dot11s_ReceiveChannelSwitchFrame(
+                    node, dot11, msg, &dropFrame);
+
+                break;
+            }
+
             if (rxFrameCategory != DOT11_ACTION_MESH)
             {
                 break;
@@ -4606,6 +5814,7 @@ void Dot11s_PacketRetransmitEvent(
         {
             // Update retransmit count to measure PER
             neighborItem->framesResent += DOT11s_FRAME_RETRANSMIT_PENALTY;
+            Dot11s_UpdatePerEstimate(neighborItem, TRUE);
         }
     }
 }
@@ -4648,6 +5857,7 @@ void Dot11s_PacketDropEvent(
         if (Dot11s_IsAssociatedNeighbor(node, dot11, frameInfo->RA))
         {
             neighborItem->framesResent += DOT11s_FRAME_DROP_PENALTY;
+            Dot11s_UpdatePerEstimate(neighborItem, TRUE);
 
             // Notify active protocol for link failure
             mp->activeProtocol.linkFailureFunction(node, dot11,
@@ -4690,13 +5900,15 @@ void Dot11s_PacketAckEvent(
     if (Dot11s_IsAssociatedNeighbor(node, dot11, frameInfo->RA))
     {
         neighborItem->framesSent++;
+        Dot11s_UpdatePerEstimate(neighborItem, FALSE);
     }
 
     switch (frameInfo->frameType)
     {
         case DOT11_ACTION:
         {
-            if (frameInfo->actionData.fieldId
+            if (frameInfo->actionData.category == DOT11_ACTION_MESH
+                && frameInfo->actionData.fieldId
                 == DOT11_MESH_LINK_STATE_ANNOUNCEMENT)
             {
                 if (neighborItem->state ==
@@ -6257,6 +7469,12 @@ void Dot11s_BeaconTransmitted(
 
     mp->stats.beaconsSent++;
 
+    // Count down a pending channel switch with every beacon.
+    if (dot11->meshChanSwitch.isPending)
+    {
+        Dot11s_SendChannelSwitchFrame(node, dot11);
+    }
+
     switch (mp->state)
     {
         case DOT11s_S_INIT_COMPLETE:
@@ -6680,6 +7898,7 @@ void Dot11sAssoc_IdleState(
 
         neighborItem->framesSent = 0;
         neighborItem->framesResent = 0;
+        neighborItem->perEstimate = 0.0f;
 
         break;
     }
@@ -8219,6 +9438,35 @@ void Dot11s_ReadUserConfiguration(
         mp->netDiameter = (unsigned char) inputInt;
     }
 
+    // Read the channel switch countdown.
+    //       MAC-DOT11s-CHANNEL-SWITCH-COUNT <int>
+    // Default is DOT11s_CHANNEL_SWITCH_COUNT_DEFAULT beacon intervals.
+
+    dot11->meshChanSwitch.switchCount = DOT11s_CHANNEL_SWITCH_COUNT_DEFAULT;
+
+    Dot11sIO_ReadInt(
+        node->nodeId,
+        address,
+        nodeInput,
+        "MAC-DOT11s-CHANNEL-SWITCH-COUNT",
+        &wasFound,
+        &inputInt,
+        isZeroValid,
+        isNegativeValid);
+
+    if (wasFound)
+    {
+        if (inputInt > 255)
+        {
+            ERROR_ReportError("Dot11s_ReadUserConfiguration: "
+                "Invalid value for MAC-DOT11s-CHANNEL-SWITCH-COUNT "
+                "in configuration file.\n"
+                "Value should be less than 256.\n");
+        }
+
+        dot11->meshChanSwitch.switchCount = inputInt;
+    }
+
     // Read the node traversal time.
     //       MAC-DOT11s-NODE-TRAVERSAL-TIME <time>
     // Default is DOT11s_NODE_TRAVERSAL_TIME_DEFAULT.
@@ -8462,16 +9710,33 @@ void Dot11s_Init(
     Dot11s_MallocMemset0(DOT11s_Data, mp);
     dot11->mp = mp;
 
+    Dot11s_MallocMemset0(DOT11s_Aging, mp->aging);
+
+    Dot11s_MallocMemset0(DOT11s_ItemPools, mp->itemPools);
+    Dot11sSlabPool_Init(&mp->itemPools->neighborPool,
+        "neighbor", sizeof(DOT11s_NeighborItem));
+    Dot11sSlabPool_Init(&mp->itemPools->proxyPool,
+        "proxy", sizeof(DOT11s_ProxyItem));
+    Dot11sSlabPool_Init(&mp->itemPools->fwdPool,
+        "forwarding", sizeof(DOT11s_FwdItem));
+    Dot11sSlabPool_Init(&mp->itemPools->dataSeenPool,
+        "data seen", sizeof(DOT11s_DataSeenEntry));
+
     ListInit(node, &(mp->neighborList));
+    Dot11sAddrIndex_Init(&(mp->neighborIndex));
     ListInit(node, &(mp->portalList));
 
     Dot11s_MallocMemset0(DOT11s_InitValues, mp->initValues);
 
     ListInit(node, &(mp->proxyList));
+    Dot11sAddrIndex_Init(&(mp->proxyIndex));
     ListInit(node, &(mp->fwdList));
-    ListInit(node, &(mp->dataSeenList));
+    Dot11sAddrIndex_Init(&(mp->fwdIndex));
+    Dot11sDataSeenSet_Init(node, dot11);
     ListInit(node, &(mp->e2eList));
+    Dot11sAddrIndex_Init(&(mp->e2eIndex));
     ListInit(node, &(mp->stationList));
+    Dot11sAddrIndex_Init(&(mp->stationIndex));
 
     Dot11s_Memset0(DOT11s_Stats, &(mp->stats));
 
@@ -8663,10 +9928,9 @@ void Dot11s_HandleTimeout(
             // Inform active protocol
             // Not needed for HWMP.
 
-            // Start maintenance timer
-            DOT11s_TimerInfo timerInfo;
-            Dot11s_StartTimer(node, dot11, &timerInfo, SECOND,
-                MSG_MAC_DOT11s_MaintenanceTimer);
+            // Start aging the mesh tables
+            mp->aging->isStarted = TRUE;
+            Dot11s_ScheduleMaintenance(node, dot11);
 
             if (dot11->state == DOT11_S_IDLE
                 && MacDot11StationPhyStatus(node, dot11) == PHY_IDLE)
@@ -8680,14 +9944,22 @@ void Dot11s_HandleTimeout(
         }
         case MSG_MAC_DOT11s_MaintenanceTimer:
         {
+            if (msg != mp->aging->timerMsg)
+            {
+                MESSAGE_Free(node, msg);
+                break;
+            }
+            mp->aging->timerMsg = NULL;
+            MESSAGE_Free(node, msg);
+
             Dot11sDataSeenList_AgeItems(node, dot11);
 
             Dot11sPortalList_AgeItems(node, dot11);
 
             Dot11sNeighborList_AgeItems(node, dot11);
 
-            // Start next maintenance timer
-            MESSAGE_Send(node, msg, SECOND);
+            // Sleep until the next deadline
+            Dot11s_ScheduleMaintenance(node, dot11);
 
             break;
         }
@@ -8875,6 +10147,12 @@ void Dot11s_HandleTimeout(
             break;
         }
 
+        case MSG_MAC_DOT11s_ChannelSwitchTimer:
+        {
+            Dot11s_ChannelSwitchEvent(node, dot11, msg);
+
+            break;
+        }
         case MSG_MAC_DOT11s_HwmpActiveRouteTimeout:
         case MSG_MAC_DOT11s_HwmpDeleteRouteTimeout:
         case MSG_MAC_DOT11s_HwmpRreqReplyTimeout:
@@ -8985,6 +10263,26 @@ void Dot11s_PrintStats(
         stats->mgmtUcDropped);
     DOT11s_STATS_PRINT;
 
+    sprintf(buf, "Mesh channel switches proposed = %d",
+        dot11->meshChanSwitch.proposals);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh channel switch announcements sent = %d",
+        dot11->meshChanSwitch.announcementsSent);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh channel switch announcements received = %d",
+        dot11->meshChanSwitch.announcementsReceived);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh channel switch conflicting proposals ignored = %d",
+        dot11->meshChanSwitch.conflictsIgnored);
+    DOT11s_STATS_PRINT;
+
+    sprintf(buf, "Mesh channel switches = %d",
+        dot11->meshChanSwitch.switches);
+    DOT11s_STATS_PRINT;
+
     //sprintf(buf, "Mesh packets to Network layer = %d",
     //    stats->pktsToNetworkLayer);
     //DOT11s_STATS_PRINT;
@@ -9086,6 +10384,14 @@ void Dot11s_PrintStats(
         stats->dataQueueUcDropped);
     DOT11s_STATS_PRINT;
 
+    Dot11sSlabPool_PrintStats(node, dot11, interfaceIndex,
+        &mp->itemPools->neighborPool);
+    Dot11sSlabPool_PrintStats(node, dot11, interfaceIndex,
+        &mp->itemPools->proxyPool);
+    Dot11sSlabPool_PrintStats(node, dot11, interfaceIndex,
+        &mp->itemPools->fwdPool);
+    Dot11sSlabPool_PrintStats(node, dot11, interfaceIndex,
+        &mp->itemPools->dataSeenPool);
 }
 
 
@@ -9144,6 +10450,18 @@ void Dot11s_Finalize(
     // Free end to end tracking list
     Dot11sE2eList_Finalize(node, dot11);
 
+    // Free aging deadlines
+    Dot11sDeadlineHeap_Free(&mp->aging->neighborDeadlines);
+    Dot11sDeadlineHeap_Free(&mp->aging->portalDeadlines);
+    MEM_free(mp->aging);
+
+    // Free the items of the lists above
+    Dot11sSlabPool_Finalize(&mp->itemPools->neighborPool);
+    Dot11sSlabPool_Finalize(&mp->itemPools->proxyPool);
+    Dot11sSlabPool_Finalize(&mp->itemPools->fwdPool);
+    Dot11sSlabPool_Finalize(&mp->itemPools->dataSeenPool);
+    MEM_free(mp->itemPools);
+
     // Free MP protocol data
     MEM_free(mp);
 }
@@ -9223,7 +10541,8 @@ unsigned int ATLM_ComputeLinkMetric(
 /**
 FUNCTION   :: Dot11s_ComputeLinkMetric
 LAYER      :: MAC
-PURPOSE    :: Compute link metric for given peer address.
+PURPOSE    :: Return the link metric for given peer address. The value
+                is cached in the neighbor item until its inputs change.
 PARAMETERS ::
 + node      : Node*         : pointer to node
 + dot11     : MacDataDot11* : pointer to Dot11 data structure
@@ -9258,10 +10577,17 @@ unsigned int Dot11s_ComputeLinkMetric(
     {
         case DOT11s_PATH_METRIC_AIRTIME:
         {
-            linkMetric = ATLM_ComputeLinkMetric(node, dot11,
-                neighborItem->phyModel,
-                neighborItem->dataRateInMbps,
-                neighborItem->PER);
+            // Recomputed only after the rate or PER has changed.
+            if (!neighborItem->isLinkMetricValid)
+            {
+                neighborItem->linkMetric = ATLM_ComputeLinkMetric(
+                    node, dot11,
+                    neighborItem->phyModel,
+                    neighborItem->dataRateInMbps,
+                    neighborItem->PER);
+                neighborItem->isLinkMetricValid = TRUE;
+            }
+            linkMetric = neighborItem->linkMetric;
 
             break;
         }
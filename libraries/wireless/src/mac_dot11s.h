@@ -0,0 +1,865 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*!
+ * \file mac_dot11s.h
+ * \brief Mesh point data and tables of 802.11s.
+ *
+ * Frame formats and element parsing are in mac_dot11s-frames.h, the
+ * HWMP path protocol is in mac_dot11s-hwmp.h.
+ */
+
+#ifndef MAC_DOT11S_H
+#define MAC_DOT11S_H
+
+#include "api.h"
+#include "mac_dot11.h"
+#include "mac_dot11s-frames.h"
+
+//--------------------------------------------------------------------
+// Defaults
+
+// Mesh ID used if none is configured.
+#define DOT11s_MESH_ID_DEFAULT                  "QualNet-Mesh"
+
+// Mesh ID of a beacon or open frame without a Mesh ID element.
+#define DOT11s_MESH_ID_INVALID                  ""
+
+// BSS ID in the header of mesh management frames.
+#define DOT11s_MESH_BSS_ID                      ANY_MAC802
+
+// SSID an MAP carries while it is initializing, so that stations
+// do not associate before mesh services start.
+#define DOT11s_SSID_WILDCARD                    "#DOT11s-MESH-INIT-WILDCARD-SSID"
+
+// Maximum number of peer links an MP accepts.
+#define DOT11s_PEER_CAPACITY_MAX                32
+
+#define DOT11s_LINK_SETUP_RATE_LIMIT_DEFAULT    3
+#define DOT11s_NET_DIAMETER_DEFAULT             32
+#define DOT11s_NODE_TRAVERSAL_TIME_DEFAULT      (40 * MILLI_SECOND)
+#define DOT11s_PORTAL_TIMEOUT_DEFAULT           (3 * SECOND)
+
+// A broadcast from the mesh is also handed to the network layer
+// of an MAP.
+#define DOT11s_MAP_HANDOFF_BC_TO_NETWORK_LAYER  TRUE
+
+// Approximate air time of a beacon, used to space beacons of
+// neighboring MPs apart.
+#define DOT11s_BEACON_DURATION_80211b_APPROX    (1 * MILLI_SECOND)
+#define DOT11s_BEACON_DURATION_80211a_APPROX    (200 * MICRO_SECOND)
+
+//--------------------------------------------------------------------
+// Initialization stages, in beacon intervals
+
+#define DOT11s_INIT_START_BEACON_COUNT          4
+#define DOT11s_NEIGHBOR_DISCOVERY_BEACON_COUNT  3
+#define DOT11s_LINK_SETUP_BEACON_COUNT          3
+#define DOT11s_LINK_STATE_BEACON_COUNT          2
+#define DOT11s_PATH_SELECTION_BEACON_COUNT      2
+
+//--------------------------------------------------------------------
+// Timers
+
+// Maximum random jitter added to periodic timers.
+#define DOT11s_JITTER_TIME                      (10 * MILLI_SECOND)
+
+#define DOT11s_LINK_SETUP_TIMER                 (5 * SECOND)
+#define DOT11s_LINK_STATE_TIMER                 (5 * SECOND)
+#define DOT11s_PATH_SELECTION_TIMER             (5 * SECOND)
+#define DOT11s_PANN_TIMER                       (1 * SECOND)
+#define DOT11s_PANN_PROPAGATION_DELAY           (10 * MILLI_SECOND)
+
+// Age of frames waiting in the mesh queues, and period of the check.
+#define DOT11s_QUEUE_AGING_TIME                 (2 * SECOND)
+
+// Age of an entry in the data seen list.
+#define DOT11s_DATA_SEEN_AGING_TIME             (5 * SECOND)
+
+//--------------------------------------------------------------------
+// Peer link setup
+
+// Neighbor is dropped when no beacon is heard for this long.
+#define DOT11s_ASSOC_ACTIVE_TIMEOUT             (10 * SECOND)
+
+// Initial retry timeout; doubled on every retry.
+#define DOT11s_ASSOC_RETRY_TIMEOUT              (40 * MILLI_SECOND)
+#define DOT11s_ASSOC_OPEN_TIMEOUT               (40 * MILLI_SECOND)
+#define DOT11s_ASSOC_HOLD_TIMEOUT               (40 * MILLI_SECOND)
+#define DOT11s_ASSOC_REQUESTS_MAX               3
+
+//--------------------------------------------------------------------
+// Link metric
+
+// Granularity of the PER carried in link state frames.
+#define DOT11s_PER_MULTIPLE                     0.01f
+
+// Frames counted as resent for a retransmission and for a drop.
+#define DOT11s_FRAME_RETRANSMIT_PENALTY         1
+#define DOT11s_FRAME_DROP_PENALTY               4
+
+//--------------------------------------------------------------------
+// Utility macros
+
+#define Dot11s_Memset0(type, ptr) \
+    memset((ptr), 0, sizeof(type))
+
+#define Dot11s_MallocMemset0(type, ptr) \
+    do { \
+        (ptr) = (type*) MEM_malloc(sizeof(type)); \
+        memset((ptr), 0, sizeof(type)); \
+    } while (0)
+
+// Print buf as a MAC statistic; expects node and interfaceIndex.
+#define DOT11s_STATS_PRINT \
+    IO_PrintStat(node, "MAC", "802.11s", ANY_DEST, interfaceIndex, buf)
+
+//--------------------------------------------------------------------
+// States
+
+/**
+ENUM        :: DOT11s_MpState
+DESCRIPTION :: Initialization stages of a mesh point, in order.
+**/
+enum DOT11s_MpState
+{
+    DOT11s_S_INIT_START,
+    DOT11s_S_NEIGHBOR_DISCOVERY,
+    DOT11s_S_LINK_SETUP,
+    DOT11s_S_LINK_STATE,
+    DOT11s_S_PATH_SELECTION,
+    DOT11s_S_INIT_COMPLETE
+};
+
+/**
+ENUM        :: DOT11s_NeighborState
+DESCRIPTION :: State of a neighbor. States after
+               DOT11s_NEIGHBOR_ASSOC_PENDING have a peer link.
+**/
+enum DOT11s_NeighborState
+{
+    DOT11s_NEIGHBOR_NO_CAPABILITY,
+    DOT11s_NEIGHBOR_CANDIDATE_PEER,
+    DOT11s_NEIGHBOR_ASSOC_PENDING,
+    DOT11s_NEIGHBOR_SUBORDINATE_LINK_DOWN,
+    DOT11s_NEIGHBOR_SUBORDINATE_LINK_UP,
+    DOT11s_NEIGHBOR_SUPERORDINATE_LINK_DOWN,
+    DOT11s_NEIGHBOR_SUPERORDINATE_LINK_UP
+};
+
+/**
+ENUM        :: DOT11s_AssocState
+DESCRIPTION :: States of the peer link state machine.
+**/
+enum DOT11s_AssocState
+{
+    DOT11s_ASSOC_S_IDLE,
+    DOT11s_ASSOC_S_LISTEN,
+    DOT11s_ASSOC_S_OPEN_SENT,
+    DOT11s_ASSOC_S_CONFIRM_RECEIVED,
+    DOT11s_ASSOC_S_CONFIRM_SENT,
+    DOT11s_ASSOC_S_ESTABLISHED,
+    DOT11s_ASSOC_S_HOLDING
+};
+
+/**
+ENUM        :: DOT11s_AssocStateEvent
+DESCRIPTION :: Events of the peer link state machine.
+**/
+enum DOT11s_AssocStateEvent
+{
+    DOT11s_ASSOC_S_EVENT_ENTER_STATE,
+    DOT11s_ASSOC_S_EVENT_CANCEL_LINK,
+    DOT11s_ASSOC_S_EVENT_ACTIVE_OPEN,
+    DOT11s_ASSOC_S_EVENT_PASSIVE_OPEN,
+    DOT11s_ASSOC_S_EVENT_CLOSE_RECEIVED,
+    DOT11s_ASSOC_S_EVENT_OPEN_RECEIVED,
+    DOT11s_ASSOC_S_EVENT_CONFIRM_RECEIVED,
+    DOT11s_ASSOC_S_EVENT_OPEN_TIMEOUT,
+    DOT11s_ASSOC_S_EVENT_RETRY_TIMEOUT,
+    DOT11s_ASSOC_S_EVENT_CANCEL_TIMEOUT
+};
+
+/**
+ENUM        :: DOT11s_FwdItemType
+DESCRIPTION :: How a forwarding entry was learnt.
+**/
+enum DOT11s_FwdItemType
+{
+    DOT11s_FWD_UNKNOWN,
+    DOT11s_FWD_OUTSIDE_MESH_MPP
+};
+
+/**
+ENUM        :: DOT11s_StationStatus
+DESCRIPTION :: Status of a station associated with an MAP.
+**/
+enum DOT11s_StationStatus
+{
+    DOT11s_STATION_ACTIVE
+};
+
+//--------------------------------------------------------------------
+// Table items
+
+struct DOT11s_Data;
+
+typedef void (*DOT11s_AssocStateFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_Data* mp);
+
+/**
+STRUCT      :: DOT11s_NeighborItem
+DESCRIPTION :: Neighbor MP and its peer link.
+**/
+struct DOT11s_NeighborItem
+{
+    Mac802Address neighborAddr;
+    Mac802Address primaryAddr;
+
+    DOT11s_NeighborState state;
+    DOT11s_NeighborState prevState;
+
+    DOT11s_AssocState assocState;
+    DOT11s_AssocState prevAssocState;
+    DOT11s_AssocStateFunctionType assocStateFn;
+
+    BOOL isAuthenticated;
+    unsigned int linkId;
+    unsigned int peerLinkId;
+    DOT11s_PeerLinkStatus linkStatus;
+    DOT11s_PeerLinkStatus peerLinkStatus;
+    BOOL isConfirmSent;
+    BOOL isConfirmReceived;
+    BOOL isCancelled;
+
+    int retryCount;
+    clocktype retryTimeout;
+    Message* retryTimerMsg;
+    Message* openTimerMsg;
+    Message* cancelTimerMsg;
+
+    int beaconInterval;
+    int beaconsReceived;
+    clocktype firstBeaconTime;
+    clocktype lastBeaconTime;
+    clocktype lastLinkStateTime;
+
+    // Link metric inputs
+    PhyModel phyModel;
+    int dataRateInMbps;
+    float PER;
+
+    int framesSent;
+    int framesResent;
+
+    // Exponentially weighted PER of transmits to the neighbor
+    float perEstimate;
+
+    // Link metric computed from dataRateInMbps and PER; valid until
+    // either changes.
+    unsigned int linkMetric;
+    BOOL isLinkMetricValid;
+};
+
+/**
+STRUCT      :: DOT11s_PortalItem
+DESCRIPTION :: Mesh portal heard through portal announcements.
+**/
+struct DOT11s_PortalItem
+{
+    Mac802Address portalAddr;
+    Mac802Address nextHopAddr;
+    DOT11s_PannData lastPannData;
+    clocktype lastPannTime;
+    BOOL isActive;
+};
+
+/**
+STRUCT      :: DOT11s_ProxyItem
+DESCRIPTION :: Station and the MAP or portal that proxies it.
+**/
+struct DOT11s_ProxyItem
+{
+    Mac802Address staAddr;
+    BOOL inMesh;
+    BOOL isProxied;
+    Mac802Address proxyAddr;
+};
+
+/**
+STRUCT      :: DOT11s_FwdItem
+DESCRIPTION :: Next hop to a mesh destination.
+**/
+struct DOT11s_FwdItem
+{
+    Mac802Address mpAddr;
+    Mac802Address nextHopAddr;
+    DOT11s_FwdItemType itemType;
+};
+
+/**
+STRUCT      :: DOT11s_StationItem
+DESCRIPTION :: Station associated with an MAP.
+**/
+struct DOT11s_StationItem
+{
+    Mac802Address staAddr;
+    Mac802Address prevApAddr;
+    DOT11s_StationStatus status;
+};
+
+/**
+STRUCT      :: DOT11s_E2eItem
+DESCRIPTION :: Last end to end sequence number of a DA/SA pair.
+**/
+struct DOT11s_E2eItem
+{
+    Mac802Address DA;
+    Mac802Address SA;
+    int seqNo;
+};
+
+/**
+STRUCT      :: DOT11s_DataSeenItem
+DESCRIPTION :: Broadcast data frame already seen, to drop duplicates.
+**/
+struct DOT11s_DataSeenItem
+{
+    Mac802Address RA;
+    Mac802Address TA;
+    Mac802Address DA;
+    Mac802Address SA;
+    DOT11s_FwdControl fwdControl;
+    clocktype insertTime;
+};
+
+/**
+STRUCT      :: DOT11s_TimerInfo
+DESCRIPTION :: Info field of mesh self timers.
+**/
+struct DOT11s_TimerInfo
+{
+    Mac802Address addr;
+
+    DOT11s_TimerInfo()
+    {
+    }
+
+    DOT11s_TimerInfo(const Mac802Address& timerAddr)
+        : addr(timerAddr)
+    {
+    }
+};
+
+//--------------------------------------------------------------------
+// Mesh point
+
+// Defined in mac_dot11s.cpp
+struct DOT11s_DataSeenSet;
+struct DOT11s_ItemPools;
+struct DOT11s_Aging;
+
+// Defined in mac_dot11s-index.h
+struct DOT11s_AddrIndex;
+
+/**
+STRUCT      :: DOT11s_InitValues
+DESCRIPTION :: Values needed only until initialization completes.
+**/
+struct DOT11s_InitValues
+{
+    char configSSID[DOT11_SSID_MAX_LENGTH + 1];
+    clocktype beaconDuration;
+    int beaconsSent;
+};
+
+/**
+STRUCT      :: DOT11s_AssocStateData
+DESCRIPTION :: Event and received values passed to the peer link
+               state functions.
+**/
+struct DOT11s_AssocStateData
+{
+    DOT11s_AssocStateEvent event;
+    DOT11s_NeighborItem* neighborItem;
+
+    char* peerMeshId;
+    DOT11s_PathProtocol peerPathProtocol;
+    DOT11s_PathMetric peerPathMetric;
+    int peerCapacity;
+    unsigned int linkId;
+    unsigned int peerLinkId;
+    DOT11s_PeerLinkStatus peerStatus;
+};
+
+typedef void (*DOT11s_RouterFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo,
+    BOOL* packetWasRouted);
+
+typedef void (*DOT11s_LinkUpdateFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address neighborAddr,
+    unsigned int metric,
+    clocktype lifetime,
+    int interfaceIndex);
+
+typedef void (*DOT11s_LinkFailureFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address neighborAddr,
+    Mac802Address destAddr,
+    int interfaceIndex);
+
+typedef void (*DOT11s_LinkCloseFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address neighborAddr,
+    int interfaceIndex);
+
+typedef void (*DOT11s_PathUpdateFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address destAddr,
+    unsigned int destSeqNo,
+    int hopCount,
+    unsigned int metric,
+    clocktype lifetime,
+    Mac802Address nextHopAddr,
+    BOOL isActive,
+    int interfaceIndex);
+
+typedef void (*DOT11s_StationAssociationFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr,
+    Mac802Address prevApAddr,
+    int interfaceIndex);
+
+typedef void (*DOT11s_StationDisassociationFunctionType)(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr,
+    int interfaceIndex);
+
+/**
+STRUCT      :: DOT11s_ActiveProtocol
+DESCRIPTION :: Path protocol in use and the functions it registers.
+**/
+struct DOT11s_ActiveProtocol
+{
+    BOOL isInitialized;
+    DOT11s_PathProtocol pathProtocol;
+
+    DOT11s_RouterFunctionType routerFunction;
+    DOT11s_LinkUpdateFunctionType linkUpdateFunction;
+    DOT11s_LinkFailureFunctionType linkFailureFunction;
+    DOT11s_LinkCloseFunctionType linkCloseFunction;
+    DOT11s_PathUpdateFunctionType pathUpdateFunction;
+    DOT11s_StationAssociationFunctionType stationAssociationFunction;
+    DOT11s_StationDisassociationFunctionType stationDisassociationFunction;
+};
+
+/**
+STRUCT      :: DOT11s_Stats
+DESCRIPTION :: Mesh point statistics.
+**/
+struct DOT11s_Stats
+{
+    int beaconsSent;
+    int beaconsReceived;
+    int assocRequestsSent;
+    int assocRequestsReceived;
+    int assocResponsesSent;
+    int assocResponsesReceived;
+    int assocCloseSent;
+    int assocCloseReceived;
+    int linkStateSent;
+    int linkStateReceived;
+    int pannInitiated;
+    int pannRelayed;
+    int pannReceived;
+    int pannDropped;
+    int mgmtBcDropped;
+    int mgmtUcDropped;
+
+    int pktsToNetworkLayer;
+    int dataBcToNetworkLayer;
+    int dataUcToNetworkLayer;
+    int pktsFromNetworkLayer;
+    int dataBcFromNetworkLayer;
+    int dataUcFromNetworkLayer;
+
+    int dataBcSentToBss;
+    int dataBcSentToMesh;
+    int dataBcReceivedFromBssAsUc;
+    int dataBcReceivedFromMesh;
+    int dataBcDropped;
+
+    int dataUcSentToBss;
+    int dataUcSentToMesh;
+    int dataUcReceivedFromBss;
+    int dataUcReceivedFromMesh;
+    int dataUcRelayedToBssFromBss;
+    int dataUcRelayedToBssFromMesh;
+    int dataUcRelayedToMeshFromBss;
+    int dataUcRelayedToMeshFromMesh;
+    int dataUcSentToRoutingFn;
+    int dataUcDropped;
+
+    int mgmtQueueBcDropped;
+    int mgmtQueueUcDropped;
+    int dataQueueBcDropped;
+    int dataQueueUcDropped;
+};
+
+/**
+STRUCT      :: DOT11s_Data
+DESCRIPTION :: Mesh point data, dot11->mp.
+**/
+struct DOT11s_Data
+{
+    DOT11s_MpState state;
+    DOT11s_MpState prevState;
+    DOT11s_InitValues* initValues;
+
+    // Configuration
+    char meshId[DOT11s_MESH_ID_LENGTH_MAX + 1];
+    DOT11s_PathProtocol pathProtocol;
+    DOT11s_PathMetric pathMetric;
+    int peerCapacity;
+    clocktype linkSetupPeriod;
+    int linkSetupRateLimit;
+    clocktype linkStatePeriod;
+    unsigned char netDiameter;
+    clocktype nodeTraversalTime;
+    BOOL isMpp;
+    clocktype pannPeriod;
+    clocktype portalTimeout;
+    int portalSeqNo;
+
+    DOT11s_ActiveProtocol activeProtocol;
+    DOT11s_AssocStateData assocStateData;
+
+    // Tables. Each index maps the address key of a table item to
+    // its list item.
+    LinkedList* neighborList;
+    DOT11s_AddrIndex* neighborIndex;
+    LinkedList* portalList;
+    LinkedList* proxyList;
+    DOT11s_AddrIndex* proxyIndex;
+    LinkedList* fwdList;
+    DOT11s_AddrIndex* fwdIndex;
+    // Hashed on DA, SA and end to end sequence number
+    DOT11s_DataSeenSet* dataSeenSet;
+    LinkedList* e2eList;
+    DOT11s_AddrIndex* e2eIndex;             // keyed on DA and SA
+    LinkedList* stationList;
+    DOT11s_AddrIndex* stationIndex;
+
+    // Slab pools the neighbor, proxy, forwarding and data seen items
+    // are allocated from
+    DOT11s_ItemPools* itemPools;
+
+    // Deadline queues and maintenance timer that age the tables
+    DOT11s_Aging* aging;
+
+    DOT11s_Stats stats;
+};
+
+//--------------------------------------------------------------------
+// Functions
+
+void Dot11sIO_ReadTime(
+    NodeAddress nodeId,
+    Address* address,
+    const NodeInput* nodeInput,
+    const char* parameter,
+    BOOL* wasFound,
+    clocktype* value,
+    BOOL isZeroValid);
+
+void Dot11sIO_ReadInt(
+    NodeAddress nodeId,
+    Address* address,
+    const NodeInput* nodeInput,
+    const char* parameter,
+    BOOL* wasFound,
+    int* value,
+    BOOL isZeroValid,
+    BOOL isNegativeValid);
+
+void ListPrepend(
+    Node *node,
+    LinkedList* list,
+    clocktype timeStamp,
+    void *data);
+
+void ListAppend(
+    Node *node,
+    LinkedList* list,
+    clocktype timeStamp,
+    void *data);
+
+void ListDelete(
+    Node *node,
+    LinkedList* list,
+    ListItem* listItem,
+    BOOL isMsg);
+
+BOOL Dot11s_IsSelfOrBssStationAddr(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address addr);
+
+void Dot11s_AddrAsDotIP(
+    char* addrStr,
+    const Mac802Address* macAddr);
+
+void Dot11s_TraceFrameInfo(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo,
+    const char* prependStr);
+
+void Dot11s_MemFreeFrameInfo(
+    Node* node,
+    DOT11s_FrameInfo** frameInfo,
+    BOOL deleteMsg);
+
+BOOL Dot11sMgmtQueue_DequeuePacket(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo** frameInfo);
+
+BOOL Dot11sMgmtQueue_EnqueuePacket(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11sMgmtQueue_Finalize(
+    Node* node,
+    MacDataDot11* dot11);
+
+BOOL Dot11sDataQueue_DequeuePacket(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo** frameInfo);
+
+BOOL Dot11sDataQueue_EnqueuePacket(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11sDataQueue_Finalize(
+    Node* node,
+    MacDataDot11* dot11);
+
+void Dot11s_DeletePacketsToNode(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address nextHopAddr,
+    Mac802Address destAddr);
+
+BOOL Dot11s_SendFrameToRoutingFunction(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_Data* mp,
+    const DOT11s_FrameInfo* const frameInfo,
+    Message* msg);
+
+int Dot11s_GetAssociatedNeighborCount(
+    Node* node,
+    MacDataDot11* dot11);
+
+DOT11s_ProxyItem* Dot11sProxyList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr);
+
+void Dot11sProxyList_Insert(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr,
+    BOOL inMesh,
+    BOOL isProxied,
+    Mac802Address proxyAddr);
+
+void Dot11sProxyList_DeleteItems(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address proxyAddr);
+
+DOT11s_FwdItem* Dot11sFwdList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address addr);
+
+void Dot11sFwdList_Insert(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address mpAddr,
+    Mac802Address nextHopAddr,
+    DOT11s_FwdItemType itemType);
+
+void Dot11sDataSeenList_Insert(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+DOT11s_DataSeenItem* Dot11sDataSeenList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+DOT11s_StationItem* Dot11sStationList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr);
+
+int Dot11s_GetAssociatedStationCount(
+    Node* node,
+    MacDataDot11* dot11);
+
+DOT11s_E2eItem* Dot11sE2eList_Insert(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address DA,
+    Mac802Address SA,
+    int seqNo);
+
+DOT11s_E2eItem* Dot11sE2eList_Lookup(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address DA,
+    Mac802Address SA);
+
+unsigned short Dot11sE2eList_NextSeqNo(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address DA,
+    Mac802Address SA);
+
+Message* Dot11s_StartTimer(
+    Node* node,
+    MacDataDot11* dot11,
+    const DOT11s_TimerInfo* const timerInfo,
+    clocktype delay,
+    int timerType);
+
+void Dot11s_SetFieldsInMgmtFrameHdr(
+    Node* node,
+    const MacDataDot11* const dot11,
+    DOT11_FrameHdr* const fHdr,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11s_SetFieldsInDataFrameHdr(
+    Node* node,
+    const MacDataDot11* const dot11,
+    char* const dot11Hdr,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11s_ReceiveBeaconFrame(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg,
+    BOOL* isProcessed);
+
+BOOL Dot11s_ReceiveMgmtBroadcast(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+BOOL Dot11s_ReceiveMgmtUnicast(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+void Dot11s_PacketRetransmitEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11s_PacketDropEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11s_PacketAckEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    DOT11s_FrameInfo* frameInfo);
+
+void Dot11s_StationAssociateEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr,
+    Mac802Address previousAp);
+
+void Dot11s_StationDisassociateEvent(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address staAddr);
+
+void Dot11s_ReceiveDataBroadcast(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+void Dot11s_ReceiveDataUnicast(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+void Dot11s_ReceiveNetworkLayerPacket(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg,
+    Mac802Address nextHopAddr,
+    int networkType,
+    TosType priority);
+
+void Dot11s_BeaconTransmitted(
+    Node* node,
+    MacDataDot11* dot11);
+
+unsigned int Dot11s_ComputeLinkMetric(
+    Node* node,
+    MacDataDot11* dot11,
+    Mac802Address addr);
+
+void Dot11s_Init(
+    Node* node,
+    const NodeInput* nodeInput,
+    MacDataDot11* dot11,
+    NetworkType networkType);
+
+void Dot11s_HandleTimeout(
+    Node* node,
+    MacDataDot11* dot11,
+    Message* msg);
+
+void Dot11s_Finalize(
+    Node* node,
+    MacDataDot11* dot11,
+    int interfaceIndex);
+
+#endif /* MAC_DOT11S_H */
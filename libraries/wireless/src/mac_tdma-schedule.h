@@ -0,0 +1,280 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Backlog-driven slot allocation of the TDMA MAC
+ * (TDMA-DYNAMIC-SLOT-ALLOCATION), kept apart from mac_tdma.cpp so that
+ * bench/mac_tdma_schedule_test.cpp can run several nodes' schedules
+ * side by side.
+ */
+
+#ifndef MAC_TDMA_SCHEDULE_H
+#define MAC_TDMA_SCHEDULE_H
+
+#include "api.h"
+#include "mac_tdma.h"
+
+//
+// Backlog a node announced in the schedule header of the frames it
+// sent during frameNumber. The last frame of the slot wins.
+//
+struct MacTdmaBacklogReport {
+    int frameNumber;
+    int backlog;
+};
+
+//
+// State of TDMA-DYNAMIC-SLOT-ALLOCATION. Every node keeps the last two
+// reports of every node of the subnet, indexed by frame parity, and
+// derives the same schedule from them at the start of a frame. The
+// epoch and hash of that schedule go out in the schedule header of
+// every frame; a node that hears a different hash for the same epoch
+// keeps to its static slot until it hears its own hash again.
+//
+struct MacTdmaDynamicAllocation {
+    int subnetListIndex;
+    int numNodesInSubnet;
+    int reallocationInterval;
+    int frameNumber;
+
+    MacTdmaBacklogReport* reports;
+    int* slotCount;
+    int* remainder;
+    int numOwnSlots;
+
+    int scheduleEpoch;
+    unsigned int scheduleHash;
+    BOOL scheduleConfirmed;     // hash heard in the last frame matched
+    BOOL scheduleMismatch;      // hash heard in the last frame differed
+    BOOL useStaticSlot;
+
+    Int64 totalOwnSlots;
+    int numReallocations;
+    int numStaticSlotFrames;
+};
+
+
+/*
+ * NAME:        MacTdmaRecordBacklog.
+ *
+ * PURPOSE:     Keep the backlog a node of the subnet announced during
+ *              a frame, for the reallocation two frames later.
+ *
+ * PARAMETERS:  tdma, TDMA data in dynamic mode.
+ *              nodeIndex, subnet list index of the announcing node.
+ *              frameNumber, frame the announcement was sent in.
+ *              backlog, packets left in the node's output queue.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaRecordBacklog(
+    MacDataTdma* tdma,
+    int nodeIndex,
+    int frameNumber,
+    int backlog)
+{
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    MacTdmaBacklogReport* report;
+
+    if (nodeIndex < 0 || nodeIndex >= dynamic->numNodesInSubnet ||
+        frameNumber < 0)
+    {
+        return;
+    }
+
+    report = &dynamic->reports[2 * nodeIndex + frameNumber % 2];
+    report->frameNumber = frameNumber;
+    report->backlog = backlog;
+}
+
+
+/*
+ * NAME:        MacTdmaCheckSchedule.
+ *
+ * PURPOSE:     Compare the schedule a node of the subnet announced with
+ *              this node's own. Only announcements of the same epoch
+ *              are compared; the result takes effect at the next frame.
+ *
+ * PARAMETERS:  tdma, TDMA data in dynamic mode.
+ *              scheduleEpoch, epoch of the announced schedule.
+ *              scheduleHash, hash of the announced schedule.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaCheckSchedule(
+    MacDataTdma* tdma,
+    int scheduleEpoch,
+    unsigned int scheduleHash)
+{
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+
+    if (scheduleEpoch != dynamic->scheduleEpoch) {
+        return;
+    }
+
+    if (scheduleHash == dynamic->scheduleHash) {
+        dynamic->scheduleConfirmed = TRUE;
+    }
+    else {
+        dynamic->scheduleMismatch = TRUE;
+    }
+}
+
+
+/*
+ * NAME:        MacTdmaLayOutSchedule.
+ *
+ * PURPOSE:     Rebuild frameDescriptor from slotCount. Slot i of the
+ *              first numNodesInSubnet slots stays with node i, as in
+ *              the static schedule; the rest go to the nodes in
+ *              contiguous runs in subnet order. With useStaticSlot the
+ *              node transmits in its static slot only, which no other
+ *              node is ever given.
+ *
+ * PARAMETERS:  tdma, TDMA data in dynamic mode.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaLayOutSchedule(MacDataTdma* tdma) {
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    const int numNodes = dynamic->numNodesInSubnet;
+    int slotId = numNodes;
+    int i;
+
+    for (i = 0; i < numNodes; i++) {
+        char status = TDMA_STATUS_RX;
+        int j;
+
+        if (i == dynamic->subnetListIndex) {
+            status = TDMA_STATUS_TX;
+        }
+
+        tdma->frameDescriptor[i] = status;
+
+        if (dynamic->useStaticSlot) {
+            status = TDMA_STATUS_RX;
+        }
+
+        for (j = 1; j < dynamic->slotCount[i]; j++) {
+            tdma->frameDescriptor[slotId++] = status;
+        }
+    }
+
+    assert(slotId == tdma->numSlotsPerFrame);
+
+    if (dynamic->useStaticSlot) {
+        dynamic->numOwnSlots = 1;
+    }
+    else {
+        dynamic->numOwnSlots = dynamic->slotCount[dynamic->subnetListIndex];
+    }
+}
+
+
+/*
+ * NAME:        MacTdmaReallocateSlots.
+ *
+ * PURPOSE:     Recompute slotCount from the backlogs announced two
+ *              frames ago, which every node of the subnet has heard by
+ *              now. Each node keeps one slot; the spare slots are split
+ *              in proportion to backlog by largest remainder, ties to
+ *              the lower index, or evenly if no node has a backlog.
+ *              The new schedule gets the frame number as epoch and an
+ *              FNV-1a hash of slotCount.
+ *
+ * PARAMETERS:  tdma, TDMA data in dynamic mode.
+ *
+ * RETURN:      None.
+ *
+ * ASSUMPTION:  Only integers are used, so that all nodes compute the
+ *              same schedule from the same reports.
+ */
+static
+void MacTdmaReallocateSlots(MacDataTdma* tdma) {
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    const int numNodes = dynamic->numNodesInSubnet;
+    const int numSpare = tdma->numSlotsPerFrame - numNodes;
+    const int reportFrame = dynamic->frameNumber - 2;
+    int totalBacklog = 0;
+    int numAssigned = 0;
+    unsigned int hash = 2166136261U;
+    int i;
+
+    for (i = 0; i < numNodes; i++) {
+        MacTdmaBacklogReport* report = NULL;
+
+        if (reportFrame >= 0) {
+            report = &dynamic->reports[2 * i + reportFrame % 2];
+        }
+
+        if (report != NULL && report->frameNumber == reportFrame) {
+            dynamic->remainder[i] = report->backlog;
+        }
+        else {
+            dynamic->remainder[i] = 0;
+        }
+
+        totalBacklog += dynamic->remainder[i];
+    }
+
+    if (totalBacklog == 0) {
+        for (i = 0; i < numNodes; i++) {
+            dynamic->remainder[i] = 1;
+        }
+        totalBacklog = numNodes;
+    }
+
+    for (i = 0; i < numNodes; i++) {
+        Int64 share = (Int64)numSpare * dynamic->remainder[i];
+
+        dynamic->slotCount[i] = 1 + (int)(share / totalBacklog);
+        dynamic->remainder[i] = (int)(share % totalBacklog);
+        numAssigned += dynamic->slotCount[i] - 1;
+    }
+
+    while (numAssigned < numSpare) {
+        int largest = 0;
+
+        for (i = 1; i < numNodes; i++) {
+            if (dynamic->remainder[i] > dynamic->remainder[largest]) {
+                largest = i;
+            }
+        }
+
+        dynamic->slotCount[largest]++;
+        dynamic->remainder[largest] = -1;
+        numAssigned++;
+    }
+
+    for (i = 0; i < numNodes; i++) {
+        unsigned int count = (unsigned int)dynamic->slotCount[i];
+        int j;
+
+        for (j = 0; j < 4; j++) {
+            hash = (hash ^ ((count >> (8 * j)) & 0xFF)) * 16777619U;
+        }
+    }
+
+    dynamic->scheduleEpoch = dynamic->frameNumber;
+    dynamic->scheduleHash = hash;
+    dynamic->numReallocations++;
+}
+
+#endif // MAC_TDMA_SCHEDULE_H
@@ -0,0 +1,117 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Slot transition table of the TDMA MAC, kept apart from mac_tdma.cpp
+ * so that bench/mac_tdma_transition_test.cpp can check it against a
+ * slot by slot walk.
+ */
+
+#ifndef MAC_TDMA_TRANSITION_H
+#define MAC_TDMA_TRANSITION_H
+
+#include "api.h"
+#include "mac_tdma.h"
+
+/*
+ * NAME:        MacTdmaComputeTransitions.
+ *
+ * PURPOSE:     For every slot, record the next slot at which the timer
+ *              has to fire and the delay to it, so that a run of slots
+ *              with the same status and channel costs a single timer.
+ *
+ *              The timer fires at the next slot whose status or channel
+ *              differs from the slot's own, and at every slot boundary
+ *              after a transmit slot. The delay includes the inter-frame
+ *              time if the frame wraps on the way. Slots of a frame that
+ *              has a single non-transmit status and channel get no
+ *              transition (-1).
+ *
+ *              With stopAtFrameStart, as for dynamic slot allocation,
+ *              the timer also fires at slot 0 of every frame, where the
+ *              schedule may change.
+ *
+ * PARAMETERS:  frameDescriptor, status of each slot.
+ *              slotChannel, channel of each slot.
+ *              numSlots, slots per frame.
+ *              slotTime, slot duration plus guard time.
+ *              interFrameTime, time between two frames.
+ *              stopAtFrameStart, fire at slot 0 of every frame.
+ *              nextTransitionSlot, output, numSlots entries.
+ *              nextTransitionDelay, output, numSlots entries.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaComputeTransitions(
+    const char* frameDescriptor,
+    const int* slotChannel,
+    int numSlots,
+    clocktype slotTime,
+    clocktype interFrameTime,
+    BOOL stopAtFrameStart,
+    int* nextTransitionSlot,
+    clocktype* nextTransitionDelay)
+{
+    int nextChange = -1;
+    int i;
+
+    //
+    // Walk two frames backwards so that nextChange is, for each slot,
+    // the closest later position (unrolled, up to 2 * numSlots - 1)
+    // whose status or channel differs from the one before it.
+    //
+    for (i = 2 * numSlots - 2; i >= 0; i--) {
+        if (frameDescriptor[i % numSlots] !=
+                frameDescriptor[(i + 1) % numSlots] ||
+            slotChannel[i % numSlots] !=
+                slotChannel[(i + 1) % numSlots])
+        {
+            nextChange = i + 1;
+        }
+
+        if (i < numSlots) {
+            int numSkipped;
+
+            if (frameDescriptor[i] == TDMA_STATUS_TX) {
+                numSkipped = 1;
+            }
+            else if (stopAtFrameStart &&
+                     (nextChange == -1 || nextChange > numSlots))
+            {
+                numSkipped = numSlots - i;
+            }
+            else if (nextChange != -1) {
+                numSkipped = nextChange - i;
+            }
+            else {
+                nextTransitionSlot[i] = -1;
+                nextTransitionDelay[i] = 0;
+                continue;
+            }
+
+            nextTransitionSlot[i] = (i + numSkipped) % numSlots;
+            nextTransitionDelay[i] = slotTime * numSkipped;
+
+            if (i + numSkipped >= numSlots) {
+                nextTransitionDelay[i] += interFrameTime;
+            }
+        }
+    }
+}
+
+#endif // MAC_TDMA_TRANSITION_H
@@ -33,6 +33,8 @@
 
 #include "api.h"
 #include "mac_tdma.h"
+#include "mac_tdma-transition.h"
+#include "mac_tdma-schedule.h"
 #include "network_ip.h"
 #include "partition.h"
 
@@ -51,6 +53,7 @@
 static const clocktype DefaultTdmaSlotDuration = (10 * MILLI_SECOND);
 static const clocktype DefaultTdmaGuardTime = 0;
 static const clocktype DefaultTdmaInterFrameTime = (1 * MICRO_SECOND);
+static const int DefaultTdmaReallocationInterval = 1;
 
 /*
  * NAME:        MacTdmaHandlePromiscuousMode.
@@ -91,6 +94,262 @@ void MacTdmaHandlePromiscuousMode(
 }
 
 
+/*
+ * NAME:        MacTdmaBuildTransitionTable.
+ *
+ * PURPOSE:     Fill nextTransitionSlot and nextTransitionDelay from the
+ *              frame, see MacTdmaComputeTransitions.
+ *
+ * PARAMETERS:  tdma, TDMA data whose frameDescriptor and slotChannel
+ *              are set.
+ *
+ * RETURN:      None.
+ *
+ * ASSUMPTION:  Call again whenever frameDescriptor or slotChannel
+ *              changes.
+ */
+static
+void MacTdmaBuildTransitionTable(MacDataTdma* tdma) {
+    const int numSlots = tdma->numSlotsPerFrame;
+
+    if (tdma->nextTransitionSlot == NULL) {
+        tdma->nextTransitionSlot =
+            (int*)MEM_malloc(numSlots * sizeof(int));
+        tdma->nextTransitionDelay =
+            (clocktype*)MEM_malloc(numSlots * sizeof(clocktype));
+    }
+
+    MacTdmaComputeTransitions(tdma->frameDescriptor,
+                              tdma->slotChannel,
+                              numSlots,
+                              tdma->slotDuration + tdma->guardTime,
+                              tdma->interFrameTime,
+                              tdma->dynamicAllocation != NULL,
+                              tdma->nextTransitionSlot,
+                              tdma->nextTransitionDelay);
+}
+
+
+/*
+ * NAME:        MacTdmaAddScheduleHeader.
+ *
+ * PURPOSE:     Put the schedule header on an outgoing frame: the
+ *              backlog left after the frame was dequeued and the epoch
+ *              and hash of the sender's schedule. The report is also
+ *              recorded locally, since a node does not hear its own
+ *              frames.
+ *
+ * PARAMETERS:  node, node sending the frame.
+ *              tdma, TDMA data in dynamic mode.
+ *              msg, frame with its TdmaHeader added.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaAddScheduleHeader(
+    Node* node,
+    MacDataTdma* tdma,
+    Message* msg)
+{
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    TdmaScheduleHeader* scheduleHdr;
+
+    MESSAGE_AddHeader(node, msg, sizeof(TdmaScheduleHeader), TRACE_TDMA);
+    scheduleHdr = (TdmaScheduleHeader*)msg->packet;
+
+    scheduleHdr->senderIndex = dynamic->subnetListIndex;
+    scheduleHdr->frameNumber = dynamic->frameNumber;
+    scheduleHdr->scheduleEpoch = dynamic->scheduleEpoch;
+    scheduleHdr->scheduleHash = dynamic->scheduleHash;
+    scheduleHdr->backlog = NetworkIpOutputQueueNumberInQueue(
+                               node,
+                               tdma->myMacData->interfaceIndex,
+                               FALSE,
+                               ALL_PRIORITIES);
+
+    MacTdmaRecordBacklog(tdma,
+                         scheduleHdr->senderIndex,
+                         scheduleHdr->frameNumber,
+                         scheduleHdr->backlog);
+}
+
+
+/*
+ * NAME:        MacTdmaRemoveScheduleHeader.
+ *
+ * PURPOSE:     Take the schedule header, if any, off a received frame
+ *              and, in dynamic mode, record the backlog and compare the
+ *              schedule it announces.
+ *
+ * PARAMETERS:  node, node receiving the frame.
+ *              tdma, TDMA data.
+ *              msg, frame received from the PHY.
+ *
+ * RETURN:      None.
+ *
+ * ASSUMPTION:  Only senders in dynamic mode add the header, so it is
+ *              told apart from TdmaHeader by its size.
+ */
+static
+void MacTdmaRemoveScheduleHeader(
+    Node* node,
+    MacDataTdma* tdma,
+    Message* msg)
+{
+    const int top = msg->numberOfHeaders - 1;
+    TdmaScheduleHeader scheduleHdr;
+
+    if (top < 0 ||
+        msg->headerProtocols[top] != TRACE_TDMA ||
+        msg->headerSizes[top] != sizeof(TdmaScheduleHeader))
+    {
+        return;
+    }
+
+    memcpy(&scheduleHdr, msg->packet, sizeof(TdmaScheduleHeader));
+    MESSAGE_RemoveHeader(node, msg, sizeof(TdmaScheduleHeader), TRACE_TDMA);
+
+    if (tdma->dynamicAllocation != NULL) {
+        MacTdmaRecordBacklog(tdma,
+                             scheduleHdr.senderIndex,
+                             scheduleHdr.frameNumber,
+                             scheduleHdr.backlog);
+        MacTdmaCheckSchedule(tdma,
+                             scheduleHdr.scheduleEpoch,
+                             scheduleHdr.scheduleHash);
+    }
+}
+
+
+/*
+ * NAME:        MacTdmaApplySchedule.
+ *
+ * PURPOSE:     Lay out the frame from slotCount, see
+ *              MacTdmaLayOutSchedule, and rebuild the transition table.
+ *
+ * PARAMETERS:  tdma, TDMA data in dynamic mode.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaApplySchedule(MacDataTdma* tdma) {
+    MacTdmaLayOutSchedule(tdma);
+    MacTdmaBuildTransitionTable(tdma);
+}
+
+
+/*
+ * NAME:        MacTdmaStartFrame.
+ *
+ * PURPOSE:     Called at slot 0 in dynamic mode, before the slot status
+ *              is applied. Moves to the static slot if a node announced
+ *              a different schedule during the last frame, and back to
+ *              the dynamic schedule once one announced the same.
+ *              Reallocates the slots every
+ *              TDMA-DYNAMIC-REALLOCATION-INTERVAL frames.
+ *
+ * PARAMETERS:  node, node starting a frame.
+ *              tdma, TDMA data in dynamic mode.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaStartFrame(Node* node, MacDataTdma* tdma) {
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    BOOL usedStaticSlot = dynamic->useStaticSlot;
+
+    dynamic->frameNumber++;
+
+    if (dynamic->scheduleMismatch) {
+        dynamic->useStaticSlot = TRUE;
+    }
+    else if (dynamic->scheduleConfirmed) {
+        dynamic->useStaticSlot = FALSE;
+    }
+    dynamic->scheduleMismatch = FALSE;
+    dynamic->scheduleConfirmed = FALSE;
+
+    if (dynamic->frameNumber % dynamic->reallocationInterval == 0) {
+        MacTdmaReallocateSlots(tdma);
+        MacTdmaApplySchedule(tdma);
+    }
+    else if (dynamic->useStaticSlot != usedStaticSlot) {
+        MacTdmaApplySchedule(tdma);
+    }
+
+    if (DEBUG) {
+        int i;
+
+        printf("node %d frame %d schedule%s: ",
+               node->nodeId, dynamic->frameNumber,
+               dynamic->useStaticSlot ? " (static slot)" : "");
+        for (i = 0; i < tdma->numSlotsPerFrame; i++) {
+            printf("%d ", (int)tdma->frameDescriptor[i]);
+        }
+        printf("\n");
+    }
+
+    if (dynamic->useStaticSlot) {
+        dynamic->numStaticSlotFrames++;
+    }
+    dynamic->totalOwnSlots += dynamic->numOwnSlots;
+    tdma->nextStatus = tdma->frameDescriptor[0];
+}
+
+
+/*
+ * NAME:        MacTdmaSetOperatingChannel.
+ *
+ * PURPOSE:     Retune to the channel of a slot the same way the 802.11
+ *              channel switch does: drop the frame being received, stop
+ *              listening to the old channel and move transmission. The
+ *              new channel is listened to unless the slot is idle, so
+ *              that PHY_CHANSWITCH charges its retune delay before the
+ *              slot's transmission goes out.
+ *
+ * PARAMETERS:  node, node changing channel.
+ *              tdma, TDMA data, currentStatus set to the new slot's.
+ *              newChannel, channel of the new slot.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaSetOperatingChannel(
+    Node* node,
+    MacDataTdma* tdma,
+    int newChannel)
+{
+    int phyIndex = tdma->myMacData->phyNumber;
+    int oldChannel = tdma->channelIndex;
+
+    if (PHY_GetStatus(node, phyIndex) == PHY_RECEIVING) {
+        BOOL frameHeaderHadError;
+        clocktype endSignalTime;
+
+        PHY_TerminateCurrentReceive(node, phyIndex, FALSE,
+            &frameHeaderHadError, &endSignalTime);
+    }
+
+    if (PHY_IsListeningToChannel(node, phyIndex, oldChannel)) {
+        PHY_StopListeningToChannel(node, phyIndex, oldChannel);
+    }
+    if (tdma->currentStatus != TDMA_STATUS_IDLE &&
+        !PHY_IsListeningToChannel(node, phyIndex, newChannel))
+    {
+        PHY_StartListeningToChannel(node, phyIndex, newChannel);
+    }
+    PHY_SetTransmissionChannel(node, phyIndex, newChannel);
+
+    tdma->channelIndex = newChannel;
+    tdma->stats.numChannelSwitches++;
+
+    if (DEBUG) {
+        printf("node %d slot %d: channel %d -> %d\n",
+               node->nodeId, tdma->currentSlotId, oldChannel, newChannel);
+    }
+}
+
+
 static
 void MacTdmaInitializeTimer(Node* node, MacDataTdma* tdma) {
     int i;
@@ -101,18 +360,17 @@ void MacTdmaInitializeTimer(Node* node, MacDataTdma* tdma) {
     }
     int initialStatus = (int)tdma->frameDescriptor[0];
 
-    if (initialStatus == TDMA_STATUS_TX) {
+    if (initialStatus == TDMA_STATUS_TX ||
+        tdma->dynamicAllocation != NULL ||
+        tdma->slotChannel[0] != tdma->channelIndex)
+    {
         i = 0;
     }
     else {
-        for (i = 0; i < tdma->numSlotsPerFrame; i++) {
-            if ((int)tdma->frameDescriptor[i] != initialStatus) {
-                break;
-            }
-        }
+        i = tdma->nextTransitionSlot[0];
     }
 
-    if (i == tdma->numSlotsPerFrame) {
+    if (i == -1) {
 #ifdef PARALLEL //Parallel
         // This node has no transmit slots
         PARALLEL_SetLookaheadHandleEOT(node,
@@ -171,48 +429,22 @@ void MacTdmaInitializeTimer(Node* node, MacDataTdma* tdma) {
 
 static
 void MacTdmaUpdateTimer(Node* node, MacDataTdma* tdma) {
-    int i;
-    int slotId = tdma->currentSlotId;
-    clocktype delay = 0;
+    clocktype delay;
 
     ERROR_Assert(tdma->currentStatus == tdma->frameDescriptor[tdma->currentSlotId],
                  "TDMA: Current status is incorrect for the current time slot.");
 
-    for (i = 0; i < tdma->numSlotsPerFrame; i++) {
-        if (slotId == tdma->numSlotsPerFrame - 1) {
-            tdma->nextSlotId = 0;
-        }
-        else {
-            tdma->nextSlotId = slotId + 1;
-        }
-        tdma->nextStatus = tdma->frameDescriptor[tdma->nextSlotId];
-
-        delay += tdma->slotDuration + tdma->guardTime;
+    tdma->nextSlotId = tdma->nextTransitionSlot[tdma->currentSlotId];
+    assert(tdma->nextSlotId != -1);
 
-        if (tdma->nextSlotId == 0) {
-            delay += tdma->interFrameTime;
-        }
-
-        if ((tdma->nextStatus != tdma->currentStatus) ||
-            (tdma->nextStatus == TDMA_STATUS_TX &&
-             tdma->currentStatus == TDMA_STATUS_TX))
-        {
-            if (DEBUG) {
-                printf("node [%d], Next Timer Being Sent, Current Status :"
-                       "%d, Next Status : %d\n",
-                       node->nodeId, tdma->currentStatus, tdma->nextStatus);
+    tdma->nextStatus = tdma->frameDescriptor[tdma->nextSlotId];
+    delay = tdma->nextTransitionDelay[tdma->currentSlotId];
 
-            }
-            break;
-        }
-
-        slotId++;
-
-        if (slotId == tdma->numSlotsPerFrame) {
-            slotId = 0;
-        }
+    if (DEBUG) {
+        printf("node [%d], Next Timer Being Sent, Current Status :"
+               "%d, Next Status : %d\n",
+               node->nodeId, tdma->currentStatus, tdma->nextStatus);
     }
-    assert(i != tdma->numSlotsPerFrame);
 
     tdma->timerExpirationTime = delay + TIME_getSimTime(node);
 
@@ -357,6 +589,75 @@ void MacTdmaInit(Node* node,
         automaticScheduling = TRUE;
     }
 
+    //
+    // TDMA-DYNAMIC-SLOT-ALLOCATION: reallocate the slots of the frame
+    // in proportion to the output queue backlog of the nodes
+    //
+    IO_ReadString(node,node->nodeId, interfaceIndex, nodeInput,
+                  "TDMA-DYNAMIC-SLOT-ALLOCATION", &wasFound,
+                  schedulingString);
+
+    if (wasFound && strcmp(schedulingString, "YES") == 0) {
+        MacTdmaDynamicAllocation* dynamic;
+        int interval;
+
+        if (automaticScheduling == FALSE) {
+            ERROR_ReportError(
+                "TDMA-DYNAMIC-SLOT-ALLOCATION requires "
+                "TDMA-SCHEDULING AUTOMATIC\n");
+        }
+
+        if (tdma->numSlotsPerFrame < numNodesInSubnet) {
+            ERROR_ReportError(
+                "TDMA-DYNAMIC-SLOT-ALLOCATION requires at least one "
+                "slot per node in TDMA-NUM-SLOTS-PER-FRAME\n");
+        }
+
+        //
+        // TDMA-DYNAMIC-REALLOCATION-INTERVAL: frames between two
+        // reallocations
+        //
+        IO_ReadInt(node,node->nodeId, interfaceIndex, nodeInput,
+                   "TDMA-DYNAMIC-REALLOCATION-INTERVAL", &wasFound,
+                   &interval);
+
+        if (!wasFound) {
+            interval = DefaultTdmaReallocationInterval;
+        }
+        else if (interval <= 0) {
+            ERROR_ReportError(
+                "TDMA-DYNAMIC-REALLOCATION-INTERVAL must be positive\n");
+        }
+
+        dynamic = (MacTdmaDynamicAllocation*)
+                  MEM_malloc(sizeof(MacTdmaDynamicAllocation));
+        memset(dynamic, 0, sizeof(MacTdmaDynamicAllocation));
+
+        dynamic->subnetListIndex = subnetListIndex;
+        dynamic->numNodesInSubnet = numNodesInSubnet;
+        dynamic->reallocationInterval = interval;
+        dynamic->frameNumber = -1;
+
+        dynamic->reports = (MacTdmaBacklogReport*)
+            MEM_malloc(2 * numNodesInSubnet * sizeof(MacTdmaBacklogReport));
+        for (i = 0; i < 2 * numNodesInSubnet; i++) {
+            dynamic->reports[i].frameNumber = -1;
+            dynamic->reports[i].backlog = 0;
+        }
+
+        dynamic->slotCount =
+            (int*)MEM_malloc(numNodesInSubnet * sizeof(int));
+        dynamic->remainder =
+            (int*)MEM_malloc(numNodesInSubnet * sizeof(int));
+        dynamic->scheduleEpoch = -1;
+
+        tdma->dynamicAllocation = dynamic;
+    }
+    else if (wasFound && strcmp(schedulingString, "NO") != 0) {
+        ERROR_ReportError(
+            "TDMA-DYNAMIC-SLOT-ALLOCATION must be either YES or NO\n");
+    }
+
     //
     // Build frameDescriptor
     //
@@ -365,13 +666,18 @@ void MacTdmaInit(Node* node,
     //
     // If TDMA-SCHEDULING = FILE is specified, all nodes stay
     // idle unless Rx or Tx is specified in TDMA-SCHEDULING-FILE.
+    // An entry may name the slot's channel as <node>-<Rx|Tx>-<channel>;
+    // other slots use the first listening channel.
     //
 
     tdma->frameDescriptor =
         (char*)MEM_malloc(tdma->numSlotsPerFrame * sizeof(char));
+    tdma->slotChannel =
+        (int*)MEM_malloc(tdma->numSlotsPerFrame * sizeof(int));
 
     for (i = 0; i < tdma->numSlotsPerFrame; i++) {
         tdma->frameDescriptor[i] = TDMA_STATUS_IDLE;
+        tdma->slotChannel[i] = -1;
     }
 
     if (automaticScheduling == TRUE) {
@@ -414,7 +720,9 @@ void MacTdmaInit(Node* node,
             while (returnValue != NULL) {
                 char nodeString[MAX_STRING_LENGTH];
                 char *typeStr;
+                char *channelStr;
                 NodeAddress nodeId;
+                int channel = -1;
                 int numReturnVals = 0;
 
                 numReturnVals = sscanf(token, "%s", nodeString);
@@ -422,10 +730,21 @@ void MacTdmaInit(Node* node,
 
                 IO_ConvertStringToLowerCase(nodeString);
 
-                typeStr = strrchr(nodeString, '-');
+                typeStr = strchr(nodeString, '-');
+                if (typeStr == NULL) {
+                    ERROR_ReportError(
+                        "Slot entry must be <node>-<Rx|Tx>[-<channel>]\n");
+                }
                 *typeStr = 0;
                 typeStr++; // to the next character
 
+                channelStr = strchr(typeStr, '-');
+                if (channelStr != NULL) {
+                    *channelStr = 0;
+                    channelStr++;
+                    channel = (int)atoi(channelStr);
+                }
+
                 if (strcmp(nodeString, "all") == 0) {
                     if (strcmp(typeStr, "rx") != 0) {
                         ERROR_ReportError("'All' must be used with '-Rx'\n");
@@ -442,16 +761,28 @@ void MacTdmaInit(Node* node,
                     continue;
                 }
 
+                if (channelStr != NULL &&
+                    (channel < 0 || channel >= numChannels ||
+                     !PHY_CanListenToChannel(
+                         node, tdma->myMacData->phyNumber, channel)))
+                {
+                    ERROR_ReportError(
+                        "Slot channel must be a channel the node "
+                        "can listen to\n");
+                }
+
                 if (strcmp(typeStr, "rx") == 0) {
                     //
                     // '-Tx' has priority over '-Rx' (likely from 'All-Rx')
                     //
                     if (tdma->frameDescriptor[slotId] != TDMA_STATUS_TX) {
                         tdma->frameDescriptor[slotId] = TDMA_STATUS_RX;
+                        tdma->slotChannel[slotId] = channel;
                     }
                 }
                 else if (strcmp(typeStr, "tx") == 0) {
                     tdma->frameDescriptor[slotId] = TDMA_STATUS_TX;
+                    tdma->slotChannel[slotId] = channel;
                 }
                 else {
                     ERROR_ReportError("Slot type must be either Rx or Tx\n");
@@ -480,11 +811,20 @@ void MacTdmaInit(Node* node,
         }
     }
 
+    for (i = 0; i < tdma->numSlotsPerFrame; i++) {
+        if (tdma->slotChannel[i] == -1) {
+            tdma->slotChannel[i] = tdma->channelIndex;
+        }
+    }
+
     tdma->stats.pktsSentUnicast = 0;
     tdma->stats.pktsSentBroadcast = 0;
     tdma->stats.pktsGotUnicast = 0;
     tdma->stats.pktsGotBroadcast = 0;
     tdma->stats.numTxSlotsMissed = 0;
+    tdma->stats.numTxSlots = 0;
+    tdma->stats.totalQueueingDelay = 0;
+    tdma->stats.numChannelSwitches = 0;
 
 #ifdef PARALLEL //Parallel
     tdma->lookaheadHandle = PARALLEL_AllocateLookaheadHandle (node);
@@ -510,6 +850,7 @@ void MacTdmaInit(Node* node,
     }
 #endif //endParallel
 
+    MacTdmaBuildTransitionTable(tdma);
     MacTdmaInitializeTimer(node, tdma);
 
 }
@@ -533,7 +874,10 @@ void MacTdmaReceivePacketFromPhy(
     switch (tdma->currentStatus) {
         case TDMA_STATUS_RX: {
             int interfaceIndex = tdma->myMacData->interfaceIndex;
-            TdmaHeader *hdr = (TdmaHeader*)msg->packet;
+            TdmaHeader *hdr;
+
+            MacTdmaRemoveScheduleHeader(node, tdma, msg);
+            hdr = (TdmaHeader*)msg->packet;
 
             if (DEBUG) {
                 char clockStr[MAX_CLOCK_STRING_LENGTH];
@@ -683,6 +1027,7 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
     MacDataTdma* tdma =
         (MacDataTdma*)node->macData[interfaceIndex]->macVar;
     int previousStatus = tdma->currentStatus;
+    int previousChannel = tdma->channelIndex;
     BOOL phyIsListening;
 
     //
@@ -694,12 +1039,25 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
     ERROR_Assert(TIME_getSimTime(node) == tdma->timerExpirationTime,
                  "TDMA: Simulation time differs from expected timer expiration");
 
+    if (tdma->dynamicAllocation != NULL && tdma->nextSlotId == 0) {
+        MacTdmaStartFrame(node, tdma);
+    }
+
     tdma->currentStatus = tdma->nextStatus;
     tdma->currentSlotId = tdma->nextSlotId;
 
     assert((tdma->currentStatus != previousStatus) ||
            (tdma->currentStatus == TDMA_STATUS_TX &&
-            previousStatus == TDMA_STATUS_TX));
+            previousStatus == TDMA_STATUS_TX) ||
+           (tdma->dynamicAllocation != NULL && tdma->currentSlotId == 0) ||
+           (tdma->slotChannel[tdma->currentSlotId] != previousChannel));
+
+    if (tdma->currentStatus != TDMA_STATUS_IDLE &&
+        tdma->slotChannel[tdma->currentSlotId] != tdma->channelIndex)
+    {
+        MacTdmaSetOperatingChannel(
+            node, tdma, tdma->slotChannel[tdma->currentSlotId]);
+    }
 
     phyIsListening =
         PHY_IsListeningToChannel(
@@ -739,6 +1097,7 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
             int networkType;
             TosType priority;
             TdmaHeader *hdr;
+            QueuedPacketInfo *queueInfo;
             clocktype transmissionDelay;
 
             if (DEBUG) {
@@ -752,6 +1111,8 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
                        PHY_TRANSMITTING);
             }
 
+            tdma->stats.numTxSlots++;
+
             if (MAC_OutputQueueIsEmpty(node,
                         tdma->myMacData->interfaceIndex)) {
                 tdma->stats.numTxSlotsMissed++;
@@ -769,6 +1130,10 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
 
             assert(msg != NULL);
 
+            queueInfo = (QueuedPacketInfo*)MESSAGE_ReturnInfo(msg);
+            tdma->stats.totalQueueingDelay +=
+                getSimTime(node) - queueInfo->insertTime;
+
             if (DEBUG) {
                 char clockStr[100];
                 //char buf[MAX_STRING_LENGTH];
@@ -814,6 +1179,11 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
 
             hdr->priority = priority;
 
+            if (tdma->dynamicAllocation != NULL) {
+                MacTdmaAddScheduleHeader(node, tdma, msg);
+                hdr = (TdmaHeader*)(msg->packet + sizeof(TdmaScheduleHeader));
+            }
+
             transmissionDelay = PHY_GetTransmissionDelay(node,
                                                          tdma->myMacData->phyNumber,
                                                          MESSAGE_ReturnPacketSize(msg));
@@ -844,6 +1214,84 @@ void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg) {
 }
 
 
+/*
+ * NAME:        MacTdmaPrintScheduleStats.
+ *
+ * PURPOSE:     Print the share of the frame this node owned, the ratio
+ *              of its transmit slots that went empty and the average
+ *              time its packets waited in the output queue, so that
+ *              the static and dynamic schedules can be compared.
+ *
+ * PARAMETERS:  node, node printing its statistics.
+ *              tdma, TDMA data.
+ *              interfaceIndex, interface of the TDMA MAC.
+ *
+ * RETURN:      None.
+ */
+static
+void MacTdmaPrintScheduleStats(
+    Node* node,
+    MacDataTdma* tdma,
+    int interfaceIndex)
+{
+    MacTdmaDynamicAllocation* dynamic = tdma->dynamicAllocation;
+    char buf[MAX_STRING_LENGTH];
+    int numPktsSent =
+        tdma->stats.pktsSentUnicast + tdma->stats.pktsSentBroadcast;
+    double slotShare = 0.0;
+    double emptySlotRatio = 0.0;
+    double queueingDelay = 0.0;
+
+    if (dynamic == NULL) {
+        int numOwnSlots = 0;
+        int i;
+
+        for (i = 0; i < tdma->numSlotsPerFrame; i++) {
+            if (tdma->frameDescriptor[i] == TDMA_STATUS_TX) {
+                numOwnSlots++;
+            }
+        }
+        slotShare = (double)numOwnSlots / tdma->numSlotsPerFrame;
+    }
+    else if (dynamic->frameNumber >= 0) {
+        slotShare = (double)dynamic->totalOwnSlots /
+                    ((double)(dynamic->frameNumber + 1) *
+                     tdma->numSlotsPerFrame);
+    }
+
+    if (tdma->stats.numTxSlots > 0) {
+        emptySlotRatio = (double)tdma->stats.numTxSlotsMissed /
+                         tdma->stats.numTxSlots;
+    }
+
+    if (numPktsSent > 0) {
+        queueingDelay = (double)tdma->stats.totalQueueingDelay /
+                        numPktsSent / SECOND;
+    }
+
+    sprintf(buf, "Slot share = %f", slotShare);
+    IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Empty transmit slot ratio = %f", emptySlotRatio);
+    IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+
+    sprintf(buf, "Average queueing delay (s) = %f", queueingDelay);
+    IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+
+    if (dynamic != NULL) {
+        sprintf(buf, "Slot reallocations = %d", dynamic->numReallocations);
+        IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+
+        sprintf(buf, "Frames on static slot = %d",
+                dynamic->numStaticSlotFrames);
+        IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+    }
+
+    sprintf(buf, "Channel switches = %d", tdma->stats.numChannelSwitches);
+    IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+}
+
+
 /*
  * FUNCTION    MAC_Finalize
  * PURPOSE     Called at the end of simulation to collect the results of
@@ -872,5 +1320,7 @@ void MacTdmaFinalize(Node *node, int interfaceIndex) {
         sprintf(buf, "BROADCAST packets received = %d",
                 tdma->stats.pktsGotBroadcast);
         IO_PrintStat(node, "MAC", "TDMA", ANY_DEST, interfaceIndex, buf);
+
+        MacTdmaPrintScheduleStats(node, tdma, interfaceIndex);
     }
 }
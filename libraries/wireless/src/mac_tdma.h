@@ -0,0 +1,133 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * TDMA has not completed the QA process.  The current model is provided
+ * "as-is".
+ */
+
+#ifndef MAC_TDMA_H
+#define MAC_TDMA_H
+
+#ifdef PARALLEL //Parallel
+#include "parallel.h"
+#endif //endParallel
+
+/*
+ * Slot status, kept in frameDescriptor.
+ */
+#define TDMA_STATUS_TX    0
+#define TDMA_STATUS_RX    1
+#define TDMA_STATUS_IDLE  2
+
+typedef struct {
+    Mac802Address sourceAddr;
+    Mac802Address destAddr;
+    TosType priority;
+} TdmaHeader;
+
+/*
+ * Sent on top of TdmaHeader with TDMA-DYNAMIC-SLOT-ALLOCATION only:
+ * the sender's subnet index, its frame number, the packets left in its
+ * output queue, and the epoch and hash of its schedule. Static
+ * schedules send TdmaHeader alone.
+ */
+typedef struct {
+    int senderIndex;
+    int frameNumber;
+    int backlog;
+    int scheduleEpoch;
+    unsigned int scheduleHash;
+} TdmaScheduleHeader;
+
+typedef struct {
+    int pktsSentUnicast;
+    int pktsSentBroadcast;
+    int pktsGotUnicast;
+    int pktsGotBroadcast;
+    int numTxSlotsMissed;
+    int numTxSlots;
+    clocktype totalQueueingDelay;
+    int numChannelSwitches;
+} TdmaStats;
+
+struct MacTdmaDynamicAllocation;
+
+typedef struct struct_mac_tdma_str {
+    MacData* myMacData;
+
+    int currentStatus;
+    int currentSlotId;
+    int currentReceiveSlotId;
+    int nextStatus;
+    int nextSlotId;
+
+    int numSlotsPerFrame;
+    char* frameDescriptor;
+
+    // Channel of each slot, from TDMA-SCHEDULING-FILE or the first
+    // listening channel
+    int* slotChannel;
+
+    // For every slot, the next slot at which the timer fires and the
+    // delay to it, or -1 if the status never changes. Built by
+    // MacTdmaBuildTransitionTable.
+    int* nextTransitionSlot;
+    clocktype* nextTransitionDelay;
+
+    clocktype slotDuration;
+    clocktype guardTime;
+    clocktype interFrameTime;
+
+    Message* timerMsg;
+    clocktype timerExpirationTime;
+
+    int channelIndex;
+
+    // NULL unless TDMA-DYNAMIC-SLOT-ALLOCATION is YES
+    struct MacTdmaDynamicAllocation* dynamicAllocation;
+
+    TdmaStats stats;
+
+#ifdef PARALLEL //Parallel
+    LookaheadHandle lookaheadHandle;
+#endif //endParallel
+} MacDataTdma;
+
+
+void MacTdmaInit(Node* node,
+                 int interfaceIndex,
+                 const NodeInput* nodeInput,
+                 const int subnetListIndex,
+                 const int numNodesInSubnet);
+
+void MacTdmaLayer(Node* node, int interfaceIndex, Message* msg);
+
+void MacTdmaFinalize(Node* node, int interfaceIndex);
+
+void MacTdmaNetworkLayerHasPacketToSend(Node* node, MacDataTdma* tdma);
+
+void MacTdmaReceivePacketFromPhy(
+    Node* node, MacDataTdma* tdma, Message* msg);
+
+void MacTdmaReceivePhyStatusChangeNotification(
+    Node* node,
+    MacDataTdma* tdma,
+    PhyStatusType oldPhyStatus,
+    PhyStatusType newPhyStatus);
+
+#endif /* MAC_TDMA_H */
@@ -2718,6 +2718,31 @@ void PHY_SetTxDataRateType(Node *node, int phyIndex, int dataRateType) {
 }
 
 
+void PHY_SetTxAggregation(Node *node, int phyIndex, BOOL isAggregate) {
+    PhyData* thisPhy = node->phyData[phyIndex];
+
+    switch(thisPhy->phyModel) {
+#ifdef WIRELESS_LIB
+        case PHY802_11b:
+        case PHY802_11a: {
+            Phy802_11SetTxAggregation(thisPhy, isAggregate);
+            return;
+        }
+        case PHY_CHANSWITCH: {
+            PhyChanSwitchSetTxAggregation(thisPhy, isAggregate);
+            return;
+        }
+#endif // WIRELESS_LIB
+
+        default:{
+            ERROR_Assert(!isAggregate,
+                "PHY_SetTxAggregation: "
+                "PHY model does not support A-MPDU reception.\n");
+        }
+    }
+}
+
+
 int PHY_GetRxDataRateType(Node *node, int phyIndex) {
     PhyData* thisPhy = node->phyData[phyIndex];
 
@@ -4131,7 +4156,10 @@ double PHY_PropagationRange(Node* node,
             if (printAllDataRates) {
                 printf("radio range: %8.3fm, for 802.11%c data rate %4.1f Mbps\n",
                        distanceReachable, modelType,
-                       ((float)phy802_11->dataRate[index] / 1000000.0));
+                       ((float)(phyModel == PHY_CHANSWITCH ?
+                                PhyChanSwitchCore::DataRate(index) :
+                                Phy802_11GetDataRate(thisRadio, index)) /
+                        1000000.0));
             }
             else {
                 return distanceReachable;
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 #include "api.h"
 #include "partition.h"
@@ -27,6 +28,8 @@
 #include "antenna_steerable.h"
 #include "antenna_patterned.h"
 #include "phy_802_11.h"
+#include "phy_802_11_core.h"
+#include "phy_802_11_receive.h"
 
 #include "mac_csma.h"
 #include "mac_dot11.h"
@@ -35,195 +38,44 @@
 #undef DEBUG
 #define DEBUG 0
 
-static
-void Phy802_11ChangeState(
-    Node* node,
-    int phyIndex,
-    PhyStatusType newStatus)
-{
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyData802_11 *phy802_11 = (PhyData802_11 *)thisPhy->phyVar;
-    phy802_11->previousMode = phy802_11->mode;
-    phy802_11->mode = newStatus;
-
-
-    Phy_ReportStatusToEnergyModel(
-        node,
-        phyIndex,
-        phy802_11->previousMode,
-        newStatus);
-}
-
-double
-Phy802_11GetSignalStrength(Node *node,PhyData802_11* phy802_11)
-{
-    double rxThreshold_mW;
-    int dataRateToUse;
-    Phy802_11GetLowestTxDataRateType(phy802_11->thisPhy, &dataRateToUse);
-    rxThreshold_mW = phy802_11->rxSensitivity_mW[dataRateToUse];
-    return IN_DB(rxThreshold_mW);
-}
-
-static
-void Phy802_11ReportExtendedStatusToMac(
-    Node *node,
-    int phyNum,
-    PhyStatusType status,
-    clocktype receiveDuration,
-    Message* potentialIncomingPacket)
-{
-    PhyData* thisPhy = node->phyData[phyNum];
-    PhyData802_11* phy802_11 = (PhyData802_11 *)thisPhy->phyVar;
+//
+// Model specific steps of the shared receive path, phy_802_11_receive.h.
+// 802.11a/b never receive while transmitting and have no retune model.
+//
+struct Phy802_11Model {
+    typedef PhyData802_11 PhyType;
+    typedef Phy802_11PlcpHeader PlcpHeader;
 
-    assert(status == phy802_11->mode);
+    enum {
+        ABORT_TX_ON_ARRIVAL = 0
+    };
 
-    if (potentialIncomingPacket != NULL) {
-        MESSAGE_RemoveHeader(
-            node,
-            potentialIncomingPacket,
-            sizeof(Phy802_11PlcpHeader),
-            TRACE_802_11);
+    static TraceProtocolType TraceProtocol() {
+        return TRACE_802_11;
     }
 
-    MAC_ReceivePhyStatusChangeNotification(
-        node, thisPhy->macInterfaceIndex,
-        phy802_11->previousMode, status,
-        receiveDuration, potentialIncomingPacket);
-
-    if (potentialIncomingPacket != NULL) {
-        MESSAGE_AddHeader(
-            node,
-            potentialIncomingPacket,
-            sizeof(Phy802_11PlcpHeader),
-            TRACE_802_11);
+    static BOOL IsRetuning(Node* node, int phyIndex) {
+        return FALSE;
     }
-}
-
-static /*inline*/
-void Phy802_11ReportStatusToMac(
-    Node *node, int phyNum, PhyStatusType status)
-{
-    Phy802_11ReportExtendedStatusToMac(
-        node, phyNum, status, 0, NULL);
-}
-
-static //inline//
-void Phy802_11LockSignal(
-    Node* node,
-    PhyData802_11* phy802_11,
-    Message *msg,
-    double rxPower_mW,
-    clocktype rxEndTime,
-    Orientation rxDOA)
-{
-
-    char *plcp = MESSAGE_ReturnPacket(msg);
-    memcpy(&phy802_11->rxDataRateType,plcp,sizeof(int));
 
-    if (DEBUG)
-    {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: LockSignal from %d at %d\n",
-               currTime,
-               msg->originatingNodeId,
-               node->nodeId);
+    static void SignalLostToRetune(PhyType* phy) {
     }
 
-    phy802_11->rxMsg = msg;
-    phy802_11->rxMsgError = FALSE;
-    phy802_11->rxMsgPower_mW = rxPower_mW;
-    phy802_11->rxTimeEvaluated = getSimTime(node);
-    phy802_11->rxEndTime = rxEndTime;
-    phy802_11->rxDOA = rxDOA;
-    phy802_11->stats.totalSignalsLocked++;
-}
-
-static //inline//
-void Phy802_11UnlockSignal(PhyData802_11* phy802_11) {
-    phy802_11->rxMsg = NULL;
-    phy802_11->rxMsgError = FALSE;
-    phy802_11->rxMsgPower_mW = 0.0;
-    phy802_11->rxTimeEvaluated = 0;
-    phy802_11->rxEndTime = 0;
-    phy802_11->rxDOA.azimuth = 0;
-    phy802_11->rxDOA.elevation = 0;
-}
-
-static /*inline*/
-BOOL Phy802_11CarrierSensing(Node* node, PhyData802_11* phy802_11) {
-
-    double rxSensitivity_mW = phy802_11->rxSensitivity_mW[0];
-
-    if (!ANTENNA_IsInOmnidirectionalMode(node, phy802_11->
-        thisPhy->phyIndex)) {
-        rxSensitivity_mW =
-            NON_DB(IN_DB(rxSensitivity_mW) +
-                   phy802_11->directionalAntennaGain_dB);
-    }//if//
-
-    if ((phy802_11->interferencePower_mW + phy802_11->noisePower_mW) >
-        rxSensitivity_mW)
-    {
-        return TRUE;
+    static void FrameReceived(PhyType* phy) {
     }
+};
 
-    return FALSE;
-}
-
-static //inline//
-BOOL Phy802_11CheckRxPacketError(
-    Node* node,
-    PhyData802_11* phy802_11,
-    double *sinrPtr)
-{
-    double sinr;
-    double BER;
-    double noise =
-        phy802_11->thisPhy->noise_mW_hz * phy802_11->channelBandwidth;
+typedef Phy802_11Receiver<Phy802_11Model> Phy802_11Rx;
 
-    assert(phy802_11->rxMsgError == FALSE);
 
-    if (phy802_11->thisPhy->phyModel == PHY802_11b &&
-        (phy802_11->rxDataRateType == PHY802_11b__6M ||
-         phy802_11->rxDataRateType == PHY802_11b_11M))
-    {
-        noise = noise * 11.0;
-    }
-
-    sinr = (phy802_11->rxMsgPower_mW /
-            (phy802_11->interferencePower_mW + noise));
-
-
-    if (sinrPtr != NULL)
-    {
-        *sinrPtr = sinr;
-    }
-
-    assert(phy802_11->rxDataRateType >= 0 &&
-           phy802_11->rxDataRateType < phy802_11->numDataRates);
-
-    BER = PHY_BER(phy802_11->thisPhy,
-                  phy802_11->rxDataRateType,
-                  sinr);
-
-    if (BER != 0.0) {
-        double numBits =
-            ((double)(getSimTime(node) - phy802_11->rxTimeEvaluated) *
-             (double)phy802_11->dataRate[phy802_11->rxDataRateType] /
-             (double)SECOND);
-
-        double errorProbability = 1.0 - pow((1.0 - BER), numBits);
-        double rand = RANDOM_erand(phy802_11->thisPhy->seed);
-
-        assert((errorProbability >= 0.0) && (errorProbability <= 1.0));
-
-        if (errorProbability > rand) {
-            return TRUE;
-        }
-    }
-
-    return FALSE;
+double
+Phy802_11GetSignalStrength(Node *node,PhyData802_11* phy802_11)
+{
+    double rxThreshold_mW;
+    int dataRateToUse;
+    Phy802_11GetLowestTxDataRateType(phy802_11->thisPhy, &dataRateToUse);
+    rxThreshold_mW = phy802_11->rxSensitivity_mW[dataRateToUse];
+    return IN_DB(rxThreshold_mW);
 }
 
 static
@@ -231,76 +83,7 @@ void Phy802_11aInitializeDefaultParameters(Node* node, int phyIndex) {
     PhyData802_11* phy802_11a =
         (PhyData802_11*)(node->phyData[phyIndex]->phyVar);
 
-
-    phy802_11a->numDataRates = PHY802_11a_NUM_DATA_RATES;
-
-    phy802_11a->txDefaultPower_dBm[PHY802_11a__6M] =
-        PHY802_11a_DEFAULT_TX_POWER__6M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a__9M] =
-        PHY802_11a_DEFAULT_TX_POWER__9M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_12M] =
-        PHY802_11a_DEFAULT_TX_POWER_12M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_18M] =
-        PHY802_11a_DEFAULT_TX_POWER_18M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_24M] =
-        PHY802_11a_DEFAULT_TX_POWER_24M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_36M] =
-        PHY802_11a_DEFAULT_TX_POWER_36M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_48M] =
-        PHY802_11a_DEFAULT_TX_POWER_48M_dBm;
-    phy802_11a->txDefaultPower_dBm[PHY802_11a_54M] =
-        PHY802_11a_DEFAULT_TX_POWER_54M_dBm;
-
-
-    phy802_11a->rxSensitivity_mW[PHY802_11a__6M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY__6M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a__9M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY__9M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_12M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_12M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_18M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_18M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_24M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_24M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_36M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_36M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_48M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_48M_dBm);
-    phy802_11a->rxSensitivity_mW[PHY802_11a_54M] =
-        NON_DB(PHY802_11a_DEFAULT_RX_SENSITIVITY_54M_dBm);
-
-
-    phy802_11a->dataRate[PHY802_11a__6M] = PHY802_11a_DATA_RATE__6M;
-    phy802_11a->dataRate[PHY802_11a__9M] = PHY802_11a_DATA_RATE__9M;
-    phy802_11a->dataRate[PHY802_11a_12M] = PHY802_11a_DATA_RATE_12M;
-    phy802_11a->dataRate[PHY802_11a_18M] = PHY802_11a_DATA_RATE_18M;
-    phy802_11a->dataRate[PHY802_11a_24M] = PHY802_11a_DATA_RATE_24M;
-    phy802_11a->dataRate[PHY802_11a_36M] = PHY802_11a_DATA_RATE_36M;
-    phy802_11a->dataRate[PHY802_11a_48M] = PHY802_11a_DATA_RATE_48M;
-    phy802_11a->dataRate[PHY802_11a_54M] = PHY802_11a_DATA_RATE_54M;
-
-
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a__6M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL__6M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a__9M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL__9M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_12M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_12M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_18M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_18M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_24M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_24M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_36M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_36M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_48M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_48M;
-    phy802_11a->numDataBitsPerSymbol[PHY802_11a_54M] =
-        PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_54M;
-
-
-    phy802_11a->lowestDataRateType = PHY802_11a_LOWEST_DATA_RATE_TYPE;
-    phy802_11a->highestDataRateType = PHY802_11a_HIGHEST_DATA_RATE_TYPE;
-    phy802_11a->txDataRateTypeForBC = PHY802_11a_DATA_RATE_TYPE_FOR_BC;
+    Phy802_11aCore::InitializeDefaultRates(phy802_11a);
 
     phy802_11a->channelBandwidth = PHY802_11a_CHANNEL_BANDWIDTH;
     phy802_11a->rxTxTurnaroundTime = PHY802_11a_RX_TX_TURNAROUND_TIME;
@@ -540,48 +323,7 @@ void Phy802_11bInitializeDefaultParameters(Node* node, int phyIndex) {
     PhyData802_11* phy802_11b =
         (PhyData802_11*)(node->phyData[phyIndex]->phyVar);
 
-
-    phy802_11b->numDataRates = PHY802_11b_NUM_DATA_RATES;
-
-    phy802_11b->txDefaultPower_dBm[PHY802_11b__1M] =
-        PHY802_11b_DEFAULT_TX_POWER__1M_dBm;
-    phy802_11b->txDefaultPower_dBm[PHY802_11b__2M] =
-        PHY802_11b_DEFAULT_TX_POWER__2M_dBm;
-    phy802_11b->txDefaultPower_dBm[PHY802_11b__6M] =
-        PHY802_11b_DEFAULT_TX_POWER__6M_dBm;
-    phy802_11b->txDefaultPower_dBm[PHY802_11b_11M] =
-        PHY802_11b_DEFAULT_TX_POWER_11M_dBm;
-
-
-    phy802_11b->rxSensitivity_mW[PHY802_11b__1M] =
-        NON_DB(PHY802_11b_DEFAULT_RX_SENSITIVITY__1M_dBm);
-    phy802_11b->rxSensitivity_mW[PHY802_11b__2M] =
-        NON_DB(PHY802_11b_DEFAULT_RX_SENSITIVITY__2M_dBm);
-    phy802_11b->rxSensitivity_mW[PHY802_11b__6M] =
-        NON_DB(PHY802_11b_DEFAULT_RX_SENSITIVITY__6M_dBm);
-    phy802_11b->rxSensitivity_mW[PHY802_11b_11M] =
-        NON_DB(PHY802_11b_DEFAULT_RX_SENSITIVITY_11M_dBm);
-
-
-    phy802_11b->dataRate[PHY802_11b__1M] = PHY802_11b_DATA_RATE__1M;
-    phy802_11b->dataRate[PHY802_11b__2M] = PHY802_11b_DATA_RATE__2M;
-    phy802_11b->dataRate[PHY802_11b__6M] = PHY802_11b_DATA_RATE__6M;
-    phy802_11b->dataRate[PHY802_11b_11M] = PHY802_11b_DATA_RATE_11M;
-
-
-    phy802_11b->numDataBitsPerSymbol[PHY802_11b__1M] =
-        PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__1M;
-    phy802_11b->numDataBitsPerSymbol[PHY802_11b__2M] =
-        PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__2M;
-    phy802_11b->numDataBitsPerSymbol[PHY802_11b__6M] =
-        PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__6M;
-    phy802_11b->numDataBitsPerSymbol[PHY802_11b_11M] =
-        PHY802_11b_NUM_DATA_BITS_PER_SYMBOL_11M;
-
-
-    phy802_11b->lowestDataRateType = PHY802_11b_LOWEST_DATA_RATE_TYPE;
-    phy802_11b->highestDataRateType = PHY802_11b_HIGHEST_DATA_RATE_TYPE;
-    phy802_11b->txDataRateTypeForBC = PHY802_11b_DATA_RATE_TYPE_FOR_BC;
+    Phy802_11bCore::InitializeDefaultRates(phy802_11b);
 
     phy802_11b->rxDataRateType = PHY802_11b_LOWEST_DATA_RATE_TYPE;
 
@@ -897,7 +639,7 @@ void Phy802_11Init(
 
         if (wasFound1) {
             for (i = 0; i < phy802_11->numDataRates; i++) {
-                if (dataRate == phy802_11->dataRate[i]) {
+                if (dataRate == Phy802_11GetDataRate(phy802_11->thisPhy, i)) {
                     break;
                 }
             }
@@ -932,7 +674,9 @@ void Phy802_11Init(
 
     if (wasFound) {
         for (i = 0; i < phy802_11->numDataRates; i++) {
-            if (dataRateForBroadcast == phy802_11->dataRate[i]) {
+            if (dataRateForBroadcast ==
+                Phy802_11GetDataRate(phy802_11->thisPhy, i))
+            {
                 break;
             }
         }
@@ -976,6 +720,8 @@ void Phy802_11Init(
             "PHY802.11-ESTIMATED-DIRECTIONAL-ANTENNA-GAIN is missing\n");
     }
 
+    Phy802_11Rx::SetDirectionalSensitivity(phy802_11);
+
 
     //
     // Initialize phy statistics variables
@@ -993,6 +739,9 @@ void Phy802_11Init(
     //
     phy802_11->rxMsg = NULL;
     phy802_11->rxMsgError = FALSE;
+    phy802_11->rxMsgIsAggregate = FALSE;
+    phy802_11->rxMinSinr = 0.0;
+    phy802_11->txIsAggregate = FALSE;
     phy802_11->rxMsgPower_mW = 0.0;
     phy802_11->interferencePower_mW = 0.0;
     phy802_11->noisePower_mW =
@@ -1003,7 +752,7 @@ void Phy802_11Init(
     phy802_11->rxDOA.elevation = 0;
     phy802_11->previousMode = PHY_IDLE;
     phy802_11->mode = PHY_IDLE;
-    Phy802_11ChangeState(node,phyIndex, PHY_IDLE);
+    Phy802_11Rx::ChangeState(node,phyIndex, PHY_IDLE);
 
     //
     // Setting up the channel to use for both TX and RX
@@ -1049,19 +798,19 @@ void Phy802_11ChannelListeningSwitchNotification(
             NULL,
             &(phy802_11->interferencePower_mW));
 
-        if (Phy802_11CarrierSensing(node, phy802_11) == TRUE) {
-            Phy802_11ChangeState(node,phyIndex, PHY_SENSING);
+        if (Phy802_11Rx::CarrierSensing(node, phy802_11) == TRUE) {
+            Phy802_11Rx::ChangeState(node,phyIndex, PHY_SENSING);
         }
         else {
-            Phy802_11ChangeState(node,phyIndex, PHY_IDLE);
+            Phy802_11Rx::ChangeState(node,phyIndex, PHY_IDLE);
         }
 
         if(phy802_11->previousMode != phy802_11->mode)
-            Phy802_11ReportStatusToMac(node, phyIndex, phy802_11->mode);
+            Phy802_11Rx::ReportStatusToMac(node, phyIndex, phy802_11->mode);
     }
     else if(phy802_11->mode != PHY_TRANSMITTING)
     {
-        Phy802_11ChangeState(node,phyIndex, PHY_TRX_OFF);
+        Phy802_11Rx::ChangeState(node,phyIndex, PHY_TRX_OFF);
     }
 
 }
@@ -1123,7 +872,7 @@ BOOL Phy802_11MediumIsIdle(Node* node, int phyIndex) {
         NULL,
         &(phy802_11->interferencePower_mW));
 
-    IsIdle = (!Phy802_11CarrierSensing(node, phy802_11));
+    IsIdle = (!Phy802_11Rx::CarrierSensing(node, phy802_11));
     phy802_11->interferencePower_mW = oldInterferencePower;
 
     return IsIdle;
@@ -1161,7 +910,7 @@ BOOL Phy802_11MediumIsIdleInDirection(Node* node, int phyIndex,
         NULL,
         &(phy802_11->interferencePower_mW));
 
-    IsIdle = (!Phy802_11CarrierSensing(node, phy802_11));
+    IsIdle = (!Phy802_11Rx::CarrierSensing(node, phy802_11));
     phy802_11->interferencePower_mW = oldInterferencePower;
     ANTENNA_SetToDefaultMode(node, phyIndex);
 
@@ -1219,136 +968,30 @@ void Phy802_11Finalize(Node *node, const int phyIndex) {
             (int) phy802_11->stats.totalSignalsWithErrors);
     IO_PrintStat(node, "Physical", "802.11", ANY_DEST, phyIndex, buf);
 
-    Phy802_11ChangeState(node,phyIndex, PHY_IDLE);
+    Phy802_11Rx::ChangeState(node,phyIndex, PHY_IDLE);
 
 }
 
 
 
+//
+// The receive path is specialized per rate set; the rate set of a node
+// is fixed, so these entry points only pick the instantiation.
+//
 void Phy802_11SignalArrivalFromChannel(
     Node* node,
     int phyIndex,
     int channelIndex,
     PropRxInfo *propRxInfo)
 {
-    PhyData *thisPhy = node->phyData[phyIndex];
-    PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
-    assert(phy802_11->mode != PHY_TRANSMITTING);
-
-    if (DEBUG)
-    {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: SignalArrival from %d at %d\n",
-               currTime,
-               propRxInfo->txMsg->originatingNodeId,
-               node->nodeId);
-    }
-    switch (phy802_11->mode) {
-        case PHY_RECEIVING: {
-            double rxPower_mW =
-                NON_DB(ANTENNA_GainForThisSignal(node, phyIndex,
-                        propRxInfo) + propRxInfo->rxPower_dBm);
-
-
-            if (!phy802_11->rxMsgError) {
-               phy802_11->rxMsgError = Phy802_11CheckRxPacketError(
-                   node,
-                   phy802_11,
-                   NULL);
-            }//if//
-
-            phy802_11->rxTimeEvaluated = getSimTime(node);
-            phy802_11->interferencePower_mW += rxPower_mW;
-
-            break;
-        }
-
-        //
-        // If the phy is idle or sensing,
-        // check if it can receive this signal.
-        //
-        case PHY_IDLE:
-        case PHY_SENSING:
-        {
-            double rxInterferencePower_mW = NON_DB(
-                ANTENNA_GainForThisSignal(node, phyIndex, propRxInfo) +
-                propRxInfo->rxPower_dBm);
-
-            double rxPowerInOmni_mW = NON_DB(
-                ANTENNA_DefaultGainForThisSignal(node, phyIndex, propRxInfo)
-                + propRxInfo->rxPower_dBm);
-
-            if (rxPowerInOmni_mW >= phy802_11->rxSensitivity_mW[0]) {
-                PropTxInfo *propTxInfo
-                    = (PropTxInfo *)MESSAGE_ReturnInfo(propRxInfo->txMsg);
-                clocktype txDuration = propTxInfo->duration;
-                double rxPower_mW;
-
-                if (!ANTENNA_IsLocked(node, phyIndex)) {
-                   ANTENNA_SetToBestGainConfigurationForThisSignal(
-                       node, phyIndex, propRxInfo);
-
-                   PHY_SignalInterference(
-                       node,
-                       phyIndex,
-                       channelIndex,
-                       propRxInfo->txMsg,
-                       &rxPower_mW,
-                       &(phy802_11->interferencePower_mW));
-                }
-                else {
-                    // 802_11 will listen to this signal, taken care of in SignalEnd
-                    rxPower_mW = rxInterferencePower_mW;
-                }
-
-                Phy802_11LockSignal(
-                    node,
-                    phy802_11,
-                    propRxInfo->txMsg,
-                    rxPower_mW,
-                    (propRxInfo->rxStartTime + propRxInfo->duration),
-                    propRxInfo->rxDOA);
-                Phy802_11ChangeState(node,phyIndex, PHY_RECEIVING);
-                Phy802_11ReportExtendedStatusToMac(
-                    node,
-                    phyIndex,
-                    PHY_RECEIVING,
-                    txDuration,
-                    propRxInfo->txMsg);
-            }
-            else {
-                //
-                // Otherwise, check if the signal changes the phy status
-                //
-
-                PhyStatusType newMode;
-
-                phy802_11->interferencePower_mW += rxInterferencePower_mW;
-
-                if (Phy802_11CarrierSensing(node, phy802_11)) {
-                   newMode = PHY_SENSING;
-                } else {
-                   newMode = PHY_IDLE;
-                }//if//
-
-                if (newMode != phy802_11->mode) {
-                    Phy802_11ChangeState(node,phyIndex, newMode);
-                    Phy802_11ReportStatusToMac(
-                        node,
-                        phyIndex,
-                        newMode);
-
-                }//if//
-            }//if//
-
-            break;
-        }
-
-        default:
-            abort();
-
-    }//switch (phy802_11->mode)//
+    if (node->phyData[phyIndex]->phyModel == PHY802_11b) {
+        Phy802_11Rx::SignalArrivalFromChannel<Phy802_11bTraits>(
+            node, phyIndex, channelIndex, propRxInfo);
+    }
+    else {
+        Phy802_11Rx::SignalArrivalFromChannel<Phy802_11aTraits>(
+            node, phyIndex, channelIndex, propRxInfo);
+    }
 }
 
 
@@ -1358,89 +1001,21 @@ void Phy802_11TerminateCurrentReceive(
     BOOL* frameError,
     clocktype* endSignalTime)
 {
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyData802_11* phy802_11 = (PhyData802_11*)thisPhy->phyVar;
-
-
-    *endSignalTime = phy802_11->rxEndTime;
-
-    if (!phy802_11->rxMsgError) {
-       phy802_11->rxMsgError = Phy802_11CheckRxPacketError(
-           node,
-           phy802_11,
-           NULL);
-    }//if//
-
-    *frameError = phy802_11->rxMsgError;
-
-    if ((terminateOnlyOnReceiveError) && (!phy802_11->rxMsgError)) {
-        return;
-    }//if//
-
-    if (thisPhy->antennaData->antennaModelType == ANTENNA_OMNIDIRECTIONAL) {
-
-        phy802_11->interferencePower_mW += phy802_11->rxMsgPower_mW;
+    if (node->phyData[phyIndex]->phyModel == PHY802_11b) {
+        Phy802_11Rx::TerminateCurrentReceive<Phy802_11bTraits>(
+            node, phyIndex, terminateOnlyOnReceiveError,
+            frameError, endSignalTime);
     }
     else {
-        int channelIndex;
-        PHY_GetTransmissionChannel(node, phyIndex, &channelIndex);
-
-        ERROR_Assert(((thisPhy->antennaData->antennaModelType
-                    == ANTENNA_SWITCHED_BEAM) ||
-               (thisPhy->antennaData->antennaModelType
-                    == ANTENNA_STEERABLE) ||
-               (thisPhy->antennaData->antennaModelType
-                    == ANTENNA_PATTERNED)) ,
-                "Illegal antennaModelType");
-
-        if (!ANTENNA_IsLocked(node, phyIndex)) {
-            ANTENNA_SetToDefaultMode(node, phyIndex);
-        }//if//
-
-        PHY_SignalInterference(
-            node,
-            phyIndex,
-            channelIndex,
-            NULL,
-            NULL,
-            &(phy802_11->interferencePower_mW));
-    }//if//
-
-
-    Phy802_11UnlockSignal(phy802_11);
-    if (Phy802_11CarrierSensing(node, phy802_11)) {
-        Phy802_11ChangeState(node,phyIndex, PHY_SENSING);
-    } else {
-            Phy802_11ChangeState(node,phyIndex, PHY_IDLE);
-
-    }//if//
+        Phy802_11Rx::TerminateCurrentReceive<Phy802_11aTraits>(
+            node, phyIndex, terminateOnlyOnReceiveError,
+            frameError, endSignalTime);
+    }
 }
 
 void Phy802_11TerminateCurrentTransmission(Node* node, int phyIndex)
 {
-    PhyData* thisPhy = node->phyData[phyIndex];
-    PhyData802_11* phy802_11 = (PhyData802_11*)thisPhy->phyVar;
-     int channelIndex;
-    PHY_GetTransmissionChannel(node, phyIndex, &channelIndex);
-
-    //GuiStart
-    if (node->guiOption == TRUE) {
-        GUI_EndBroadcast(node->nodeId,
-                         GUI_PHY_LAYER,
-                         GUI_DEFAULT_DATA_TYPE,
-                         thisPhy->macInterfaceIndex,
-                         getSimTime(node));
-    }
-    //GuiEnd
-    assert(phy802_11->mode == PHY_TRANSMITTING);
-
-    //Cancel the timer end message so that 'Phy802_11TransmissionEnd' is
-    // not called.
-    if( phy802_11->txEndTimer)
-    {
-        MESSAGE_CancelSelfMsg(node, phy802_11->txEndTimer);
-        phy802_11->txEndTimer = NULL;
-    }
+    Phy802_11Rx::TerminateCurrentTransmission(node, phyIndex);
 }
 
 
@@ -1452,183 +1027,14 @@ void Phy802_11SignalEndFromChannel(
     int channelIndex,
     PropRxInfo *propRxInfo)
 {
-    PhyData *thisPhy = node->phyData[phyIndex];
-    PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
-    double sinr = -1.0;
-
-    BOOL receiveErrorOccurred = FALSE;
-
-    if (DEBUG)
-    {
-        char currTime[MAX_STRING_LENGTH];
-        TIME_PrintClockInSecond(getSimTime(node), currTime);
-        printf("\ntime %s: SignalEnd from %d at %d\n",
-               currTime,
-               propRxInfo->txMsg->originatingNodeId,
-               node->nodeId);
-    }
-    assert(phy802_11->mode != PHY_TRANSMITTING);
-
-    if (phy802_11->mode == PHY_RECEIVING) {
-        if (phy802_11->rxMsgError == FALSE) {
-            phy802_11->rxMsgError = Phy802_11CheckRxPacketError(
-                node,
-                phy802_11,
-                &sinr);
-            phy802_11->rxTimeEvaluated = getSimTime(node);
-        }//if
-    }//if//
-
-    receiveErrorOccurred = phy802_11->rxMsgError;
-
-    //
-    // If the phy is still receiving this signal, forward the frame
-    // to the MAC layer.
-    //
-
-    if ((phy802_11->mode == PHY_RECEIVING) &&
-        (phy802_11->rxMsg == propRxInfo->txMsg))
-    {
-        Message *newMsg;
-
-        if (!ANTENNA_IsLocked(node, phyIndex)) {
-            ANTENNA_SetToDefaultMode(node, phyIndex);
-            //GuiStart
-            if (node->guiOption) {
-                GUI_SetPatternIndex(node,
-                                    thisPhy->macInterfaceIndex,
-                                    ANTENNA_OMNIDIRECTIONAL_PATTERN,
-                                    getSimTime(node));
-            }
-            //GuiEnd
-            PHY_SignalInterference(
-                node,
-                phyIndex,
-                channelIndex,
-                NULL,
-                NULL,
-                &(phy802_11->interferencePower_mW));
-        }//if//
-
-        //Perform Signal measurement
-        PhySignalMeasurement sigMeasure;
-        sigMeasure.rxBeginTime = propRxInfo->rxStartTime;
-
-        double noise = phy802_11->thisPhy->noise_mW_hz *
-                           phy802_11->channelBandwidth;
-        if (phy802_11->thisPhy->phyModel == PHY802_11b &&
-            (phy802_11->rxDataRateType == PHY802_11b__6M ||
-             phy802_11->rxDataRateType == PHY802_11b_11M))
-        {
-            noise = noise * 11.0;
-        }
-
-        sigMeasure.rss = IN_DB(phy802_11->rxMsgPower_mW);
-        sigMeasure.snr = IN_DB(phy802_11->rxMsgPower_mW /noise);
-        sigMeasure.cinr = IN_DB(phy802_11->rxMsgPower_mW /
-                             (phy802_11->interferencePower_mW + noise));
-
-        // printf("Phy802_11SignalEndFromChannel: rss %f, snr %f, cinr %f \n", 
-        //     sigMeasure.rss, sigMeasure.snr, sigMeasure.cinr);
-
-		//pasted from forum
-		//------------------------
-		/*
-		static int count;
-		static float total;
-		float avg;
-		//printf("SignalEnd from %d at %d\n",propRxInfo->txMsg->originatingNodeId,node->nodeId);
-		//if(propRxInfo->txMsg->originatingProtocol == 4 && node->nodeId == 26 && propRxInfo->txMsg->originatingNodeId == 12)
-		printf("noise = %f\n",noise);
-		printf("%f\n",phy802_11->rxMsgPower_mW );
-		//printf("check = %f\n",c);
-		//printf("%d \t %f\n",phy802_11->channelBandwidth,phy802_11->interferencePower_mW);
-		//printf("originating protocol is %d\n", propRxInfo->txMsg->originatingProtocol);
-		count++;
-		Int8 buf[MAX_STRING_LENGTH];
-		sprintf(buf,"\n nodeid %d with SNR = %f",node->nodeId, sigMeasure.snr);
-		ERROR_ReportWarning(buf);
-		total = total + sigMeasure.snr;
-		printf("\n%d\t\t%f\n",count,total);
-		avg = total/count;
-		printf("\n\t%f",avg);
-		*/
-		//-------------------------
-		//end of pasted from forum
-
-        Phy802_11UnlockSignal(phy802_11);
-
-        if (Phy802_11CarrierSensing(node, phy802_11) == TRUE) {
-
-            Phy802_11ChangeState(node,phyIndex, PHY_SENSING);
-        }
-        else {
-            Phy802_11ChangeState(node,phyIndex, PHY_IDLE);
-        }
-
-        if (!receiveErrorOccurred) {
-            newMsg = MESSAGE_Duplicate(node, propRxInfo->txMsg);
-
-            MESSAGE_RemoveHeader(
-                node, newMsg, sizeof(Phy802_11PlcpHeader), TRACE_802_11);
-
-            PhySignalMeasurement* signalMeaInfo;
-            MESSAGE_InfoAlloc(node,
-                              newMsg,
-                              sizeof(PhySignalMeasurement));
-            signalMeaInfo = (PhySignalMeasurement*)
-                            MESSAGE_ReturnInfo(newMsg);
-            memcpy(signalMeaInfo,&sigMeasure,sizeof(PhySignalMeasurement));
-
-
-            MESSAGE_SetInstanceId(newMsg, (short) phyIndex);
-            MAC_ReceivePacketFromPhy(
-                node,
-                node->phyData[phyIndex]->macInterfaceIndex,
-                newMsg);
-
-            phy802_11->stats.totalRxSignalsToMac++;
-        }
-        else {
-            // printf("receive error occurred node %d \n", node->nodeId);
-            Phy802_11ReportStatusToMac(
-                node,
-                phyIndex,
-                phy802_11->mode);
-
-            phy802_11->stats.totalSignalsWithErrors++;
-        }//if//
+    if (node->phyData[phyIndex]->phyModel == PHY802_11b) {
+        Phy802_11Rx::SignalEndFromChannel<Phy802_11bTraits>(
+            node, phyIndex, channelIndex, propRxInfo);
     }
     else {
-        PhyStatusType newMode;
-
-        double rxPower_mW =
-            NON_DB(ANTENNA_GainForThisSignal(node, phyIndex, propRxInfo) +
-                   propRxInfo->rxPower_dBm);
-
-        phy802_11->interferencePower_mW -= rxPower_mW;
-
-        if (phy802_11->interferencePower_mW < 0.0) {
-            phy802_11->interferencePower_mW = 0.0;
-        }
-
-
-        if (phy802_11->mode != PHY_RECEIVING) {
-           if (Phy802_11CarrierSensing(node, phy802_11) == TRUE) {
-               newMode = PHY_SENSING;
-           } else {
-               newMode = PHY_IDLE;
-           }//if//
-
-           if (newMode != phy802_11->mode) {
-                Phy802_11ChangeState(node,phyIndex, newMode);
-               Phy802_11ReportStatusToMac(
-                   node,
-                   phyIndex,
-                   newMode);
-           }//if//
-        }//if//
-    }//if//
+        Phy802_11Rx::SignalEndFromChannel<Phy802_11aTraits>(
+            node, phyIndex, channelIndex, propRxInfo);
+    }
 }
 
 
@@ -1648,17 +1054,26 @@ void Phy802_11GetTransmitPower(PhyData *thisPhy, double *txPower_mW) {
 
 
 
+int Phy802_11GetDataRate(PhyData *thisPhy, int dataRateType) {
+    if (thisPhy->phyModel == PHY802_11b) {
+        return Phy802_11bCore::DataRate(dataRateType);
+    }
+
+    return Phy802_11aCore::DataRate(dataRateType);
+}
+
+
 int Phy802_11GetTxDataRate(PhyData *thisPhy) {
     PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
 
-    return phy802_11->dataRate[phy802_11->txDataRateType];
+    return Phy802_11GetDataRate(thisPhy, phy802_11->txDataRateType);
 }
 
 
 int Phy802_11GetRxDataRate(PhyData *thisPhy) {
     PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
 
-    return phy802_11->dataRate[phy802_11->rxDataRateType];
+    return Phy802_11GetDataRate(thisPhy, phy802_11->rxDataRateType);
 }
 
 
@@ -1688,6 +1103,15 @@ void Phy802_11SetTxDataRateType(PhyData* thisPhy, int dataRateType) {
 }
 
 
+// Marks the next frame handed to the PHY as an A-MPDU. Cleared again
+// once that frame is on the air.
+void Phy802_11SetTxAggregation(PhyData* thisPhy, BOOL isAggregate) {
+    PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
+
+    phy802_11->txIsAggregate = isAggregate;
+}
+
+
 void Phy802_11GetLowestTxDataRateType(PhyData* thisPhy, int* dataRateType) {
     PhyData802_11* phy802_11 = (PhyData802_11*) thisPhy->phyVar;
 
@@ -1760,27 +1184,11 @@ clocktype Phy802_11GetFrameDuration(
 {
     switch (thisPhy->phyModel) {
         case PHY802_11a: {
-            const PhyData802_11* phy802_11a = (PhyData802_11*)
-                                                thisPhy->phyVar;
-            const int numOfdmSymbols =
-                (int)ceil((size * 8 +
-                           PHY802_11a_SERVICE_BITS_SIZE +
-                           PHY802_11a_TAIL_BITS_SIZE) /
-                          phy802_11a->numDataBitsPerSymbol[dataRateType]);
-            return
-                PHY802_11a_SYNCHRONIZATION_TIME +
-                (numOfdmSymbols * PHY802_11a_OFDM_SYMBOL_DURATION) *
-                MICRO_SECOND;
+            return Phy802_11aCore::FrameDuration(dataRateType, size);
         }
 
         case PHY802_11b: {
-            const PhyData802_11* phy802_11b =
-                        (PhyData802_11*) thisPhy->phyVar;
-            const int numSymbols =
-                (int)ceil(size * 8 / phy802_11b->numDataBitsPerSymbol
-                                                       [dataRateType]);
-            return PHY802_11b_SYNCHRONIZATION_TIME + numSymbols
-                                                    * MICRO_SECOND;
+            return Phy802_11bCore::FrameDuration(dataRateType, size);
         }
 
         default:
@@ -1908,9 +1316,9 @@ void StartTransmittingSignal(
                 NULL,
                 &(phy802_11->interferencePower_mW));
         }
-        Phy802_11UnlockSignal(phy802_11);
+        Phy802_11Rx::UnlockSignal(phy802_11);
     }
-    Phy802_11ChangeState(node,phyIndex, PHY_TRANSMITTING);
+    Phy802_11Rx::ChangeState(node,phyIndex, PHY_TRANSMITTING);
 
     duration =
         Phy802_11GetFrameDuration(
@@ -1919,8 +1327,11 @@ void StartTransmittingSignal(
     MESSAGE_AddHeader(node, packet, sizeof(Phy802_11PlcpHeader),
                       TRACE_802_11);
 
-    char *plcp1 = MESSAGE_ReturnPacket(packet);
-    memcpy(plcp1,&phy802_11->txDataRateType,sizeof(int));
+    Phy802_11PlcpHeader plcp;
+    plcp.rate = phy802_11->txDataRateType;
+    plcp.isAggregate = phy802_11->txIsAggregate;
+    memcpy(MESSAGE_ReturnPacket(packet), &plcp, sizeof(Phy802_11PlcpHeader));
+    phy802_11->txIsAggregate = FALSE;
 
     if (PHY_IsListeningToChannel(node, phyIndex, channelIndex))
     {
@@ -153,8 +153,14 @@
 #define PHY802_11b_DEFAULT_RX_SENSITIVITY__6M_dBm  -87.0
 #define PHY802_11b_DEFAULT_RX_SENSITIVITY_11M_dBm  -83.0
 
+//
+// isAggregate stands in for the aggregation bit of the HT-SIG field.
+// The receiver then leaves the error decision to the MAC, which draws
+// it per subframe.
+//
 typedef struct phy_802_11_plcp_header {
-    int rate;
+    int  rate;
+    BOOL isAggregate;
 } Phy802_11PlcpHeader;
 
 //
@@ -206,12 +212,12 @@ typedef struct struct_phy_802_11_str {
     double    rxSensitivity_mW[PHY802_11_NUM_DATA_RATES];
 
     int       numDataRates;
-    int       dataRate[PHY802_11_NUM_DATA_RATES];
-    double    numDataBitsPerSymbol[PHY802_11_NUM_DATA_RATES];
     int       lowestDataRateType;
     int       highestDataRateType;
 
     double    directionalAntennaGain_dB;
+    // carrier sense threshold while the antenna is not omnidirectional
+    double    directionalRxSensitivity_mW;
 
     Message*  rxMsg;
     double    rxMsgPower_mW;
@@ -220,6 +226,12 @@ typedef struct struct_phy_802_11_str {
     clocktype rxEndTime;
     Orientation rxDOA;
 
+    // A-MPDU reception: lowest SINR seen over the frame, reported to
+    // the MAC in place of the whole-frame error draw.
+    BOOL      txIsAggregate;
+    BOOL      rxMsgIsAggregate;
+    double    rxMinSinr;
+
     Message *txEndTimer;
     D_Int32   channelBandwidth;
     clocktype rxTxTurnaroundTime;
@@ -303,12 +315,14 @@ void Phy802_11StartTransmittingSignalDirectionally(
 
 
 
+int Phy802_11GetDataRate(PhyData *thisPhy, int dataRateType);
 int Phy802_11GetTxDataRate(PhyData *thisPhy);
 int Phy802_11GetRxDataRate(PhyData *thisPhy);
 int Phy802_11GetTxDataRateType(PhyData *thisPhy);
 int Phy802_11GetRxDataRateType(PhyData *thisPhy);
 
 void Phy802_11SetTxDataRateType(PhyData* thisPhy, int dataRateType);
+void Phy802_11SetTxAggregation(PhyData* thisPhy, BOOL isAggregate);
 void Phy802_11GetLowestTxDataRateType(PhyData* thisPhy, int* dataRateType);
 void Phy802_11SetLowestTxDataRateType(PhyData* thisPhy);
 void Phy802_11GetHighestTxDataRateType(PhyData* thisPhy, int* dataRateType);
@@ -0,0 +1,249 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Shared core of the 802.11 style PHY models (PHY802.11a, PHY802.11b
+ * and PHY_CHANSWITCH).
+ *
+ * Everything that is fixed by the PHY variant - the rate set, bits per
+ * symbol, symbol time, PLCP overhead - lives in a traits struct, so each
+ * model gets its own copy of the kernels below with the tables folded in
+ * at compile time. Only what the user can configure (tx power and rx
+ * sensitivity per rate, the allowed rate range, ...) stays in the
+ * per-instance PHY structure.
+ *
+ * A traits struct provides:
+ *   NUM_DATA_RATES          number of entries in the rate tables
+ *   LOWEST_DATA_RATE_TYPE, HIGHEST_DATA_RATE_TYPE, DATA_RATE_TYPE_FOR_BC
+ *                           default rate range and broadcast rate
+ *   SERVICE_AND_TAIL_BITS   bits added to the payload before coding
+ *   BITS_PER_SYMBOL_SCALE   scale of ScaledDataBitsPerSymbol(), so that
+ *                           fractional values (5.5 for CCK) stay integral
+ *   SynchronizationTime()   preamble plus PLCP header time
+ *   SymbolDuration()        duration of one data symbol
+ *   DataRate(i)             data rate of rate type i in bps
+ *   ScaledDataBitsPerSymbol(i)
+ *   NoiseFactor(i)          noise bandwidth scaling of rate type i
+ *   DefaultTxPower_dBm(i), DefaultRxSensitivity_dBm(i)
+ *                           defaults of the configurable per-rate values
+ *
+ * The receive path shared by the models is in phy_802_11_receive.h.
+ */
+
+#ifndef PHY_802_11_CORE_H
+#define PHY_802_11_CORE_H
+
+#include "phy_802_11.h"
+
+struct Phy802_11aTraits {
+    enum {
+        NUM_DATA_RATES = PHY802_11a_NUM_DATA_RATES,
+        LOWEST_DATA_RATE_TYPE = PHY802_11a_LOWEST_DATA_RATE_TYPE,
+        HIGHEST_DATA_RATE_TYPE = PHY802_11a_HIGHEST_DATA_RATE_TYPE,
+        DATA_RATE_TYPE_FOR_BC = PHY802_11a_DATA_RATE_TYPE_FOR_BC,
+        SERVICE_AND_TAIL_BITS =
+            PHY802_11a_SERVICE_BITS_SIZE + PHY802_11a_TAIL_BITS_SIZE,
+        BITS_PER_SYMBOL_SCALE = 1
+    };
+
+    static clocktype SynchronizationTime() {
+        return PHY802_11a_SYNCHRONIZATION_TIME;
+    }
+
+    static clocktype SymbolDuration() {
+        return PHY802_11a_OFDM_SYMBOL_DURATION * MICRO_SECOND;
+    }
+
+    static int DataRate(int dataRateType) {
+        static const int dataRate[NUM_DATA_RATES] = {
+            PHY802_11a_DATA_RATE__6M, PHY802_11a_DATA_RATE__9M,
+            PHY802_11a_DATA_RATE_12M, PHY802_11a_DATA_RATE_18M,
+            PHY802_11a_DATA_RATE_24M, PHY802_11a_DATA_RATE_36M,
+            PHY802_11a_DATA_RATE_48M, PHY802_11a_DATA_RATE_54M };
+        return dataRate[dataRateType];
+    }
+
+    static int ScaledDataBitsPerSymbol(int dataRateType) {
+        static const int numDataBitsPerSymbol[NUM_DATA_RATES] = {
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL__6M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL__9M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_12M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_18M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_24M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_36M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_48M,
+            PHY802_11a_NUM_DATA_BITS_PER_SYMBOL_54M };
+        return numDataBitsPerSymbol[dataRateType];
+    }
+
+    static double NoiseFactor(int dataRateType) {
+        return 1.0;
+    }
+
+    static double DefaultTxPower_dBm(int dataRateType) {
+        static const double txPower_dBm[NUM_DATA_RATES] = {
+            PHY802_11a_DEFAULT_TX_POWER__6M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER__9M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_12M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_18M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_24M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_36M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_48M_dBm,
+            PHY802_11a_DEFAULT_TX_POWER_54M_dBm };
+        return txPower_dBm[dataRateType];
+    }
+
+    static double DefaultRxSensitivity_dBm(int dataRateType) {
+        static const double rxSensitivity_dBm[NUM_DATA_RATES] = {
+            PHY802_11a_DEFAULT_RX_SENSITIVITY__6M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY__9M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_12M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_18M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_24M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_36M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_48M_dBm,
+            PHY802_11a_DEFAULT_RX_SENSITIVITY_54M_dBm };
+        return rxSensitivity_dBm[dataRateType];
+    }
+};
+
+//
+// 802.11b sends one symbol per microsecond with no service or tail bits.
+// CCK at 5.5 Mbps carries 5.5 bits per symbol, hence the scale of 2.
+// The CCK rates see the noise of the full 22 MHz channel, 11 times the
+// 2 MHz channelBandwidth.
+//
+struct Phy802_11bTraits {
+    enum {
+        NUM_DATA_RATES = PHY802_11b_NUM_DATA_RATES,
+        LOWEST_DATA_RATE_TYPE = PHY802_11b_LOWEST_DATA_RATE_TYPE,
+        HIGHEST_DATA_RATE_TYPE = PHY802_11b_HIGHEST_DATA_RATE_TYPE,
+        DATA_RATE_TYPE_FOR_BC = PHY802_11b_DATA_RATE_TYPE_FOR_BC,
+        SERVICE_AND_TAIL_BITS = 0,
+        BITS_PER_SYMBOL_SCALE = 2
+    };
+
+    static clocktype SynchronizationTime() {
+        return PHY802_11b_SYNCHRONIZATION_TIME;
+    }
+
+    static clocktype SymbolDuration() {
+        return MICRO_SECOND;
+    }
+
+    static int DataRate(int dataRateType) {
+        static const int dataRate[NUM_DATA_RATES] = {
+            PHY802_11b_DATA_RATE__1M, PHY802_11b_DATA_RATE__2M,
+            PHY802_11b_DATA_RATE__6M, PHY802_11b_DATA_RATE_11M };
+        return dataRate[dataRateType];
+    }
+
+    static int ScaledDataBitsPerSymbol(int dataRateType) {
+        static const int numDataBitsPerSymbol[NUM_DATA_RATES] = {
+            (int)(PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__1M * 2),
+            (int)(PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__2M * 2),
+            (int)(PHY802_11b_NUM_DATA_BITS_PER_SYMBOL__6M * 2),
+            (int)(PHY802_11b_NUM_DATA_BITS_PER_SYMBOL_11M * 2) };
+        return numDataBitsPerSymbol[dataRateType];
+    }
+
+    static double NoiseFactor(int dataRateType) {
+        return (dataRateType == PHY802_11b__6M ||
+                dataRateType == PHY802_11b_11M) ? 11.0 : 1.0;
+    }
+
+    static double DefaultTxPower_dBm(int dataRateType) {
+        static const double txPower_dBm[NUM_DATA_RATES] = {
+            PHY802_11b_DEFAULT_TX_POWER__1M_dBm,
+            PHY802_11b_DEFAULT_TX_POWER__2M_dBm,
+            PHY802_11b_DEFAULT_TX_POWER__6M_dBm,
+            PHY802_11b_DEFAULT_TX_POWER_11M_dBm };
+        return txPower_dBm[dataRateType];
+    }
+
+    static double DefaultRxSensitivity_dBm(int dataRateType) {
+        static const double rxSensitivity_dBm[NUM_DATA_RATES] = {
+            PHY802_11b_DEFAULT_RX_SENSITIVITY__1M_dBm,
+            PHY802_11b_DEFAULT_RX_SENSITIVITY__2M_dBm,
+            PHY802_11b_DEFAULT_RX_SENSITIVITY__6M_dBm,
+            PHY802_11b_DEFAULT_RX_SENSITIVITY_11M_dBm };
+        return rxSensitivity_dBm[dataRateType];
+    }
+};
+
+template <class Traits>
+struct Phy802_11Core {
+    static int NumDataRates() {
+        return Traits::NUM_DATA_RATES;
+    }
+
+    static int DataRate(int dataRateType) {
+        return Traits::DataRate(dataRateType);
+    }
+
+    //
+    // Air time of a size byte frame, PLCP preamble and header included.
+    // Integer ceiling, so no floating point on the per-frame path.
+    //
+    static clocktype FrameDuration(int dataRateType, int size) {
+        const int scaledBits =
+            (size * 8 + Traits::SERVICE_AND_TAIL_BITS) *
+            Traits::BITS_PER_SYMBOL_SCALE;
+        const int scaledBitsPerSymbol =
+            Traits::ScaledDataBitsPerSymbol(dataRateType);
+        const int numSymbols =
+            (scaledBits + scaledBitsPerSymbol - 1) / scaledBitsPerSymbol;
+
+        return Traits::SynchronizationTime() +
+               numSymbols * Traits::SymbolDuration();
+    }
+
+    //
+    // Number of bits of a frame at dataRateType that fit in duration.
+    //
+    static double NumBits(int dataRateType, clocktype duration) {
+        return (double)duration *
+               (double)Traits::DataRate(dataRateType) / (double)SECOND;
+    }
+
+    //
+    // Load the variant defaults into the configurable part of a PHY
+    // structure, before the user configuration is read over them.
+    //
+    template <class PhyType>
+    static void InitializeDefaultRates(PhyType* phy) {
+        int i;
+
+        phy->numDataRates = Traits::NUM_DATA_RATES;
+
+        for (i = 0; i < Traits::NUM_DATA_RATES; i++) {
+            phy->txDefaultPower_dBm[i] =
+                (float)Traits::DefaultTxPower_dBm(i);
+            phy->rxSensitivity_mW[i] =
+                NON_DB(Traits::DefaultRxSensitivity_dBm(i));
+        }
+
+        phy->lowestDataRateType = Traits::LOWEST_DATA_RATE_TYPE;
+        phy->highestDataRateType = Traits::HIGHEST_DATA_RATE_TYPE;
+        phy->txDataRateTypeForBC = Traits::DATA_RATE_TYPE_FOR_BC;
+    }
+};
+
+typedef Phy802_11Core<Phy802_11aTraits> Phy802_11aCore;
+typedef Phy802_11Core<Phy802_11bTraits> Phy802_11bCore;
+
+#endif /* PHY_802_11_CORE_H */
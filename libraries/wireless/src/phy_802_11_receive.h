@@ -0,0 +1,613 @@
+// Copyright (c) 2001-2009, Scalable Network Technologies, Inc.  All Rights Reserved.
+//                          6100 Center Drive
+//                          Suite 1250
+//                          Los Angeles, CA 90045
+//                          sales@scalable-networks.com
+//
+// This source code is licensed, not sold, and is subject to a written
+// license agreement.  Among other things, no portion of this source
+// code may be copied, transmitted, disclosed, displayed, distributed,
+// translated, used as the basis for a derivative work, or used, in
+// whole or in part, for any program or purpose other than its intended
+// use in compliance with the license agreement as part of the QualNet
+// software.  This source code and certain of the algorithms contained
+// within it are confidential trade secrets of Scalable Network
+// Technologies, Inc. and may not be used as the basis for any other
+// software, hardware, product or service.
+
+/*
+ * Receive path shared by the 802.11 style PHY models: signal arrival and
+ * end, carrier sensing, the packet error check and the PHY state changes
+ * that go with them.
+ *
+ * Phy802_11Receiver is parameterized by a model struct that names the
+ * PHY structure and supplies the few model specific steps. The functions
+ * that depend on the rate set also take the variant traits of
+ * phy_802_11_core.h as a template argument, so the data rate and noise
+ * bandwidth lookups are folded in at compile time. The PHY structure must
+ * have the receive fields common to PhyData802_11 and PhyDataChanSwitch.
+ *
+ * A model struct provides:
+ *   PhyType                 the PHY structure
+ *   PlcpHeader              the PLCP header type
+ *   ABORT_TX_ON_ARRIVAL     nonzero to end a transmission in progress when
+ *                           a signal arrives, zero to assert there is none
+ *   TraceProtocol()         trace protocol of the PLCP header
+ *   IsRetuning(node, phyIndex)
+ *                           TRUE while the radio cannot lock on a signal
+ *   SignalLostToRetune(phy) a receivable signal arrived while retuning
+ *   FrameReceived(phy)      a frame is being passed up to the MAC
+ */
+
+#ifndef PHY_802_11_RECEIVE_H
+#define PHY_802_11_RECEIVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "api.h"
+#include "antenna.h"
+#include "phy_802_11_core.h"
+#include "util_dbconv.h"
+
+#define PHY802_11_RECEIVE_DEBUG 0
+
+template <class Model>
+struct Phy802_11Receiver {
+    typedef typename Model::PhyType PhyType;
+    typedef typename Model::PlcpHeader PlcpHeader;
+
+    static PhyType* GetPhy(Node* node, int phyIndex) {
+        return (PhyType*)node->phyData[phyIndex]->phyVar;
+    }
+
+    static void ChangeState(
+        Node* node,
+        int phyIndex,
+        PhyStatusType newStatus)
+    {
+        PhyType* phy = GetPhy(node, phyIndex);
+
+        phy->previousMode = phy->mode;
+        phy->mode = newStatus;
+
+        Phy_ReportStatusToEnergyModel(
+            node,
+            phyIndex,
+            phy->previousMode,
+            newStatus);
+    }
+
+    static void ReportExtendedStatusToMac(
+        Node* node,
+        int phyIndex,
+        PhyStatusType status,
+        clocktype receiveDuration,
+        Message* potentialIncomingPacket)
+    {
+        PhyData* thisPhy = node->phyData[phyIndex];
+        PhyType* phy = GetPhy(node, phyIndex);
+
+        assert(status == phy->mode);
+
+        if (potentialIncomingPacket != NULL) {
+            MESSAGE_RemoveHeader(
+                node,
+                potentialIncomingPacket,
+                sizeof(PlcpHeader),
+                Model::TraceProtocol());
+        }
+
+        MAC_ReceivePhyStatusChangeNotification(
+            node, thisPhy->macInterfaceIndex,
+            phy->previousMode, status,
+            receiveDuration, potentialIncomingPacket);
+
+        if (potentialIncomingPacket != NULL) {
+            MESSAGE_AddHeader(
+                node,
+                potentialIncomingPacket,
+                sizeof(PlcpHeader),
+                Model::TraceProtocol());
+        }
+    }
+
+    static void ReportStatusToMac(
+        Node* node,
+        int phyIndex,
+        PhyStatusType status)
+    {
+        ReportExtendedStatusToMac(node, phyIndex, status, 0, NULL);
+    }
+
+    static void LockSignal(
+        Node* node,
+        PhyType* phy,
+        Message* msg,
+        double rxPower_mW,
+        clocktype rxEndTime,
+        Orientation rxDOA)
+    {
+        PlcpHeader plcp;
+
+        memcpy(&plcp, MESSAGE_ReturnPacket(msg), sizeof(PlcpHeader));
+        phy->rxDataRateType = plcp.rate;
+        phy->rxMsgIsAggregate = plcp.isAggregate;
+        phy->rxMinSinr = DBL_MAX;
+
+        if (PHY802_11_RECEIVE_DEBUG) {
+            char currTime[MAX_STRING_LENGTH];
+            TIME_PrintClockInSecond(getSimTime(node), currTime);
+            printf("\ntime %s: LockSignal from %d at %d\n",
+                   currTime,
+                   msg->originatingNodeId,
+                   node->nodeId);
+        }
+
+        phy->rxMsg = msg;
+        phy->rxMsgError = FALSE;
+        phy->rxMsgPower_mW = rxPower_mW;
+        phy->rxTimeEvaluated = getSimTime(node);
+        phy->rxEndTime = rxEndTime;
+        phy->rxDOA = rxDOA;
+        phy->stats.totalSignalsLocked++;
+    }
+
+    static void UnlockSignal(PhyType* phy) {
+        phy->rxMsg = NULL;
+        phy->rxMsgError = FALSE;
+        phy->rxMsgIsAggregate = FALSE;
+        phy->rxMsgPower_mW = 0.0;
+        phy->rxTimeEvaluated = 0;
+        phy->rxEndTime = 0;
+        phy->rxDOA.azimuth = 0;
+        phy->rxDOA.elevation = 0;
+    }
+
+    //
+    // The directional threshold is derived from the configuration once at
+    // init, so sensing costs one comparison in either antenna mode.
+    //
+    static BOOL CarrierSensing(Node* node, PhyType* phy) {
+        double rxSensitivity_mW = phy->rxSensitivity_mW[0];
+
+        if (!ANTENNA_IsInOmnidirectionalMode(node,
+                                             phy->thisPhy->phyIndex))
+        {
+            rxSensitivity_mW = phy->directionalRxSensitivity_mW;
+        }
+
+        return (phy->interferencePower_mW + phy->noisePower_mW) >
+               rxSensitivity_mW;
+    }
+
+    //
+    // Derive directionalRxSensitivity_mW, after rxSensitivity_mW and
+    // directionalAntennaGain_dB are configured.
+    //
+    static void SetDirectionalSensitivity(PhyType* phy) {
+        phy->directionalRxSensitivity_mW =
+            NON_DB(IN_DB(phy->rxSensitivity_mW[0]) +
+                   phy->directionalAntennaGain_dB);
+    }
+
+    template <class Traits>
+    static BOOL CheckRxPacketError(
+        Node* node,
+        PhyType* phy,
+        double* sinrPtr)
+    {
+        double sinr;
+        double BER;
+        double noise = phy->thisPhy->noise_mW_hz * phy->channelBandwidth *
+                       Traits::NoiseFactor(phy->rxDataRateType);
+
+        assert(phy->rxMsgError == FALSE);
+
+        sinr = (phy->rxMsgPower_mW / (phy->interferencePower_mW + noise));
+
+        if (sinrPtr != NULL) {
+            *sinrPtr = sinr;
+        }
+
+        // The subframes of an aggregate are checked one by one in the MAC,
+        // against the worst SINR of the whole reception.
+        if (phy->rxMsgIsAggregate) {
+            phy->rxMinSinr = MIN(phy->rxMinSinr, sinr);
+            return FALSE;
+        }
+
+        assert(phy->rxDataRateType >= 0 &&
+               phy->rxDataRateType < Traits::NUM_DATA_RATES);
+
+        BER = PHY_BER(phy->thisPhy, phy->rxDataRateType, sinr);
+
+        if (BER != 0.0) {
+            double numBits = Phy802_11Core<Traits>::NumBits(
+                phy->rxDataRateType,
+                getSimTime(node) - phy->rxTimeEvaluated);
+
+            double errorProbability = 1.0 - pow((1.0 - BER), numBits);
+            double rand = RANDOM_erand(phy->thisPhy->seed);
+
+            assert((errorProbability >= 0.0) && (errorProbability <= 1.0));
+
+            if (errorProbability > rand) {
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    static void TerminateCurrentTransmission(Node* node, int phyIndex) {
+        PhyData* thisPhy = node->phyData[phyIndex];
+        PhyType* phy = GetPhy(node, phyIndex);
+
+        //GuiStart
+        if (node->guiOption == TRUE) {
+            GUI_EndBroadcast(node->nodeId,
+                             GUI_PHY_LAYER,
+                             GUI_DEFAULT_DATA_TYPE,
+                             thisPhy->macInterfaceIndex,
+                             getSimTime(node));
+        }
+        //GuiEnd
+        assert(phy->mode == PHY_TRANSMITTING);
+
+        // Cancel the timer end message so that the model's
+        // TransmissionEnd is not called.
+        if (phy->txEndTimer) {
+            MESSAGE_CancelSelfMsg(node, phy->txEndTimer);
+            phy->txEndTimer = NULL;
+        }
+    }
+
+    template <class Traits>
+    static void SignalArrivalFromChannel(
+        Node* node,
+        int phyIndex,
+        int channelIndex,
+        PropRxInfo* propRxInfo)
+    {
+        PhyType* phy = GetPhy(node, phyIndex);
+
+        if (Model::ABORT_TX_ON_ARRIVAL && phy->mode == PHY_TRANSMITTING) {
+            TerminateCurrentTransmission(node, phyIndex);
+            ChangeState(node, phyIndex, PHY_IDLE);
+
+            if (phy->previousMode != phy->mode) {
+                ReportStatusToMac(node, phyIndex, phy->mode);
+            }
+        }
+        assert(phy->mode != PHY_TRANSMITTING);
+
+        if (PHY802_11_RECEIVE_DEBUG) {
+            char currTime[MAX_STRING_LENGTH];
+            TIME_PrintClockInSecond(getSimTime(node), currTime);
+            printf("\ntime %s: SignalArrival from %d at %d\n",
+                   currTime,
+                   propRxInfo->txMsg->originatingNodeId,
+                   node->nodeId);
+        }
+
+        switch (phy->mode) {
+            case PHY_RECEIVING: {
+                double rxPower_mW =
+                    DBCONV_NonDb(ANTENNA_GainForThisSignal(node, phyIndex,
+                                                           propRxInfo) +
+                                 propRxInfo->rxPower_dBm);
+
+                if (!phy->rxMsgError) {
+                    phy->rxMsgError =
+                        CheckRxPacketError<Traits>(node, phy, NULL);
+                }
+
+                phy->rxTimeEvaluated = getSimTime(node);
+                phy->interferencePower_mW += rxPower_mW;
+
+                break;
+            }
+
+            //
+            // If the phy is idle or sensing,
+            // check if it can receive this signal.
+            //
+            case PHY_IDLE:
+            case PHY_SENSING:
+            {
+                double rxInterferencePower_mW = DBCONV_NonDb(
+                    ANTENNA_GainForThisSignal(node, phyIndex, propRxInfo) +
+                    propRxInfo->rxPower_dBm);
+
+                double rxPowerInOmni_mW = DBCONV_NonDb(
+                    ANTENNA_DefaultGainForThisSignal(node, phyIndex,
+                                                     propRxInfo) +
+                    propRxInfo->rxPower_dBm);
+
+                BOOL receivable =
+                    rxPowerInOmni_mW >= phy->rxSensitivity_mW[0];
+
+                if (receivable && Model::IsRetuning(node, phyIndex)) {
+                    Model::SignalLostToRetune(phy);
+                    receivable = FALSE;
+                }
+
+                if (receivable) {
+                    PropTxInfo* propTxInfo =
+                        (PropTxInfo*)MESSAGE_ReturnInfo(propRxInfo->txMsg);
+                    clocktype txDuration = propTxInfo->duration;
+                    double rxPower_mW;
+
+                    if (!ANTENNA_IsLocked(node, phyIndex)) {
+                        ANTENNA_SetToBestGainConfigurationForThisSignal(
+                            node, phyIndex, propRxInfo);
+
+                        PHY_SignalInterference(
+                            node,
+                            phyIndex,
+                            channelIndex,
+                            propRxInfo->txMsg,
+                            &rxPower_mW,
+                            &(phy->interferencePower_mW));
+                    }
+                    else {
+                        // Listen to this signal, taken care of in SignalEnd
+                        rxPower_mW = rxInterferencePower_mW;
+                    }
+
+                    LockSignal(
+                        node,
+                        phy,
+                        propRxInfo->txMsg,
+                        rxPower_mW,
+                        (propRxInfo->rxStartTime + propRxInfo->duration),
+                        propRxInfo->rxDOA);
+                    ChangeState(node, phyIndex, PHY_RECEIVING);
+                    ReportExtendedStatusToMac(
+                        node,
+                        phyIndex,
+                        PHY_RECEIVING,
+                        txDuration,
+                        propRxInfo->txMsg);
+                }
+                else {
+                    //
+                    // Otherwise, check if the signal changes the phy status
+                    //
+                    PhyStatusType newMode;
+
+                    phy->interferencePower_mW += rxInterferencePower_mW;
+
+                    if (CarrierSensing(node, phy)) {
+                        newMode = PHY_SENSING;
+                    } else {
+                        newMode = PHY_IDLE;
+                    }
+
+                    if (newMode != phy->mode) {
+                        ChangeState(node, phyIndex, newMode);
+                        ReportStatusToMac(node, phyIndex, newMode);
+                    }
+                }
+
+                break;
+            }
+
+            default:
+                abort();
+        }
+    }
+
+    template <class Traits>
+    static void TerminateCurrentReceive(
+        Node* node,
+        int phyIndex,
+        const BOOL terminateOnlyOnReceiveError,
+        BOOL* frameError,
+        clocktype* endSignalTime)
+    {
+        PhyData* thisPhy = node->phyData[phyIndex];
+        PhyType* phy = GetPhy(node, phyIndex);
+
+        *endSignalTime = phy->rxEndTime;
+
+        if (!phy->rxMsgError) {
+            phy->rxMsgError = CheckRxPacketError<Traits>(node, phy, NULL);
+        }
+
+        *frameError = phy->rxMsgError;
+
+        if ((terminateOnlyOnReceiveError) && (!phy->rxMsgError)) {
+            return;
+        }
+
+        if (thisPhy->antennaData->antennaModelType ==
+            ANTENNA_OMNIDIRECTIONAL)
+        {
+            phy->interferencePower_mW += phy->rxMsgPower_mW;
+        }
+        else {
+            int channelIndex;
+            PHY_GetTransmissionChannel(node, phyIndex, &channelIndex);
+
+            ERROR_Assert(((thisPhy->antennaData->antennaModelType
+                        == ANTENNA_SWITCHED_BEAM) ||
+                   (thisPhy->antennaData->antennaModelType
+                        == ANTENNA_STEERABLE) ||
+                   (thisPhy->antennaData->antennaModelType
+                        == ANTENNA_PATTERNED)) ,
+                    "Illegal antennaModelType");
+
+            if (!ANTENNA_IsLocked(node, phyIndex)) {
+                ANTENNA_SetToDefaultMode(node, phyIndex);
+            }
+
+            PHY_SignalInterference(
+                node,
+                phyIndex,
+                channelIndex,
+                NULL,
+                NULL,
+                &(phy->interferencePower_mW));
+        }
+
+        UnlockSignal(phy);
+        if (CarrierSensing(node, phy)) {
+            ChangeState(node, phyIndex, PHY_SENSING);
+        } else {
+            ChangeState(node, phyIndex, PHY_IDLE);
+        }
+    }
+
+    template <class Traits>
+    static void SignalEndFromChannel(
+        Node* node,
+        int phyIndex,
+        int channelIndex,
+        PropRxInfo* propRxInfo)
+    {
+        PhyData* thisPhy = node->phyData[phyIndex];
+        PhyType* phy = GetPhy(node, phyIndex);
+        double sinr = -1.0;
+        BOOL receiveErrorOccurred = FALSE;
+
+        if (PHY802_11_RECEIVE_DEBUG) {
+            char currTime[MAX_STRING_LENGTH];
+            TIME_PrintClockInSecond(getSimTime(node), currTime);
+            printf("\ntime %s: SignalEnd from %d at %d\n",
+                   currTime,
+                   propRxInfo->txMsg->originatingNodeId,
+                   node->nodeId);
+        }
+        assert(phy->mode != PHY_TRANSMITTING);
+
+        if (phy->mode == PHY_RECEIVING) {
+            if (phy->rxMsgError == FALSE) {
+                phy->rxMsgError =
+                    CheckRxPacketError<Traits>(node, phy, &sinr);
+                phy->rxTimeEvaluated = getSimTime(node);
+            }
+        }
+
+        receiveErrorOccurred = phy->rxMsgError;
+
+        //
+        // If the phy is still receiving this signal, forward the frame
+        // to the MAC layer.
+        //
+        if ((phy->mode == PHY_RECEIVING) &&
+            (phy->rxMsg == propRxInfo->txMsg))
+        {
+            Message* newMsg;
+
+            if (!ANTENNA_IsLocked(node, phyIndex)) {
+                ANTENNA_SetToDefaultMode(node, phyIndex);
+                //GuiStart
+                if (node->guiOption) {
+                    GUI_SetPatternIndex(node,
+                                        thisPhy->macInterfaceIndex,
+                                        ANTENNA_OMNIDIRECTIONAL_PATTERN,
+                                        getSimTime(node));
+                }
+                //GuiEnd
+                PHY_SignalInterference(
+                    node,
+                    phyIndex,
+                    channelIndex,
+                    NULL,
+                    NULL,
+                    &(phy->interferencePower_mW));
+            }
+
+            //Perform Signal measurement
+            PhySignalMeasurement sigMeasure;
+            sigMeasure.rxBeginTime = propRxInfo->rxStartTime;
+
+            double noise = thisPhy->noise_mW_hz * phy->channelBandwidth *
+                           Traits::NoiseFactor(phy->rxDataRateType);
+
+            sigMeasure.rss = DBCONV_InDb(phy->rxMsgPower_mW);
+            sigMeasure.snr = DBCONV_InDb(phy->rxMsgPower_mW / noise);
+            sigMeasure.cinr = DBCONV_InDb(phy->rxMsgPower_mW /
+                                          (phy->interferencePower_mW +
+                                           noise));
+            if (phy->rxMsgIsAggregate) {
+                sigMeasure.cinr = DBCONV_InDb(phy->rxMinSinr);
+            }
+
+            Model::FrameReceived(phy);
+
+            UnlockSignal(phy);
+
+            if (CarrierSensing(node, phy) == TRUE) {
+                ChangeState(node, phyIndex, PHY_SENSING);
+            }
+            else {
+                ChangeState(node, phyIndex, PHY_IDLE);
+            }
+
+            if (!receiveErrorOccurred) {
+                newMsg = MESSAGE_Duplicate(node, propRxInfo->txMsg);
+
+                MESSAGE_RemoveHeader(
+                    node, newMsg, sizeof(PlcpHeader),
+                    Model::TraceProtocol());
+
+                PhySignalMeasurement* signalMeaInfo;
+                MESSAGE_InfoAlloc(node,
+                                  newMsg,
+                                  sizeof(PhySignalMeasurement));
+                signalMeaInfo = (PhySignalMeasurement*)
+                                MESSAGE_ReturnInfo(newMsg);
+                memcpy(signalMeaInfo, &sigMeasure,
+                       sizeof(PhySignalMeasurement));
+
+                MESSAGE_SetInstanceId(newMsg, (short) phyIndex);
+                MAC_ReceivePacketFromPhy(
+                    node,
+                    node->phyData[phyIndex]->macInterfaceIndex,
+                    newMsg);
+
+                phy->stats.totalRxSignalsToMac++;
+            }
+            else {
+                ReportStatusToMac(node, phyIndex, phy->mode);
+
+                phy->stats.totalSignalsWithErrors++;
+            }
+        }
+        else {
+            PhyStatusType newMode;
+
+            double rxPower_mW =
+                DBCONV_NonDb(ANTENNA_GainForThisSignal(node, phyIndex,
+                                                       propRxInfo) +
+                             propRxInfo->rxPower_dBm);
+
+            phy->interferencePower_mW -= rxPower_mW;
+
+            if (phy->interferencePower_mW < 0.0) {
+                phy->interferencePower_mW = 0.0;
+            }
+
+            if (phy->mode != PHY_RECEIVING) {
+                if (CarrierSensing(node, phy) == TRUE) {
+                    newMode = PHY_SENSING;
+                } else {
+                    newMode = PHY_IDLE;
+                }
+
+                if (newMode != phy->mode) {
+                    ChangeState(node, phyIndex, newMode);
+                    ReportStatusToMac(node, phyIndex, newMode);
+                }
+            }
+        }
+    }
+};
+
+#endif /* PHY_802_11_RECEIVE_H */
@@ -6123,6 +6123,9 @@ void MAC_ProcessDisableInterface(Node* node,
             forwardTable->row[i].interfaceIsEnabled = FALSE;
         }
     }
+
+    // Cached routes may go through the disabled entries.
+    forwardTable->generation++;
 }
 
 
@@ -6203,6 +6206,9 @@ void MAC_ProcessEnableInterface(Node*    node,
         }
     }
 
+    // Cached lookups may have missed the re-enabled entries.
+    forwardTable->generation++;
+
 #ifdef ENTERPRISE_LIB
     if (MAC_IsASwitch(node))
     {